@@ -329,7 +329,13 @@ const struct ppm_event_info g_event_info[PPM_EVENT_MAX] = {
 	/* PPME_SYSCALL_CHMOD_E */{"chmod", EC_FILE, EF_NONE, 0},
 	/* PPME_SYSCALL_CHMOD_X */{"chmod", EC_FILE, EF_NONE, 3, {{"res", PT_ERRNO, PF_DEC}, {"filename", PT_FSPATH, PF_NA}, {"mode", PT_MODE, PF_OCT, chmod_mode} } },
 	/* PPME_SYSCALL_FCHMOD_E */{"fchmod", EC_FILE, EF_NONE, 0},
-	/* PPME_SYSCALL_FCHMOD_X */{"fchmod", EC_FILE, EF_NONE, 3, {{"res", PT_ERRNO, PF_DEC}, {"fd", PT_FD, PF_DEC}, {"mode", PT_MODE, PF_OCT, chmod_mode} } }
+	/* PPME_SYSCALL_FCHMOD_X */{"fchmod", EC_FILE, EF_NONE, 3, {{"res", PT_ERRNO, PF_DEC}, {"fd", PT_FD, PF_DEC}, {"mode", PT_MODE, PF_OCT, chmod_mode} } },
+	/* PPME_CONTAINER_BIN_E */{"container", EC_PROCESS, EF_MODIFIES_STATE, 1, {{"info", PT_BYTEBUF, PF_NA} } },
+	/* PPME_CONTAINER_BIN_X */{"container", EC_PROCESS, EF_UNUSED, 0},
+	/* PPME_USER_ADDED_E */{"useradded", EC_INTERNAL, EF_SKIPPARSERESET | EF_MODIFIES_STATE, 5, {{"uid", PT_UINT32, PF_DEC}, {"gid", PT_UINT32, PF_DEC}, {"name", PT_CHARBUF, PF_NA}, {"home", PT_CHARBUF, PF_NA}, {"shell", PT_CHARBUF, PF_NA} } },
+	/* PPME_USER_ADDED_X */{"useradded", EC_INTERNAL, EF_UNUSED, 0},
+	/* PPME_GROUP_ADDED_E */{"groupadded", EC_INTERNAL, EF_SKIPPARSERESET | EF_MODIFIES_STATE, 2, {{"gid", PT_UINT32, PF_DEC}, {"name", PT_CHARBUF, PF_NA} } },
+	/* PPME_GROUP_ADDED_X */{"groupadded", EC_INTERNAL, EF_UNUSED, 0}
 
 	/* NB: Starting from scap version 1.2, event types will no longer be changed when an event is modified, and the only kind of change permitted for pre-existent events is adding parameters.
 	 *     New event types are allowed only for new syscalls or new internal events.
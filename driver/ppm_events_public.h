@@ -946,7 +946,13 @@ enum ppm_event_type {
 	PPME_SYSCALL_CHMOD_X = 315,
 	PPME_SYSCALL_FCHMOD_E = 316,
 	PPME_SYSCALL_FCHMOD_X = 317,
-	PPM_EVENT_MAX = 318
+	PPME_CONTAINER_BIN_E = 318,
+	PPME_CONTAINER_BIN_X = 319,
+	PPME_USER_ADDED_E = 320,
+	PPME_USER_ADDED_X = 321,
+	PPME_GROUP_ADDED_E = 322,
+	PPME_GROUP_ADDED_X = 323,
+	PPM_EVENT_MAX = 324
 };
 /*@}*/
 
@@ -0,0 +1,134 @@
+#!/bin/bash
+#
+# Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+#
+# This file is part of sysdig .
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+#
+# This script checks that running chisels with --parallel over a set of trace
+# files gives the same results as processing the files sequentially.
+#
+# Every file is parsed starting from the state (processes and fds) stored in
+# it, both in the sequential and in the parallel case. The state dependent
+# fields used below (fd.name, proc.name) make sure that the workers rebuild
+# the state at the file boundaries exactly like a sequential run does.
+#
+# A single file rewritten with --checkpoint-interval is also checked: it
+# must read the same as the original, and --parallel splits it at the
+# checkpoints.
+#
+# Arguments:
+#  - sysdig path
+#  - sysdig chisels directory
+#  - traces directory
+#
+set -eu
+
+SYSDIG=$1
+SYSDIG_CHISEL_DIR=$2
+TRACESDIR=$3
+
+export SYSDIG_CHISEL_DIR
+
+READARGS=""
+for f in $TRACESDIR/*
+do
+	READARGS="$READARGS -r $f"
+done
+
+ret=0
+
+#
+# A sequential run prints the (cumulative) table after every file, the last
+# one is the result for the whole set of files.
+#
+last_table()
+{
+	awk '/^-+$/ { table = "" ; next } { table = table $0 "\n" } END { printf "%s", table }' | sort
+}
+
+check_table()
+{
+	local keys=$1
+	local value=$2
+
+	# No top limit, so that ties at the bottom of the table don't matter
+	local chisel="-ctable_generator \"$keys $keys $value $value '' 100000000 none\""
+
+	TZ=UTC eval $SYSDIG $READARGS $chisel | last_table > $TMPDIR/sequential
+
+	for n in 2 4
+	do
+		TZ=UTC eval $SYSDIG --parallel=$n $READARGS $chisel | last_table > $TMPDIR/parallel
+		if ! diff $TMPDIR/sequential $TMPDIR/parallel; then
+			echo "Table $keys/$value differs with --parallel=$n"
+			ret=1
+		fi
+	done
+}
+
+#
+# Chisels that can't merge their results must fall back to a sequential run
+#
+check_fallback()
+{
+	local chisel=$1
+
+	TZ=UTC eval $SYSDIG $READARGS $chisel > $TMPDIR/sequential
+	TZ=UTC eval $SYSDIG --parallel=4 $READARGS $chisel > $TMPDIR/parallel 2> /dev/null
+	if ! diff $TMPDIR/sequential $TMPDIR/parallel; then
+		echo "Chisel $chisel differs with --parallel=4"
+		ret=1
+	fi
+}
+
+#
+# Split a single file at its checkpoints. Only the keys that don't depend on
+# the enter event of a system call are compared, since the calls that
+# straddle a checkpoint lose it.
+#
+check_checkpoints()
+{
+	local trace=$(ls $TRACESDIR/* | head -n 1)
+	local chisel="-ctable_generator \"proc.name proc.name evt.count evt.count '' 100000000 none\""
+
+	$SYSDIG -r $trace -w $TMPDIR/checkpoints.scap --checkpoint-interval=1
+
+	TZ=UTC $SYSDIG -r $trace > $TMPDIR/sequential
+	TZ=UTC $SYSDIG -r $TMPDIR/checkpoints.scap > $TMPDIR/checkpoints
+	if ! diff -q $TMPDIR/sequential $TMPDIR/checkpoints; then
+		echo "Checkpoints change the events read from $trace"
+		ret=1
+	fi
+
+	TZ=UTC eval $SYSDIG -r $TMPDIR/checkpoints.scap $chisel | last_table > $TMPDIR/sequential
+	TZ=UTC eval $SYSDIG --parallel=4 -r $TMPDIR/checkpoints.scap $chisel | last_table > $TMPDIR/parallel
+	if ! diff $TMPDIR/sequential $TMPDIR/parallel; then
+		echo "Table proc.name/evt.count differs when splitting at the checkpoints"
+		ret=1
+	fi
+}
+
+TMPDIR=$(mktemp -d)
+
+check_table fd.name evt.rawarg.res
+check_table proc.name evt.count
+check_table fd.name,proc.name evt.latency
+check_fallback -ctopprocs_cpu
+check_fallback -cecho_fds
+check_checkpoints
+
+rm -rf $TMPDIR
+exit $ret
@@ -137,5 +137,8 @@ $BASEDIR/sysdig_batch_parser.sh $SYSDIG $CHISELS "-p\"*%evt.num %evt.outputtime
 $BASEDIR/sysdig_batch_parser.sh $SYSDIG $CHISELS "proc.apid=10 or proc.apid=26890" $TRACEDIR $RESULTDIR/apid-parent-loop $BASELINEDIR/apid-parent-loop || ret=1
 $BASEDIR/sysdig_batch_parser.sh $SYSDIG $CHISELS "proc.aname=foo or proc.aname=sh" $TRACEDIR $RESULTDIR/aname-parent-loop $BASELINEDIR/aname-parent-loop || ret=1
 
+# Parallel chisels
+$BASEDIR/sysdig_parallel_chisels.sh $SYSDIG $CHISELS $TRACEDIR || ret=1
+
 rm -rf "${TMPBASE}"
 exit $ret
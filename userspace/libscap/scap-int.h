@@ -79,6 +79,9 @@ typedef struct scap_device
 	uint32_t m_lastreadsize;
 	char* m_sn_next_event; // Pointer to the next event available for scap_next
 	uint32_t m_sn_len; // Number of bytes available in the buffer pointed by m_sn_next_event
+	int32_t m_node; // NUMA node of the CPU this ring belongs to, -1 if unknown
+	scap_evt* m_sn_barrier; // Unordered mode: next barrier event in the buffer, NULL if none
+	uint64_t m_sn_barrier_ts; // Unordered mode: timestamp of m_sn_barrier, or (uint64_t)-1
 	union
 	{
 		// Anonymous struct with ppm stuff
@@ -116,6 +119,22 @@ struct scap
 	FILE* m_file;
 #endif
 	char* m_file_evt_buf;
+	scap_hugepages_mode m_hugepages;
+
+	// Where the consumer (the thread calling scap_next) runs
+	int32_t m_consumer_cpu;
+	int32_t m_consumer_node;
+	bool m_consumer_pinned;
+	bool m_consumer_local_alloc;
+	// NUMA node of each CPU, read from sysfs the first time it's needed
+	int32_t* m_cpu_nodes;
+	uint32_t m_ncpu_nodes;
+
+	// Unordered consumption, see scap_set_unordered()
+	bool m_unordered;
+	uint32_t m_unordered_dev;
+	uint64_t m_unordered_barrier_ts;
+	bool m_unordered_barriers[PPM_EVENT_MAX];
 	uint32_t m_last_evt_dump_flags;
 	char m_lasterr[SCAP_LASTERR_SIZE];
 
@@ -136,6 +155,12 @@ struct scap
 	bool refresh_proc_table_when_saving;
 	uint32_t m_fd_lookup_limit;
 	uint64_t m_unexpected_block_readsize;
+	// Return SCAP_EOF at the next checkpoint instead of skipping it
+	bool m_stop_at_checkpoint;
+	// The section flags block of the trace file section being read
+	uint32_t m_section_flags;
+	// Drop the events up to the next section, see scap_skip_section()
+	bool m_skip_section;
 	uint32_t m_ncpus;
 	// Abstraction layer for windows
 #ifdef CYGWING_AGENT
@@ -197,6 +222,14 @@ struct scap_ns_socket_list
 // Internal library functions
 //
 
+// NUMA node of the given CPU, -1 if unknown
+int32_t scap_get_cpu_node(scap_t* handle, int32_t cpu);
+// Record the CPU the calling thread is running on as the consumer one,
+// unless the consumer is pinned
+void scap_sample_consumer_cpu(scap_t* handle);
+// Fill the consumer placement part of the stats
+void scap_get_placement_stats(scap_t* handle, OUT scap_stats* stats);
+
 // Read the full event buffer for the given processor
 int32_t scap_readbuf(scap_t* handle, uint32_t proc, OUT char** buf, OUT uint32_t* len);
 // Read a single thread info from /proc
@@ -89,7 +89,8 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 			   void* proc_callback_context,
 			   bool import_users,
 			   const char *bpf_probe,
-			   const char **suppressed_comms)
+			   const char **suppressed_comms,
+			   scap_hugepages_mode hugepages)
 {
 	snprintf(error, SCAP_LASTERR_SIZE, "live capture not supported on %s", PLATFORM_NAME);
 	*rc = SCAP_NOT_SUPPORTED;
@@ -121,7 +122,8 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 			   void* proc_callback_context,
 			   bool import_users,
 			   const char *bpf_probe,
-			   const char **suppressed_comms)
+			   const char **suppressed_comms,
+			   scap_hugepages_mode hugepages)
 {
 	uint32_t j;
 	char filename[SCAP_MAX_PATH_SIZE];
@@ -143,6 +145,9 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 	// Preliminary initializations
 	//
 	handle->m_mode = SCAP_MODE_LIVE;
+	handle->m_hugepages = hugepages;
+	handle->m_consumer_cpu = -1;
+	handle->m_consumer_node = -1;
 
 	//
 	// While in theory we could always rely on the scap caller to properly
@@ -213,6 +218,7 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 	for(j = 0; j < ndevs; j++)
 	{
 		handle->m_devs[j].m_buffer = (char*)MAP_FAILED;
+		handle->m_devs[j].m_node = -1;
 		if(!handle->m_bpf)
 		{
 			handle->m_devs[j].m_bufinfo = (struct ppm_ring_buffer_info*)MAP_FAILED;
@@ -369,6 +375,9 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 				return NULL;
 			}
 
+			scap_advise_hugepages(handle->m_devs[j].m_buffer, len, hugepages);
+			handle->m_devs[j].m_node = scap_get_cpu_node(handle, all_scanned_devs);
+
 			//
 			// Map the ppm_ring_buffer_info that contains the buffer pointers
 			//
@@ -438,7 +447,8 @@ scap_t* scap_open_offline_int(gzFile gzfile,
 			      void* proc_callback_context,
 			      bool import_users,
 			      uint64_t start_offset,
-			      const char **suppressed_comms)
+			      const char **suppressed_comms,
+			      scap_hugepages_mode hugepages)
 {
 	scap_t* handle = NULL;
 
@@ -457,6 +467,17 @@ scap_t* scap_open_offline_int(gzFile gzfile,
 	// Preliminary initializations
 	//
 	handle->m_mode = SCAP_MODE_CAPTURE;
+	handle->m_hugepages = hugepages;
+	handle->m_consumer_cpu = -1;
+	handle->m_consumer_node = -1;
+	handle->m_consumer_pinned = false;
+	handle->m_consumer_local_alloc = false;
+	handle->m_cpu_nodes = NULL;
+	handle->m_ncpu_nodes = 0;
+	handle->m_unordered = false;
+	handle->m_stop_at_checkpoint = false;
+	handle->m_section_flags = 0;
+	handle->m_skip_section = false;
 	handle->m_proc_callback = proc_callback;
 	handle->m_proc_callback_context = proc_callback_context;
 	handle->m_devs = NULL;
@@ -479,7 +500,7 @@ scap_t* scap_open_offline_int(gzFile gzfile,
 	handle->m_suppressed_comms = NULL;
 	handle->m_suppressed_tids = NULL;
 
-	handle->m_file_evt_buf = (char*)malloc(FILE_READ_BUF_SIZE);
+	handle->m_file_evt_buf = (char*)scap_alloc_buffer(FILE_READ_BUF_SIZE, hugepages);
 	if(!handle->m_file_evt_buf)
 	{
 		snprintf(error, SCAP_LASTERR_SIZE, "error allocating the read buffer");
@@ -550,7 +571,7 @@ scap_t* scap_open_offline(const char* fname, char *error, int32_t* rc)
 		return NULL;
 	}
 
-	return scap_open_offline_int(gzfile, error, rc, NULL, NULL, true, 0, NULL);
+	return scap_open_offline_int(gzfile, error, rc, NULL, NULL, true, 0, NULL, SCAP_HUGEPAGES_NONE);
 }
 
 scap_t* scap_open_offline_fd(int fd, char *error, int32_t *rc)
@@ -563,12 +584,12 @@ scap_t* scap_open_offline_fd(int fd, char *error, int32_t *rc)
 		return NULL;
 	}
 
-	return scap_open_offline_int(gzfile, error, rc, NULL, NULL, true, 0, NULL);
+	return scap_open_offline_int(gzfile, error, rc, NULL, NULL, true, 0, NULL, SCAP_HUGEPAGES_NONE);
 }
 
 scap_t* scap_open_live(char *error, int32_t *rc)
 {
-	return scap_open_live_int(error, rc, NULL, NULL, true, NULL, NULL);
+	return scap_open_live_int(error, rc, NULL, NULL, true, NULL, NULL, SCAP_HUGEPAGES_NONE);
 }
 
 scap_t* scap_open_nodriver_int(char *error, int32_t *rc,
@@ -600,6 +621,8 @@ scap_t* scap_open_nodriver_int(char *error, int32_t *rc,
 	//
 	memset(handle, 0, sizeof(scap_t));
 	handle->m_mode = SCAP_MODE_NODRIVER;
+	handle->m_consumer_cpu = -1;
+	handle->m_consumer_node = -1;
 
 	//
 	// Extract machine information
@@ -714,7 +737,8 @@ scap_t* scap_open(scap_open_args args, char *error, int32_t *rc)
 		return scap_open_offline_int(gzfile, error, rc,
 					     args.proc_callback, args.proc_callback_context,
 					     args.import_users, args.start_offset,
-					     args.suppressed_comms);
+					     args.suppressed_comms,
+					     args.hugepages);
 	}
 	case SCAP_MODE_LIVE:
 #ifndef CYGWING_AGENT
@@ -722,7 +746,8 @@ scap_t* scap_open(scap_open_args args, char *error, int32_t *rc)
 					  args.proc_callback_context,
 					  args.import_users,
 					  args.bpf_probe,
-					  args.suppressed_comms);
+					  args.suppressed_comms,
+					  args.hugepages);
 #else
 		snprintf(error,	SCAP_LASTERR_SIZE, "scap_open: live mode currently not supported on windows. Use nodriver mode instead.");
 		*rc = SCAP_NOT_SUPPORTED;
@@ -798,9 +823,11 @@ void scap_close(scap_t* handle)
 
 	if(handle->m_file_evt_buf)
 	{
-		free(handle->m_file_evt_buf);
+		scap_free_buffer(handle->m_file_evt_buf, FILE_READ_BUF_SIZE, handle->m_hugepages);
 	}
 
+	free(handle->m_cpu_nodes);
+
 	// Free the process table
 	if(handle->m_proclist != NULL)
 	{
@@ -1161,6 +1188,211 @@ static int32_t scap_next_live(scap_t* handle, OUT scap_evt** pevent, OUT uint16_
 #endif
 }
 
+#if defined(HAS_CAPTURE) && !defined(CYGWING_AGENT)
+//
+// Find the next barrier event in the data read from a ring, see
+// scap_set_unordered()
+//
+static void find_unordered_barrier(scap_t* handle, scap_device* dev)
+{
+	char* p = dev->m_sn_next_event;
+	uint32_t len = dev->m_sn_len;
+
+	dev->m_sn_barrier = NULL;
+	dev->m_sn_barrier_ts = (uint64_t)-1;
+
+	while(len > 0)
+	{
+		scap_evt* pe;
+		uint32_t reclen;
+
+		if(handle->m_bpf)
+		{
+			struct perf_event_header* hdr = (struct perf_event_header*)p;
+
+			reclen = hdr->size;
+			pe = (hdr->type == PERF_RECORD_SAMPLE)? scap_bpf_evt_from_perf_sample(p) : NULL;
+		}
+		else
+		{
+			pe = (scap_evt*)p;
+			reclen = pe->len;
+		}
+
+		//
+		// A corrupted buffer is reported when the event is consumed
+		//
+		if(reclen == 0 || reclen > len)
+		{
+			return;
+		}
+
+		if(pe != NULL && (pe->type >= PPM_EVENT_MAX || handle->m_unordered_barriers[pe->type]))
+		{
+			dev->m_sn_barrier = pe;
+			dev->m_sn_barrier_ts = pe->ts;
+			return;
+		}
+
+		p += reclen;
+		len -= reclen;
+	}
+}
+
+static void update_unordered_barrier(scap_t* handle)
+{
+	uint32_t j;
+
+	handle->m_unordered_barrier_ts = (uint64_t)-1;
+
+	for(j = 0; j < handle->m_ndevs; j++)
+	{
+		if(handle->m_devs[j].m_sn_barrier_ts < handle->m_unordered_barrier_ts)
+		{
+			handle->m_unordered_barrier_ts = handle->m_devs[j].m_sn_barrier_ts;
+		}
+	}
+}
+
+//
+// Drain one ring at a time, as long as its events are older than the oldest
+// barrier across the rings. When no ring has such events left, the barrier
+// is the oldest event overall: it's picked in timestamp order like
+// scap_next_live() does.
+//
+static int32_t scap_next_live_unordered(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
+{
+	uint32_t ndevs = handle->m_ndevs;
+	bool pending = false;
+	int32_t res;
+	uint32_t n;
+	uint32_t j;
+
+	for(n = 0; n < ndevs; n++)
+	{
+		scap_device* dev;
+
+		j = handle->m_unordered_dev;
+		dev = &handle->m_devs[j];
+
+		if(dev->m_sn_len != 0)
+		{
+			scap_evt* pe;
+
+			if(handle->m_bpf)
+			{
+				pe = scap_bpf_evt_from_perf_sample(dev->m_sn_next_event);
+			}
+			else
+			{
+				pe = (scap_evt *) dev->m_sn_next_event;
+			}
+
+			if(pe->ts < handle->m_unordered_barrier_ts)
+			{
+				if(pe->len > dev->m_sn_len)
+				{
+					snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "scap_next buffer corruption");
+					ASSERT(false);
+					return SCAP_FAILURE;
+				}
+
+				*pevent = pe;
+				*pcpuid = j;
+
+				if(handle->m_bpf)
+				{
+					scap_bpf_advance_to_evt(handle, j, true,
+								dev->m_sn_next_event,
+								&dev->m_sn_next_event,
+								&dev->m_sn_len);
+				}
+				else
+				{
+					dev->m_sn_len -= pe->len;
+					dev->m_sn_next_event += pe->len;
+				}
+
+				return SCAP_SUCCESS;
+			}
+
+			pending = true;
+		}
+		else if(dev->m_lastreadsize > 0)
+		{
+			scap_advance_tail(handle, j);
+		}
+
+		handle->m_unordered_dev = (j + 1 < ndevs)? j + 1 : 0;
+	}
+
+	if(pending)
+	{
+		res = scap_next_live(handle, pevent, pcpuid);
+
+		if(res == SCAP_SUCCESS && *pevent == handle->m_devs[*pcpuid].m_sn_barrier)
+		{
+			find_unordered_barrier(handle, &handle->m_devs[*pcpuid]);
+			update_unordered_barrier(handle);
+		}
+
+		return res;
+	}
+
+	res = refill_read_buffers(handle);
+
+	for(j = 0; j < ndevs; j++)
+	{
+		find_unordered_barrier(handle, &handle->m_devs[j]);
+	}
+
+	update_unordered_barrier(handle);
+
+	return res;
+}
+#endif // HAS_CAPTURE
+
+int32_t scap_set_unordered(scap_t* handle, bool enable)
+{
+#if !defined(HAS_CAPTURE) || defined(CYGWING_AGENT)
+	snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "live capture not supported on %s", PLATFORM_NAME);
+	return SCAP_FAILURE;
+#else
+	uint32_t j;
+
+	if(handle->m_mode != SCAP_MODE_LIVE)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "unordered consumption is only supported for live captures");
+		return SCAP_FAILURE;
+	}
+
+	//
+	// The barriers are the events that change the thread or fd state, except
+	// the ones that just use an existing fd (e.g. sendto, recvfrom) since
+	// they are frequent and only update the fd they use
+	//
+	for(j = 0; j < PPM_EVENT_MAX; j++)
+	{
+		uint32_t flags = g_event_info[j].flags;
+
+		handle->m_unordered_barriers[j] = (flags & EF_MODIFIES_STATE) &&
+			!((flags & EF_USES_FD) && !(flags & (EF_CREATES_FD | EF_DESTROYS_FD)));
+	}
+
+	handle->m_unordered = enable;
+	handle->m_unordered_dev = 0;
+
+	for(j = 0; j < handle->m_ndevs; j++)
+	{
+		find_unordered_barrier(handle, &handle->m_devs[j]);
+	}
+
+	update_unordered_barrier(handle);
+
+	return SCAP_SUCCESS;
+#endif
+}
+
 #ifndef _WIN32
 static int32_t scap_next_nodriver(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
 {
@@ -1191,6 +1423,13 @@ int32_t scap_next(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
 		res = scap_next_offline(handle, pevent, pcpuid);
 		break;
 	case SCAP_MODE_LIVE:
+#if defined(HAS_CAPTURE) && !defined(CYGWING_AGENT)
+		if(handle->m_unordered)
+		{
+			res = scap_next_live_unordered(handle, pevent, pcpuid);
+			break;
+		}
+#endif
 		res = scap_next_live(handle, pevent, pcpuid);
 		break;
 #ifndef _WIN32
@@ -1251,6 +1490,8 @@ int32_t scap_get_stats(scap_t* handle, OUT scap_stats* stats)
 	stats->n_suppressed = handle->m_num_suppressed_evts;
 	stats->n_tids_suppressed = HASH_COUNT(handle->m_suppressed_tids);
 
+	scap_get_placement_stats(handle, stats);
+
 #if defined(HAS_CAPTURE) && !defined(CYGWING_AGENT)
 	if(handle->m_bpf)
 	{
@@ -1893,6 +2134,21 @@ uint64_t scap_get_unexpected_block_readsize(scap_t* handle)
 	return handle->m_unexpected_block_readsize;
 }
 
+void scap_set_stop_at_checkpoint(scap_t* handle, bool stop)
+{
+	handle->m_stop_at_checkpoint = stop;
+}
+
+bool scap_section_is_ordered(scap_t* handle)
+{
+	return handle->m_mode == SCAP_MODE_CAPTURE && (handle->m_section_flags & SF_EVENTS_ORDERED) != 0;
+}
+
+void scap_skip_section(scap_t* handle)
+{
+	handle->m_skip_section = true;
+}
+
 int32_t scap_enable_simpledriver_mode(scap_t* handle)
 {
 	//
@@ -2030,6 +2286,13 @@ bool scap_check_suppressed_tid(scap_t *handle, int64_t tid)
 	return (stid != NULL);
 }
 
+int32_t scap_update_suppressed_tid(scap_t* handle, const char* comm, int64_t tid)
+{
+	bool suppressed;
+
+	return scap_update_suppressed(handle, comm, tid, 0, &suppressed);
+}
+
 int32_t scap_set_fullcapture_port_range(scap_t* handle, uint16_t range_start, uint16_t range_end)
 {
 	//
@@ -81,6 +81,12 @@ struct iovec;
 //
 #define SCAP_LASTERR_SIZE 256
 
+//
+// Size of the hugepages used by scap_alloc_buffer(), and its log2
+//
+#define SCAP_HUGEPAGE_SHIFT 21
+#define SCAP_HUGEPAGE_SIZE (1 << SCAP_HUGEPAGE_SHIFT)
+
 /*!
   \brief Statistics about an in progress capture
 */
@@ -94,6 +100,12 @@ typedef struct scap_stats
 	uint64_t n_preemptions; ///< Number of preemptions.
 	uint64_t n_suppressed; ///< Number of events skipped due to the tid being in a set of suppressed tids
 	uint64_t n_tids_suppressed; ///< Number of threads currently being suppressed
+	int32_t consumer_cpu; ///< CPU the consumer is pinned to, or the one the thread calling scap_get_stats() runs on. -1 if unknown.
+	int32_t consumer_node; ///< NUMA node of consumer_cpu, -1 if unknown.
+	bool consumer_pinned; ///< true if the consumer is pinned to consumer_cpu.
+	bool consumer_local_alloc; ///< true if the consumer memory is allocated on consumer_node.
+	uint32_t n_rings_local; ///< Number of per CPU ring buffers on the consumer NUMA node.
+	uint32_t n_rings_remote; ///< Number of per CPU ring buffers on other NUMA nodes.
 }scap_stats;
 
 /*!
@@ -286,6 +298,28 @@ typedef enum {
 	SCAP_MODE_NODRIVER
 } scap_mode_t;
 
+/*!
+  \brief How the large userspace buffers (event rings, read buffers) are backed.
+*/
+typedef enum {
+	/*!
+	 * Regular pages.
+	 */
+	SCAP_HUGEPAGES_NONE = 0,
+	/*!
+	 * Transparent hugepages, requested with madvise(MADV_HUGEPAGE). Needs
+	 * /sys/kernel/mm/transparent_hugepage/enabled set to madvise or always.
+	 */
+	SCAP_HUGEPAGES_TRANSPARENT,
+	/*!
+	 * Explicit hugepages from the SCAP_HUGEPAGE_SIZE pool, reserved in
+	 * /sys/kernel/mm/hugepages/hugepages-2048kB/nr_hugepages. Falls back to
+	 * transparent hugepages when the pool is empty, or when the kernel can't
+	 * be asked for that size and it's not the default one.
+	 */
+	SCAP_HUGEPAGES_EXPLICIT
+} scap_hugepages_mode;
+
 typedef struct scap_open_args
 {
 	scap_mode_t mode;
@@ -300,8 +334,21 @@ typedef struct scap_open_args
 	                                                         // events should be returned, with a trailing NULL value.
 	                                                         // You can provide additional comm
 	                                                         // values via scap_suppress_events_comm().
+	scap_hugepages_mode hugepages; ///< How to back the ring buffer mappings and the file read buffer.
 }scap_open_args;
 
+/*!
+  \brief A state checkpoint in a trace file, see scap_write_checkpoint()
+*/
+typedef struct scap_checkpoint_info
+{
+	uint64_t offset; ///< Position of the checkpoint in the file, to be used as scap_open_args::start_offset.
+	uint64_t ts; ///< Timestamp of the last event before the checkpoint.
+	uint64_t nevts; ///< Number of events in the file before the checkpoint, as counted by a reader that skips the checkpoints.
+	uint32_t nstateevts; ///< Number of events at the end of the checkpoint that only carry state, e.g. the containers.
+	bool ordered; ///< The events of the file before the checkpoint are declared in timestamp order, see scap_section_is_ordered().
+}scap_checkpoint_info;
+
 
 //
 // The follwing stuff is byte aligned because we save it to disk.
@@ -620,6 +667,36 @@ const char* scap_getlasterr(scap_t* handle);
 */
 int32_t scap_next(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid);
 
+/*!
+  \brief Enable or disable the unordered consumption of a live capture.
+
+  By default scap_next() returns the oldest event across all the per CPU
+  ring buffers. In unordered mode it drains one ring at a time instead, which
+  is cheaper and more cache friendly, for consumers that don't depend on the
+  order of the events (e.g. counters).
+
+  The events that change the thread or fd state (clone, fork, execve,
+  procexit, the ones that create or close an fd, chdir, setuid...) are
+  barriers. The guarantees are:
+   - the events of a CPU are returned in timestamp order.
+   - a barrier is returned after all the older events and before all the
+     newer events read from the rings along with it, so the thread and fd
+     tables are updated in the same order as in ordered mode.
+   - the other events between two barriers can be returned out of order
+     across CPUs. When a thread moves to another CPU while it's inside a
+     system call, its exit event can be returned before its enter event.
+     Time deltas between events (e.g. evt.latency, evt.delta) are not
+     reliable.
+
+  \param handle Handle to the capture instance.
+  \param enable true to enable the unordered consumption.
+
+  \return SCAP_SUCCESS if the call is successful.
+   On Failure, SCAP_FAILURE is returned and scap_getlasterr() can be used to obtain
+   the cause of the error.
+*/
+int32_t scap_set_unordered(scap_t* handle, bool enable);
+
 /*!
   \brief Get the length of an event
 
@@ -760,6 +837,75 @@ int32_t scap_number_of_bytes_to_write(scap_evt *e, uint16_t cpuid, int32_t* byte
 */
 int32_t scap_dump(scap_t *handle, scap_dumper_t *d, scap_evt* e, uint16_t cpuid, uint32_t flags);
 
+/*!
+  \brief Write a state checkpoint to a trace file: a new section with the
+   machine info and the interface and user lists of the handle, that the
+   caller completes with the process and fd tables (see
+   scap_write_proclist_header() and scap_write_proc_fds()) and then
+   nstateevts events that carry state, before writing more events.
+
+  \param handle Handle to the capture instance.
+  \param d The dump handle, returned by \ref scap_dump_open
+  \param ts The timestamp of the last event written.
+  \param nevts The number of events written so far, not counting the state
+   events of the previous checkpoints.
+  \param nstateevts The number of state events that complete the checkpoint.
+   They are skipped along with the rest of the checkpoint.
+
+  \return SCAP_SUCCESS if the call is successful.
+   On Failure, SCAP_FAILURE is returned and scap_getlasterr() can be used to obtain
+   the cause of the error.
+*/
+int32_t scap_write_checkpoint(scap_t *handle, scap_dumper_t *d, uint64_t ts, uint64_t nevts, uint32_t nstateevts);
+
+/*!
+  \brief List the state checkpoints in a trace file. Only the block headers
+   are read, but compressed files still need to be decompressed.
+
+  \param fname The name of the trace file.
+  \param checkpoints Set to an array with the checkpoints in file order, to
+   be freed with free(). NULL if there are none.
+  \param ncheckpoints Set to the number of checkpoints.
+  \param error Pointer to a buffer that will contain the error string in case the
+    function fails. The buffer must have size SCAP_LASTERR_SIZE.
+
+  \return SCAP_SUCCESS if the call is successful, SCAP_FAILURE otherwise.
+*/
+int32_t scap_list_checkpoints(const char *fname, OUT scap_checkpoint_info **checkpoints, OUT uint32_t *ncheckpoints, char *error);
+
+/*!
+  \brief When reading a trace file, the checkpoints are skipped since they
+   restate the state built from the previous events. With this set,
+   scap_next() returns SCAP_EOF at the next checkpoint instead, so that
+   the chunks between checkpoints can be processed independently.
+
+  \param handle Handle to the capture instance.
+  \param stop true to stop at the next checkpoint.
+*/
+void scap_set_stop_at_checkpoint(scap_t *handle, bool stop);
+
+/*!
+  \brief Tell if the events of the trace file section being read are in
+   timestamp order, as declared by the capture that wrote them: live
+   captures without scap_set_unordered() are. The order is only as good as
+   the merge of the per-CPU buffers, so it can be off by a buffer refill.
+   Sections written from other trace files, and concatenated captures as
+   a whole, are not known to be ordered.
+
+  \param handle Handle to the capture instance.
+*/
+bool scap_section_is_ordered(scap_t *handle);
+
+/*!
+  \brief Drop the rest of the events of the trace file section being read,
+   without returning them. The checkpoints don't end the section: after
+   the last event, scap_next() returns SCAP_UNEXPECTED_BLOCK if a
+   concatenated capture follows, SCAP_EOF otherwise.
+
+  \param handle Handle to the capture instance.
+*/
+void scap_skip_section(scap_t *handle);
+
 /*!
   \brief Get the process list for the given capture instance
 
@@ -844,6 +990,25 @@ scap_addrlist* scap_get_ifaddr_list(scap_t* handle);
 */
 scap_userlist* scap_get_user_list(scap_t* handle);
 
+/*!
+  \brief Replace the machine user and group lists with a copy of the given
+  entries. The lists written to the trace files are the ones of the handle,
+  so this lets a consumer that resolves the users on its own (see the
+  import_users field of \ref scap_open_args) provide the ones it knows about
+  before calling \ref scap_dump_open or \ref scap_write_checkpoint.
+
+  \param handle Handle to the capture instance.
+  \param users The users, can be NULL if nusers is 0.
+  \param nusers Number of users.
+  \param groups The groups, can be NULL if ngroups is 0.
+  \param ngroups Number of groups.
+
+  \return SCAP_SUCCESS if the call is successful.
+   On Failure, SCAP_FAILURE is returned and scap_getlasterr() can be used to obtain
+   the cause of the error.
+*/
+int32_t scap_set_user_list(scap_t* handle, const scap_userinfo* users, uint32_t nusers, const scap_groupinfo* groups, uint32_t ngroups);
+
 /*!
   \brief Retrieve the table with the description of every event type that
   the capture driver supports.
@@ -962,6 +1127,13 @@ int32_t scap_suppress_events_comm(scap_t* handle, const char *comm);
 
 bool scap_check_suppressed_tid(scap_t *handle, int64_t tid);
 
+/*!
+  \brief Suppress the given tid if comm is one of the suppressed comms, stop
+  suppressing it otherwise. This is what the /proc scan does for every
+  thread it finds, scap_proc_get_detached() callers need to do it themselves.
+*/
+int32_t scap_update_suppressed_tid(scap_t* handle, const char* comm, int64_t tid);
+
 /*@}*/
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -986,6 +1158,15 @@ uint32_t scap_event_get_sentinel_begin(scap_evt* e);
 // The returned pointer must be freed via scap_proc_free by the caller.
 struct scap_threadinfo* scap_proc_get(scap_t* handle, int64_t tid, bool scan_sockets);
 
+// Like scap_proc_get(), but without touching the state of the handle, so that
+// it can run on a thread other than the one calling scap_next(): the fds are
+// returned in the fdlist instead of going to the proc callback, and the
+// suppressed tids are not updated (see scap_update_suppressed_tid()).
+// procdirname is the /proc directory to read, usually "<host root>/proc".
+// On failure, returns NULL and fills error.
+// The returned pointer must be freed via scap_proc_free by the caller.
+struct scap_threadinfo* scap_proc_get_detached(scap_t* handle, const char* procdirname, int64_t tid, bool scan_sockets, char* error);
+
 // Check if the given thread exists in ;proc
 bool scap_is_thread_alive(scap_t* handle, int64_t pid, int64_t tid, const char* comm);
 
@@ -1011,6 +1192,7 @@ int32_t scap_enable_page_faults(scap_t *handle);
 uint64_t scap_get_unexpected_block_readsize(scap_t* handle);
 int32_t scap_proc_add(scap_t* handle, uint64_t tid, scap_threadinfo* tinfo);
 int32_t scap_fd_add(scap_t *handle, scap_threadinfo* tinfo, uint64_t fd, scap_fdinfo* fdinfo);
+void scap_fd_free_proc_fd_table(scap_t* handle, scap_threadinfo* pi);
 scap_dumper_t *scap_memory_dump_open(scap_t *handle, uint8_t* targetbuf, uint64_t targetbufsize);
 int32_t compr(uint8_t* dest, uint64_t* destlen, const uint8_t* source, uint64_t sourcelen, int level);
 uint8_t* scap_get_memorydumper_curpos(scap_dumper_t *d);
@@ -1048,6 +1230,48 @@ int32_t scap_set_fullcapture_port_range(scap_t* handle, uint16_t range_start, ui
  */
 int32_t scap_set_statsd_port(scap_t* handle, uint16_t port);
 
+/*!
+  \brief Allocate a large buffer, backed by hugepages if requested. Hugepage
+  backed buffers are mmap()ed and rounded up to SCAP_HUGEPAGE_SIZE.
+
+  \param size The buffer size in bytes.
+  \param mode How to back the buffer.
+
+  \return The buffer, or NULL in case of failure. Free it with scap_free_buffer()
+   and the same size and mode.
+*/
+void* scap_alloc_buffer(size_t size, scap_hugepages_mode mode);
+
+/*!
+  \brief Free a buffer allocated with scap_alloc_buffer().
+*/
+void scap_free_buffer(void* buf, size_t size, scap_hugepages_mode mode);
+
+/*!
+  \brief Hint the kernel to back an existing mapping with hugepages.
+  This is best effort: mappings of driver memory are made of regular pages
+  and the kernel is free to ignore the hint.
+*/
+void scap_advise_hugepages(void* addr, size_t len, scap_hugepages_mode mode);
+
+/*!
+  \brief Set where the consumer runs. This applies to the calling thread, so
+  it must be called from the thread that calls scap_next().
+
+  \param handle Handle to the capture instance.
+  \param cpu The CPU to pin the thread to, -1 to leave the affinity untouched.
+  \param local_alloc If true, the memory that the thread allocates from now
+   on is preferably taken from the NUMA node of the CPU it's pinned to (or
+   is running on, if not pinned).
+
+  \return SCAP_SUCCESS if the call is successful.
+   On Failure, SCAP_FAILURE is returned and scap_getlasterr() can be used to obtain
+   the cause of the error.
+
+  \note The effective placement is reported by scap_get_stats().
+*/
+int32_t scap_set_consumer_placement(scap_t* handle, int32_t cpu, bool local_alloc);
+
 #ifdef __cplusplus
 }
 #endif
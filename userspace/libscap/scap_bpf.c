@@ -707,6 +707,8 @@ static void *perf_event_mmap(scap_t *handle, int fd)
 
 	ASSERT(p2 == tmp);
 
+	scap_advise_hugepages(tmp, total_size, handle->m_hugepages);
+
 	return tmp;
 }
 
@@ -1382,6 +1384,8 @@ int32_t scap_bpf_load(scap_t *handle, const char *bpf_probe)
 			return SCAP_FAILURE;
 		}
 
+		handle->m_devs[online_cpu].m_node = scap_get_cpu_node(handle, j);
+
 		++online_cpu;
 	}
 
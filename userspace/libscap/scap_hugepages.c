@@ -0,0 +1,184 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "scap.h"
+#include "scap-int.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+
+static size_t hugepage_round(size_t size)
+{
+	return (size + SCAP_HUGEPAGE_SIZE - 1) & ~((size_t)SCAP_HUGEPAGE_SIZE - 1);
+}
+
+//
+// Transparent hugepages are only used for the hugepage aligned parts of a
+// mapping, so map a bit more than needed and trim the mapping to an aligned
+// range.
+//
+static void* alloc_transparent(size_t len)
+{
+	char* map = (char*)mmap(NULL, len + SCAP_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(map == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	char* start = (char*)(((uintptr_t)map + SCAP_HUGEPAGE_SIZE - 1) & ~((uintptr_t)SCAP_HUGEPAGE_SIZE - 1));
+	if(start != map)
+	{
+		munmap(map, start - map);
+	}
+
+	if(start + len != map + len + SCAP_HUGEPAGE_SIZE)
+	{
+		munmap(start + len, map + len + SCAP_HUGEPAGE_SIZE - (start + len));
+	}
+
+	scap_advise_hugepages(start, len, SCAP_HUGEPAGES_TRANSPARENT);
+	return start;
+}
+
+#ifdef MAP_HUGETLB
+//
+// The size of the pages that MAP_HUGETLB maps when it's not given one,
+// 0 if unknown
+//
+static size_t get_default_hugepage_size()
+{
+	char filename[SCAP_MAX_PATH_SIZE];
+	char line[512];
+	size_t size_kb;
+	size_t res = 0;
+
+	snprintf(filename, sizeof(filename), "%s/proc/meminfo", scap_get_host_root());
+
+	FILE* f = fopen(filename, "r");
+	if(f == NULL)
+	{
+		return 0;
+	}
+
+	while(fgets(line, sizeof(line), f) != NULL)
+	{
+		if(sscanf(line, "Hugepagesize: %zu kB", &size_kb) == 1)
+		{
+			res = size_kb * 1024;
+			break;
+		}
+	}
+
+	fclose(f);
+	return res;
+}
+
+//
+// The users of the buffers rely on their SCAP_HUGEPAGE_SIZE alignment, and
+// munmap() wants whole pages, but the default hugepages are 1GB or 512MB
+// on some systems. Ask for the size when it's not the default one.
+//
+static void* alloc_explicit(size_t len)
+{
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+
+	if(len % SCAP_HUGEPAGE_SIZE != 0)
+	{
+		return NULL;
+	}
+
+	if(get_default_hugepage_size() != SCAP_HUGEPAGE_SIZE)
+	{
+#ifdef MAP_HUGE_SHIFT
+		flags |= SCAP_HUGEPAGE_SHIFT << MAP_HUGE_SHIFT;
+#else
+		return NULL;
+#endif
+	}
+
+	void* buf = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if(buf == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	return buf;
+}
+#endif
+#endif
+
+void* scap_alloc_buffer(size_t size, scap_hugepages_mode mode)
+{
+#if defined(__linux__)
+	if(mode != SCAP_HUGEPAGES_NONE)
+	{
+		size_t len = hugepage_round(size);
+
+#ifdef MAP_HUGETLB
+		if(mode == SCAP_HUGEPAGES_EXPLICIT)
+		{
+			void* buf = alloc_explicit(len);
+			if(buf != NULL)
+			{
+				return buf;
+			}
+		}
+#endif
+
+		return alloc_transparent(len);
+	}
+#endif
+
+	return malloc(size);
+}
+
+void scap_free_buffer(void* buf, size_t size, scap_hugepages_mode mode)
+{
+	if(buf == NULL)
+	{
+		return;
+	}
+
+#if defined(__linux__)
+	if(mode != SCAP_HUGEPAGES_NONE)
+	{
+		munmap(buf, hugepage_round(size));
+		return;
+	}
+#endif
+
+	free(buf);
+}
+
+void scap_advise_hugepages(void* addr, size_t len, scap_hugepages_mode mode)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if(mode != SCAP_HUGEPAGES_NONE)
+	{
+		//
+		// Errors are ignored on purpose: kernels without transparent
+		// hugepage support return EINVAL, and so do some driver mappings.
+		//
+		madvise(addr, len, MADV_HUGEPAGE);
+	}
+#endif
+}
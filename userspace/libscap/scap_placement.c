@@ -0,0 +1,223 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "scap.h"
+#include "scap-int.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#define MAX_NUMA_NODES 1024
+
+//
+// The node of a CPU is the nodeN entry in its sysfs directory
+//
+static int32_t scap_read_cpu_node(int32_t cpu)
+{
+	char path[SCAP_MAX_PATH_SIZE];
+	struct dirent* de;
+	int32_t node = -1;
+	DIR* dir;
+
+	if(cpu < 0)
+	{
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	dir = opendir(path);
+	if(dir == NULL)
+	{
+		return -1;
+	}
+
+	while((de = readdir(dir)) != NULL)
+	{
+		if(strncmp(de->d_name, "node", sizeof("node") - 1) == 0)
+		{
+			node = atoi(de->d_name + sizeof("node") - 1);
+			break;
+		}
+	}
+
+	closedir(dir);
+	return node;
+}
+
+//
+// Read the nodes of all the CPUs at once, the first time one is needed
+//
+static int32_t scap_init_cpu_nodes(scap_t* handle)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+	int32_t cpu;
+
+	if(ncpus <= 0)
+	{
+		return SCAP_FAILURE;
+	}
+
+	handle->m_cpu_nodes = (int32_t*)malloc(ncpus * sizeof(int32_t));
+	if(handle->m_cpu_nodes == NULL)
+	{
+		return SCAP_FAILURE;
+	}
+
+	for(cpu = 0; cpu < ncpus; cpu++)
+	{
+		handle->m_cpu_nodes[cpu] = scap_read_cpu_node(cpu);
+	}
+
+	handle->m_ncpu_nodes = (uint32_t)ncpus;
+	return SCAP_SUCCESS;
+}
+
+int32_t scap_get_cpu_node(scap_t* handle, int32_t cpu)
+{
+	if(handle->m_cpu_nodes == NULL && scap_init_cpu_nodes(handle) != SCAP_SUCCESS)
+	{
+		return -1;
+	}
+
+	if(cpu < 0 || (uint32_t)cpu >= handle->m_ncpu_nodes)
+	{
+		return -1;
+	}
+
+	return handle->m_cpu_nodes[cpu];
+}
+
+void scap_sample_consumer_cpu(scap_t* handle)
+{
+	if(!handle->m_consumer_pinned)
+	{
+		handle->m_consumer_cpu = sched_getcpu();
+		handle->m_consumer_node = scap_get_cpu_node(handle, handle->m_consumer_cpu);
+	}
+}
+
+int32_t scap_set_consumer_placement(scap_t* handle, int32_t cpu, bool local_alloc)
+{
+	if(cpu >= 0)
+	{
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if(sched_setaffinity(0, sizeof(set), &set) != 0)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "can't pin the consumer to CPU %d: %s", cpu, scap_strerror(handle, errno));
+			return SCAP_FAILURE;
+		}
+
+		handle->m_consumer_pinned = true;
+		handle->m_consumer_cpu = cpu;
+		handle->m_consumer_node = scap_get_cpu_node(handle, cpu);
+	}
+	else
+	{
+		handle->m_consumer_pinned = false;
+		handle->m_consumer_cpu = -1;
+		scap_sample_consumer_cpu(handle);
+	}
+
+	if(local_alloc && handle->m_consumer_node >= 0 && handle->m_consumer_node < MAX_NUMA_NODES)
+	{
+		//
+		// Prefer the consumer node for the memory this thread faults in
+		// from now on (the thread table, the event buffers...), even if the
+		// scheduler moves it to another node.
+		//
+		unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+
+		memset(mask, 0, sizeof(mask));
+		mask[handle->m_consumer_node / (8 * sizeof(unsigned long))] |= 1UL << (handle->m_consumer_node % (8 * sizeof(unsigned long)));
+
+		if(syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, MAX_NUMA_NODES + 1) != 0)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "can't set the memory policy to NUMA node %d: %s", handle->m_consumer_node, scap_strerror(handle, errno));
+			return SCAP_FAILURE;
+		}
+
+		handle->m_consumer_local_alloc = true;
+	}
+
+	return SCAP_SUCCESS;
+}
+
+#else // __linux__
+
+int32_t scap_get_cpu_node(scap_t* handle, int32_t cpu)
+{
+	return -1;
+}
+
+void scap_sample_consumer_cpu(scap_t* handle)
+{
+}
+
+int32_t scap_set_consumer_placement(scap_t* handle, int32_t cpu, bool local_alloc)
+{
+	snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "consumer placement not supported on %s", PLATFORM_NAME);
+	return SCAP_NOT_SUPPORTED;
+}
+
+#endif // __linux__
+
+void scap_get_placement_stats(scap_t* handle, OUT scap_stats* stats)
+{
+	uint32_t j;
+
+	scap_sample_consumer_cpu(handle);
+
+	stats->consumer_cpu = handle->m_consumer_cpu;
+	stats->consumer_node = handle->m_consumer_node;
+	stats->consumer_pinned = handle->m_consumer_pinned;
+	stats->consumer_local_alloc = handle->m_consumer_local_alloc;
+	stats->n_rings_local = 0;
+	stats->n_rings_remote = 0;
+
+	if(handle->m_mode != SCAP_MODE_LIVE || handle->m_consumer_node < 0)
+	{
+		return;
+	}
+
+	for(j = 0; j < handle->m_ndevs; j++)
+	{
+		if(handle->m_devs[j].m_node == handle->m_consumer_node)
+		{
+			stats->n_rings_local++;
+		}
+		else if(handle->m_devs[j].m_node >= 0)
+		{
+			stats->n_rings_remote++;
+		}
+	}
+}
@@ -1161,6 +1161,63 @@ struct scap_threadinfo* scap_proc_get(scap_t* handle, int64_t tid, bool scan_soc
 #endif // HAS_CAPTURE
 }
 
+struct scap_threadinfo* scap_proc_get_detached(scap_t* handle, const char* procdirname, int64_t tid, bool scan_sockets, char* error)
+{
+#if !defined(HAS_CAPTURE)
+	snprintf(error, SCAP_LASTERR_SIZE, "/proc lookups not supported on %s", PLATFORM_NAME);
+	return NULL;
+#else
+	struct scap_threadinfo* tinfo = NULL;
+	scap_t* lookup_handle;
+
+	//
+	// No /proc parsing for offline captures
+	//
+	if(handle->m_mode == SCAP_MODE_CAPTURE)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "/proc lookups not supported on offline captures");
+		return NULL;
+	}
+
+	//
+	// The /proc parsing code keeps its scratch state (error strings, the
+	// mount id cache, the suppressed tids) in the handle. Give it a private
+	// one that only shares what is read-only after the open: the device fds
+	// for the vtid/vpid ioctls and the fd limit.
+	//
+	lookup_handle = (scap_t*)calloc(1, sizeof(scap_t));
+	if(lookup_handle == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "error allocating the lookup handle");
+		return NULL;
+	}
+
+	lookup_handle->m_mode = handle->m_mode;
+	lookup_handle->m_bpf = handle->m_bpf;
+	lookup_handle->m_devs = handle->m_devs;
+	lookup_handle->m_ndevs = handle->m_ndevs;
+	lookup_handle->m_fd_lookup_limit = handle->m_fd_lookup_limit;
+
+	if(scap_proc_read_thread(lookup_handle, (char*)procdirname, tid, &tinfo, error, scan_sockets) != SCAP_SUCCESS)
+	{
+		if(tinfo != NULL)
+		{
+			scap_proc_free(lookup_handle, tinfo);
+			tinfo = NULL;
+		}
+	}
+	else if(tinfo == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "tid %" PRId64 " not found in %s", tid, procdirname);
+	}
+
+	scap_free_device_table(lookup_handle);
+	free(lookup_handle);
+
+	return tinfo;
+#endif // HAS_CAPTURE
+}
+
 bool scap_is_thread_alive(scap_t* handle, int64_t pid, int64_t tid, const char* comm)
 {
 #if !defined(HAS_CAPTURE)
@@ -781,18 +781,12 @@ static int32_t scap_write_userlist(scap_t *handle, scap_dumper_t* d)
 	return SCAP_SUCCESS;
 }
 
-//
-// Create the dump file headers and add the tables
-//
-int32_t scap_setup_dump(scap_t *handle, scap_dumper_t* d, const char *fname)
+static int32_t scap_write_section_header(scap_t *handle, scap_dumper_t* d, const char *fname)
 {
 	block_header bh;
 	section_header_block sh;
 	uint32_t bt;
 
-	//
-	// Write the section header
-	//
 	bh.block_type = SHB_BLOCK_TYPE;
 	bh.block_total_length = sizeof(block_header) + sizeof(section_header_block) + 4;
 
@@ -811,6 +805,56 @@ int32_t scap_setup_dump(scap_t *handle, scap_dumper_t* d, const char *fname)
 		return SCAP_FAILURE;
 	}
 
+	return SCAP_SUCCESS;
+}
+
+//
+// Only a live capture, which merges the per-CPU buffers, knows the order
+// of its events. The events written from a trace file are as ordered as
+// that file, which can change at a concatenated capture.
+//
+static int32_t scap_write_section_flags(scap_t *handle, scap_dumper_t* d)
+{
+	block_header bh;
+	section_flags_block sf;
+	uint32_t bt;
+
+	bh.block_type = SF_BLOCK_TYPE;
+	bh.block_total_length = sizeof(block_header) + sizeof(section_flags_block) + 4;
+
+	sf.flags = 0;
+	if(handle->m_mode == SCAP_MODE_LIVE && !handle->m_unordered)
+	{
+		sf.flags |= SF_EVENTS_ORDERED;
+	}
+
+	bt = bh.block_total_length;
+
+	if(scap_dump_write(d, &bh, sizeof(bh)) != sizeof(bh) ||
+	        scap_dump_write(d, &sf, sizeof(sf)) != sizeof(sf) ||
+	        scap_dump_write(d, &bt, sizeof(bt)) != sizeof(bt))
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing the section flags block");
+		return SCAP_FAILURE;
+	}
+
+	return SCAP_SUCCESS;
+}
+
+//
+// Create the dump file headers and add the tables
+//
+int32_t scap_setup_dump(scap_t *handle, scap_dumper_t* d, const char *fname)
+{
+	//
+	// Write the section header
+	//
+	if(scap_write_section_header(handle, d, fname) != SCAP_SUCCESS ||
+		scap_write_section_flags(handle, d) != SCAP_SUCCESS)
+	{
+		return SCAP_FAILURE;
+	}
+
 	//
 	// If we're dumping in live mode, refresh the process tables list
 	// so we don't lose information about processes created in the interval
@@ -889,6 +933,50 @@ int32_t scap_setup_dump(scap_t *handle, scap_dumper_t* d, const char *fname)
 	return SCAP_SUCCESS;
 }
 
+//
+// Start a checkpoint section. The process and fd tables are written by the
+// caller, from its own state: the ones in the handle are only up to date
+// right after a /proc scan.
+//
+int32_t scap_write_checkpoint(scap_t *handle, scap_dumper_t *d, uint64_t ts, uint64_t nevts, uint32_t nstateevts)
+{
+	block_header bh;
+	checkpoint_block cp;
+	uint32_t bt;
+
+	if(scap_write_section_header(handle, d, "") != SCAP_SUCCESS)
+	{
+		return SCAP_FAILURE;
+	}
+
+	bh.block_type = CP_BLOCK_TYPE;
+	bh.block_total_length = sizeof(block_header) + sizeof(checkpoint_block) + 4;
+
+	cp.ts = ts;
+	cp.nevts = nevts;
+	cp.nstateevts = nstateevts;
+
+	bt = bh.block_total_length;
+
+	if(scap_dump_write(d, &bh, sizeof(bh)) != sizeof(bh) ||
+	        scap_dump_write(d, &cp, sizeof(cp)) != sizeof(cp) ||
+	        scap_dump_write(d, &bt, sizeof(bt)) != sizeof(bt))
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing the checkpoint block");
+		return SCAP_FAILURE;
+	}
+
+	if(scap_write_section_flags(handle, d) != SCAP_SUCCESS ||
+		scap_write_machine_info(handle, d) != SCAP_SUCCESS ||
+		scap_write_iflist(handle, d) != SCAP_SUCCESS ||
+		scap_write_userlist(handle, d) != SCAP_SUCCESS)
+	{
+		return SCAP_FAILURE;
+	}
+
+	return SCAP_SUCCESS;
+}
+
 // fname is only used for log messages in scap_setup_dump
 static scap_dumper_t *scap_dump_open_gzfile(scap_t *handle, gzFile gzfile, const char *fname, bool skip_proc_scan)
 {
@@ -2482,6 +2570,35 @@ static int32_t scap_read_fdlist(scap_t *handle, gzFile f, uint32_t block_length,
 	return SCAP_SUCCESS;
 }
 
+//
+// Parse the section flags block. Blocks written by a later version can be
+// longer, the flags we don't know are dropped
+//
+static int32_t scap_read_section_flags(scap_t *handle, gzFile f, uint32_t block_length)
+{
+	section_flags_block sf;
+	size_t readsize;
+
+	if(block_length < sizeof(sf))
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "invalid section flags block length %u", block_length);
+		return SCAP_FAILURE;
+	}
+
+	readsize = gzread(f, &sf, sizeof(sf));
+	CHECK_READ_SIZE(readsize, sizeof(sf));
+
+	if(block_length > sizeof(sf) && gzseek(f, (long)(block_length - sizeof(sf)), SEEK_CUR) == -1)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error reading the section flags block");
+		return SCAP_FAILURE;
+	}
+
+	handle->m_section_flags = sf.flags & SF_EVENTS_ORDERED;
+
+	return SCAP_SUCCESS;
+}
+
 //
 // Parse the headers of a trace file and load the tables
 //
@@ -2500,6 +2617,9 @@ int32_t scap_read_init(scap_t *handle, gzFile f)
 	int8_t found_ul = 0;
 	int8_t found_ev = 0;
 
+	handle->m_section_flags = 0;
+	handle->m_skip_section = false;
+
 	//
 	// Read the section header block
 	//
@@ -2630,6 +2750,12 @@ int32_t scap_read_init(scap_t *handle, gzFile f)
 				return SCAP_FAILURE;
 			}
 			break;
+		case SF_BLOCK_TYPE:
+			if(scap_read_section_flags(handle, f, bh.block_total_length - sizeof(block_header) - 4) != SCAP_SUCCESS)
+			{
+				return SCAP_FAILURE;
+			}
+			break;
 		default:
 			//
 			// Unknwon block type. Skip the block.
@@ -2687,6 +2813,110 @@ int32_t scap_read_init(scap_t *handle, gzFile f)
 	return SCAP_SUCCESS;
 }
 
+static inline bool scap_is_event_block(uint32_t block_type)
+{
+	return block_type == EV_BLOCK_TYPE ||
+		block_type == EV_BLOCK_TYPE_V2 ||
+		block_type == EV_BLOCK_TYPE_INT ||
+		block_type == EVF_BLOCK_TYPE ||
+		block_type == EVF_BLOCK_TYPE_V2;
+}
+
+//
+// Called when a section header shows up in the middle of the events. A
+// checkpoint restates the state that the previous events already built,
+// so it's skipped, leaving the header of the next event block in bh.
+// Any other section is a concatenated capture: return SCAP_UNEXPECTED_BLOCK
+// with the number of bytes read since the start of the section, so that
+// the caller can reopen the file there.
+//
+static int32_t scap_skip_checkpoint(scap_t *handle, gzFile f, block_header *bh)
+{
+	section_header_block sh;
+	checkpoint_block cp;
+	uint32_t bt;
+	uint32_t toskip;
+	size_t readsize;
+
+	readsize = gzread(f, &sh, sizeof(sh));
+	CHECK_READ_SIZE(readsize, sizeof(sh));
+
+	readsize = gzread(f, &bt, sizeof(bt));
+	CHECK_READ_SIZE(readsize, sizeof(bt));
+
+	readsize = gzread(f, bh, sizeof(*bh));
+	CHECK_READ_SIZE(readsize, sizeof(*bh));
+
+	if(bh->block_type != CP_BLOCK_TYPE)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "unexpected block type %u", (uint32_t)bh->block_type);
+		handle->m_unexpected_block_readsize = 2 * sizeof(block_header) + sizeof(sh) + sizeof(bt);
+		return SCAP_UNEXPECTED_BLOCK;
+	}
+
+	if(handle->m_stop_at_checkpoint)
+	{
+		return SCAP_EOF;
+	}
+
+	if(bh->block_total_length < sizeof(block_header) + sizeof(cp) + 4)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "checkpoint block length too short %u", (uint32_t)bh->block_total_length);
+		return SCAP_FAILURE;
+	}
+
+	readsize = gzread(f, &cp, sizeof(cp));
+	CHECK_READ_SIZE(readsize, sizeof(cp));
+
+	toskip = bh->block_total_length - sizeof(block_header) - sizeof(cp);
+
+	//
+	// Skip the tables, and then the state events
+	//
+	while(true)
+	{
+		if(gzseek(f, (long)toskip, SEEK_CUR) == -1)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "corrupted input file. Can't skip block of type %x and size %u.",
+				 (int)bh->block_type,
+				 (unsigned int)bh->block_total_length);
+			return SCAP_FAILURE;
+		}
+
+		readsize = gzread(f, bh, sizeof(*bh));
+		if(readsize == 0)
+		{
+			//
+			// Checkpoint at the end of the file
+			//
+			return SCAP_EOF;
+		}
+		CHECK_READ_SIZE(readsize, sizeof(*bh));
+
+		if(bh->block_type == SHB_BLOCK_TYPE)
+		{
+			return scap_skip_checkpoint(handle, f, bh);
+		}
+		else if(scap_is_event_block(bh->block_type))
+		{
+			if(cp.nstateevts == 0)
+			{
+				return SCAP_SUCCESS;
+			}
+
+			cp.nstateevts--;
+		}
+
+		if(bh->block_total_length < sizeof(block_header) + 4)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "block length too short %u", (uint32_t)bh->block_total_length);
+			return SCAP_FAILURE;
+		}
+
+		toskip = bh->block_total_length - sizeof(block_header);
+	}
+}
+
 //
 // Read an event from disk
 //
@@ -2734,11 +2964,17 @@ int32_t scap_next_offline(scap_t *handle, OUT scap_evt **pevent, OUT uint16_t *p
 			}
 		}
 
-		if(bh.block_type != EV_BLOCK_TYPE &&
-		   bh.block_type != EV_BLOCK_TYPE_V2 &&
-		   bh.block_type != EV_BLOCK_TYPE_INT &&
-		   bh.block_type != EVF_BLOCK_TYPE &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2)
+		if(bh.block_type == SHB_BLOCK_TYPE)
+		{
+			int32_t res = scap_skip_checkpoint(handle, f, &bh);
+
+			if(res != SCAP_SUCCESS)
+			{
+				return res;
+			}
+		}
+
+		if(!scap_is_event_block(bh.block_type))
 		{
 			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "unexpected block type %u", (uint32_t)bh.block_type);
 			handle->m_unexpected_block_readsize = readsize;
@@ -2768,6 +3004,19 @@ int32_t scap_next_offline(scap_t *handle, OUT scap_evt **pevent, OUT uint16_t *p
 			return SCAP_FAILURE;
 		}
 
+		if(handle->m_skip_section)
+		{
+			//
+			// Seek over the event, in an uncompressed file it isn't even read
+			//
+			if(gzseek(f, (long)readlen, SEEK_CUR) == -1)
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error skipping an event block");
+				return SCAP_FAILURE;
+			}
+			continue;
+		}
+
 		readsize = gzread(f, handle->m_file_evt_buf, readlen);
 		CHECK_READ_SIZE(readsize, readlen);
 
@@ -2884,3 +3133,170 @@ void scap_fseek(scap_t *handle, uint64_t off)
 
 	gzseek(f, off, SEEK_SET);
 }
+
+int32_t scap_list_checkpoints(const char *fname, OUT scap_checkpoint_info **checkpoints, OUT uint32_t *ncheckpoints, char *error)
+{
+	block_header bh;
+	checkpoint_block cp;
+	uint32_t prev_type = 0;
+	uint64_t prev_offset = 0;
+	uint32_t size = 0;
+	bool pending = false;
+	uint32_t nstateevts = 0;
+	bool ordered = false;
+	bool concatenated = false;
+	char skipbuf[16384];
+	gzFile f;
+
+	*checkpoints = NULL;
+	*ncheckpoints = 0;
+
+	f = gzopen(fname, "rb");
+	if(f == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "can't open file %s", fname);
+		return SCAP_FAILURE;
+	}
+
+	//
+	// Go through the block headers, looking for the checkpoint blocks that
+	// follow a section header. A checkpoint stays pending until an event
+	// other than its state events comes after it: a chunk without events is
+	// wasted work, and opening the file where no event follows would fail.
+	//
+	while(true)
+	{
+		uint64_t offset = gztell(f);
+		uint32_t toskip;
+		int readsize = gzread(f, &bh, sizeof(bh));
+
+		if(readsize == 0)
+		{
+			break;
+		}
+
+		if(readsize != sizeof(bh) || bh.block_total_length < sizeof(bh) + 4)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "corrupted file %s at offset %" PRIu64, fname, offset);
+			goto error;
+		}
+
+		toskip = bh.block_total_length - sizeof(bh);
+
+		//
+		// A section header without a checkpoint after the first one is a
+		// capture appended to the file: from there on, the time goes back
+		//
+		if(prev_type == SHB_BLOCK_TYPE && prev_offset != 0 && bh.block_type != CP_BLOCK_TYPE)
+		{
+			concatenated = true;
+		}
+
+		if(bh.block_type == SF_BLOCK_TYPE && toskip >= sizeof(section_flags_block) + 4 &&
+		   (prev_type == SHB_BLOCK_TYPE || prev_type == CP_BLOCK_TYPE))
+		{
+			section_flags_block sf;
+
+			if(gzread(f, &sf, sizeof(sf)) != sizeof(sf))
+			{
+				snprintf(error, SCAP_LASTERR_SIZE, "corrupted file %s at offset %" PRIu64, fname, offset);
+				goto error;
+			}
+			toskip -= sizeof(sf);
+
+			if(prev_type == SHB_BLOCK_TYPE)
+			{
+				ordered = (sf.flags & SF_EVENTS_ORDERED) != 0;
+			}
+			else
+			{
+				ordered = ordered && (sf.flags & SF_EVENTS_ORDERED) != 0;
+			}
+		}
+		else if(bh.block_type == CP_BLOCK_TYPE && prev_type == SHB_BLOCK_TYPE &&
+		   toskip >= sizeof(cp) + 4)
+		{
+			if(gzread(f, &cp, sizeof(cp)) != sizeof(cp))
+			{
+				snprintf(error, SCAP_LASTERR_SIZE, "corrupted file %s at offset %" PRIu64, fname, offset);
+				goto error;
+			}
+			toskip -= sizeof(cp);
+
+			if(pending)
+			{
+				(*ncheckpoints)--;
+			}
+
+			if(*ncheckpoints == size)
+			{
+				scap_checkpoint_info *tmp;
+
+				size = size ? size * 2 : 64;
+				tmp = (scap_checkpoint_info *)realloc(*checkpoints, size * sizeof(scap_checkpoint_info));
+				if(tmp == NULL)
+				{
+					snprintf(error, SCAP_LASTERR_SIZE, "out of memory listing the checkpoints");
+					goto error;
+				}
+				*checkpoints = tmp;
+			}
+
+			(*checkpoints)[*ncheckpoints].offset = prev_offset;
+			(*checkpoints)[*ncheckpoints].ts = cp.ts;
+			(*checkpoints)[*ncheckpoints].nevts = cp.nevts;
+			(*checkpoints)[*ncheckpoints].nstateevts = cp.nstateevts;
+			(*checkpoints)[*ncheckpoints].ordered = ordered && !concatenated;
+			(*ncheckpoints)++;
+			pending = true;
+			nstateevts = cp.nstateevts;
+		}
+		else if(scap_is_event_block(bh.block_type))
+		{
+			if(nstateevts != 0)
+			{
+				nstateevts--;
+			}
+			else
+			{
+				pending = false;
+			}
+		}
+
+		//
+		// Read the small blocks instead of seeking over them: in an
+		// uncompressed file every seek throws away the zlib buffer
+		//
+		if(toskip <= sizeof(skipbuf))
+		{
+			if(gzread(f, skipbuf, toskip) != (int)toskip)
+			{
+				snprintf(error, SCAP_LASTERR_SIZE, "corrupted file %s at offset %" PRIu64, fname, offset);
+				goto error;
+			}
+		}
+		else if(gzseek(f, (long)toskip, SEEK_CUR) == -1)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "corrupted file %s at offset %" PRIu64, fname, offset);
+			goto error;
+		}
+
+		prev_type = bh.block_type;
+		prev_offset = offset;
+	}
+
+	if(pending)
+	{
+		(*ncheckpoints)--;
+	}
+
+	gzclose(f);
+	return SCAP_SUCCESS;
+
+error:
+	gzclose(f);
+	free(*checkpoints);
+	*checkpoints = NULL;
+	*ncheckpoints = 0;
+	return SCAP_FAILURE;
+}
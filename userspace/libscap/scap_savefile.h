@@ -150,6 +150,43 @@ typedef struct _section_header_block
 
 #define EVF_BLOCK_TYPE_V2	0x217
 
+///////////////////////////////////////////////////////////////////////////////
+// CHECKPOINT BLOCK
+///////////////////////////////////////////////////////////////////////////////
+// Comes right after the section header of a checkpoint, i.e. a section in
+// the middle of a capture that restates the machine info and the interface,
+// user, process and fd tables, followed by nstateevts events that carry
+// state too (e.g. the containers). A reader can start from a checkpoint, or
+// skip it, state events included, if it has been reading the events before
+// it.
+// Readers that don't know this block type see a new section, and reload
+// the state from it like they do for concatenated captures.
+#define CP_BLOCK_TYPE		0x221
+
+typedef struct _checkpoint_block
+{
+	uint64_t ts; // Timestamp of the last event before the checkpoint
+	uint64_t nevts; // Number of events before the checkpoint, not counting the state events of the previous checkpoints
+	uint32_t nstateevts; // Number of state events at the end of the checkpoint
+}checkpoint_block;
+
+///////////////////////////////////////////////////////////////////////////////
+// SECTION FLAGS BLOCK
+///////////////////////////////////////////////////////////////////////////////
+// Properties of the events of a section, declared by the capture that
+// wrote them. It comes after the section header, or after the checkpoint
+// block in a checkpoint. A section without it has no flags.
+#define SF_BLOCK_TYPE		0x222
+
+// The events come in timestamp order, give or take the time it takes to
+// merge the per-CPU buffers of a live capture
+#define SF_EVENTS_ORDERED	(1 << 0)
+
+typedef struct _section_flags_block
+{
+	uint32_t flags;
+}section_flags_block;
+
 #if defined __sun
 #pragma pack()
 #else
@@ -170,6 +170,66 @@ int32_t scap_create_userlist(scap_t* handle)
 }
 #endif // HAS_CAPTURE
 
+//
+// Replace the list of users with a copy of the given entries
+//
+int32_t scap_set_user_list(scap_t* handle, const scap_userinfo* users, uint32_t nusers, const scap_groupinfo* groups, uint32_t ngroups)
+{
+	uint32_t j;
+	scap_userlist* ul;
+
+	ul = (scap_userlist*)malloc(sizeof(scap_userlist));
+	if(ul == NULL)
+	{
+		snprintf(handle->m_lasterr,	SCAP_LASTERR_SIZE, "userlist allocation failed(1)");
+		return SCAP_FAILURE;
+	}
+
+	ul->nusers = nusers;
+	ul->ngroups = ngroups;
+	ul->totsavelen = 0;
+
+	//
+	// Allocate at least one entry, malloc(0) may return NULL
+	//
+	ul->users = (scap_userinfo*)malloc((nusers + 1) * sizeof(scap_userinfo));
+	ul->groups = (scap_groupinfo*)malloc((ngroups + 1) * sizeof(scap_groupinfo));
+	if(ul->users == NULL || ul->groups == NULL)
+	{
+		snprintf(handle->m_lasterr,	SCAP_LASTERR_SIZE, "userlist allocation failed(2)");
+		scap_free_userlist(ul);
+		return SCAP_FAILURE;
+	}
+
+	for(j = 0; j < nusers; j++)
+	{
+		ul->users[j] = users[j];
+
+		ul->totsavelen +=
+			sizeof(uint8_t) + // type
+			sizeof(uint32_t) + // uid
+			sizeof(uint32_t) +  // gid
+			strlen(ul->users[j].name) + 2 +
+			strlen(ul->users[j].homedir) + 2 +
+			strlen(ul->users[j].shell) + 2;
+	}
+
+	for(j = 0; j < ngroups; j++)
+	{
+		ul->groups[j] = groups[j];
+
+		ul->totsavelen +=
+			sizeof(uint8_t) + // type
+			sizeof(uint32_t) +  // gid
+			strlen(ul->groups[j].name) + 2;
+	}
+
+	scap_free_userlist(handle->m_userlist);
+	handle->m_userlist = ul;
+
+	return SCAP_SUCCESS;
+}
+
 //
 // Free a previously allocated list of users
 //
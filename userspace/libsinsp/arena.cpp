@@ -0,0 +1,123 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+#include <algorithm>
+#include "arena.h"
+
+sinsp_arena::sinsp_arena(uint32_t chunk_size):
+	m_chunk(NULL),
+	m_chunk_size(chunk_size),
+	m_cur(NULL),
+	m_end(NULL),
+	m_overflow_size(0),
+	m_n_allocs(0),
+	m_n_heap_allocs(0)
+{
+}
+
+sinsp_arena::~sinsp_arena()
+{
+	for(auto chunk : m_overflow)
+	{
+		delete[] chunk;
+	}
+
+	delete[] m_chunk;
+}
+
+void* sinsp_arena::alloc_slow(uint32_t size)
+{
+	char* chunk;
+	uint32_t chunk_size;
+
+	//
+	// The main chunk is allocated on first use, so that the inspectors that
+	// never need it don't pay for it
+	//
+	if(m_chunk == NULL && m_overflow.empty() && size <= m_chunk_size)
+	{
+		m_chunk = new char[m_chunk_size];
+		chunk = m_chunk;
+		chunk_size = m_chunk_size;
+	}
+	else
+	{
+		chunk_size = std::max(size, m_chunk_size);
+		chunk = new char[chunk_size];
+		m_overflow.push_back(chunk);
+		m_overflow_size += chunk_size;
+	}
+
+	m_n_heap_allocs++;
+
+	m_cur = chunk + size;
+	m_end = chunk + chunk_size;
+	return chunk;
+}
+
+void sinsp_arena::grow()
+{
+	uint64_t needed = (uint64_t)(m_chunk != NULL ? m_chunk_size : 0) + m_overflow_size;
+
+	for(auto chunk : m_overflow)
+	{
+		delete[] chunk;
+	}
+
+	m_overflow.clear();
+	m_overflow_size = 0;
+
+	if(m_chunk == NULL || needed > m_chunk_size)
+	{
+		//
+		// Double the chunk until it fits, up to MAX_CHUNK_SIZE. Past that,
+		// the events that need more keep using extra chunks.
+		//
+		uint32_t chunk_size = m_chunk_size;
+		while(chunk_size < needed && chunk_size < MAX_CHUNK_SIZE)
+		{
+			chunk_size *= 2;
+		}
+
+		if(m_chunk == NULL || chunk_size != m_chunk_size)
+		{
+			delete[] m_chunk;
+			m_chunk_size = chunk_size;
+			m_chunk = new char[m_chunk_size];
+			m_n_heap_allocs++;
+		}
+	}
+
+	m_end = m_chunk + m_chunk_size;
+}
+
+sinsp_strview sinsp_arena::concat(const char* str1, uint32_t len1, const char* str2, uint32_t len2)
+{
+	sinsp_strview res;
+	char* data = (char*)alloc(len1 + len2 + 1);
+
+	memcpy(data, str1, len1);
+	memcpy(data + len1, str2, len2);
+	data[len1 + len2] = 0;
+
+	res.m_data = data;
+	res.m_len = len1 + len2;
+	return res;
+}
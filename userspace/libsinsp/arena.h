@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+//
+// A string that is not owned by whoever holds it: it points into an arena,
+// or into an object that outlives the holder (e.g. a thread's cwd). m_data
+// is NUL terminated.
+//
+struct sinsp_strview
+{
+	const char* m_data;
+	uint32_t m_len;
+};
+
+//
+// Bump allocator for the memory that lives as long as an event, e.g. the
+// temporary strings of the parsers and the filterchecks. The inspector
+// resets its arena at the beginning of every sinsp::next(), so the memory
+// stays valid while the event returned by next() is being looked at.
+//
+// Allocating is a pointer bump in the current chunk. When an event needs
+// more than a chunk, the extra chunks are freed at the next reset() and the
+// main chunk grows to fit all of them, so that the steady state doesn't
+// touch the heap at all.
+//
+// Not thread safe, like the rest of the per event state.
+//
+class sinsp_arena
+{
+public:
+	const static uint32_t DEFAULT_CHUNK_SIZE = 4096;
+	const static uint32_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+	sinsp_arena(uint32_t chunk_size = DEFAULT_CHUNK_SIZE);
+	~sinsp_arena();
+
+	sinsp_arena(const sinsp_arena&) = delete;
+	sinsp_arena& operator=(const sinsp_arena&) = delete;
+
+	//
+	// size bytes, 8 bytes aligned, valid until the next reset()
+	//
+	inline void* alloc(uint32_t size)
+	{
+		size = (size + 7) & ~7;
+		m_n_allocs++;
+
+		if((uint64_t)(m_end - m_cur) < size)
+		{
+			return alloc_slow(size);
+		}
+
+		void* res = m_cur;
+		m_cur += size;
+		return res;
+	}
+
+	//
+	// The NUL terminated concatenation of the two strings
+	//
+	sinsp_strview concat(const char* str1, uint32_t len1, const char* str2 = "", uint32_t len2 = 0);
+
+	inline void reset()
+	{
+		if(!m_overflow.empty())
+		{
+			grow();
+		}
+
+		m_cur = m_chunk;
+	}
+
+	// The allocations served since the arena was created
+	uint64_t get_n_allocs() const
+	{
+		return m_n_allocs;
+	}
+
+	// The chunks that had to be taken from the heap to serve them
+	uint64_t get_n_heap_allocs() const
+	{
+		return m_n_heap_allocs;
+	}
+
+private:
+	void* alloc_slow(uint32_t size);
+	void grow();
+
+	char* m_chunk;
+	uint32_t m_chunk_size;
+	char* m_cur;
+	char* m_end;
+	// The chunks allocated since the last reset, and their total size
+	std::vector<char*> m_overflow;
+	uint64_t m_overflow_size;
+	uint64_t m_n_allocs;
+	uint64_t m_n_heap_allocs;
+};
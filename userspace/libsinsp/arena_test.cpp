@@ -0,0 +1,199 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "sinsp.h"
+#include "parsers.h"
+
+//
+// Count the heap allocations of the whole test binary, to measure the
+// allocations per event of the benchmark below
+//
+static uint64_t g_n_heap_allocs = 0;
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+	g_n_heap_allocs++;
+
+	void* res = malloc(size == 0 ? 1 : size);
+	if(res == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	return res;
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t size) noexcept
+{
+	free(ptr);
+}
+
+TEST(arena, alloc)
+{
+	sinsp_arena arena(64);
+
+	char* a = (char*)arena.alloc(3);
+	char* b = (char*)arena.alloc(8);
+	EXPECT_EQ(0u, (uintptr_t)a % 8);
+	EXPECT_EQ(a + 8, b);
+	EXPECT_EQ(1u, arena.get_n_heap_allocs());
+
+	// Bigger than a chunk
+	char* c = (char*)arena.alloc(1000);
+	memset(c, 'x', 1000);
+	EXPECT_EQ(2u, arena.get_n_heap_allocs());
+	EXPECT_EQ(3u, arena.get_n_allocs());
+
+	sinsp_strview s = arena.concat("/tmp", 4, "/", 1);
+	EXPECT_EQ(5u, s.m_len);
+	EXPECT_STREQ("/tmp/", s.m_data);
+
+	s = arena.concat("", 0);
+	EXPECT_EQ(0u, s.m_len);
+	EXPECT_STREQ("", s.m_data);
+}
+
+TEST(arena, reset)
+{
+	sinsp_arena arena(64);
+	std::vector<void*> first;
+
+	//
+	// The first event overflows the chunk, the next ones get a chunk big
+	// enough for all of it and don't touch the heap anymore
+	//
+	for(uint32_t j = 0; j < 20; j++)
+	{
+		first.push_back(arena.alloc(16));
+	}
+	uint64_t n_heap_allocs = arena.get_n_heap_allocs();
+	EXPECT_GT(n_heap_allocs, 1u);
+
+	arena.reset();
+	n_heap_allocs = arena.get_n_heap_allocs();
+	void* prev = NULL;
+
+	for(uint32_t k = 0; k < 10; k++)
+	{
+		void* p = arena.alloc(16);
+		for(uint32_t j = 1; j < 20; j++)
+		{
+			arena.alloc(16);
+		}
+
+		// Same memory as the previous event
+		if(prev != NULL)
+		{
+			EXPECT_EQ(prev, p);
+		}
+		prev = p;
+
+		arena.reset();
+	}
+
+	EXPECT_EQ(n_heap_allocs, arena.get_n_heap_allocs());
+}
+
+TEST(arena, max_chunk_size)
+{
+	sinsp_arena arena;
+
+	// Larger than MAX_CHUNK_SIZE: served by an extra chunk every time
+	for(uint32_t j = 0; j < 3; j++)
+	{
+		char* p = (char*)arena.alloc(sinsp_arena::MAX_CHUNK_SIZE + 1);
+		p[sinsp_arena::MAX_CHUNK_SIZE] = 0;
+		arena.reset();
+	}
+
+	EXPECT_EQ(4u, arena.get_n_heap_allocs());
+
+	// The main chunk is at its maximum and still usable
+	arena.alloc(sinsp_arena::MAX_CHUNK_SIZE);
+	EXPECT_EQ(4u, arena.get_n_heap_allocs());
+}
+
+//
+// The paths resolved by the parsers and the filterchecks are in the
+// event arena
+//
+TEST(arena, evt_paths)
+{
+	sinsp inspector;
+	sinsp_evt evt(&inspector);
+	sinsp_arena* arena = inspector.get_evt_arena();
+	uint64_t n_allocs = arena->get_n_allocs();
+
+	sinsp_strview path = sinsp_parser::concatenate_evt_paths(&evt, sinsp_strview{"/tmp", 4}, "a/../b", 7);
+	EXPECT_STREQ("/tmp/b", path.m_data);
+	EXPECT_EQ(6u, path.m_len);
+	EXPECT_EQ(n_allocs + 1, arena->get_n_allocs());
+
+	std::string dir(SCAP_MAX_PATH_SIZE, 'x');
+	path = sinsp_parser::concatenate_evt_paths(&evt, sinsp_strview{dir.c_str(), (uint32_t)dir.length()}, "a", 2);
+	EXPECT_STREQ("/PATH_TOO_LONG", path.m_data);
+}
+
+//
+// The directory temporaries of an openat() path resolution, built the way
+// the parsers used to (std::string) and with the event arena. Prints the heap
+// allocations per event.
+//
+TEST(arena, DISABLED_benchmark)
+{
+	const uint32_t nevts = 1000000;
+	std::string dirname = "/var/lib/docker/overlay2/0123456789abcdef0123456789abcdef/merged/usr/lib";
+	std::string name = "x86_64-linux-gnu/libc.so.6";
+	char fullpath[4096];
+	sinsp_arena arena;
+	uint64_t start;
+
+	start = g_n_heap_allocs;
+	for(uint32_t j = 0; j < nevts; j++)
+	{
+		std::string sdir = dirname + '/';
+		memcpy(fullpath, sdir.c_str(), sdir.length());
+		memcpy(fullpath + sdir.length(), name.c_str(), name.length() + 1);
+	}
+	printf("std::string: %.2f heap allocations per event\n", (double)(g_n_heap_allocs - start) / nevts);
+
+	start = g_n_heap_allocs;
+	for(uint32_t j = 0; j < nevts; j++)
+	{
+		arena.reset();
+		sinsp_strview sdir = arena.concat(dirname.c_str(), (uint32_t)dirname.length(), "/", 1);
+		memcpy(fullpath, sdir.m_data, sdir.m_len);
+		memcpy(fullpath + sdir.m_len, name.c_str(), name.length() + 1);
+	}
+	printf("arena: %.2f heap allocations per event\n", (double)(g_n_heap_allocs - start) / nevts);
+
+	EXPECT_EQ(1u, arena.get_n_heap_allocs());
+}
@@ -0,0 +1,156 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <chrono>
+#include "async_key_value_source.h"
+#include "async_proc_lookup.h"
+
+class sinsp_proc_lookup_source : public sysdig::async_key_value_source<int64_t, sinsp_proc_lookup_result>
+{
+public:
+	sinsp_proc_lookup_source(scap_t* h, const std::string& procdir, uint64_t ttl_ms):
+		async_key_value_source(NO_WAIT_LOOKUP, ttl_ms),
+		m_h(h),
+		m_procdir(procdir)
+	{
+	}
+
+	~sinsp_proc_lookup_source()
+	{
+		stop();
+	}
+
+protected:
+	void run_impl()
+	{
+		int64_t tid;
+
+		while(dequeue_next_key(tid))
+		{
+			sinsp_proc_lookup_result res = get_value(tid);
+			char error[SCAP_LASTERR_SIZE];
+			scap_t* h = m_h;
+
+			uint64_t start = sinsp_async_proc_lookup::get_monotonic_ns();
+			scap_threadinfo* tinfo = scap_proc_get_detached(m_h, m_procdir.c_str(), tid, res.m_scan_sockets, error);
+			res.m_lookup_ns = sinsp_async_proc_lookup::get_monotonic_ns() - start;
+
+			if(tinfo != NULL)
+			{
+				res.m_tinfo.reset(tinfo, [h](scap_threadinfo* p) { scap_proc_free(h, p); });
+			}
+			else
+			{
+				res.m_error = error;
+			}
+
+			store_value(tid, res);
+		}
+	}
+
+private:
+	scap_t* m_h;
+	std::string m_procdir;
+};
+
+sinsp_async_proc_lookup::sinsp_async_proc_lookup(scap_t* h, const std::string& procdir, uint32_t nworkers, uint64_t ttl_ms):
+	m_ttl_ns(ttl_ms * 1000000)
+{
+	for(uint32_t j = 0; j < nworkers; j++)
+	{
+		m_workers.emplace_back(new sinsp_proc_lookup_source(h, procdir, ttl_ms));
+	}
+}
+
+sinsp_async_proc_lookup::~sinsp_async_proc_lookup()
+{
+}
+
+bool sinsp_async_proc_lookup::request(int64_t tid, bool scan_sockets)
+{
+	sinsp_proc_lookup_result res;
+
+	if(m_pending.find(tid) != m_pending.end())
+	{
+		return false;
+	}
+
+	res.m_scan_sockets = scan_sockets;
+	res.m_request_ns = get_monotonic_ns();
+	m_pending[tid] = res.m_request_ns;
+
+	//
+	// If an earlier request for this tid expired here just before its
+	// worker pruned the result, lookup() hands it back right away
+	//
+	if(m_workers[(uint64_t)tid % m_workers.size()]->lookup(tid, res))
+	{
+		res.m_wait_ns = get_monotonic_ns() - res.m_request_ns;
+		m_ready.emplace_back(tid, res);
+	}
+
+	return true;
+}
+
+void sinsp_async_proc_lookup::get_complete_results(std::vector<std::pair<int64_t, sinsp_proc_lookup_result>>& results)
+{
+	uint64_t now = get_monotonic_ns();
+
+	for(auto& it : m_ready)
+	{
+		results.push_back(std::move(it));
+	}
+	m_ready.clear();
+
+	for(auto& worker : m_workers)
+	{
+		for(auto& it : worker->get_complete_results())
+		{
+			it.second.m_wait_ns = now - it.second.m_request_ns;
+			results.emplace_back(it.first, std::move(it.second));
+		}
+	}
+
+	for(auto& it : results)
+	{
+		m_pending.erase(it.first);
+	}
+
+	//
+	// A result that stayed uncollected past the TTL is dropped by its
+	// worker, and will never show up here
+	//
+	for(auto it = m_pending.begin(); it != m_pending.end();)
+	{
+		if(now - it->second > m_ttl_ns)
+		{
+			it = m_pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+uint64_t sinsp_async_proc_lookup::get_monotonic_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,137 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <scap.h>
+
+class sinsp_proc_lookup_source;
+
+//
+// The results are collected at every event, so they are only pruned if
+// nobody calls next() for a long time
+//
+#define PROC_LOOKUP_TTL_MS 60000
+
+//
+// The outcome of the /proc lookup of one thread
+//
+struct sinsp_proc_lookup_result
+{
+	sinsp_proc_lookup_result():
+		m_scan_sockets(false),
+		m_request_ns(0),
+		m_lookup_ns(0),
+		m_wait_ns(0)
+	{
+	}
+
+	bool m_scan_sockets;
+	// NULL if the thread is not in /proc anymore
+	std::shared_ptr<scap_threadinfo> m_tinfo;
+	std::string m_error;
+	// Monotonic time of the request
+	uint64_t m_request_ns;
+	// Time spent reading /proc
+	uint64_t m_lookup_ns;
+	// Time from the request to the moment the result was collected
+	uint64_t m_wait_ns;
+};
+
+//
+// Counters and latencies of the async /proc lookups, see
+// sinsp::set_async_proc_lookups()
+//
+struct sinsp_proc_lookup_stats
+{
+	sinsp_proc_lookup_stats():
+		m_n_requested(0),
+		m_n_pending(0),
+		m_n_merged(0),
+		m_n_failed(0),
+		m_n_discarded(0),
+		m_lookup_ns_total(0),
+		m_lookup_ns_max(0),
+		m_wait_ns_total(0),
+		m_wait_ns_max(0)
+	{
+	}
+
+	uint64_t m_n_requested;
+	// Requested and neither collected nor expired yet
+	uint64_t m_n_pending;
+	// The placeholder thread was replaced with the /proc information
+	uint64_t m_n_merged;
+	// The thread was gone from /proc, the placeholder stays
+	uint64_t m_n_failed;
+	// The events filled or removed the placeholder before the result came
+	uint64_t m_n_discarded;
+	uint64_t m_lookup_ns_total;
+	uint64_t m_lookup_ns_max;
+	uint64_t m_wait_ns_total;
+	uint64_t m_wait_ns_max;
+};
+
+//
+// A pool of threads reading /proc/<tid> for the threads that the event
+// thread doesn't know about. Every worker is an async_key_value_source and
+// a tid always goes to the same worker. The results are collected, not
+// delivered with a callback, so that the event thread can merge them
+// between two events.
+//
+class sinsp_async_proc_lookup
+{
+public:
+	sinsp_async_proc_lookup(scap_t* h, const std::string& procdir, uint32_t nworkers, uint64_t ttl_ms = PROC_LOOKUP_TTL_MS);
+	~sinsp_async_proc_lookup();
+
+	//
+	// Returns false if the tid is already pending, in which case nothing
+	// new is requested
+	//
+	bool request(int64_t tid, bool scan_sockets);
+
+	//
+	// Append the lookups that completed since the last call to results.
+	// The requests whose result was pruned by the workers stop being
+	// pending too.
+	//
+	void get_complete_results(std::vector<std::pair<int64_t, sinsp_proc_lookup_result>>& results);
+
+	// The requests that were not collected yet
+	uint64_t get_n_pending() const
+	{
+		return m_pending.size();
+	}
+
+	static uint64_t get_monotonic_ns();
+
+private:
+	std::vector<std::unique_ptr<sinsp_proc_lookup_source>> m_workers;
+	std::vector<std::pair<int64_t, sinsp_proc_lookup_result>> m_ready;
+	// The time of the requests that were not collected yet, by tid
+	std::unordered_map<int64_t, uint64_t> m_pending;
+	uint64_t m_ttl_ns;
+};
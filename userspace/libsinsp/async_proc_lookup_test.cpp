@@ -0,0 +1,247 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <thread>
+#include "async_proc_lookup.h"
+#include "scap-int.h"
+
+//
+// A fake /proc with a few processes, each with a file fd, read through a
+// live handle that has no driver behind it
+//
+class async_proc_lookup : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		char tmpl[] = "/tmp/fake_procXXXXXX";
+
+		ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+		m_root = tmpl;
+		m_procdir = m_root + "/proc";
+		mkdir(m_procdir.c_str(), 0755);
+
+		m_handle = (scap_t*)calloc(1, sizeof(scap_t));
+		m_handle->m_mode = SCAP_MODE_LIVE;
+		m_handle->m_bpf = true;
+	}
+
+	void TearDown()
+	{
+		free(m_handle);
+		ASSERT_EQ(0, system(("rm -rf " + m_root).c_str()));
+	}
+
+	void write_file(const std::string& path, const std::string& content)
+	{
+		FILE* f = fopen(path.c_str(), "w");
+		ASSERT_TRUE(f != NULL);
+		fwrite(content.data(), 1, content.size(), f);
+		fclose(f);
+	}
+
+	void add_process(int64_t tid, int64_t ptid, const std::string& comm)
+	{
+		std::string dir = m_procdir + "/" + std::to_string(tid);
+		std::string t = std::to_string(tid);
+		std::string data = m_root + "/data" + t;
+
+		mkdir(dir.c_str(), 0755);
+		mkdir((dir + "/fd").c_str(), 0755);
+		mkdir((dir + "/fdinfo").c_str(), 0755);
+
+		ASSERT_EQ(0, symlink(("/usr/bin/" + comm).c_str(), (dir + "/exe").c_str()));
+		ASSERT_EQ(0, symlink("/tmp", (dir + "/cwd").c_str()));
+		ASSERT_EQ(0, symlink("/", (dir + "/root").c_str()));
+
+		write_file(dir + "/status",
+			"Name:\t" + comm + "\n"
+			"Tgid:\t" + t + "\n"
+			"PPid:\t" + std::to_string(ptid) + "\n"
+			"Uid:\t1000\t1000\t1000\t1000\n"
+			"Gid:\t100\t100\t100\t100\n"
+			"VmSize:\t1024 kB\n"
+			"VmRSS:\t512 kB\n"
+			"VmSwap:\t0 kB\n"
+			"NStgid:\t" + t + "\n"
+			"NSpid:\t" + t + "\n");
+		write_file(dir + "/stat", t + " (" + comm + ") S " + std::to_string(ptid) + " " + t + " " + t + " 0 -1 4194304 100 0 2 0\n");
+		write_file(dir + "/cmdline", std::string("/usr/bin/") + comm + '\0' + "--arg" + '\0');
+		write_file(dir + "/environ", std::string("HOME=/root") + '\0');
+		write_file(dir + "/cgroup", "1:cpu:/\n");
+		write_file(dir + "/loginuid", "1000");
+
+		write_file(data, "x");
+		ASSERT_EQ(0, symlink(data.c_str(), (dir + "/fd/3").c_str()));
+		write_file(dir + "/fdinfo/3", "pos:\t0\nflags:\t02\nmnt_id:\t0\n");
+	}
+
+	scap_t* m_handle;
+	std::string m_root;
+	std::string m_procdir;
+};
+
+TEST_F(async_proc_lookup, detached)
+{
+	char error[SCAP_LASTERR_SIZE];
+
+	add_process(100, 1, "nginx");
+
+	scap_threadinfo* tinfo = scap_proc_get_detached(m_handle, m_procdir.c_str(), 100, true, error);
+	ASSERT_TRUE(tinfo != NULL) << error;
+
+	EXPECT_EQ(100u, tinfo->tid);
+	EXPECT_EQ(100u, tinfo->pid);
+	EXPECT_EQ(1u, tinfo->ptid);
+	EXPECT_STREQ("nginx", tinfo->comm);
+	EXPECT_STREQ("/usr/bin/nginx", tinfo->exe);
+	EXPECT_STREQ("--arg", tinfo->args);
+	EXPECT_STREQ("/tmp", tinfo->cwd);
+	EXPECT_EQ(1000u, tinfo->uid);
+	EXPECT_EQ(100u, tinfo->gid);
+	EXPECT_EQ(1000, tinfo->loginuid);
+
+	uint64_t fd = 3;
+	scap_fdinfo* fdi;
+	HASH_FIND_INT64(tinfo->fdlist, &fd, fdi);
+	ASSERT_TRUE(fdi != NULL);
+	EXPECT_EQ(SCAP_FD_FILE_V2, fdi->type);
+	EXPECT_EQ(m_root + "/data100", fdi->info.regularinfo.fname);
+
+	scap_proc_free(m_handle, tinfo);
+
+	// The handle state is untouched
+	EXPECT_TRUE(m_handle->m_dev_list == NULL);
+	EXPECT_TRUE(m_handle->m_proclist == NULL);
+}
+
+TEST_F(async_proc_lookup, detached_errors)
+{
+	char error[SCAP_LASTERR_SIZE];
+
+	EXPECT_TRUE(scap_proc_get_detached(m_handle, m_procdir.c_str(), 100, true, error) == NULL);
+	EXPECT_TRUE(strstr(error, "100") != NULL);
+
+	add_process(100, 1, "nginx");
+	m_handle->m_mode = SCAP_MODE_CAPTURE;
+	EXPECT_TRUE(scap_proc_get_detached(m_handle, m_procdir.c_str(), 100, true, error) == NULL);
+}
+
+TEST_F(async_proc_lookup, workers)
+{
+	const int64_t ntids = 200;
+	std::map<int64_t, sinsp_proc_lookup_result> results;
+
+	for(int64_t tid = 1000; tid < 1000 + ntids; tid++)
+	{
+		// Every fourth thread is gone by the time we look for it
+		if(tid % 4 != 0)
+		{
+			add_process(tid, 1, "proc" + std::to_string(tid));
+		}
+	}
+
+	sinsp_async_proc_lookup lookup(m_handle, m_procdir, 4);
+
+	for(int64_t tid = 1000; tid < 1000 + ntids; tid++)
+	{
+		lookup.request(tid, tid % 2 == 0);
+	}
+
+	for(uint32_t j = 0; j < 5000 && results.size() < ntids; j++)
+	{
+		std::vector<std::pair<int64_t, sinsp_proc_lookup_result>> batch;
+
+		lookup.get_complete_results(batch);
+		for(auto& it : batch)
+		{
+			EXPECT_TRUE(results.find(it.first) == results.end()) << it.first;
+			results[it.first] = it.second;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	ASSERT_EQ((size_t)ntids, results.size());
+
+	for(auto& it : results)
+	{
+		if(it.first % 4 == 0)
+		{
+			EXPECT_TRUE(it.second.m_tinfo == NULL);
+			EXPECT_FALSE(it.second.m_error.empty());
+		}
+		else
+		{
+			ASSERT_TRUE(it.second.m_tinfo != NULL) << it.second.m_error;
+			EXPECT_EQ((uint64_t)it.first, it.second.m_tinfo->tid);
+			EXPECT_EQ("proc" + std::to_string(it.first), it.second.m_tinfo->comm);
+		}
+
+		EXPECT_EQ(it.first % 2 == 0, it.second.m_scan_sockets);
+		EXPECT_GT(it.second.m_lookup_ns, 0u);
+		EXPECT_GE(it.second.m_wait_ns, it.second.m_lookup_ns);
+	}
+}
+
+//
+// A tid is pending once, however many times it's requested, and stops
+// being pending when it's collected or when its result expires
+//
+TEST_F(async_proc_lookup, pending)
+{
+	std::vector<std::pair<int64_t, sinsp_proc_lookup_result>> results;
+
+	add_process(100, 1, "nginx");
+
+	sinsp_async_proc_lookup lookup(m_handle, m_procdir, 1);
+
+	EXPECT_TRUE(lookup.request(100, false));
+	EXPECT_FALSE(lookup.request(100, false));
+	EXPECT_EQ(1u, lookup.get_n_pending());
+
+	for(uint32_t j = 0; j < 5000 && results.empty(); j++)
+	{
+		lookup.get_complete_results(results);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	ASSERT_EQ(1u, results.size());
+	EXPECT_EQ(0u, lookup.get_n_pending());
+
+	//
+	// Nobody collects the result in time
+	//
+	sinsp_async_proc_lookup expiring(m_handle, m_procdir, 1, 1);
+
+	EXPECT_TRUE(expiring.request(100, false));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	results.clear();
+	expiring.get_complete_results(results);
+	EXPECT_EQ(0u, expiring.get_n_pending());
+	EXPECT_TRUE(expiring.request(100, false));
+}
@@ -0,0 +1,354 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <errno.h>
+#include <string.h>
+#ifndef _WIN32
+#include <grp.h>
+#include <pwd.h>
+#include <unistd.h>
+#endif
+#include "async_key_value_source.h"
+#include "async_proc_lookup.h"
+#include "async_user_lookup.h"
+
+//
+// The results are collected at every event, so they are only pruned if
+// nobody calls next() for a long time
+//
+#define USER_LOOKUP_TTL_MS 60000
+
+//
+// How long an id that doesn't exist stays that way, so that the users
+// created during the capture show up eventually
+//
+#define USER_LOOKUP_NEGATIVE_TTL_NS (60 * 1000000000ULL)
+
+#define USER_LOOKUP_GROUP_FLAG (1ULL << 32)
+#define USER_LOOKUP_MAX_BUFSIZE (1024 * 1024)
+
+class sinsp_user_lookup_source : public sysdig::async_key_value_source<uint64_t, sinsp_user_lookup_result>
+{
+public:
+	sinsp_user_lookup_source():
+		async_key_value_source(NO_WAIT_LOOKUP, USER_LOOKUP_TTL_MS)
+	{
+	}
+
+	~sinsp_user_lookup_source()
+	{
+		stop();
+	}
+
+protected:
+	void run_impl()
+	{
+		uint64_t key;
+
+		while(dequeue_next_key(key))
+		{
+			sinsp_user_lookup_result res;
+
+			if(key & USER_LOOKUP_GROUP_FLAG)
+			{
+				res.m_found = sinsp_async_user_lookup::lookup_group((uint32_t)key, &res.m_group);
+			}
+			else
+			{
+				res.m_found = sinsp_async_user_lookup::lookup_user((uint32_t)key, &res.m_user);
+			}
+
+			store_value(key, res);
+		}
+	}
+};
+
+//
+// Copy src to the fixed size field, truncating it if needed
+//
+static void copy_credential_str(char* dst, const char* src, size_t dstsize)
+{
+	if(src == NULL)
+	{
+		*dst = '\0';
+		return;
+	}
+
+	strncpy(dst, src, dstsize - 1);
+	dst[dstsize - 1] = '\0';
+}
+
+#ifndef _WIN32
+static size_t get_nss_bufsize(int name)
+{
+	long res = sysconf(name);
+
+	return (res > 0) ? (size_t)res : 16384;
+}
+#endif
+
+sinsp_async_user_lookup::sinsp_async_user_lookup(std::unordered_map<uint32_t, scap_userinfo*>* userlist,
+	std::unordered_map<uint32_t, scap_groupinfo*>* grouplist):
+	m_worker(new sinsp_user_lookup_source()),
+	m_userlist(userlist),
+	m_grouplist(grouplist)
+{
+}
+
+sinsp_async_user_lookup::~sinsp_async_user_lookup()
+{
+	//
+	// Stop the worker before the tables go away
+	//
+	m_worker.reset();
+	m_userlist->clear();
+	m_grouplist->clear();
+}
+
+void sinsp_async_user_lookup::request_user(uint32_t uid)
+{
+	request(uid);
+}
+
+void sinsp_async_user_lookup::request_group(uint32_t gid)
+{
+	request(USER_LOOKUP_GROUP_FLAG | gid);
+}
+
+void sinsp_async_user_lookup::request(uint64_t key)
+{
+	if(m_pending.find(key) != m_pending.end() ||
+	   is_known_missing(key, sinsp_async_proc_lookup::get_monotonic_ns()))
+	{
+		return;
+	}
+
+	sinsp_user_lookup_result res;
+
+	m_pending.insert(key);
+
+	//
+	// If an earlier request for this key completed and was not collected
+	// yet, lookup() hands it back right away
+	//
+	if(m_worker->lookup(key, res))
+	{
+		m_ready.emplace_back(key, res);
+	}
+}
+
+bool sinsp_async_user_lookup::is_known_missing(uint64_t key, uint64_t now)
+{
+	auto it = m_missing.find(key);
+
+	if(it == m_missing.end())
+	{
+		return false;
+	}
+
+	if(now >= it->second)
+	{
+		m_missing.erase(it);
+		return false;
+	}
+
+	return true;
+}
+
+void sinsp_async_user_lookup::merge_results()
+{
+	uint64_t now = sinsp_async_proc_lookup::get_monotonic_ns();
+
+	for(auto& it : m_worker->get_complete_results())
+	{
+		m_ready.emplace_back(it.first, it.second);
+	}
+
+	for(auto& it : m_ready)
+	{
+		uint64_t key = it.first;
+		sinsp_user_lookup_result& res = it.second;
+
+		m_pending.erase(key);
+
+		if(!res.m_found)
+		{
+			m_missing[key] = now + USER_LOOKUP_NEGATIVE_TTL_NS;
+		}
+		else if(key & USER_LOOKUP_GROUP_FLAG)
+		{
+			add_group(res.m_group);
+		}
+		else
+		{
+			add_user(res.m_user);
+		}
+	}
+
+	m_ready.clear();
+}
+
+scap_userinfo* sinsp_async_user_lookup::get_user_now(uint32_t uid)
+{
+	auto it = m_userlist->find(uid);
+	scap_userinfo user;
+
+	if(it != m_userlist->end())
+	{
+		return it->second;
+	}
+
+	uint64_t now = sinsp_async_proc_lookup::get_monotonic_ns();
+
+	if(is_known_missing(uid, now))
+	{
+		return NULL;
+	}
+
+	if(!lookup_user(uid, &user))
+	{
+		m_missing[uid] = now + USER_LOOKUP_NEGATIVE_TTL_NS;
+		return NULL;
+	}
+
+	//
+	// A pending result for this uid is just dropped by add_user()
+	//
+	return add_user(user);
+}
+
+scap_groupinfo* sinsp_async_user_lookup::get_group_now(uint32_t gid)
+{
+	auto it = m_grouplist->find(gid);
+	scap_groupinfo group;
+
+	if(it != m_grouplist->end())
+	{
+		return it->second;
+	}
+
+	uint64_t key = USER_LOOKUP_GROUP_FLAG | gid;
+	uint64_t now = sinsp_async_proc_lookup::get_monotonic_ns();
+
+	if(is_known_missing(key, now))
+	{
+		return NULL;
+	}
+
+	if(!lookup_group(gid, &group))
+	{
+		m_missing[key] = now + USER_LOOKUP_NEGATIVE_TTL_NS;
+		return NULL;
+	}
+
+	return add_group(group);
+}
+
+void sinsp_async_user_lookup::get_new_entries(std::vector<scap_userinfo*>& users, std::vector<scap_groupinfo*>& groups)
+{
+	users.clear();
+	groups.clear();
+	users.swap(m_new_users);
+	groups.swap(m_new_groups);
+}
+
+scap_userinfo* sinsp_async_user_lookup::add_user(const scap_userinfo& user)
+{
+	auto res = m_userlist->emplace(user.uid, nullptr);
+
+	if(res.second)
+	{
+		m_users.push_back(user);
+		res.first->second = &m_users.back();
+		m_new_users.push_back(res.first->second);
+	}
+
+	return res.first->second;
+}
+
+scap_groupinfo* sinsp_async_user_lookup::add_group(const scap_groupinfo& group)
+{
+	auto res = m_grouplist->emplace(group.gid, nullptr);
+
+	if(res.second)
+	{
+		m_groups.push_back(group);
+		res.first->second = &m_groups.back();
+		m_new_groups.push_back(res.first->second);
+	}
+
+	return res.first->second;
+}
+
+bool sinsp_async_user_lookup::lookup_user(uint32_t uid, scap_userinfo* user)
+{
+#ifdef _WIN32
+	return false;
+#else
+	std::vector<char> buf(get_nss_bufsize(_SC_GETPW_R_SIZE_MAX));
+	struct passwd pwd;
+	struct passwd* p = NULL;
+	int res;
+
+	while((res = getpwuid_r(uid, &pwd, buf.data(), buf.size(), &p)) == ERANGE &&
+	      buf.size() < USER_LOOKUP_MAX_BUFSIZE)
+	{
+		buf.resize(buf.size() * 2);
+	}
+
+	if(res != 0 || p == NULL)
+	{
+		return false;
+	}
+
+	user->uid = uid;
+	user->gid = p->pw_gid;
+	copy_credential_str(user->name, p->pw_name, sizeof(user->name));
+	copy_credential_str(user->homedir, p->pw_dir, sizeof(user->homedir));
+	copy_credential_str(user->shell, p->pw_shell, sizeof(user->shell));
+	return true;
+#endif
+}
+
+bool sinsp_async_user_lookup::lookup_group(uint32_t gid, scap_groupinfo* group)
+{
+#ifdef _WIN32
+	return false;
+#else
+	std::vector<char> buf(get_nss_bufsize(_SC_GETGR_R_SIZE_MAX));
+	struct group grp;
+	struct group* g = NULL;
+	int res;
+
+	while((res = getgrgid_r(gid, &grp, buf.data(), buf.size(), &g)) == ERANGE &&
+	      buf.size() < USER_LOOKUP_MAX_BUFSIZE)
+	{
+		buf.resize(buf.size() * 2);
+	}
+
+	if(res != 0 || g == NULL)
+	{
+		return false;
+	}
+
+	group->gid = gid;
+	copy_credential_str(group->name, g->gr_name, sizeof(group->name));
+	return true;
+#endif
+}
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <stdint.h>
+#include <scap.h>
+
+class sinsp_user_lookup_source;
+
+//
+// The outcome of the lookup of one uid or gid
+//
+struct sinsp_user_lookup_result
+{
+	sinsp_user_lookup_result():
+		m_found(false)
+	{
+	}
+
+	// false if the id doesn't exist or the lookup failed
+	bool m_found;
+	// Only one of the two is filled, depending on the key
+	scap_userinfo m_user;
+	scap_groupinfo m_group;
+};
+
+//
+// Resolves the uids and gids one at a time with getpwuid_r/getgrgid_r on
+// a worker thread, instead of enumerating the whole user database when the
+// capture is opened, which can take very long with LDAP or SSSD. The
+// entries are added to the user and group tables of the inspector between
+// two events; until then, and forever if the id doesn't exist, the lookups
+// in the tables fail. The ids that don't exist are requested again only
+// after a while.
+//
+class sinsp_async_user_lookup
+{
+public:
+	sinsp_async_user_lookup(std::unordered_map<uint32_t, scap_userinfo*>* userlist,
+		std::unordered_map<uint32_t, scap_groupinfo*>* grouplist);
+	~sinsp_async_user_lookup();
+
+	//
+	// Called for the ids that are not in the tables. Nothing happens if the
+	// lookup is already in progress or the id is known to be missing.
+	//
+	void request_user(uint32_t uid);
+	void request_group(uint32_t gid);
+
+	inline bool has_pending() const
+	{
+		return !m_pending.empty();
+	}
+
+	//
+	// Add the results that came since the last call to the tables
+	//
+	void merge_results();
+
+	//
+	// Resolve the id synchronously if it's not in the table yet. Used only
+	// for the few ids that go in the trace files.
+	//
+	scap_userinfo* get_user_now(uint32_t uid);
+	scap_groupinfo* get_group_now(uint32_t gid);
+
+	//
+	// The entries added to the tables since the last call, by the lookups
+	// or by get_user_now()/get_group_now()
+	//
+	inline bool has_new_entries() const
+	{
+		return !m_new_users.empty() || !m_new_groups.empty();
+	}
+
+	void get_new_entries(std::vector<scap_userinfo*>& users, std::vector<scap_groupinfo*>& groups);
+
+	static bool lookup_user(uint32_t uid, scap_userinfo* user);
+	static bool lookup_group(uint32_t gid, scap_groupinfo* group);
+
+private:
+	void request(uint64_t key);
+	bool is_known_missing(uint64_t key, uint64_t now);
+	scap_userinfo* add_user(const scap_userinfo& user);
+	scap_groupinfo* add_group(const scap_groupinfo& group);
+
+	std::unique_ptr<sinsp_user_lookup_source> m_worker;
+	std::unordered_map<uint32_t, scap_userinfo*>* m_userlist;
+	std::unordered_map<uint32_t, scap_groupinfo*>* m_grouplist;
+	// The tables point here, a deque never moves its elements
+	std::deque<scap_userinfo> m_users;
+	std::deque<scap_groupinfo> m_groups;
+	std::unordered_set<uint64_t> m_pending;
+	// Key -> monotonic time after which the id is requested again
+	std::unordered_map<uint64_t, uint64_t> m_missing;
+	std::vector<std::pair<uint64_t, sinsp_user_lookup_result>> m_ready;
+	std::vector<scap_userinfo*> m_new_users;
+	std::vector<scap_groupinfo*> m_new_groups;
+};
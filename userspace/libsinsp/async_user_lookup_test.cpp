@@ -0,0 +1,142 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <chrono>
+#include <string.h>
+#include <thread>
+#define VISIBILITY_PRIVATE
+#include "sinsp.h"
+#include "parsers.h"
+#include "async_user_lookup.h"
+#include "scap-int.h"
+
+// Assumed not to exist on the test machines
+#define MISSING_ID 0x7ffffff0
+
+class async_user_lookup_test : public testing::Test
+{
+protected:
+	async_user_lookup_test():
+		m_lookup(&m_userlist, &m_grouplist)
+	{
+	}
+
+	void wait_results()
+	{
+		for(uint32_t j = 0; j < 500 && m_lookup.has_pending(); j++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			m_lookup.merge_results();
+		}
+
+		ASSERT_FALSE(m_lookup.has_pending());
+	}
+
+	std::unordered_map<uint32_t, scap_userinfo*> m_userlist;
+	std::unordered_map<uint32_t, scap_groupinfo*> m_grouplist;
+	sinsp_async_user_lookup m_lookup;
+};
+
+TEST_F(async_user_lookup_test, resolve)
+{
+	m_lookup.request_user(0);
+	m_lookup.request_group(0);
+	m_lookup.request_user(MISSING_ID);
+
+	// Nothing is added before the merge
+	EXPECT_TRUE(m_userlist.empty());
+	EXPECT_TRUE(m_grouplist.empty());
+
+	wait_results();
+
+	ASSERT_EQ(1u, m_userlist.size());
+	EXPECT_STREQ("root", m_userlist[0]->name);
+	EXPECT_EQ(0u, m_userlist[0]->gid);
+	ASSERT_EQ(1u, m_grouplist.size());
+	EXPECT_STREQ("root", m_grouplist[0]->name);
+
+	// Negative cache
+	m_lookup.request_user(MISSING_ID);
+	EXPECT_FALSE(m_lookup.has_pending());
+	EXPECT_EQ(NULL, m_lookup.get_user_now(MISSING_ID));
+}
+
+TEST_F(async_user_lookup_test, sync)
+{
+	scap_userinfo* user;
+
+	m_lookup.request_user(0);
+	user = m_lookup.get_user_now(0);
+	ASSERT_NE(nullptr, user);
+	EXPECT_STREQ("root", user->name);
+	EXPECT_EQ(user, m_userlist[0]);
+
+	// The async result for the same uid doesn't replace the entry
+	wait_results();
+	EXPECT_EQ(1u, m_userlist.size());
+	EXPECT_EQ(user, m_userlist[0]);
+
+	EXPECT_EQ(NULL, m_lookup.get_group_now(MISSING_ID));
+}
+
+//
+// The entries resolved after open() go out as events, which add them to
+// the tables of a reader
+//
+TEST(async_user_lookup_evts, round_trip)
+{
+	sinsp live;
+	sinsp capture;
+
+	live.m_async_user_lookup.reset(new sinsp_async_user_lookup(&live.m_userlist, &live.m_grouplist));
+	ASSERT_NE(nullptr, live.m_async_user_lookup->get_user_now(0));
+	ASSERT_NE(nullptr, live.m_async_user_lookup->get_group_now(0));
+	EXPECT_TRUE(live.m_async_user_lookup->has_new_entries());
+
+	live.queue_user_evts();
+	EXPECT_FALSE(live.m_async_user_lookup->has_new_entries());
+	ASSERT_EQ(2u, live.m_pending_user_evts.size());
+	EXPECT_EQ(PPME_USER_ADDED_E, live.m_pending_user_evts[0]->get_type());
+	EXPECT_EQ(PPME_GROUP_ADDED_E, live.m_pending_user_evts[1]->get_type());
+
+	//
+	// The parser looks at the dump flags of the events read from a file
+	//
+	capture.m_mode = SCAP_MODE_CAPTURE;
+	capture.m_h = (scap_t*)calloc(1, sizeof(scap_t));
+	for(auto& evt : live.m_pending_user_evts)
+	{
+		evt->m_inspector = &capture;
+		capture.m_parser->process_event(evt.get());
+	}
+	free(capture.m_h);
+	capture.m_h = NULL;
+
+	scap_userinfo* user = capture.get_user(0);
+	ASSERT_NE(nullptr, user);
+	EXPECT_STREQ("root", user->name);
+	EXPECT_STREQ(live.m_userlist[0]->homedir, user->homedir);
+	EXPECT_STREQ(live.m_userlist[0]->shell, user->shell);
+	EXPECT_EQ(0u, user->gid);
+
+	scap_groupinfo* group = capture.get_group(0);
+	ASSERT_NE(nullptr, group);
+	EXPECT_STREQ("root", group->name);
+}
@@ -0,0 +1,795 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#else
+#include <winsock2.h>
+#endif
+
+#include "buffer_encoders.h"
+
+//
+// The vectorized encoders rely on function-level target attributes, so that
+// the rest of the library doesn't need to be compiled with -mavx2. SSE2 is
+// part of the x86_64 baseline.
+//
+#if defined(__x86_64__) && \
+	(defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define BUFENC_HAS_X86 1
+#include <immintrin.h>
+#define BUFENC_TARGET(t) __attribute__((target(t)))
+#endif
+
+static const char g_hex_digits[] = "0123456789abcdef";
+
+static const char g_base64_table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+	'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+	'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+	'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+	'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+	'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+	'w', 'x', 'y', 'z', '0', '1', '2', '3',
+	'4', '5', '6', '7', '8', '9', '+', '/'};
+
+buffer_encoders::isa buffer_encoders::m_isa = buffer_encoders::detect_isa();
+
+///////////////////////////////////////////////////////////////////////////////
+// Reference implementations
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t to_hex_scalar(char *dst, const char *src, uint32_t dstlen, uint32_t srclen, bool with_ascii)
+{
+	uint32_t j;
+	uint32_t k;
+	uint32_t l = 0;
+	uint32_t num_chunks;
+	uint32_t row_len;
+	char row[128];
+	const char *ptr;
+	bool truncated = false;
+
+	for(j = 0; j < srclen; j += 8 * sizeof(uint16_t))
+	{
+		k = 0;
+		k += sprintf(row + k, "\n\t0x%.4x:", j);
+
+		ptr = &src[j];
+		num_chunks = 0;
+		while(num_chunks < 8 && ptr < src + srclen)
+		{
+			if(ptr == src + srclen - 1)
+			{
+				k += sprintf(row + k, " %.2x", (uint8_t)*ptr);
+			}
+			else
+			{
+				uint16_t chunk = htons(*(uint16_t*)ptr);
+				k += sprintf(row + k, " %.4x", chunk);
+			}
+
+			num_chunks++;
+			ptr += sizeof(uint16_t);
+		}
+
+		if(with_ascii)
+		{
+			// Fill the row with spaces to align it to other rows
+			while(num_chunks < 8)
+			{
+				memset(row + k, ' ', 5);
+
+				k += 5;
+				num_chunks++;
+			}
+
+			row[k++] = ' ';
+			row[k++] = ' ';
+
+			for(ptr = &src[j];
+				ptr < src + j + 8 * sizeof(uint16_t) && ptr < src + srclen;
+				ptr++, k++)
+			{
+				if(isprint((int)(uint8_t)*ptr))
+				{
+					row[k] = *ptr;
+				}
+				else
+				{
+					row[k] = '.';
+				}
+			}
+		}
+		row[k] = 0;
+
+		row_len = (uint32_t)strlen(row);
+		if(l + row_len >= dstlen - 1)
+		{
+			truncated = true;
+			break;
+		}
+		strcpy(dst + l, row);
+		l += row_len;
+	}
+
+	dst[l++] = '\n';
+
+	if(truncated)
+	{
+		return dstlen;
+	}
+	else
+	{
+		return l;
+	}
+}
+
+//
+// j and k allow the vectorized versions to hand over parts of the buffer.
+//
+static uint32_t to_asciionly_scalar(char *dst, const char *src, uint32_t dstlen, uint32_t srclen,
+	uint32_t j, uint32_t k)
+{
+	for(; j < srclen; j++)
+	{
+		//
+		// Make sure there's enough space in the target buffer.
+		//
+		if(k >= dstlen - 1)
+		{
+			dst[k - 1] = 0;
+			return dstlen;
+		}
+
+		if(isprint((int)(uint8_t)src[j]))
+		{
+			dst[k] = src[j];
+			k++;
+		}
+		else if(src[j] == '\r')
+		{
+			dst[k] = '\n';
+			k++;
+		}
+		else if(src[j] == '\n')
+		{
+			if(j > 0 && src[j - 1] != '\r')
+			{
+				dst[k] = src[j];
+				k++;
+			}
+		}
+	}
+
+	return k;
+}
+
+static uint32_t to_dots_scalar(char *dst, const char *src, uint32_t dstlen, uint32_t srclen, uint32_t j)
+{
+	uint32_t k = j;
+
+	for(; j < srclen; j++)
+	{
+		//
+		// Make sure there's enough space in the target buffer.
+		//
+		if(k >= dstlen - 1)
+		{
+			dst[k - 1] = 0;
+			return dstlen;
+		}
+
+		if(isprint((int)(uint8_t)src[j]))
+		{
+			dst[k] = src[j];
+		}
+		else
+		{
+			dst[k] = '.';
+		}
+
+		k++;
+	}
+
+	return k;
+}
+
+//
+// base64 encoder, malloc-free version of:
+// http://stackoverflow.com/questions/342409/how-do-i-base64-encode-decode-in-c
+// j and k allow the vectorized versions to hand over the tail of the buffer.
+//
+static uint32_t to_base64_scalar(char *dst, const char *src, uint32_t srclen, uint32_t j, uint32_t k)
+{
+	static uint32_t mod_table[] = {0, 2, 1};
+	uint32_t enc_dstlen = 4 * ((srclen + 2) / 3);
+
+	while(j < srclen)
+	{
+		uint32_t octet_a = j < srclen ? (unsigned char)src[j++] : 0;
+		uint32_t octet_b = j < srclen ? (unsigned char)src[j++] : 0;
+		uint32_t octet_c = j < srclen ? (unsigned char)src[j++] : 0;
+
+		uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
+
+		dst[k++] = g_base64_table[(triple >> 3 * 6) & 0x3F];
+		dst[k++] = g_base64_table[(triple >> 2 * 6) & 0x3F];
+		dst[k++] = g_base64_table[(triple >> 1 * 6) & 0x3F];
+		dst[k++] = g_base64_table[(triple >> 0 * 6) & 0x3F];
+	}
+
+	for(j = 0; j < mod_table[srclen % 3]; j++)
+	{
+		dst[enc_dstlen - 1 - j] = '=';
+	}
+
+	return enc_dstlen;
+}
+
+#ifdef BUFENC_HAS_X86
+///////////////////////////////////////////////////////////////////////////////
+// SSE2/SSSE3/AVX2 building blocks
+///////////////////////////////////////////////////////////////////////////////
+
+//
+// 0xff for the bytes in [0x20, 0x7e], 0 otherwise. Bytes >= 0x80 are negative
+// as signed chars, so a signed comparison rules them out too.
+//
+static inline __m128i printable_mask_sse2(__m128i v)
+{
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+		_mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+}
+
+static inline void dots16_sse2(char *dst, const char *src)
+{
+	__m128i v = _mm_loadu_si128((const __m128i*)src);
+	__m128i mask = printable_mask_sse2(v);
+	__m128i res = _mm_or_si128(_mm_and_si128(mask, v),
+		_mm_andnot_si128(mask, _mm_set1_epi8('.')));
+	_mm_storeu_si128((__m128i*)dst, res);
+}
+
+static inline __m128i nibbles_to_hex_sse2(__m128i n)
+{
+	// '0' + n, plus the gap between '9' and 'a' for n > 9
+	__m128i gap = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+	return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), gap);
+}
+
+//
+// Convert 16 bytes into 32 hex digits, in memory order
+//
+static inline void hexify16_sse2(char *dst, const char *src)
+{
+	__m128i v = _mm_loadu_si128((const __m128i*)src);
+	__m128i lomask = _mm_set1_epi8(0x0f);
+	__m128i hi = nibbles_to_hex_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), lomask));
+	__m128i lo = nibbles_to_hex_sse2(_mm_and_si128(v, lomask));
+	_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(hi, lo));
+	_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+BUFENC_TARGET("avx2")
+static inline __m256i printable_mask_avx2(__m256i v)
+{
+	return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(0x1f)),
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), v));
+}
+
+BUFENC_TARGET("avx2")
+static inline void dots32_avx2(char *dst, const char *src)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i*)src);
+	__m256i mask = printable_mask_avx2(v);
+	__m256i res = _mm256_blendv_epi8(_mm256_set1_epi8('.'), v, mask);
+	_mm256_storeu_si256((__m256i*)dst, res);
+}
+
+//
+// Convert 32 bytes into 64 hex digits, in memory order
+//
+BUFENC_TARGET("avx2")
+static inline void hexify32_avx2(char *dst, const char *src)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i*)src);
+	__m256i lomask = _mm256_set1_epi8(0x0f);
+	__m256i hin = _mm256_and_si256(_mm256_srli_epi16(v, 4), lomask);
+	__m256i lon = _mm256_and_si256(v, lomask);
+	__m256i gap = _mm256_set1_epi8('a' - '0' - 10);
+	__m256i nine = _mm256_set1_epi8(9);
+	__m256i zero = _mm256_set1_epi8('0');
+	__m256i hi = _mm256_add_epi8(_mm256_add_epi8(hin, zero), _mm256_and_si256(_mm256_cmpgt_epi8(hin, nine), gap));
+	__m256i lo = _mm256_add_epi8(_mm256_add_epi8(lon, zero), _mm256_and_si256(_mm256_cmpgt_epi8(lon, nine), gap));
+
+	// The unpacks work within each 128 bit lane, so the halves need to be
+	// swapped back in place
+	__m256i a = _mm256_unpacklo_epi8(hi, lo);
+	__m256i b = _mm256_unpackhi_epi8(hi, lo);
+	_mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(a, b, 0x20));
+	_mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(a, b, 0x31));
+}
+
+//
+// Base64 of 12 input bytes (of the 16 that are loaded) into 16 characters.
+// This is the well known multiply-shift approach by Wojciech Mula.
+//
+BUFENC_TARGET("ssse3")
+static inline __m128i base64_reshuffle_ssse3(__m128i in)
+{
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+	__m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+	__m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+	__m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+	return _mm_or_si128(t1, t3);
+}
+
+BUFENC_TARGET("ssse3")
+static inline __m128i base64_translate_ssse3(__m128i indices)
+{
+	// Offset to add to each 6 bit value, selected by range:
+	// 0..25 -> 'A', 26..51 -> 'a' - 26, 52..61 -> '0' - 52, 62 -> '+' - 62, 63 -> '/' - 63
+	const __m128i lut = _mm_setr_epi8('A', 'a' - 26,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'+' - 62, '/' - 63, 0, 0);
+	__m128i sel = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	__m128i lt26 = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+	// 0..25 -> 0, 26..51 -> 1, 52..63 -> 2..13
+	sel = _mm_add_epi8(sel, _mm_andnot_si128(lt26, _mm_set1_epi8(1)));
+	sel = _mm_and_si128(sel, _mm_andnot_si128(lt26, _mm_set1_epi8(0x0f)));
+	return _mm_add_epi8(indices, _mm_shuffle_epi8(lut, sel));
+}
+
+BUFENC_TARGET("avx2")
+static inline __m256i base64_reshuffle_avx2(__m256i in)
+{
+	in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+		10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+	__m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+	__m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+	__m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+	return _mm256_or_si256(t1, t3);
+}
+
+BUFENC_TARGET("avx2")
+static inline __m256i base64_translate_avx2(__m256i indices)
+{
+	const __m256i lut = _mm256_setr_epi8('A', 'a' - 26,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'+' - 62, '/' - 63, 0, 0,
+		'A', 'a' - 26,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'+' - 62, '/' - 63, 0, 0);
+	__m256i sel = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+	__m256i lt26 = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+	sel = _mm256_add_epi8(sel, _mm256_andnot_si256(lt26, _mm256_set1_epi8(1)));
+	sel = _mm256_and_si256(sel, _mm256_andnot_si256(lt26, _mm256_set1_epi8(0x0f)));
+	return _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut, sel));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Vectorized encoders
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t to_dots_sse2(char *dst, const char *src, uint32_t dstlen, uint32_t srclen)
+{
+	// The reference loop bails out when the output reaches dstlen - 1
+	uint32_t fit = srclen < dstlen - 1 ? srclen : dstlen - 1;
+	uint32_t j = 0;
+
+	for(; j + 16 <= fit; j += 16)
+	{
+		dots16_sse2(dst + j, src + j);
+	}
+
+	return to_dots_scalar(dst, src, dstlen, srclen, j);
+}
+
+BUFENC_TARGET("avx2")
+static uint32_t to_dots_avx2(char *dst, const char *src, uint32_t dstlen, uint32_t srclen)
+{
+	uint32_t fit = srclen < dstlen - 1 ? srclen : dstlen - 1;
+	uint32_t j = 0;
+
+	for(; j + 32 <= fit; j += 32)
+	{
+		dots32_avx2(dst + j, src + j);
+	}
+
+	if(j + 16 <= fit)
+	{
+		dots16_sse2(dst + j, src + j);
+		j += 16;
+	}
+
+	return to_dots_scalar(dst, src, dstlen, srclen, j);
+}
+
+//
+// Copy the runs of printable characters 16 (or 32) at a time, and let the
+// reference loop deal with the end of lines and the other special
+// characters one by one. The reference loop returns dstlen only when it
+// runs out of space.
+//
+static uint32_t to_asciionly_sse2(char *dst, const char *src, uint32_t dstlen, uint32_t srclen, uint32_t k)
+{
+	uint32_t j = 0;
+
+	while(j + 16 <= srclen)
+	{
+		if(k + 16 > dstlen - 1)
+		{
+			break;
+		}
+
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + j));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(printable_mask_sse2(v));
+		uint32_t nprint = (mask == 0xffff) ? 16 : __builtin_ctz(~mask);
+
+		_mm_storeu_si128((__m128i*)(dst + k), v);
+		j += nprint;
+		k += nprint;
+
+		if(nprint < 16)
+		{
+			k = to_asciionly_scalar(dst, src, dstlen, j + 1, j, k);
+			j++;
+		}
+	}
+
+	return to_asciionly_scalar(dst, src, dstlen, srclen, j, k);
+}
+
+BUFENC_TARGET("avx2")
+static uint32_t to_asciionly_avx2(char *dst, const char *src, uint32_t dstlen, uint32_t srclen, uint32_t k)
+{
+	uint32_t j = 0;
+
+	while(j + 32 <= srclen)
+	{
+		if(k + 32 > dstlen - 1)
+		{
+			break;
+		}
+
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + j));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(printable_mask_avx2(v));
+		uint32_t nprint = (mask == 0xffffffff) ? 32 : __builtin_ctz(~mask);
+
+		_mm256_storeu_si256((__m256i*)(dst + k), v);
+		j += nprint;
+		k += nprint;
+
+		if(nprint < 32)
+		{
+			k = to_asciionly_scalar(dst, src, dstlen, j + 1, j, k);
+			j++;
+		}
+	}
+
+	return to_asciionly_scalar(dst, src, dstlen, srclen, j, k);
+}
+
+BUFENC_TARGET("ssse3")
+static uint32_t to_base64_ssse3(char *dst, const char *src, uint32_t srclen)
+{
+	uint32_t j = 0;
+	uint32_t k = 0;
+
+	// Every step consumes 12 bytes but loads 16
+	for(; j + 16 <= srclen; j += 12, k += 16)
+	{
+		__m128i in = _mm_loadu_si128((const __m128i*)(src + j));
+		__m128i out = base64_translate_ssse3(base64_reshuffle_ssse3(in));
+		_mm_storeu_si128((__m128i*)(dst + k), out);
+	}
+
+	return to_base64_scalar(dst, src, srclen, j, k);
+}
+
+BUFENC_TARGET("avx2")
+static uint32_t to_base64_avx2(char *dst, const char *src, uint32_t srclen)
+{
+	uint32_t j = 0;
+	uint32_t k = 0;
+
+	// Every step consumes 24 bytes, 12 per lane, but loads up to j + 28
+	for(; j + 28 <= srclen; j += 24, k += 32)
+	{
+		__m128i lo = _mm_loadu_si128((const __m128i*)(src + j));
+		__m128i hi = _mm_loadu_si128((const __m128i*)(src + j + 12));
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		__m256i out = base64_translate_avx2(base64_reshuffle_avx2(in));
+		_mm256_storeu_si256((__m256i*)(dst + k), out);
+	}
+
+	for(; j + 16 <= srclen; j += 12, k += 16)
+	{
+		__m128i in = _mm_loadu_si128((const __m128i*)(src + j));
+		__m128i out = base64_translate_ssse3(base64_reshuffle_ssse3(in));
+		_mm_storeu_si128((__m128i*)(dst + k), out);
+	}
+
+	return to_base64_scalar(dst, src, srclen, j, k);
+}
+#endif // BUFENC_HAS_X86
+
+///////////////////////////////////////////////////////////////////////////////
+// Table-driven hexdump. The hex digits of full rows are produced by the
+// vectorized helpers, everything else is plain table lookups instead of
+// the sprintf() calls of the reference implementation.
+///////////////////////////////////////////////////////////////////////////////
+static inline void hexify_table(char *dst, const char *src, uint32_t len)
+{
+	for(uint32_t j = 0; j < len; j++)
+	{
+		dst[j * 2] = g_hex_digits[((uint8_t)src[j]) >> 4];
+		dst[j * 2 + 1] = g_hex_digits[((uint8_t)src[j]) & 0x0f];
+	}
+}
+
+static inline void dots_table(char *dst, const char *src, uint32_t len)
+{
+	for(uint32_t j = 0; j < len; j++)
+	{
+		uint8_t c = (uint8_t)src[j];
+		dst[j] = (c >= 0x20 && c < 0x7f) ? (char)c : '.';
+	}
+}
+
+static uint32_t to_hex_fast(char *dst, const char *src, uint32_t dstlen, uint32_t srclen, bool with_ascii,
+	buffer_encoders::isa isa)
+{
+	uint32_t l = 0;
+	char hex[64];
+	uint32_t hexbase = 0;
+	uint32_t hexlen = 0;
+
+	for(uint32_t j = 0; j < srclen; j += 16)
+	{
+		uint32_t nbytes = srclen - j < 16 ? srclen - j : 16;
+		uint32_t nchunks = (nbytes + 1) / 2;
+
+		//
+		// The row offset is printed with %.4x, i.e. with at least 4 digits
+		//
+		uint32_t ndigits = 4;
+		while(ndigits < 8 && (j >> (ndigits * 4)) != 0)
+		{
+			ndigits++;
+		}
+
+		uint32_t row_len = 4 + ndigits + 1 + nbytes * 2 + nchunks;
+		if(with_ascii)
+		{
+			row_len += (8 - nchunks) * 5 + 2 + nbytes;
+		}
+
+		if(l + row_len >= dstlen - 1)
+		{
+			dst[l] = '\n';
+			return dstlen;
+		}
+
+		//
+		// Hex digits for this row
+		//
+		if(j >= hexbase + hexlen)
+		{
+			hexbase = j;
+#ifdef BUFENC_HAS_X86
+			if(isa >= buffer_encoders::ISA_AVX2 && srclen - j >= 32)
+			{
+				hexify32_avx2(hex, src + j);
+				hexlen = 32;
+			}
+			else if(isa >= buffer_encoders::ISA_SSE2 && nbytes == 16)
+			{
+				hexify16_sse2(hex, src + j);
+				hexlen = 16;
+			}
+			else
+#endif
+			{
+				hexify_table(hex, src + j, nbytes);
+				hexlen = nbytes;
+			}
+		}
+		const char *rowhex = hex + (j - hexbase) * 2;
+
+		char *p = dst + l;
+		*p++ = '\n';
+		*p++ = '\t';
+		*p++ = '0';
+		*p++ = 'x';
+		for(uint32_t d = ndigits; d > 0; d--)
+		{
+			*p++ = g_hex_digits[(j >> ((d - 1) * 4)) & 0x0f];
+		}
+		*p++ = ':';
+
+		for(uint32_t c = 0; c < nchunks; c++)
+		{
+			*p++ = ' ';
+			if(c * 2 + 1 < nbytes)
+			{
+				memcpy(p, rowhex + c * 4, 4);
+				p += 4;
+			}
+			else
+			{
+				memcpy(p, rowhex + c * 4, 2);
+				p += 2;
+			}
+		}
+
+		if(with_ascii)
+		{
+			uint32_t npad = (8 - nchunks) * 5 + 2;
+			memset(p, ' ', npad);
+			p += npad;
+
+#ifdef BUFENC_HAS_X86
+			if(isa >= buffer_encoders::ISA_SSE2 && nbytes == 16)
+			{
+				dots16_sse2(p, src + j);
+			}
+			else
+#endif
+			{
+				dots_table(p, src + j, nbytes);
+			}
+			p += nbytes;
+		}
+
+		l += row_len;
+	}
+
+	dst[l++] = '\n';
+	return l;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Dispatch
+///////////////////////////////////////////////////////////////////////////////
+buffer_encoders::isa buffer_encoders::detect_isa()
+{
+#ifdef BUFENC_HAS_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return ISA_AVX2;
+	}
+	else if(__builtin_cpu_supports("ssse3"))
+	{
+		return ISA_SSSE3;
+	}
+	else if(__builtin_cpu_supports("sse2"))
+	{
+		return ISA_SSE2;
+	}
+#endif
+	return ISA_SCALAR;
+}
+
+buffer_encoders::isa buffer_encoders::get_isa()
+{
+	return m_isa;
+}
+
+void buffer_encoders::set_isa(isa val)
+{
+	isa best = detect_isa();
+	m_isa = val > best ? best : val;
+}
+
+const char* buffer_encoders::isa_name(isa val)
+{
+	switch(val)
+	{
+	case ISA_SCALAR:
+		return "scalar";
+	case ISA_SSE2:
+		return "sse2";
+	case ISA_SSSE3:
+		return "ssse3";
+	case ISA_AVX2:
+		return "avx2";
+	default:
+		return "unknown";
+	}
+}
+
+uint32_t buffer_encoders::to_hex(char* dst, const char* src, uint32_t dstlen, uint32_t srclen, bool with_ascii)
+{
+	if(m_isa == ISA_SCALAR)
+	{
+		return to_hex_scalar(dst, src, dstlen, srclen, with_ascii);
+	}
+
+	return to_hex_fast(dst, src, dstlen, srclen, with_ascii, m_isa);
+}
+
+uint32_t buffer_encoders::to_asciionly(char* dst, const char* src, uint32_t dstlen, uint32_t srclen, bool leading_eol)
+{
+	uint32_t k = 0;
+
+	if(leading_eol)
+	{
+		dst[k++] = '\n';
+	}
+
+#ifdef BUFENC_HAS_X86
+	if(m_isa >= ISA_AVX2)
+	{
+		return to_asciionly_avx2(dst, src, dstlen, srclen, k);
+	}
+	else if(m_isa >= ISA_SSE2)
+	{
+		return to_asciionly_sse2(dst, src, dstlen, srclen, k);
+	}
+#endif
+	return to_asciionly_scalar(dst, src, dstlen, srclen, 0, k);
+}
+
+uint32_t buffer_encoders::to_dots(char* dst, const char* src, uint32_t dstlen, uint32_t srclen)
+{
+#ifdef BUFENC_HAS_X86
+	if(m_isa >= ISA_AVX2)
+	{
+		return to_dots_avx2(dst, src, dstlen, srclen);
+	}
+	else if(m_isa >= ISA_SSE2)
+	{
+		return to_dots_sse2(dst, src, dstlen, srclen);
+	}
+#endif
+	return to_dots_scalar(dst, src, dstlen, srclen, 0);
+}
+
+uint32_t buffer_encoders::to_base64(char* dst, const char* src, uint32_t dstlen, uint32_t srclen)
+{
+	uint32_t enc_dstlen = 4 * ((srclen + 2) / 3);
+
+	//
+	// Make sure there's enough space in the target buffer.
+	//
+	if(enc_dstlen >= dstlen - 1)
+	{
+		return dstlen;
+	}
+
+#ifdef BUFENC_HAS_X86
+	if(m_isa >= ISA_AVX2)
+	{
+		return to_base64_avx2(dst, src, srclen);
+	}
+	else if(m_isa >= ISA_SSSE3)
+	{
+		return to_base64_ssse3(dst, src, srclen);
+	}
+#endif
+	return to_base64_scalar(dst, src, srclen, 0, 0);
+}
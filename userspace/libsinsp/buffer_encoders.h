@@ -0,0 +1,88 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+//
+// Renderers for binary buffers (read/write payloads, evt.buffer & co.).
+//
+// Every encoder has a byte-by-byte reference implementation and, on x86,
+// vectorized versions that are selected at runtime based on the CPU
+// features. All the implementations produce exactly the same output, including
+// the truncation behavior when dst is not big enough:
+//  - the return value is the number of characters written, or dstlen if the
+//    output didn't fit (in which case the caller is expected to grow dst and
+//    retry).
+//  - the output is not null-terminated.
+//
+// Printability is evaluated like isprint() in the "C" locale, which is the
+// one sysdig runs in.
+//
+class buffer_encoders
+{
+public:
+	enum isa
+	{
+		ISA_SCALAR = 0,	///< Byte-by-byte reference implementation
+		ISA_SSE2 = 1,
+		ISA_SSSE3 = 2,
+		ISA_AVX2 = 3,
+	};
+
+	//
+	// Return the best instruction set available on this CPU
+	//
+	static isa detect_isa();
+
+	//
+	// Get/set the instruction set used by the encoders. set_isa() is meant
+	// for tests and benchmarks, and never selects something that the CPU
+	// doesn't support.
+	//
+	static isa get_isa();
+	static void set_isa(isa val);
+	static const char* isa_name(isa val);
+
+	//
+	// Classic hexdump, 16 bytes per row, optionally followed by the
+	// printable version of the row (-X).
+	//
+	static uint32_t to_hex(char* dst, const char* src, uint32_t dstlen, uint32_t srclen, bool with_ascii);
+
+	//
+	// Only the printable characters plus the end of lines (-A). \r\n and
+	// \r are converted into \n.
+	//
+	static uint32_t to_asciionly(char* dst, const char* src, uint32_t dstlen, uint32_t srclen, bool leading_eol);
+
+	//
+	// The buffer with the non printable characters replaced by dots.
+	//
+	static uint32_t to_dots(char* dst, const char* src, uint32_t dstlen, uint32_t srclen);
+
+	//
+	// Base64 (-b)
+	//
+	static uint32_t to_base64(char* dst, const char* src, uint32_t dstlen, uint32_t srclen);
+
+private:
+	static isa m_isa;
+};
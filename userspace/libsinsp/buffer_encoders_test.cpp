@@ -0,0 +1,251 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "buffer_encoders.h"
+
+enum encoder_type
+{
+	ENC_HEX,
+	ENC_HEXASCII,
+	ENC_ASCIIONLY,
+	ENC_ASCIIONLY_COMPACT,
+	ENC_DOTS,
+	ENC_BASE64,
+};
+
+static const encoder_type g_encoders[] = {ENC_HEX, ENC_HEXASCII, ENC_ASCIIONLY, ENC_ASCIIONLY_COMPACT, ENC_DOTS, ENC_BASE64};
+
+static uint32_t encode(encoder_type type, char* dst, const char* src, uint32_t dstlen, uint32_t srclen)
+{
+	switch(type)
+	{
+	case ENC_HEX:
+		return buffer_encoders::to_hex(dst, src, dstlen, srclen, false);
+	case ENC_HEXASCII:
+		return buffer_encoders::to_hex(dst, src, dstlen, srclen, true);
+	case ENC_ASCIIONLY:
+		return buffer_encoders::to_asciionly(dst, src, dstlen, srclen, true);
+	case ENC_ASCIIONLY_COMPACT:
+		return buffer_encoders::to_asciionly(dst, src, dstlen, srclen, false);
+	case ENC_DOTS:
+		return buffer_encoders::to_dots(dst, src, dstlen, srclen);
+	case ENC_BASE64:
+		return buffer_encoders::to_base64(dst, src, dstlen, srclen);
+	}
+
+	return 0;
+}
+
+//
+// Run the encoder with the given instruction set and return the rendered
+// output (or the whole destination buffer if the output didn't fit).
+//
+static std::string run(buffer_encoders::isa isa, encoder_type type, const std::string& src, uint32_t dstlen, uint32_t* res)
+{
+	std::vector<char> dst(dstlen + 1, '#');
+
+	buffer_encoders::set_isa(isa);
+	*res = encode(type, &dst[0], src.data(), dstlen, (uint32_t)src.size());
+	return std::string(&dst[0], *res);
+}
+
+//
+// Either random bytes or text with an end of line every 40 characters or so
+//
+static std::string random_buffer(uint32_t len, bool text)
+{
+	static const char text_chars[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789\"\\<>{}";
+	static const char eol_chars[] = "\r\n\t";
+	std::string res(len, 0);
+
+	for(uint32_t j = 0; j < len; j++)
+	{
+		if(text)
+		{
+			if(rand() % 40 == 0)
+			{
+				res[j] = eol_chars[rand() % (sizeof(eol_chars) - 1)];
+			}
+			else
+			{
+				res[j] = text_chars[rand() % (sizeof(text_chars) - 1)];
+			}
+		}
+		else
+		{
+			res[j] = (char)(rand() & 0xff);
+		}
+	}
+
+	return res;
+}
+
+static void check_equivalence(const std::string& src, uint32_t dstlen)
+{
+	buffer_encoders::isa best = buffer_encoders::detect_isa();
+
+	for(encoder_type type : g_encoders)
+	{
+		uint32_t ref_res;
+		std::string ref = run(buffer_encoders::ISA_SCALAR, type, src, dstlen, &ref_res);
+
+		for(int32_t isa = buffer_encoders::ISA_SSE2; isa <= best; isa++)
+		{
+			uint32_t res;
+			std::string out = run((buffer_encoders::isa)isa, type, src, dstlen, &res);
+
+			ASSERT_EQ(ref_res, res) << "encoder " << type << " isa " << buffer_encoders::isa_name((buffer_encoders::isa)isa)
+				<< " srclen " << src.size() << " dstlen " << dstlen;
+			ASSERT_EQ(ref, out) << "encoder " << type << " isa " << buffer_encoders::isa_name((buffer_encoders::isa)isa)
+				<< " srclen " << src.size() << " dstlen " << dstlen;
+		}
+	}
+
+	buffer_encoders::set_isa(best);
+}
+
+TEST(buffer_encoders, reference_output)
+{
+	const char src[] = "GET / HTTP/1.1\r\nHost: x\r\n\x01\xff";
+	uint32_t srclen = sizeof(src) - 1;
+	char dst[1024];
+	uint32_t res;
+
+	for(int32_t isa = buffer_encoders::ISA_SCALAR; isa <= buffer_encoders::detect_isa(); isa++)
+	{
+		buffer_encoders::set_isa((buffer_encoders::isa)isa);
+
+		res = buffer_encoders::to_dots(dst, src, sizeof(dst), srclen);
+		EXPECT_EQ("GET / HTTP/1.1..Host: x....", std::string(dst, res));
+
+		res = buffer_encoders::to_asciionly(dst, src, sizeof(dst), srclen, true);
+		EXPECT_EQ("\nGET / HTTP/1.1\nHost: x\n", std::string(dst, res));
+
+		res = buffer_encoders::to_base64(dst, src, sizeof(dst), 5);
+		EXPECT_EQ("R0VUIC8=", std::string(dst, res));
+
+		res = buffer_encoders::to_hex(dst, src, sizeof(dst), 17, true);
+		EXPECT_EQ("\n\t0x0000: 4745 5420 2f20 4854 5450 2f31 2e31 0d0a  GET / HTTP/1.1.."
+			"\n\t0x0010: 48" + std::string(7 * 5 + 2, ' ') + "H\n", std::string(dst, res));
+	}
+
+	buffer_encoders::set_isa(buffer_encoders::detect_isa());
+}
+
+TEST(buffer_encoders, equivalence_sizes)
+{
+	srand(42);
+
+	for(uint32_t len = 0; len < 300; len++)
+	{
+		check_equivalence(random_buffer(len, false), 100000);
+		check_equivalence(random_buffer(len, true), 100000);
+	}
+
+	check_equivalence(random_buffer(65535, false), 1000000);
+	check_equivalence(random_buffer(65535, true), 1000000);
+	check_equivalence(random_buffer(70000, false), 1000000);
+}
+
+TEST(buffer_encoders, equivalence_truncation)
+{
+	srand(43);
+
+	std::string bin = random_buffer(200, false);
+	std::string text = random_buffer(200, true);
+	std::string printable(200, 'a');
+
+	for(uint32_t dstlen = 2; dstlen < 1200; dstlen++)
+	{
+		check_equivalence(bin, dstlen);
+		check_equivalence(text, dstlen);
+		check_equivalence(printable, dstlen);
+	}
+}
+
+TEST(buffer_encoders, equivalence_eols)
+{
+	// End of lines right at the vector boundaries
+	std::string src(128, 'x');
+	for(uint32_t j = 0; j < src.size(); j++)
+	{
+		std::string s = src;
+		s[j] = '\n';
+		check_equivalence(s, 4096);
+		s[j] = '\r';
+		check_equivalence(s, 4096);
+		if(j + 1 < s.size())
+		{
+			s[j + 1] = '\n';
+			check_equivalence(s, 4096);
+		}
+	}
+}
+
+//
+// Throughput of every encoder and instruction set across buffer sizes.
+// Run with --gtest_also_run_disabled_tests.
+//
+TEST(buffer_encoders, DISABLED_benchmark)
+{
+	const uint32_t sizes[] = {64, 1024, 16384, 65535};
+	const char* names[] = {"hex", "hexascii", "asciionly", "asciionly_compact", "dots", "base64"};
+	const uint64_t total_bytes = 32 * 1024 * 1024;
+	std::vector<char> dst(65536 * 8);
+
+	srand(44);
+
+	for(uint32_t size : sizes)
+	{
+		std::string src = random_buffer(size, true);
+
+		for(encoder_type type : g_encoders)
+		{
+			for(int32_t isa = buffer_encoders::ISA_SCALAR; isa <= buffer_encoders::detect_isa(); isa++)
+			{
+				buffer_encoders::set_isa((buffer_encoders::isa)isa);
+
+				uint64_t iterations = total_bytes / size;
+				auto start = std::chrono::steady_clock::now();
+				for(uint64_t j = 0; j < iterations; j++)
+				{
+					encode(type, &dst[0], src.data(), (uint32_t)dst.size(), size);
+				}
+				auto end = std::chrono::steady_clock::now();
+				double secs = std::chrono::duration<double>(end - start).count();
+
+				printf("%-18s %-7s %6u bytes: %8.1f MB/s\n",
+					names[type],
+					buffer_encoders::isa_name((buffer_encoders::isa)isa),
+					size,
+					(double)(iterations * size) / secs / (1024 * 1024));
+			}
+		}
+	}
+
+	buffer_encoders::set_isa(buffer_encoders::detect_isa());
+}
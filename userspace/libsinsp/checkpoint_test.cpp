@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "../../driver/ppm_events_public.h"
+
+//
+// A close() of this process, at the given time
+//
+static void dump_close(scap_t* h, scap_dumper_t* dumper, uint64_t ts)
+{
+	struct
+	{
+		scap_evt hdr;
+		uint16_t len;
+		int64_t fd;
+	} __attribute__((packed)) evt;
+
+	memset(&evt, 0, sizeof(evt));
+	evt.hdr.ts = ts;
+	evt.hdr.tid = getpid();
+	evt.hdr.len = sizeof(evt);
+	evt.hdr.type = PPME_SYSCALL_CLOSE_E;
+	evt.hdr.nparams = 1;
+	evt.len = sizeof(evt.fd);
+
+	ASSERT_EQ(SCAP_SUCCESS, scap_dump(h, dumper, &evt.hdr, 0, 0));
+}
+
+static std::vector<uint64_t> read_ts(sinsp* inspector)
+{
+	std::vector<uint64_t> res;
+	sinsp_evt* evt;
+	int32_t rc;
+
+	while((rc = inspector->next(&evt)) != SCAP_EOF)
+	{
+		if(rc == SCAP_SUCCESS && evt->get_type() == PPME_SYSCALL_CLOSE_E)
+		{
+			res.push_back(evt->get_ts());
+		}
+	}
+
+	return res;
+}
+
+class checkpoint : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_open_args oargs = {};
+		char raw[] = "/tmp/sinsp_checkpoint_testXXXXXX";
+		char path[] = "/tmp/sinsp_checkpoint_testXXXXXX";
+
+		::close(mkstemp(raw));
+		::close(mkstemp(path));
+		m_path = path;
+
+		oargs.mode = SCAP_MODE_NODRIVER;
+		oargs.import_users = true;
+		scap_t* h = scap_open(oargs, error, &rc);
+		ASSERT_NE(nullptr, h) << error;
+		scap_dumper_t* dumper = scap_dump_open(h, raw, SCAP_COMPRESSION_NONE, false);
+		ASSERT_NE(nullptr, dumper) << scap_getlasterr(h);
+
+		m_ts = sinsp_utils::get_current_time_ns();
+		for(uint64_t ts : std::vector<uint64_t>({m_ts, m_ts + ONE_SECOND_IN_NS, m_ts + ONE_SECOND_IN_NS, m_ts + 2 * ONE_SECOND_IN_NS}))
+		{
+			dump_close(h, dumper, ts);
+		}
+
+		scap_dump_close(dumper);
+		scap_close(h);
+
+		//
+		// The checkpoint goes right after the first event one second in,
+		// before the second one with the same timestamp
+		//
+		sinsp inspector;
+		inspector.open(raw);
+		inspector.set_checkpoint_interval(ONE_SECOND_IN_NS);
+		inspector.autodump_start(m_path, false);
+		read_ts(&inspector);
+		inspector.close();
+		unlink(raw);
+	}
+
+	void TearDown()
+	{
+		unlink(m_path.c_str());
+	}
+
+	std::string m_path;
+	uint64_t m_ts;
+};
+
+TEST_F(checkpoint, list)
+{
+	std::vector<scap_checkpoint_info> checkpoints;
+
+	sinsp::get_checkpoints(m_path, &checkpoints);
+	ASSERT_EQ(1u, checkpoints.size());
+	EXPECT_EQ(m_ts + ONE_SECOND_IN_NS, checkpoints[0].ts);
+	EXPECT_EQ(2u, checkpoints[0].nevts - checkpoints[0].nstateevts);
+}
+
+//
+// Seeking to the timestamp of a checkpoint starts before it, so that the
+// events at that timestamp written before the checkpoint are read too
+//
+TEST_F(checkpoint, seek)
+{
+	sinsp inspector;
+	uint64_t cp_ts = m_ts + ONE_SECOND_IN_NS;
+
+	inspector.open(m_path);
+	EXPECT_EQ(4u, read_ts(&inspector).size());
+
+	inspector.seek_to_checkpoint(cp_ts);
+	EXPECT_EQ(std::vector<uint64_t>({m_ts, cp_ts, cp_ts, m_ts + 2 * ONE_SECOND_IN_NS}), read_ts(&inspector));
+
+	inspector.seek_to_checkpoint(cp_ts + 1);
+	EXPECT_EQ(std::vector<uint64_t>({cp_ts, m_ts + 2 * ONE_SECOND_IN_NS}), read_ts(&inspector));
+
+	inspector.close();
+}
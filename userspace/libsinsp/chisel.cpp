@@ -28,6 +28,9 @@ limitations under the License.
 #include <stdlib.h>
 #include <unistd.h>
 #endif
+#include <atomic>
+#include <thread>
+#include <sys/stat.h>
 #include <third-party/tinydir.h>
 #include <json/json.h>
 
@@ -38,6 +41,7 @@ limitations under the License.
 #include "filter.h"
 #include "filterchecks.h"
 #include "table.h"
+#include "span_aggregator.h"
 
 #ifdef HAS_CHISELS
 #define HAS_LUA_CHISELS
@@ -112,6 +116,8 @@ const static struct luaL_reg ll_sysdig [] =
 	{"get_thread_table_nofds", &lua_cbacks::get_thread_table_nofds},
 	{"get_thread_table_barebone", &lua_cbacks::get_thread_table_barebone},
 	{"get_thread_table_barebone_nofds", &lua_cbacks::get_thread_table_barebone_nofds},
+	{"iter_thread_table", &lua_cbacks::iter_thread_table},
+	{"iter_thread_table_nofds", &lua_cbacks::iter_thread_table_nofds},
 	{"get_container_table", &lua_cbacks::get_container_table},
 	{"is_print_container_data", &lua_cbacks::is_print_container_data},
 	{"get_output_format", &lua_cbacks::get_output_format},
@@ -142,6 +148,8 @@ const static struct luaL_reg ll_chisel [] =
 	{"set_interval_s", &lua_cbacks::set_interval_s},
 	{"set_precise_interval_ns", &lua_cbacks::set_precise_interval_ns},
 	{"exec", &lua_cbacks::exec},
+	{"set_span_aggregation", &lua_cbacks::set_span_aggregation},
+	{"print_span_aggregation", &lua_cbacks::print_span_aggregation},
 	{NULL,NULL}
 };
 
@@ -164,6 +172,7 @@ chiselinfo::chiselinfo(sinsp* inspector)
 	m_filter = NULL;
 	m_formatter = NULL;
 	m_dumper = NULL;
+	m_span_aggregator = NULL;
 	m_inspector = inspector;
 	m_has_nextrun_args = false;
 	m_end_capture = false;
@@ -190,6 +199,11 @@ chiselinfo::~chiselinfo()
 	{
 		delete m_dumper;
 	}
+
+	if(m_span_aggregator)
+	{
+		delete m_span_aggregator;
+	}
 }
 
 void chiselinfo::init(string filterstr, string formatterstr)
@@ -257,6 +271,9 @@ sinsp_chisel::sinsp_chisel(sinsp* inspector, string filename)
 	m_lua_last_interval_sample_time = 0;
 	m_lua_last_interval_ts = 0;
 	m_udp_socket = 0;
+	m_has_shards = false;
+	m_shards_first_ts = 0;
+	m_shards_last_ts = 0;
 
 	load(filename);
 }
@@ -716,7 +733,6 @@ bool sinsp_chisel::parse_view_info(lua_State *ls, OUT chisel_desc* cd)
 	lua_getglobal(ls, "view_info");
 	if(lua_isnoneornil(ls, -1))
 	{
-		lua_close(ls);
 		return false;
 	}
 
@@ -962,6 +978,7 @@ bool sinsp_chisel::parse_view_info(lua_State *ls, OUT chisel_desc* cd)
 // Initializes a lua chisel
 bool sinsp_chisel::init_lua_chisel(chisel_desc &cd, string const &fpath)
 {
+	bool res;
 	lua_State* ls = lua_open();
 	if(ls == NULL)
 	{
@@ -1002,7 +1019,18 @@ bool sinsp_chisel::init_lua_chisel(chisel_desc &cd, string const &fpath)
 	lua_getglobal(ls, "description");
 	if(!lua_isstring(ls, -1))
 	{
-		return parse_view_info(ls, &cd);
+		try
+		{
+			res = parse_view_info(ls, &cd);
+		}
+		catch(...)
+		{
+			lua_close(ls);
+			throw;
+		}
+
+		lua_close(ls);
+		return res;
 	}
 	cd.m_description = lua_tostring(ls, -1);
 
@@ -1057,6 +1085,7 @@ bool sinsp_chisel::init_lua_chisel(chisel_desc &cd, string const &fpath)
 		goto failure;
 	}
 
+	lua_close(ls);
 	return true;
 
 failure:
@@ -1089,13 +1118,414 @@ static filename split_filename(string const &fname)
 	return res;
 }
 
+#ifdef HAS_LUA_CHISELS
+//
+// Chisel catalog cache
+//
+#define CHISEL_CATALOG_VERSION 1
+
+static string g_chisel_catalog_file;
+static string g_chisel_catalog_sysdig_version;
+
+typedef struct chisel_load_job
+{
+	string m_path;
+	string m_name;
+	int64_t m_mtime;
+	int64_t m_mtime_ns;
+	int64_t m_size;
+	bool m_loaded;
+	bool m_is_chisel;
+	chisel_desc m_desc;
+	std::exception_ptr m_error;
+}chisel_load_job;
+
+static Json::Value strings_to_json(const vector<string>& strs)
+{
+	Json::Value res(Json::arrayValue);
+
+	for(const string& s : strs)
+	{
+		res.append(s);
+	}
+
+	return res;
+}
+
+static vector<string> json_to_strings(const Json::Value& jv)
+{
+	vector<string> res;
+
+	for(const Json::Value& s : jv)
+	{
+		res.push_back(s.asString());
+	}
+
+	return res;
+}
+
+static Json::Value chisel_desc_to_json(const chisel_desc& cd)
+{
+	Json::Value res;
+
+	res["description"] = cd.m_description;
+	res["category"] = cd.m_category;
+	res["shortdesc"] = cd.m_shortdesc;
+
+	res["args"] = Json::Value(Json::arrayValue);
+	for(const chiselarg_desc& arg : cd.m_args)
+	{
+		Json::Value jarg;
+		jarg["name"] = arg.m_name;
+		jarg["type"] = arg.m_type;
+		jarg["description"] = arg.m_description;
+		jarg["optional"] = arg.m_optional;
+		res["args"].append(jarg);
+	}
+
+	const sinsp_view_info& vi = cd.m_viewinfo;
+	if(vi.m_valid)
+	{
+		Json::Value jview;
+
+		//
+		// The view is rebuilt through the sinsp_view_info constructor, which
+		// recomputes the derived fields (sorting column, hotkeys, etc.)
+		//
+		jview["type"] = (uint32_t)vi.m_type;
+		jview["id"] = vi.m_id;
+		jview["name"] = vi.m_name;
+		jview["description"] = vi.m_description;
+		jview["tags"] = strings_to_json(vi.m_tags);
+		jview["tips"] = strings_to_json(vi.m_tips);
+		jview["applies_to"] = strings_to_json(vi.m_applies_to);
+		jview["filter"] = vi.m_filter;
+		jview["drilldown_target"] = vi.m_drilldown_target;
+		jview["use_defaults"] = vi.m_use_defaults;
+		jview["is_root"] = vi.m_is_root;
+		jview["drilldown_increase_depth"] = vi.m_drilldown_increase_depth;
+		jview["spectro_type"] = vi.m_spectro_type;
+		jview["propagate_filter"] = vi.m_propagate_filter;
+
+		jview["columns"] = Json::Value(Json::arrayValue);
+		for(const sinsp_view_column_info& col : vi.m_columns)
+		{
+			Json::Value jcol;
+			jcol["field"] = col.m_field;
+			jcol["name"] = col.m_name;
+			jcol["description"] = col.m_description;
+			jcol["colsize"] = col.m_colsize;
+			jcol["flags"] = col.m_flags;
+			jcol["aggregation"] = (uint32_t)col.m_aggregation;
+			jcol["groupby_aggregation"] = (uint32_t)col.m_groupby_aggregation;
+			jcol["tags"] = strings_to_json(col.m_tags);
+			jcol["filterfield"] = col.m_filterfield;
+			jview["columns"].append(jcol);
+		}
+
+		jview["actions"] = Json::Value(Json::arrayValue);
+		for(const sinsp_view_action_info& act : vi.m_actions)
+		{
+			Json::Value jact;
+			jact["hotkey"] = (int32_t)act.m_hotkey;
+			jact["command"] = act.m_command;
+			jact["description"] = act.m_description;
+			jact["ask_confirmation"] = act.m_ask_confirmation;
+			jact["waitfinish"] = act.m_waitfinish;
+			jview["actions"].append(jact);
+		}
+
+		res["view"] = jview;
+	}
+
+	return res;
+}
+
+static void json_to_chisel_desc(const Json::Value& jv, OUT chisel_desc* cd)
+{
+	cd->m_description = jv["description"].asString();
+	cd->m_category = jv["category"].asString();
+	cd->m_shortdesc = jv["shortdesc"].asString();
+
+	for(const Json::Value& jarg : jv["args"])
+	{
+		cd->m_args.push_back(chiselarg_desc(jarg["name"].asString(),
+			jarg["type"].asString(),
+			jarg["description"].asString(),
+			jarg["optional"].asBool()));
+	}
+
+	const Json::Value& jview = jv["view"];
+	if(jview.isObject())
+	{
+		vector<sinsp_view_column_info> columns;
+		vector<sinsp_view_action_info> actions;
+
+		for(const Json::Value& jcol : jview["columns"])
+		{
+			columns.push_back(sinsp_view_column_info(jcol["field"].asString(),
+				jcol["name"].asString(),
+				jcol["description"].asString(),
+				jcol["colsize"].asUInt(),
+				jcol["flags"].asUInt(),
+				(sinsp_field_aggregation)jcol["aggregation"].asUInt(),
+				(sinsp_field_aggregation)jcol["groupby_aggregation"].asUInt(),
+				json_to_strings(jcol["tags"]),
+				jcol["filterfield"].asString()));
+		}
+
+		for(const Json::Value& jact : jview["actions"])
+		{
+			actions.push_back(sinsp_view_action_info((char)jact["hotkey"].asInt(),
+				jact["command"].asString(),
+				jact["description"].asString(),
+				jact["ask_confirmation"].asBool(),
+				jact["waitfinish"].asBool()));
+		}
+
+		cd->m_viewinfo = sinsp_view_info((sinsp_view_info::viewtype)jview["type"].asUInt(),
+			jview["id"].asString(),
+			jview["name"].asString(),
+			jview["description"].asString(),
+			json_to_strings(jview["tags"]),
+			json_to_strings(jview["tips"]),
+			columns,
+			json_to_strings(jview["applies_to"]),
+			jview["filter"].asString(),
+			jview["drilldown_target"].asString(),
+			jview["use_defaults"].asBool(),
+			jview["is_root"].asBool(),
+			actions,
+			jview["drilldown_increase_depth"].asBool(),
+			jview["spectro_type"].asString(),
+			jview["propagate_filter"].asBool());
+	}
+}
+
+//
+// Fill the jobs whose file didn't change since the catalog was written.
+// Any problem with the catalog just means that every chisel gets loaded.
+//
+static void read_chisel_catalog(const string& filename, vector<chisel_load_job>* jobs)
+{
+	ifstream is(filename);
+	Json::Value root;
+	Json::Reader reader;
+
+	if(!is.is_open() || !reader.parse(is, root, false) || !root.isObject())
+	{
+		return;
+	}
+
+	if(root["version"].asUInt() != CHISEL_CATALOG_VERSION ||
+		root["sysdig_version"].asString() != g_chisel_catalog_sysdig_version)
+	{
+		return;
+	}
+
+	const Json::Value& entries = root["chisels"];
+	if(!entries.isObject())
+	{
+		return;
+	}
+
+	try
+	{
+		for(chisel_load_job& job : *jobs)
+		{
+			const Json::Value& entry = entries[job.m_path];
+
+			if(!entry.isObject() ||
+				entry["mtime"].asInt64() != job.m_mtime ||
+				entry["mtime_ns"].asInt64() != job.m_mtime_ns ||
+				entry["size"].asInt64() != job.m_size)
+			{
+				continue;
+			}
+
+			job.m_desc.m_name = job.m_name;
+			job.m_is_chisel = entry["is_chisel"].asBool();
+			if(job.m_is_chisel)
+			{
+				json_to_chisel_desc(entry["desc"], &job.m_desc);
+			}
+
+			job.m_loaded = true;
+		}
+	}
+	catch(...)
+	{
+		//
+		// Malformed catalog. Throw away what we got from it.
+		//
+		for(chisel_load_job& job : *jobs)
+		{
+			job.m_desc = chisel_desc();
+			job.m_loaded = false;
+		}
+	}
+}
+
+static void write_chisel_catalog(const string& filename, const vector<chisel_load_job>& jobs)
+{
+	Json::Value root;
+	Json::FastWriter writer;
+
+	root["version"] = CHISEL_CATALOG_VERSION;
+	root["sysdig_version"] = g_chisel_catalog_sysdig_version;
+	root["chisels"] = Json::Value(Json::objectValue);
+
+	for(const chisel_load_job& job : jobs)
+	{
+		//
+		// Chisels that failed with an error are not cached, so that the
+		// error is reported again next time
+		//
+		if(!job.m_loaded)
+		{
+			continue;
+		}
+
+		Json::Value entry;
+		entry["mtime"] = (Json::Int64)job.m_mtime;
+		entry["mtime_ns"] = (Json::Int64)job.m_mtime_ns;
+		entry["size"] = (Json::Int64)job.m_size;
+		entry["is_chisel"] = job.m_is_chisel;
+		if(job.m_is_chisel)
+		{
+			entry["desc"] = chisel_desc_to_json(job.m_desc);
+		}
+
+		root["chisels"][job.m_path] = entry;
+	}
+
+#ifndef _WIN32
+	//
+	// Create the cache directory if needed (one level is enough for the
+	// default location), then replace the catalog atomically, so that
+	// concurrent runs never see a partial file.
+	//
+	string::size_type sep = filename.rfind('/');
+	if(sep != string::npos && sep != 0)
+	{
+		string dir = filename.substr(0, sep);
+		string::size_type parent_sep = dir.rfind('/');
+		if(parent_sep != string::npos && parent_sep != 0)
+		{
+			mkdir(dir.substr(0, parent_sep).c_str(), 0755);
+		}
+		mkdir(dir.c_str(), 0755);
+	}
+
+	string tmpname = filename + ".tmp." + to_string(getpid());
+#else
+	string tmpname = filename + ".tmp";
+#endif
+
+	ofstream os(tmpname);
+	if(!os.is_open())
+	{
+		return;
+	}
+
+	os << writer.write(root);
+	os.close();
+
+	if(os.fail() || rename(tmpname.c_str(), filename.c_str()) != 0)
+	{
+		remove(tmpname.c_str());
+	}
+}
+
+//
+// Evaluate the chisels that are not in the catalog. Every chisel gets its own
+// lua state, so they can be loaded in parallel.
+//
+void sinsp_chisel::load_chisel_descs(void* pjobs)
+{
+	vector<chisel_load_job*>* jobs = (vector<chisel_load_job*>*)pjobs;
+	std::atomic<uint32_t> next_job(0);
+
+	auto worker = [&]()
+	{
+		uint32_t j;
+
+		while((j = next_job++) < jobs->size())
+		{
+			chisel_load_job* job = jobs->at(j);
+
+			try
+			{
+				job->m_desc.m_name = job->m_name;
+				job->m_is_chisel = init_lua_chisel(job->m_desc, job->m_path);
+				job->m_loaded = true;
+			}
+			catch(...)
+			{
+				job->m_error = std::current_exception();
+			}
+		}
+	};
+
+	uint32_t nthreads = std::thread::hardware_concurrency();
+	if(nthreads > jobs->size())
+	{
+		nthreads = (uint32_t)jobs->size();
+	}
+
+	vector<std::thread> threads;
+	for(uint32_t j = 1; j < nthreads; j++)
+	{
+		threads.push_back(std::thread(worker));
+	}
+
+	worker();
+
+	for(std::thread& t : threads)
+	{
+		t.join();
+	}
+}
+#endif // HAS_LUA_CHISELS
+
+void sinsp_chisel::set_catalog_cache_file(const string& filename, const string& version)
+{
+#ifdef HAS_LUA_CHISELS
+	g_chisel_catalog_file = filename;
+	g_chisel_catalog_sysdig_version = version;
+#endif
+}
+
+string sinsp_chisel::get_default_catalog_cache_file()
+{
+#ifndef _WIN32
+	const char* cache_home = getenv("XDG_CACHE_HOME");
+	if(cache_home != NULL && cache_home[0] != 0)
+	{
+		return string(cache_home) + "/sysdig/chisel_catalog.json";
+	}
+
+	const char* home = getenv("HOME");
+	if(home != NULL && home[0] != 0)
+	{
+		return string(home) + "/.cache/sysdig/chisel_catalog.json";
+	}
+#endif
+
+	return "";
+}
+
 //
 // 1. Iterates through the chisel files on disk (.sc and .lua)
-// 2. Opens them and extracts the fields (name, description, etc)
+// 2. Opens them and extracts the fields (name, description, etc), or takes
+//    them from the catalog cache if the file didn't change since last time
 // 3. Adds them to the chisel_descs vector.
 //
 void sinsp_chisel::get_chisel_list(vector<chisel_desc>* chisel_descs)
 {
+#ifdef HAS_LUA_CHISELS
+	vector<chisel_load_job> jobs;
+
 	for(vector<chiseldir_info>::const_iterator it = g_chisel_dirs->begin();
 		it != g_chisel_dirs->end(); ++it)
 	{
@@ -1113,43 +1543,99 @@ void sinsp_chisel::get_chisel_list(vector<chisel_desc>* chisel_descs)
 			tinydir_file file;
 			tinydir_readfile(&dir, &file);
 
-			string fpath(file.path);
-			bool add_to_vector = false;
-			chisel_desc cd;
-
 			filename fn = split_filename(string(file.name));
-			if(fn.ext != "sc" && fn.ext != "lua")
-			{
-				goto next_file;
-			}
-
-			for(vector<chisel_desc>::const_iterator it_desc = chisel_descs->begin();
-				it_desc != chisel_descs->end(); ++it_desc)
+			if(fn.ext == "lua")
 			{
-				if(fn.name == it_desc->m_name)
+				chisel_load_job job;
+				struct stat st;
+
+				job.m_path = file.path;
+				job.m_name = fn.name;
+				job.m_mtime = 0;
+				job.m_mtime_ns = 0;
+				job.m_size = -1;
+				job.m_loaded = false;
+				job.m_is_chisel = false;
+
+				if(stat(file.path, &st) == 0)
 				{
-					goto next_file;
+					job.m_mtime = st.st_mtime;
+#ifdef __linux__
+					job.m_mtime_ns = st.st_mtim.tv_nsec;
+#endif
+					job.m_size = st.st_size;
 				}
-			}
-			cd.m_name = fn.name;
 
-#ifdef HAS_LUA_CHISELS
-			if(fn.ext == "lua")
-			{
-				add_to_vector = init_lua_chisel(cd, fpath);
+				jobs.push_back(job);
 			}
 
-			if(add_to_vector)
-			{
-				chisel_descs->push_back(cd);
-			}
-#endif
-next_file:
 			tinydir_next(&dir);
 		}
 
 		tinydir_close(&dir);
 	}
+
+	bool use_catalog = !g_chisel_catalog_file.empty();
+
+	if(use_catalog)
+	{
+		read_chisel_catalog(g_chisel_catalog_file, &jobs);
+	}
+
+	vector<chisel_load_job*> to_load;
+	for(chisel_load_job& job : jobs)
+	{
+		if(!job.m_loaded)
+		{
+			to_load.push_back(&job);
+		}
+	}
+
+	if(!to_load.empty())
+	{
+		load_chisel_descs(&to_load);
+
+		if(use_catalog)
+		{
+			write_chisel_catalog(g_chisel_catalog_file, jobs);
+		}
+	}
+
+	//
+	// Add the chisels in directory order. A chisel in a directory shadows the
+	// ones with the same name in the following directories, and errors are
+	// reported only for the chisels that would have been used.
+	//
+	for(chisel_load_job& job : jobs)
+	{
+		bool duplicate = false;
+
+		for(vector<chisel_desc>::const_iterator it_desc = chisel_descs->begin();
+			it_desc != chisel_descs->end(); ++it_desc)
+		{
+			if(job.m_name == it_desc->m_name)
+			{
+				duplicate = true;
+				break;
+			}
+		}
+
+		if(duplicate)
+		{
+			continue;
+		}
+
+		if(job.m_error)
+		{
+			std::rethrow_exception(job.m_error);
+		}
+
+		if(job.m_is_chisel)
+		{
+			chisel_descs->push_back(job.m_desc);
+		}
+	}
+#endif
 }
 
 //
@@ -1588,6 +2074,14 @@ bool sinsp_chisel::run(sinsp_evt* evt)
 		}
 	}
 
+	//
+	// The span aggregation doesn't need the script
+	//
+	if(m_lua_cinfo->m_span_aggregator != NULL)
+	{
+		m_lua_cinfo->m_span_aggregator->process_event(evt);
+	}
+
 	//
 	// If the script has the on_event callback, call it
 	//
@@ -1778,6 +2272,13 @@ void sinsp_chisel::on_capture_end()
 	{
 		uint64_t ts = m_inspector->m_firstevent_ts;
 		uint64_t te = m_inspector->m_lastevent_ts;
+
+		if(m_has_shards)
+		{
+			ts = m_shards_first_ts;
+			te = m_shards_last_ts;
+		}
+
 		int64_t delta = te - ts;
 
 		lua_pushnumber(m_ls, (double)(te / 1000000000));
@@ -1802,4 +2303,168 @@ bool sinsp_chisel::get_nextrun_args(OUT string* args)
 	return m_lua_cinfo->m_has_nextrun_args;
 }
 
+#ifdef HAS_LUA_CHISELS
+//
+// Mergeable results travel between processes as json. Lua tables are
+// converted into arrays of [key, value] pairs, so that the type of the keys
+// (e.g. fd numbers vs file names) is preserved.
+//
+static Json::Value lua_to_json(lua_State* ls, int idx, const string& chname)
+{
+	if(idx < 0)
+	{
+		idx = lua_gettop(ls) + idx + 1;
+	}
+
+	switch(lua_type(ls, idx))
+	{
+	case LUA_TNUMBER:
+		return Json::Value(lua_tonumber(ls, idx));
+	case LUA_TBOOLEAN:
+		return Json::Value(lua_toboolean(ls, idx) != 0);
+	case LUA_TSTRING:
+		{
+			size_t len;
+			const char* str = lua_tolstring(ls, idx, &len);
+			return Json::Value(str, str + len);
+		}
+	case LUA_TTABLE:
+		{
+			Json::Value res(Json::arrayValue);
+
+			lua_pushnil(ls);
+			while(lua_next(ls, idx) != 0)
+			{
+				Json::Value entry(Json::arrayValue);
+				entry.append(lua_to_json(ls, -2, chname));
+				entry.append(lua_to_json(ls, -1, chname));
+				res.append(entry);
+				lua_pop(ls, 1);
+			}
+
+			return res;
+		}
+	default:
+		throw sinsp_exception(chname + " chisel error: get_mergeable_result() can only return numbers, strings, booleans and tables");
+	}
+}
+
+static void json_to_lua(lua_State* ls, const Json::Value& jv)
+{
+	if(jv.isArray())
+	{
+		lua_newtable(ls);
+
+		for(const Json::Value& entry : jv)
+		{
+			json_to_lua(ls, entry[0]);
+			json_to_lua(ls, entry[1]);
+			lua_settable(ls, -3);
+		}
+	}
+	else if(jv.isString())
+	{
+		string str = jv.asString();
+		lua_pushlstring(ls, str.c_str(), str.size());
+	}
+	else if(jv.isBool())
+	{
+		lua_pushboolean(ls, jv.asBool());
+	}
+	else
+	{
+		lua_pushnumber(ls, jv.asDouble());
+	}
+}
+#endif // HAS_LUA_CHISELS
+
+bool sinsp_chisel::is_mergeable()
+{
+#ifdef HAS_LUA_CHISELS
+	bool res;
+
+	lua_getglobal(m_ls, "get_mergeable_result");
+	lua_getglobal(m_ls, "on_merge");
+	res = lua_isfunction(m_ls, -1) && lua_isfunction(m_ls, -2);
+	lua_pop(m_ls, 2);
+
+	return res;
+#else
+	return false;
+#endif
+}
+
+void sinsp_chisel::on_shard_end()
+{
+	//
+	// A shard that didn't see any event doesn't contribute to the range
+	//
+	if(m_inspector->m_lastevent_ts == 0)
+	{
+		return;
+	}
+
+	if(!m_has_shards || m_inspector->m_firstevent_ts < m_shards_first_ts)
+	{
+		m_shards_first_ts = m_inspector->m_firstevent_ts;
+	}
+
+	if(!m_has_shards || m_inspector->m_lastevent_ts > m_shards_last_ts)
+	{
+		m_shards_last_ts = m_inspector->m_lastevent_ts;
+	}
+
+	m_has_shards = true;
+}
+
+void sinsp_chisel::get_mergeable_result(OUT Json::Value* res)
+{
+#ifdef HAS_LUA_CHISELS
+	lua_getglobal(m_ls, "get_mergeable_result");
+
+	if(lua_pcall(m_ls, 0, 1, 0) != 0)
+	{
+		throw sinsp_exception(m_filename + " chisel error: calling get_mergeable_result() failed:" + lua_tostring(m_ls, -1));
+	}
+
+	(*res)["result"] = lua_to_json(m_ls, -1, m_filename);
+	lua_pop(m_ls, 1);
+
+	(*res)["has_shards"] = m_has_shards;
+	(*res)["first_ts"] = (Json::UInt64)m_shards_first_ts;
+	(*res)["last_ts"] = (Json::UInt64)m_shards_last_ts;
+#endif // HAS_LUA_CHISELS
+}
+
+void sinsp_chisel::merge_result(const Json::Value& res)
+{
+#ifdef HAS_LUA_CHISELS
+	if(res["has_shards"].asBool())
+	{
+		uint64_t first_ts = res["first_ts"].asUInt64();
+		uint64_t last_ts = res["last_ts"].asUInt64();
+
+		if(!m_has_shards || first_ts < m_shards_first_ts)
+		{
+			m_shards_first_ts = first_ts;
+		}
+
+		if(!m_has_shards || last_ts > m_shards_last_ts)
+		{
+			m_shards_last_ts = last_ts;
+		}
+
+		m_has_shards = true;
+	}
+
+	lua_getglobal(m_ls, "on_merge");
+	json_to_lua(m_ls, res["result"]);
+
+	if(lua_pcall(m_ls, 1, 0, 0) != 0)
+	{
+		throw sinsp_exception(m_filename + " chisel error: calling on_merge() failed:" + lua_tostring(m_ls, -1));
+	}
+#endif // HAS_LUA_CHISELS
+}
+
 #endif // HAS_CHISELS
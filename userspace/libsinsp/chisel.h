@@ -24,6 +24,7 @@ limitations under the License.
 class sinsp_filter_check;
 class sinsp_evt_formatter;
 class sinsp_view_info;
+class sinsp_span_aggregator;
 
 typedef struct lua_State lua_State;
 
@@ -96,6 +97,8 @@ public:
 	bool m_has_nextrun_args;
 	string m_nextrun_args;
 	bool m_end_capture;
+	// Set by chisel.set_span_aggregation(), fed with the filtered events
+	sinsp_span_aggregator* m_span_aggregator;
 
 private:
 	sinsp* m_inspector;
@@ -108,6 +111,15 @@ public:
 	~sinsp_chisel();
 	static void add_lua_package_path(lua_State* ls, const char* path);
 	static void get_chisel_list(vector<chisel_desc>* chisel_descs);
+	//
+	// The catalog cache stores the metadata extracted by get_chisel_list(),
+	// keyed by file path, mtime and size, so that the next run only needs to
+	// evaluate the chisels that changed. An empty file name (the default)
+	// disables it. The entries written by another version of the program
+	// are ignored, since the descriptions can change with it.
+	//
+	static void set_catalog_cache_file(const string& filename, const string& version = "");
+	static string get_default_catalog_cache_file();
 	void load(string cmdstr);
 	string get_name()
 	{
@@ -125,6 +137,20 @@ public:
 	void on_capture_start();
 	void on_capture_end();
 	bool get_nextrun_args(OUT string* args);
+
+	//
+	// Support for offline runs that split the input files across several
+	// processes. A chisel is mergeable if it defines get_mergeable_result(),
+	// which returns its partial result as a Lua table, and on_merge(result),
+	// which folds the partial result of another shard into its own.
+	// on_shard_end() replaces on_capture_end() at the end of every shard;
+	// on_capture_end() is then called once, after merging, and gets the
+	// time range of all the shards.
+	//
+	bool is_mergeable();
+	void on_shard_end();
+	void get_mergeable_result(OUT Json::Value* res);
+	void merge_result(const Json::Value& res);
 	chisel_desc* get_lua_script_info()
 	{
 		return &m_lua_script_info;
@@ -140,6 +166,7 @@ private:
 	static void parse_view_actions(lua_State *ls, OUT chisel_desc* cd, OUT void* actions);
 	static bool parse_view_info(lua_State *ls, OUT chisel_desc* cd);
 	static bool init_lua_chisel(chisel_desc &cd, string const &path);
+	static void load_chisel_descs(void* jobs);
 	void first_event_inits(sinsp_evt* evt);
 
 	sinsp* m_inspector;
@@ -158,6 +185,9 @@ private:
 	string m_new_chisel_to_exec;
 	int m_udp_socket;
 	struct sockaddr_in m_serveraddr;
+	bool m_has_shards;
+	uint64_t m_shards_first_ts;
+	uint64_t m_shards_last_ts;
 
 	friend class lua_cbacks;
 };
@@ -38,6 +38,7 @@ limitations under the License.
 #include "chisel_api.h"
 #include "filter.h"
 #include "filterchecks.h"
+#include "span_aggregator.h"
 #ifdef HAS_ANALYZER
 #include "analyzer.h"
 #endif
@@ -701,390 +702,435 @@ int lua_cbacks::get_machine_info(lua_State *ls)
 	return 1;
 }
 
-int lua_cbacks::get_thread_table_int(lua_State *ls, bool include_fds, bool barebone)
+//
+// The state of a thread table call. For the iterators it lives in a Lua
+// userdata, so that the threads are converted one at a time while the
+// script walks them.
+//
+struct lua_cbacks::thread_table_iter
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit;
-	uint32_t j;
-	sinsp_filter_compiler* compiler = NULL;
-	sinsp_filter* filter = NULL;
-	sinsp_evt tevt;
-	scap_evt tscapevt;
+	thread_table_iter():
+		m_inspector(NULL),
+		m_include_fds(false),
+		m_barebone(false),
+		m_pos(0)
+	{
+	}
 
-	//
-	// Get the chisel state
-	//
-	lua_getglobal(ls, "sichisel");
+	sinsp* m_inspector;
+	bool m_include_fds;
+	bool m_barebone;
+	std::unique_ptr<sinsp_filter> m_filter;
+	sinsp_evt m_tevt;
+	scap_evt m_tscapevt;
+	// Sorted, the threads that are gone by the time they're reached are skipped
+	vector<int64_t> m_tids;
+	size_t m_pos;
+};
+
+//
+// Compile the filter argument of the thread table calls, if any
+//
+void lua_cbacks::thread_table_filter_init(sinsp_chisel* ch, const string& filterstr, thread_table_iter* iter)
+{
+	iter->m_inspector = ch->m_inspector;
 
-	sinsp_chisel* ch = (sinsp_chisel*)lua_touserdata(ls, -1);
-	lua_pop(ls, 1);
+	if(filterstr == "")
+	{
+		return;
+	}
 
-	ASSERT(ch);
-	ASSERT(ch->m_lua_cinfo);
-	ASSERT(ch->m_inspector);
+	try
+	{
+		sinsp_filter_compiler compiler(ch->m_inspector, filterstr, true);
+		iter->m_filter.reset(compiler.compile());
+	}
+	catch(sinsp_exception& e)
+	{
+		string err = "invalid filter argument for get_thread_table in chisel " + ch->m_filename + ": " + e.what();
+		fprintf(stderr, "%s\n", err.c_str());
+		throw sinsp_exception("chisel error");
+	}
+
+	iter->m_tscapevt.ts = ch->m_inspector->m_lastevent_ts;
+	iter->m_tscapevt.type = PPME_SYSCALL_READ_X;
+	iter->m_tscapevt.len = 0;
+	iter->m_tscapevt.nparams = 0;
+
+	iter->m_tevt.m_inspector = ch->m_inspector;
+	iter->m_tevt.m_info = &(g_infotables.m_event_info[PPME_SYSCALL_READ_X]);
+	iter->m_tevt.m_cpuid = 0;
+	iter->m_tevt.m_evtnum = 0;
+	iter->m_tevt.m_pevt = &iter->m_tscapevt;
+}
+
+//
+// Run the filter on a fake event on the given fd
+//
+bool lua_cbacks::thread_table_filter_match(thread_table_iter* iter, sinsp_threadinfo& tinfo, int64_t fd, const sinsp_fdinfo_t* fdinfo)
+{
+	if(iter->m_filter == NULL)
+	{
+		return true;
+	}
 
 	//
-	// If the caller specified a filter, compile it
+	// The filter only reads the fd, which may still be shared with the
+	// other side of a fork()
 	//
-	if(lua_isstring(ls, 1))
+	iter->m_tevt.m_tinfo = &tinfo;
+	iter->m_tevt.m_fdinfo = const_cast<sinsp_fdinfo_t*>(fdinfo);
+	iter->m_tscapevt.tid = tinfo.m_tid;
+	int64_t tlefd = tinfo.m_lastevent_fd;
+	tinfo.m_lastevent_fd = fd;
+
+	bool res = iter->m_filter->run(&iter->m_tevt);
+
+	tinfo.m_lastevent_fd = tlefd;
+	return res;
+}
+
+//
+// With a filter, a thread is included if at least one of its fds matches
+//
+bool lua_cbacks::thread_table_filter_match_thread(thread_table_iter* iter, sinsp_threadinfo& tinfo)
+{
+	if(iter->m_filter == NULL)
 	{
-		string filterstr = lua_tostring(ls, 1);
-		lua_pop(ls, 1);
+		return true;
+	}
 
-		if(filterstr != "")
-		{
-			try
-			{
-				compiler = new sinsp_filter_compiler(ch->m_inspector, filterstr, true);
-				filter = compiler->compile();
-			}
-			catch(sinsp_exception& e)
-			{
-				string err = "invalid filter argument for get_thread_table in chisel " + ch->m_filename + ": " + e.what();
-				fprintf(stderr, "%s\n", err.c_str());
-				throw sinsp_exception("chisel error");
-			}
+	sinsp_fdtable* fdtable = tinfo.get_fd_table();
 
-			tscapevt.ts = ch->m_inspector->m_lastevent_ts;
-			tscapevt.type = PPME_SYSCALL_READ_X;
-			tscapevt.len = 0;
-			tscapevt.nparams = 0;
-
-			tevt.m_inspector = ch->m_inspector;
-			tevt.m_info = &(g_infotables.m_event_info[PPME_SYSCALL_READ_X]);
-			tevt.m_pevt = NULL;
-			tevt.m_cpuid = 0;
-			tevt.m_evtnum = 0;
-			tevt.m_pevt = &tscapevt;
+	for(auto& it : fdtable->peek_table())
+	{
+		if(thread_table_filter_match(iter, tinfo, it.first, &it.second))
+		{
+			return true;
 		}
 	}
 
-	threadinfo_map_t* threadtable  = ch->m_inspector->m_thread_manager->get_threads();
+	return false;
+}
 
-	ASSERT(threadtable != NULL);
+//
+// Push the table of one thread
+//
+void lua_cbacks::push_thread_table_entry(lua_State *ls, thread_table_iter* iter, sinsp_threadinfo& tinfo)
+{
+	unordered_map<int64_t, sinsp_fdinfo_t>::const_iterator fdit;
+	sinsp_fdtable* fdtable = tinfo.get_fd_table();
+	uint32_t j;
 
+	//
+	// Set the thread properties
+	//
 	lua_newtable(ls);
+	lua_pushliteral(ls, "tid");
+	lua_pushnumber(ls, (uint32_t)tinfo.m_tid);
+	lua_settable(ls, -3);
+	lua_pushliteral(ls, "pid");
+	lua_pushnumber(ls, (uint32_t)tinfo.m_pid);
+	lua_settable(ls, -3);
+	if(!iter->m_barebone)
+	{
+		lua_pushliteral(ls, "ptid");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_ptid);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "comm");
+		lua_pushstring(ls, tinfo.m_comm.c_str());
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "exe");
+		lua_pushstring(ls, tinfo.m_exe.c_str());
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "flags");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_flags);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "fdlimit");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_fdlimit);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "uid");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_uid);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "gid");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_gid);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "nchilds");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_nchilds);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "vmsize_kb");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_vmsize_kb);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "vmrss_kb");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_vmrss_kb);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "vmswap_kb");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_vmswap_kb);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "pfmajor");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_pfmajor);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "pfminor");
+		lua_pushnumber(ls, (uint32_t)tinfo.m_pfminor);
+		lua_settable(ls, -3);
+		lua_pushliteral(ls, "clone_ts");
+		lua_pushstring(ls, to_string((long long int)tinfo.m_clone_ts).c_str());
+		lua_settable(ls, -3);
 
-	threadtable->loop([&] (sinsp_threadinfo& tinfo) {
 		//
-		// Check if there's at least an fd that matches the filter.
-		// If not, skip this thread
+		// Extract the user name
 		//
-		sinsp_fdtable* fdtable = tinfo.get_fd_table();
+		string username;
+		scap_userinfo* uinfo = iter->m_inspector->get_user(tinfo.m_uid);
 
-		if(filter != NULL)
+		if(uinfo == NULL)
 		{
-			bool match = false;
-
-			for(fdit = fdtable->m_table.begin(); fdit != fdtable->m_table.end(); ++fdit)
-			{
-				tevt.m_tinfo = &tinfo;
-				tevt.m_fdinfo = &(fdit->second);
-				tscapevt.tid = tinfo.m_tid;
-				int64_t tlefd = tevt.m_tinfo->m_lastevent_fd;
-				tevt.m_tinfo->m_lastevent_fd = fdit->first;
+			username = "<NA>";
+		}
+		else
+		{
+			username = uinfo->name;
+		}
 
-				if(filter->run(&tevt))
-				{
-					match = true;
-					break;
-				}
+		lua_pushliteral(ls, "username");
+		lua_pushstring(ls, username.c_str());
+		lua_settable(ls, -3);
 
-				tevt.m_tinfo->m_lastevent_fd = tlefd;
-			}
+		//
+		// Create the arguments sub-table
+		//
+		lua_pushstring(ls, "args");
 
-			if(!match)
-			{
-				return true;
-			}
+		vector<string>* args = &tinfo.m_args;
+		lua_newtable(ls);
+		for(j = 0; j < args->size(); j++)
+		{
+			lua_pushinteger(ls, j + 1);
+			lua_pushstring(ls, args->at(j).c_str());
+			lua_settable(ls, -3);
 		}
+		lua_settable(ls,-3);
 
 		//
-		// Set the thread properties
+		// Create the environment variables sub-table
 		//
+		lua_pushstring(ls, "env");
+
+		const auto& env = tinfo.get_env();
 		lua_newtable(ls);
-		lua_pushliteral(ls, "tid");
-		lua_pushnumber(ls, (uint32_t)tinfo.m_tid);
-		lua_settable(ls, -3);
-		lua_pushliteral(ls, "pid");
-		lua_pushnumber(ls, (uint32_t)tinfo.m_pid);
-		lua_settable(ls, -3);
-		if(!barebone)
+		for(j = 0; j < env.size(); j++)
 		{
-			lua_pushliteral(ls, "ptid");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_ptid);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "comm");
-			lua_pushstring(ls, tinfo.m_comm.c_str());
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "exe");
-			lua_pushstring(ls, tinfo.m_exe.c_str());
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "flags");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_flags);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "fdlimit");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_fdlimit);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "uid");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_uid);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "gid");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_gid);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "nchilds");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_nchilds);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "vmsize_kb");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_vmsize_kb);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "vmrss_kb");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_vmrss_kb);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "vmswap_kb");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_vmswap_kb);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "pfmajor");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_pfmajor);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "pfminor");
-			lua_pushnumber(ls, (uint32_t)tinfo.m_pfminor);
-			lua_settable(ls, -3);
-			lua_pushliteral(ls, "clone_ts");
-			lua_pushstring(ls, to_string((long long int)tinfo.m_clone_ts).c_str());
+			lua_pushinteger(ls, j + 1);
+			lua_pushstring(ls, env.at(j).c_str());
 			lua_settable(ls, -3);
+		}
+		lua_settable(ls,-3);
+	}
 
-			//
-			// Extract the user name
-			//
-			string username;
-			unordered_map<uint32_t, scap_userinfo*>::const_iterator uit;
+	//
+	// Create and populate the FD table
+	//
+	lua_pushstring(ls, "fdtable");
+	lua_newtable(ls);
 
-			const unordered_map<uint32_t, scap_userinfo*>* userlist = ch->m_inspector->get_userlist();
-			ASSERT(userlist->size() != 0);
+	if(iter->m_include_fds)
+	{
+		for(fdit = fdtable->peek_table().begin(); fdit != fdtable->peek_table().end(); ++fdit)
+		{
+			if(!thread_table_filter_match(iter, tinfo, fdit->first, &(fdit->second)))
+			{
+				continue;
+			}
 
-			if(tinfo.m_uid == 0xffffffff)
+			lua_newtable(ls);
+			if(!iter->m_barebone)
 			{
-				username = "<NA>";
+				lua_pushliteral(ls, "name");
+				lua_pushstring(ls, fdit->second.tostring_clean().c_str());
+				lua_settable(ls, -3);
+				lua_pushliteral(ls, "type");
+				lua_pushstring(ls, fdit->second.get_typestring());
+				lua_settable(ls, -3);
 			}
-			else
+
+			scap_fd_type evt_type = fdit->second.m_type;
+			if(evt_type == SCAP_FD_IPV4_SOCK || evt_type == SCAP_FD_IPV4_SERVSOCK ||
+			   evt_type == SCAP_FD_IPV6_SOCK || evt_type == SCAP_FD_IPV6_SERVSOCK)
 			{
-				uit = userlist->find(tinfo.m_uid);
-				if(uit == userlist->end())
+				bool include_client;
+				char sipbuf[128], cipbuf[128];
+				uint8_t *sip, *cip;
+				uint16_t sport, cport;
+				bool is_server;
+				int af;
+
+				if(evt_type == SCAP_FD_IPV4_SOCK)
+				{
+					include_client = true;
+					af = AF_INET;
+					cip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv4info.m_fields.m_sip);
+					sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv4info.m_fields.m_dip);
+					cport = fdit->second.m_sockinfo.m_ipv4info.m_fields.m_sport;
+					sport = fdit->second.m_sockinfo.m_ipv4info.m_fields.m_dport;
+					is_server = fdit->second.is_role_server();
+				}
+				else if (evt_type == SCAP_FD_IPV4_SERVSOCK)
+				{
+					include_client = false;
+					af = AF_INET;
+					cip = NULL;
+					sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv4serverinfo.m_ip);
+					sport = fdit->second.m_sockinfo.m_ipv4serverinfo.m_port;
+					is_server = true;
+				}
+				else if (evt_type == SCAP_FD_IPV6_SOCK)
 				{
-					username = "<NA>";
+					include_client = true;
+					af = AF_INET6;
+					cip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv6info.m_fields.m_sip);
+					sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv6info.m_fields.m_dip);
+					cport = fdit->second.m_sockinfo.m_ipv6info.m_fields.m_sport;
+					sport = fdit->second.m_sockinfo.m_ipv6info.m_fields.m_dport;
+					is_server = fdit->second.is_role_server();
 				}
 				else
 				{
-					ASSERT(uit->second != NULL);
-					username = uit->second->name;
+					include_client = false;
+					af = AF_INET6;
+					cip = NULL;
+					sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv6serverinfo.m_ip);
+					sport = fdit->second.m_sockinfo.m_ipv6serverinfo.m_port;
+					is_server = true;
 				}
-			}
 
-			lua_pushliteral(ls, "username");
-			lua_pushstring(ls, username.c_str());
-			lua_settable(ls, -3);
+				// Now convert the raw sip/cip to strings
+				if(NULL == inet_ntop(af, sip, sipbuf, sizeof(sipbuf)))
+				{
+					strcpy(sipbuf, "<NA>");
+				}
 
-			//
-			// Create the arguments sub-table
-			//
-			lua_pushstring(ls, "args");
+				if(cip)
+				{
+					if(NULL == inet_ntop(af, cip, cipbuf, sizeof(cipbuf)))
+					{
+						strcpy(cipbuf, "<NA>");
+					}
+				}
 
-			vector<string>* args = &tinfo.m_args;
-			lua_newtable(ls);
-			for(j = 0; j < args->size(); j++)
-			{
-				lua_pushinteger(ls, j + 1);
-				lua_pushstring(ls, args->at(j).c_str());
+				if(include_client)
+				{
+					// cip
+					lua_pushliteral(ls, "cip");
+					lua_pushstring(ls, cipbuf);
+					lua_settable(ls, -3);
+				}
+
+				// sip
+				lua_pushliteral(ls, "sip");
+				lua_pushstring(ls, sipbuf);
 				lua_settable(ls, -3);
-			}
-			lua_settable(ls,-3);
 
-			//
-			// Create the environment variables sub-table
-			//
-			lua_pushstring(ls, "env");
+				if(include_client)
+				{
+					// cport
+					lua_pushliteral(ls, "cport");
+					lua_pushnumber(ls, cport);
+					lua_settable(ls, -3);
+				}
 
-			const auto& env = tinfo.get_env();
-			lua_newtable(ls);
-			for(j = 0; j < env.size(); j++)
-			{
-				lua_pushinteger(ls, j + 1);
-				lua_pushstring(ls, env.at(j).c_str());
+				// sport
+				lua_pushliteral(ls, "sport");
+				lua_pushnumber(ls, sport);
 				lua_settable(ls, -3);
-			}
-			lua_settable(ls,-3);
-		}
 
-		//
-		// Create and populate the FD table
-		//
-		lua_pushstring(ls, "fdtable");
-		lua_newtable(ls);
+				// is_server
+				lua_pushliteral(ls, "is_server");
+				lua_pushboolean(ls, is_server);
+				lua_settable(ls, -3);
 
-		if(include_fds)
-		{
-			for(fdit = fdtable->m_table.begin(); fdit != fdtable->m_table.end(); ++fdit)
-			{
-				tevt.m_tinfo = &tinfo;
-				tevt.m_fdinfo = &(fdit->second);
-				tscapevt.tid = tinfo.m_tid;
-				int64_t tlefd = tevt.m_tinfo->m_lastevent_fd;
-				tevt.m_tinfo->m_lastevent_fd = fdit->first;
+				// l4proto
+				const char* l4ps;
+				scap_l4_proto l4p = fdit->second.get_l4proto();
 
-				if(filter != NULL)
+				switch(l4p)
 				{
-					if(filter->run(&tevt) == false)
-					{
-						continue;
-					}
+				case SCAP_L4_TCP:
+					l4ps = "tcp";
+					break;
+				case SCAP_L4_UDP:
+					l4ps = "udp";
+					break;
+				case SCAP_L4_ICMP:
+					l4ps = "icmp";
+					break;
+				case SCAP_L4_RAW:
+					l4ps = "raw";
+					break;
+				default:
+					l4ps = "<NA>";
+					break;
 				}
 
-				tevt.m_tinfo->m_lastevent_fd = tlefd;
+				// l4proto
+				lua_pushliteral(ls, "l4proto");
+				lua_pushstring(ls, l4ps);
+				lua_settable(ls, -3);
+			}
 
-				lua_newtable(ls);
-				if(!barebone)
-				{
-					lua_pushliteral(ls, "name");
-					lua_pushstring(ls, fdit->second.tostring_clean().c_str());
-					lua_settable(ls, -3);
-					lua_pushliteral(ls, "type");
-					lua_pushstring(ls, fdit->second.get_typestring());
-					lua_settable(ls, -3);
-				}
+			// is_server
+			string l4proto;
 
-				scap_fd_type evt_type = fdit->second.m_type;
-				if(evt_type == SCAP_FD_IPV4_SOCK || evt_type == SCAP_FD_IPV4_SERVSOCK ||
-				   evt_type == SCAP_FD_IPV6_SOCK || evt_type == SCAP_FD_IPV6_SERVSOCK)
-				{
-					bool include_client;
-					char sipbuf[128], cipbuf[128];
-					uint8_t *sip, *cip;
-					uint16_t sport, cport;
-					bool is_server;
-					int af;
-
-					if(evt_type == SCAP_FD_IPV4_SOCK)
-					{
-						include_client = true;
-						af = AF_INET;
-						cip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv4info.m_fields.m_sip);
-						sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv4info.m_fields.m_dip);
-						cport = fdit->second.m_sockinfo.m_ipv4info.m_fields.m_sport;
-						sport = fdit->second.m_sockinfo.m_ipv4info.m_fields.m_dport;
-						is_server = fdit->second.is_role_server();
-					}
-					else if (evt_type == SCAP_FD_IPV4_SERVSOCK)
-					{
-						include_client = false;
-						af = AF_INET;
-						cip = NULL;
-						sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv4serverinfo.m_ip);
-						sport = fdit->second.m_sockinfo.m_ipv4serverinfo.m_port;
-						is_server = true;
-					}
-					else if (evt_type == SCAP_FD_IPV6_SOCK)
-					{
-						include_client = true;
-						af = AF_INET6;
-						cip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv6info.m_fields.m_sip);
-						sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv6info.m_fields.m_dip);
-						cport = fdit->second.m_sockinfo.m_ipv6info.m_fields.m_sport;
-						sport = fdit->second.m_sockinfo.m_ipv6info.m_fields.m_dport;
-						is_server = fdit->second.is_role_server();
-					}
-					else
-					{
-						include_client = false;
-						af = AF_INET6;
-						cip = NULL;
-						sip = (uint8_t*)&(fdit->second.m_sockinfo.m_ipv6serverinfo.m_ip);
-						sport = fdit->second.m_sockinfo.m_ipv6serverinfo.m_port;
-						is_server = true;
-					}
+			lua_rawseti(ls,-2, (uint32_t)fdit->first);
+		}
+	}
 
-					// Now convert the raw sip/cip to strings
-					if(NULL == inet_ntop(af, sip, sipbuf, sizeof(sipbuf)))
-					{
-						strcpy(sipbuf, "<NA>");
-					}
 
-					if(cip)
-					{
-						if(NULL == inet_ntop(af, cip, cipbuf, sizeof(cipbuf)))
-						{
-							strcpy(cipbuf, "<NA>");
-						}
-					}
+	lua_settable(ls,-3);
+}
 
-					if(include_client)
-					{
-						// cip
-						lua_pushliteral(ls, "cip");
-						lua_pushstring(ls, cipbuf);
-						lua_settable(ls, -3);
-					}
+int lua_cbacks::get_thread_table_int(lua_State *ls, bool include_fds, bool barebone)
+{
+	thread_table_iter iter;
+	string filterstr;
 
-					// sip
-					lua_pushliteral(ls, "sip");
-					lua_pushstring(ls, sipbuf);
-					lua_settable(ls, -3);
+	//
+	// Get the chisel state
+	//
+	lua_getglobal(ls, "sichisel");
 
-					if(include_client)
-					{
-						// cport
-						lua_pushliteral(ls, "cport");
-						lua_pushnumber(ls, cport);
-						lua_settable(ls, -3);
-					}
+	sinsp_chisel* ch = (sinsp_chisel*)lua_touserdata(ls, -1);
+	lua_pop(ls, 1);
 
-					// sport
-					lua_pushliteral(ls, "sport");
-					lua_pushnumber(ls, sport);
-					lua_settable(ls, -3);
+	ASSERT(ch);
+	ASSERT(ch->m_lua_cinfo);
+	ASSERT(ch->m_inspector);
 
-					// is_server
-					lua_pushliteral(ls, "is_server");
-					lua_pushboolean(ls, is_server);
-					lua_settable(ls, -3);
+	//
+	// If the caller specified a filter, compile it
+	//
+	if(lua_isstring(ls, 1))
+	{
+		filterstr = lua_tostring(ls, 1);
+		lua_pop(ls, 1);
+	}
 
-					// l4proto
-					const char* l4ps;
-					scap_l4_proto l4p = fdit->second.get_l4proto();
+	iter.m_include_fds = include_fds;
+	iter.m_barebone = barebone;
+	thread_table_filter_init(ch, filterstr, &iter);
 
-					switch(l4p)
-					{
-					case SCAP_L4_TCP:
-						l4ps = "tcp";
-						break;
-					case SCAP_L4_UDP:
-						l4ps = "udp";
-						break;
-					case SCAP_L4_ICMP:
-						l4ps = "icmp";
-						break;
-					case SCAP_L4_RAW:
-						l4ps = "raw";
-						break;
-					default:
-						l4ps = "<NA>";
-						break;
-					}
+	threadinfo_map_t* threadtable  = ch->m_inspector->m_thread_manager->get_threads();
 
-					// l4proto
-					lua_pushliteral(ls, "l4proto");
-					lua_pushstring(ls, l4ps);
-					lua_settable(ls, -3);
-				}
+	ASSERT(threadtable != NULL);
 
-				// is_server
-				string l4proto;
+	lua_newtable(ls);
 
-				lua_rawseti(ls,-2, (uint32_t)fdit->first);
-			}
+	threadtable->loop([&] (sinsp_threadinfo& tinfo) {
+		if(!thread_table_filter_match_thread(&iter, tinfo))
+		{
+			return true;
 		}
 
-
-		lua_settable(ls,-3);
+		push_thread_table_entry(ls, &iter, tinfo);
 
 		//
 		// Set the key for this entry
@@ -1093,14 +1139,83 @@ int lua_cbacks::get_thread_table_int(lua_State *ls, bool include_fds, bool bareb
 		return true;
 	});
 
-	if(filter)
+	return 1;
+}
+
+int lua_cbacks::iter_thread_table_int(lua_State *ls, bool include_fds)
+{
+	string filterstr;
+
+	lua_getglobal(ls, "sichisel");
+
+	sinsp_chisel* ch = (sinsp_chisel*)lua_touserdata(ls, -1);
+	lua_pop(ls, 1);
+
+	ASSERT(ch);
+	ASSERT(ch->m_inspector);
+
+	if(lua_isstring(ls, 1))
+	{
+		filterstr = lua_tostring(ls, 1);
+		lua_pop(ls, 1);
+	}
+
+	//
+	// The state is freed by the garbage collector once the loop is over
+	//
+	thread_table_iter* iter = new(lua_newuserdata(ls, sizeof(thread_table_iter))) thread_table_iter();
+
+	if(luaL_newmetatable(ls, "sysdig.thread_table_iter"))
+	{
+		lua_pushcfunction(ls, &lua_cbacks::iter_thread_table_gc);
+		lua_setfield(ls, -2, "__gc");
+	}
+	lua_setmetatable(ls, -2);
+
+	iter->m_include_fds = include_fds;
+	thread_table_filter_init(ch, filterstr, iter);
+
+	ch->m_inspector->m_thread_manager->get_threads()->loop([&] (sinsp_threadinfo& tinfo) {
+		iter->m_tids.push_back(tinfo.m_tid);
+		return true;
+	});
+	sort(iter->m_tids.begin(), iter->m_tids.end());
+
+	lua_pushcclosure(ls, &lua_cbacks::iter_thread_table_next, 1);
+	return 1;
+}
+
+int lua_cbacks::iter_thread_table_next(lua_State *ls)
+{
+	thread_table_iter* iter = (thread_table_iter*)lua_touserdata(ls, lua_upvalueindex(1));
+	threadinfo_map_t* threadtable = iter->m_inspector->m_thread_manager->get_threads();
+
+	while(iter->m_pos < iter->m_tids.size())
 	{
-		delete filter;
+		sinsp_threadinfo* tinfo = threadtable->get(iter->m_tids[iter->m_pos++]);
+
+		if(tinfo == NULL || !thread_table_filter_match_thread(iter, *tinfo))
+		{
+			continue;
+		}
+
+		lua_pushnumber(ls, (uint32_t)tinfo->m_tid);
+		push_thread_table_entry(ls, iter, *tinfo);
+		return 2;
 	}
 
+	lua_pushnil(ls);
 	return 1;
 }
 
+int lua_cbacks::iter_thread_table_gc(lua_State *ls)
+{
+	thread_table_iter* iter = (thread_table_iter*)lua_touserdata(ls, 1);
+
+	iter->~thread_table_iter();
+	return 0;
+}
+
 int lua_cbacks::get_thread_table(lua_State *ls)
 {
 	return get_thread_table_int(ls, true, false);
@@ -1121,6 +1236,16 @@ int lua_cbacks::get_thread_table_barebone_nofds(lua_State *ls)
 	return get_thread_table_int(ls, false, true);
 }
 
+int lua_cbacks::iter_thread_table(lua_State *ls)
+{
+	return iter_thread_table_int(ls, true);
+}
+
+int lua_cbacks::iter_thread_table_nofds(lua_State *ls)
+{
+	return iter_thread_table_int(ls, false);
+}
+
 int lua_cbacks::get_container_table(lua_State *ls)
 {
 	unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit;
@@ -1414,6 +1539,62 @@ int lua_cbacks::exec(lua_State *ls)
 	return 0;
 }
 
+int lua_cbacks::set_span_aggregation(lua_State *ls)
+{
+	lua_getglobal(ls, "sichisel");
+
+	sinsp_chisel* ch = (sinsp_chisel*)lua_touserdata(ls, -1);
+	lua_pop(ls, 1);
+
+	ASSERT(ch);
+	ASSERT(ch->m_lua_cinfo);
+
+	uint32_t max_nodes = SPAN_AGGREGATOR_DEFAULT_MAX_NODES;
+
+	if(lua_isnumber(ls, 1))
+	{
+		max_nodes = (uint32_t)lua_tonumber(ls, 1);
+	}
+
+	if(max_nodes == 0)
+	{
+		string err = "invalid span aggregation node limit in chisel " + ch->m_filename;
+		fprintf(stderr, "%s\n", err.c_str());
+		throw sinsp_exception("chisel error");
+	}
+
+	if(ch->m_lua_cinfo->m_span_aggregator != NULL)
+	{
+		delete ch->m_lua_cinfo->m_span_aggregator;
+	}
+
+	ch->m_lua_cinfo->m_span_aggregator = new sinsp_span_aggregator(ch->m_inspector, max_nodes);
+
+	return 0;
+}
+
+int lua_cbacks::print_span_aggregation(lua_State *ls)
+{
+	lua_getglobal(ls, "sichisel");
+
+	sinsp_chisel* ch = (sinsp_chisel*)lua_touserdata(ls, -1);
+	lua_pop(ls, 1);
+
+	ASSERT(ch);
+	ASSERT(ch->m_lua_cinfo);
+
+	if(ch->m_lua_cinfo->m_span_aggregator == NULL)
+	{
+		string err = "print_span_aggregation called without set_span_aggregation in chisel " + ch->m_filename;
+		fprintf(stderr, "%s\n", err.c_str());
+		throw sinsp_exception("chisel error");
+	}
+
+	ch->m_lua_cinfo->m_span_aggregator->dump_collapsed(cout);
+
+	return 0;
+}
+
 int lua_cbacks::log(lua_State *ls)
 {
 	lua_getglobal(ls, "sichisel");
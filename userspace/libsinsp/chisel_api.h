@@ -51,6 +51,8 @@ public:
 	static int get_thread_table_nofds(lua_State *ls);
 	static int get_thread_table_barebone(lua_State *ls);
 	static int get_thread_table_barebone_nofds(lua_State *ls);
+	static int iter_thread_table(lua_State *ls);
+	static int iter_thread_table_nofds(lua_State *ls);
 	static int get_container_table(lua_State *ls);
 	static int is_print_container_data(lua_State *ls);
 	static int get_output_format(lua_State *ls);
@@ -62,6 +64,8 @@ public:
 	static int set_interval_s(lua_State *ls);
 	static int set_precise_interval_ns(lua_State *ls);
 	static int exec(lua_State *ls);
+	static int set_span_aggregation(lua_State *ls);
+	static int print_span_aggregation(lua_State *ls);
 	static int log(lua_State *ls);
 	static int udp_setpeername(lua_State *ls);
 	static int udp_send(lua_State *ls);
@@ -70,7 +74,16 @@ public:
 	static int push_metric(lua_State *ls);
 #endif
 private:
+	struct thread_table_iter;
+
+	static void thread_table_filter_init(sinsp_chisel* ch, const string& filterstr, thread_table_iter* iter);
+	static bool thread_table_filter_match(thread_table_iter* iter, sinsp_threadinfo& tinfo, int64_t fd, const sinsp_fdinfo_t* fdinfo);
+	static bool thread_table_filter_match_thread(thread_table_iter* iter, sinsp_threadinfo& tinfo);
+	static void push_thread_table_entry(lua_State *ls, thread_table_iter* iter, sinsp_threadinfo& tinfo);
 	static int get_thread_table_int(lua_State *ls, bool include_fds, bool barebone);
+	static int iter_thread_table_int(lua_State *ls, bool include_fds);
+	static int iter_thread_table_next(lua_State *ls);
+	static int iter_thread_table_gc(lua_State *ls);
 };
 
 #endif // HAS_CHISELS
@@ -0,0 +1,176 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "chisel.h"
+
+extern vector<chiseldir_info>* g_chisel_dirs;
+
+//
+// A chisel directory of its own, in front of the other ones, with the
+// catalog next to it
+//
+class chisel_catalog : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		char dir[] = "/tmp/sinsp_chisel_catalogXXXXXX";
+		ASSERT_NE(nullptr, mkdtemp(dir));
+
+		m_dir = dir;
+		m_chisel = m_dir + "/catalog_test.lua";
+		m_catalog = m_dir + "/cache/chisel_catalog.json";
+
+		chiseldir_info cdi;
+		cdi.m_need_to_resolve = false;
+		cdi.m_dir = m_dir + "/";
+		g_chisel_dirs->insert(g_chisel_dirs->begin(), cdi);
+
+		sinsp_chisel::set_catalog_cache_file(m_catalog, "1.0.0");
+	}
+
+	void TearDown()
+	{
+		sinsp_chisel::set_catalog_cache_file("");
+		g_chisel_dirs->erase(g_chisel_dirs->begin());
+
+		unlink(m_chisel.c_str());
+		unlink(m_catalog.c_str());
+		rmdir((m_dir + "/cache").c_str());
+		rmdir(m_dir.c_str());
+	}
+
+	void write_chisel(const std::string& description)
+	{
+		std::ofstream os(m_chisel);
+		os << "description = \"" << description << "\"\n"
+		   << "short_description = \"catalog test\"\n"
+		   << "category = \"misc\"\n"
+		   << "args = {}\n";
+	}
+
+	// The description of the test chisel, as listed
+	std::string get_description()
+	{
+		vector<chisel_desc> chlist;
+
+		sinsp_chisel::get_chisel_list(&chlist);
+
+		for(const chisel_desc& cd : chlist)
+		{
+			if(cd.m_name == "catalog_test")
+			{
+				return cd.m_description;
+			}
+		}
+
+		return "<not listed>";
+	}
+
+	std::string read_catalog()
+	{
+		std::ifstream is(m_catalog);
+		std::stringstream ss;
+
+		ss << is.rdbuf();
+		return ss.str();
+	}
+
+	void write_catalog(const std::string& catalog)
+	{
+		std::ofstream os(m_catalog);
+		os << catalog;
+	}
+
+	std::string m_dir;
+	std::string m_chisel;
+	std::string m_catalog;
+};
+
+//
+// A chisel that didn't change is not run again: what the catalog says
+// about it is what gets listed
+//
+TEST_F(chisel_catalog, hit)
+{
+	write_chisel("first");
+	EXPECT_EQ("first", get_description());
+
+	std::string catalog = read_catalog();
+	std::string::size_type pos = catalog.find("\"first\"");
+	ASSERT_NE(std::string::npos, pos);
+	write_catalog(catalog.replace(pos, 7, "\"cached\""));
+
+	EXPECT_EQ("cached", get_description());
+}
+
+TEST_F(chisel_catalog, invalidation)
+{
+	write_chisel("first");
+	EXPECT_EQ("first", get_description());
+
+	// Another size
+	write_chisel("second one");
+	EXPECT_EQ("second one", get_description());
+
+	// Same size, another mtime
+	write_chisel("third one!");
+	struct timespec times[2] = {{0, UTIME_OMIT}, {1000000000, 0}};
+	ASSERT_EQ(0, utimensat(AT_FDCWD, m_chisel.c_str(), times, 0));
+	EXPECT_EQ("third one!", get_description());
+	EXPECT_NE(std::string::npos, read_catalog().find("\"third one!\""));
+}
+
+//
+// An upgrade throws the catalog away
+//
+TEST_F(chisel_catalog, version)
+{
+	write_chisel("first");
+	EXPECT_EQ("first", get_description());
+
+	std::string catalog = read_catalog();
+	std::string::size_type pos = catalog.find("\"first\"");
+	ASSERT_NE(std::string::npos, pos);
+	write_catalog(catalog.replace(pos, 7, "\"cached\""));
+
+	sinsp_chisel::set_catalog_cache_file(m_catalog, "1.0.1");
+	EXPECT_EQ("first", get_description());
+	EXPECT_NE(std::string::npos, read_catalog().find("\"1.0.1\""));
+}
+
+TEST_F(chisel_catalog, disabled)
+{
+	sinsp_chisel::set_catalog_cache_file("");
+
+	write_chisel("first");
+	EXPECT_EQ("first", get_description());
+	EXPECT_NE(0, access(m_catalog.c_str(), F_OK));
+}
@@ -36,7 +36,8 @@ using namespace libsinsp;
 
 sinsp_container_manager::sinsp_container_manager(sinsp* inspector) :
 	m_inspector(inspector),
-	m_last_flush_time_ns(0)
+	m_last_flush_time_ns(0),
+	m_binary_evts(false)
 {
 }
 
@@ -139,6 +140,29 @@ bool sinsp_container_manager::resolve_container(sinsp_threadinfo* tinfo, bool qu
 	return matches;
 }
 
+bool sinsp_container_manager::resolve_container(sinsp_threadinfo* tinfo,
+						const vector<pair<string, string>>& ref_cgroups,
+						const string& ref_container_id,
+						bool query_os_for_missing_info)
+{
+	ASSERT(tinfo);
+
+	//
+	// The fd listener's on_resolve_container() gets the whole thread and
+	// may match it on more than its cgroups, so the shortcut is only safe
+	// without a listener
+	//
+	if(m_inspector->m_parser->m_fd_listener || tinfo->m_cgroups != ref_cgroups)
+	{
+		return resolve_container(tinfo, query_os_for_missing_info);
+	}
+
+	tinfo->m_container_id = ref_container_id;
+	identify_category(tinfo);
+
+	return !tinfo->m_container_id.empty();
+}
+
 string sinsp_container_manager::container_to_json(const sinsp_container_info& container_info)
 {
 	Json::Value obj;
@@ -205,9 +229,7 @@ string sinsp_container_manager::container_to_json(const sinsp_container_info& co
 	{
 		// Only append a limited set of mesos/marathon-related
 		// environment variables.
-		if(var.find("MESOS") != std::string::npos ||
-		   var.find("MARATHON") != std::string::npos ||
-		   var.find("mesos") != std::string::npos)
+		if(sinsp_container_info::is_evt_env_var(var))
 		{
 			env_vars.append(var);
 		}
@@ -230,9 +252,31 @@ string sinsp_container_manager::container_to_json(const sinsp_container_info& co
 	return Json::FastWriter().write(obj);
 }
 
-bool sinsp_container_manager::container_to_sinsp_event(const string& json, sinsp_evt* evt, shared_ptr<sinsp_threadinfo> tinfo)
+bool sinsp_container_manager::container_to_sinsp_event(const sinsp_container_info& container_info, sinsp_evt* evt, shared_ptr<sinsp_threadinfo> tinfo)
 {
-	size_t totlen = sizeof(scap_evt) +  sizeof(uint16_t) + json.length() + 1;
+	string payload;
+	uint16_t type = PPME_CONTAINER_JSON_E;
+	size_t len = 0;
+
+	if(m_binary_evts)
+	{
+		container_info.to_bin(payload);
+		type = PPME_CONTAINER_BIN_E;
+		len = payload.length();
+	}
+
+	//
+	// A container with huge labels or mounts might not fit in a
+	// parameter, in that case it goes out as JSON like before
+	//
+	if(!m_binary_evts || len > UINT16_MAX)
+	{
+		payload = container_to_json(container_info);
+		type = PPME_CONTAINER_JSON_E;
+		len = payload.length() + 1;
+	}
+
+	size_t totlen = sizeof(scap_evt) +  sizeof(uint16_t) + len;
 
 	ASSERT(evt->m_pevt_storage == nullptr);
 	evt->m_pevt_storage = new char[totlen];
@@ -257,14 +301,14 @@ bool sinsp_container_manager::container_to_sinsp_event(const string& json, sinsp
 	}
 	scapevt->tid = -1;
 	scapevt->len = (uint32_t)totlen;
-	scapevt->type = PPME_CONTAINER_JSON_E;
+	scapevt->type = type;
 	scapevt->nparams = 1;
 
 	uint16_t* lens = (uint16_t*)((char *)scapevt + sizeof(struct ppm_evt_hdr));
 	char* valptr = (char*)lens + sizeof(uint16_t);
 
-	*lens = (uint16_t)json.length() + 1;
-	memcpy(valptr, json.c_str(), *lens);
+	*lens = (uint16_t)len;
+	memcpy(valptr, payload.c_str(), len);
 
 	evt->init();
 	evt->m_tinfo_ref = tinfo;
@@ -292,10 +336,10 @@ void sinsp_container_manager::notify_new_container(const sinsp_container_info& c
 {
 	sinsp_evt *evt = new sinsp_evt();
 
-	if(container_to_sinsp_event(container_to_json(container_info), evt, container_info.get_tinfo(m_inspector)))
+	if(container_to_sinsp_event(container_info, evt, container_info.get_tinfo(m_inspector)))
 	{
 		g_logger.format(sinsp_logger::SEV_DEBUG,
-				"notify_new_container (%s): created CONTAINER_JSON event, queuing to inspector",
+				"notify_new_container (%s): created container event, queuing to inspector",
 				container_info.m_id.c_str());
 
 		std::shared_ptr<sinsp_evt> cevt(evt);
@@ -306,26 +350,32 @@ void sinsp_container_manager::notify_new_container(const sinsp_container_info& c
 	else
 	{
 		g_logger.format(sinsp_logger::SEV_ERROR,
-				"notify_new_container (%s): could not create CONTAINER_JSON event, dropping",
+				"notify_new_container (%s): could not create container event, dropping",
 				container_info.m_id.c_str());
 		delete evt;
 	}
 }
 
-void sinsp_container_manager::dump_containers(scap_dumper_t* dumper)
+uint32_t sinsp_container_manager::dump_containers(scap_dumper_t* dumper)
 {
+	uint32_t nevts = 0;
+
 	for(unordered_map<string, sinsp_container_info>::const_iterator it = m_containers.begin(); it != m_containers.end(); ++it)
 	{
 		sinsp_evt evt;
-		if(container_to_sinsp_event(container_to_json(it->second), &evt, it->second.get_tinfo(m_inspector)))
+		if(container_to_sinsp_event(it->second, &evt, it->second.get_tinfo(m_inspector)))
 		{
 			int32_t res = scap_dump(m_inspector->m_h, dumper, evt.m_pevt, evt.m_cpuid, 0);
 			if(res != SCAP_SUCCESS)
 			{
 				throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
 			}
+
+			nevts++;
 		}
 	}
+
+	return nevts;
 }
 
 string sinsp_container_manager::get_container_name(sinsp_threadinfo* tinfo)
@@ -45,7 +45,16 @@ public:
 	template<typename E> bool resolve_container_impl(sinsp_threadinfo* tinfo, bool query_os_for_missing_info);
 	template<typename E1, typename E2, typename... Args> bool resolve_container_impl(sinsp_threadinfo* tinfo, bool query_os_for_missing_info);
 	bool resolve_container(sinsp_threadinfo* tinfo, bool query_os_for_missing_info);
-	void dump_containers(scap_dumper_t* dumper);
+	// Like resolve_container(), for a thread cloned from an already resolved
+	// one: if it has the same cgroups, it's in the same container, and the
+	// engines are skipped. Only for clone()/fork(), where the environment
+	// and the root, which some engines match on, are inherited too.
+	bool resolve_container(sinsp_threadinfo* tinfo,
+			       const std::vector<std::pair<std::string, std::string>>& ref_cgroups,
+			       const string& ref_container_id,
+			       bool query_os_for_missing_info);
+	// Returns the number of events written
+	uint32_t dump_containers(scap_dumper_t* dumper);
 	string get_container_name(sinsp_threadinfo* tinfo);
 
 	// Set tinfo's m_category based on the container context.  It
@@ -70,10 +79,12 @@ public:
 	void set_cri_extra_queries(bool extra_queries);
 	void set_cri_socket_path(const std::string& path);
 	void set_cri_timeout(int64_t timeout_ms);
+	// Write the container events with the binary encoding instead of JSON
+	void set_binary_container_evts(bool enable) { m_binary_evts = enable; }
 	sinsp* get_inspector() { return m_inspector; }
 private:
 	string container_to_json(const sinsp_container_info& container_info);
-	bool container_to_sinsp_event(const string& json, sinsp_evt* evt, shared_ptr<sinsp_threadinfo> tinfo);
+	bool container_to_sinsp_event(const sinsp_container_info& container_info, sinsp_evt* evt, shared_ptr<sinsp_threadinfo> tinfo);
 	string get_docker_env(const Json::Value &env_vars, const string &mti);
 
 	std::list<std::unique_ptr<libsinsp::container_engine::resolver>> m_container_engines;
@@ -81,6 +92,7 @@ private:
 	sinsp* m_inspector;
 	unordered_map<string, sinsp_container_info> m_containers;
 	uint64_t m_last_flush_time_ns;
+	bool m_binary_evts;
 	list<new_container_cb> m_new_callbacks;
 	list<remove_container_cb> m_remove_callbacks;
 
@@ -17,6 +17,7 @@ limitations under the License.
 
 */
 
+#include <string.h>
 #include <utility>
 
 #include "container_info.h"
@@ -187,3 +188,437 @@ sinsp_container_info::container_health_probe::probe_type sinsp_container_info::m
 
 	return match->m_probe_type;
 }
+
+bool sinsp_container_info::is_evt_env_var(const std::string& var)
+{
+	return var.find("MESOS") != std::string::npos ||
+		var.find("MARATHON") != std::string::npos ||
+		var.find("mesos") != std::string::npos;
+}
+
+namespace
+{
+
+enum container_bin_tag
+{
+	CBT_ID = 1,
+	CBT_TYPE = 2,
+	CBT_NAME = 3,
+	CBT_IMAGE = 4,
+	CBT_IMAGEID = 5,
+	CBT_IMAGEREPO = 6,
+	CBT_IMAGETAG = 7,
+	CBT_IMAGEDIGEST = 8,
+	CBT_PRIVILEGED = 9,
+	CBT_IS_POD_SANDBOX = 10,
+	CBT_IP = 11,
+	// source, dest, mode, rdwr (uint8), propagation
+	CBT_MOUNT = 12,
+	// host ip (uint32), host port (uint16), container port (uint16)
+	CBT_PORT_MAPPING = 13,
+	// key, value
+	CBT_LABEL = 14,
+	CBT_ENV = 15,
+	CBT_MEMORY_LIMIT = 16,
+	CBT_SWAP_LIMIT = 17,
+	CBT_CPU_SHARES = 18,
+	CBT_CPU_QUOTA = 19,
+	CBT_CPU_PERIOD = 20,
+	CBT_CPUSET_CPU_COUNT = 21,
+	CBT_MESOS_TASK_ID = 22,
+	CBT_METADATA_DEADLINE = 23,
+	// probe type (uint8), exe, args...
+	CBT_HEALTH_PROBE = 24,
+};
+
+//
+// The strings inside a field are prefixed with their 16 bit length, the
+// numbers are in host byte order like the rest of the event.
+//
+class bin_writer
+{
+public:
+	bin_writer(std::string& buf):
+		m_buf(buf)
+	{
+	}
+
+	template<typename T> void put(T val)
+	{
+		m_buf.append((const char*)&val, sizeof(T));
+	}
+
+	void put_str(const std::string& str)
+	{
+		put<uint16_t>((uint16_t)str.size());
+		m_buf.append(str);
+	}
+
+	size_t begin_field(container_bin_tag tag)
+	{
+		put<uint8_t>(tag);
+		put<uint16_t>(0);
+		return m_buf.size();
+	}
+
+	void end_field(size_t start)
+	{
+		// If this overflows the event doesn't fit in a parameter and is
+		// not used, see container_to_sinsp_event()
+		uint16_t len = (uint16_t)(m_buf.size() - start);
+		memcpy(&m_buf[start - sizeof(uint16_t)], &len, sizeof(len));
+	}
+
+	template<typename T> void put_field(container_bin_tag tag, T val)
+	{
+		size_t start = begin_field(tag);
+		put<T>(val);
+		end_field(start);
+	}
+
+	void put_field(container_bin_tag tag, const std::string& str)
+	{
+		if(str.empty())
+		{
+			return;
+		}
+
+		size_t start = begin_field(tag);
+		m_buf.append(str);
+		end_field(start);
+	}
+
+private:
+	std::string& m_buf;
+};
+
+class bin_reader
+{
+public:
+	bin_reader(const char* buf, uint32_t len):
+		m_p(buf),
+		m_end(buf + len)
+	{
+	}
+
+	bool empty() const
+	{
+		return m_p == m_end;
+	}
+
+	template<typename T> bool get(T& val)
+	{
+		if(m_end - m_p < (ptrdiff_t)sizeof(T))
+		{
+			return false;
+		}
+
+		memcpy(&val, m_p, sizeof(T));
+		m_p += sizeof(T);
+		return true;
+	}
+
+	bool get_str(std::string& str)
+	{
+		uint16_t len;
+
+		if(!get(len) || m_end - m_p < len)
+		{
+			return false;
+		}
+
+		str.assign(m_p, len);
+		m_p += len;
+		return true;
+	}
+
+	bool get_field(uint8_t& tag, bin_reader& value)
+	{
+		uint16_t len;
+
+		if(!get(tag) || !get(len) || m_end - m_p < len)
+		{
+			return false;
+		}
+
+		value = bin_reader(m_p, len);
+		m_p += len;
+		return true;
+	}
+
+	std::string rest()
+	{
+		std::string res(m_p, m_end - m_p);
+		m_p = m_end;
+		return res;
+	}
+
+private:
+	const char* m_p;
+	const char* m_end;
+};
+
+} // end namespace
+
+const uint8_t sinsp_container_info::BIN_VERSION = 1;
+
+void sinsp_container_info::to_bin(std::string& buf) const
+{
+	bin_writer w(buf);
+
+	buf.clear();
+	w.put<uint8_t>(BIN_VERSION);
+
+	w.put_field(CBT_ID, m_id);
+	w.put_field<uint32_t>(CBT_TYPE, m_type);
+	w.put_field(CBT_NAME, m_name);
+	w.put_field(CBT_IMAGE, m_image);
+	w.put_field(CBT_IMAGEID, m_imageid);
+	w.put_field(CBT_IMAGEREPO, m_imagerepo);
+	w.put_field(CBT_IMAGETAG, m_imagetag);
+	w.put_field(CBT_IMAGEDIGEST, m_imagedigest);
+	w.put_field<uint8_t>(CBT_PRIVILEGED, m_privileged);
+	w.put_field<uint8_t>(CBT_IS_POD_SANDBOX, m_is_pod_sandbox);
+	w.put_field<uint32_t>(CBT_IP, m_container_ip);
+
+	for(const auto& mntinfo : m_mounts)
+	{
+		size_t start = w.begin_field(CBT_MOUNT);
+		w.put_str(mntinfo.m_source);
+		w.put_str(mntinfo.m_dest);
+		w.put_str(mntinfo.m_mode);
+		w.put<uint8_t>(mntinfo.m_rdwr);
+		w.put_str(mntinfo.m_propagation);
+		w.end_field(start);
+	}
+
+	for(const auto& mapping : m_port_mappings)
+	{
+		size_t start = w.begin_field(CBT_PORT_MAPPING);
+		w.put<uint32_t>(mapping.m_host_ip);
+		w.put<uint16_t>(mapping.m_host_port);
+		w.put<uint16_t>(mapping.m_container_port);
+		w.end_field(start);
+	}
+
+	for(const auto& label : m_labels)
+	{
+		size_t start = w.begin_field(CBT_LABEL);
+		w.put_str(label.first);
+		w.put_str(label.second);
+		w.end_field(start);
+	}
+
+	for(const auto& var : m_env)
+	{
+		if(is_evt_env_var(var))
+		{
+			w.put_field(CBT_ENV, var);
+		}
+	}
+
+	w.put_field<int64_t>(CBT_MEMORY_LIMIT, m_memory_limit);
+	w.put_field<int64_t>(CBT_SWAP_LIMIT, m_swap_limit);
+	w.put_field<int64_t>(CBT_CPU_SHARES, m_cpu_shares);
+	w.put_field<int64_t>(CBT_CPU_QUOTA, m_cpu_quota);
+	w.put_field<int64_t>(CBT_CPU_PERIOD, m_cpu_period);
+	w.put_field<int32_t>(CBT_CPUSET_CPU_COUNT, m_cpuset_cpu_count);
+	w.put_field(CBT_MESOS_TASK_ID, m_mesos_task_id);
+	w.put_field<uint64_t>(CBT_METADATA_DEADLINE, m_metadata_deadline);
+
+	for(const auto& probe : m_health_probes)
+	{
+		size_t start = w.begin_field(CBT_HEALTH_PROBE);
+		w.put<uint8_t>(probe.m_probe_type);
+		w.put_str(probe.m_health_probe_exe);
+		for(const auto& arg : probe.m_health_probe_args)
+		{
+			w.put_str(arg);
+		}
+		w.end_field(start);
+	}
+}
+
+bool sinsp_container_info::from_bin(const char* buf, uint32_t len, std::string& error)
+{
+	bin_reader r(buf, len);
+	uint8_t version;
+
+	if(!r.get(version))
+	{
+		error = "empty container info";
+		return false;
+	}
+
+	if(version != BIN_VERSION)
+	{
+		error = "unsupported container info version " + std::to_string(version);
+		return false;
+	}
+
+	while(!r.empty())
+	{
+		uint8_t tag;
+		bin_reader v(nullptr, 0);
+		bool ok = true;
+
+		if(!r.get_field(tag, v))
+		{
+			error = "truncated container info field";
+			return false;
+		}
+
+		switch(tag)
+		{
+		case CBT_ID:
+			m_id = v.rest();
+			break;
+		case CBT_TYPE:
+		{
+			uint32_t type = 0;
+			ok = v.get(type);
+			if(ok)
+			{
+				m_type = (sinsp_container_type)type;
+			}
+			break;
+		}
+		case CBT_NAME:
+			m_name = v.rest();
+			break;
+		case CBT_IMAGE:
+			m_image = v.rest();
+			break;
+		case CBT_IMAGEID:
+			m_imageid = v.rest();
+			break;
+		case CBT_IMAGEREPO:
+			m_imagerepo = v.rest();
+			break;
+		case CBT_IMAGETAG:
+			m_imagetag = v.rest();
+			break;
+		case CBT_IMAGEDIGEST:
+			m_imagedigest = v.rest();
+			break;
+		case CBT_PRIVILEGED:
+		{
+			uint8_t privileged = 0;
+			ok = v.get(privileged);
+			if(ok)
+			{
+				m_privileged = privileged != 0;
+			}
+			break;
+		}
+		case CBT_IS_POD_SANDBOX:
+		{
+			uint8_t is_pod_sandbox = 0;
+			ok = v.get(is_pod_sandbox);
+			if(ok)
+			{
+				m_is_pod_sandbox = is_pod_sandbox != 0;
+			}
+			break;
+		}
+		case CBT_IP:
+			ok = v.get(m_container_ip);
+			break;
+		case CBT_MOUNT:
+		{
+			container_mount_info mntinfo;
+			uint8_t rdwr = 0;
+			ok = v.get_str(mntinfo.m_source) &&
+				v.get_str(mntinfo.m_dest) &&
+				v.get_str(mntinfo.m_mode) &&
+				v.get(rdwr) &&
+				v.get_str(mntinfo.m_propagation);
+			if(ok)
+			{
+				mntinfo.m_rdwr = rdwr != 0;
+				m_mounts.push_back(std::move(mntinfo));
+			}
+			break;
+		}
+		case CBT_PORT_MAPPING:
+		{
+			container_port_mapping mapping;
+			ok = v.get(mapping.m_host_ip) &&
+				v.get(mapping.m_host_port) &&
+				v.get(mapping.m_container_port);
+			if(ok)
+			{
+				m_port_mappings.push_back(mapping);
+			}
+			break;
+		}
+		case CBT_LABEL:
+		{
+			std::string key;
+			std::string value;
+			ok = v.get_str(key) && v.get_str(value);
+			if(ok)
+			{
+				m_labels[key] = std::move(value);
+			}
+			break;
+		}
+		case CBT_ENV:
+			m_env.emplace_back(v.rest());
+			break;
+		case CBT_MEMORY_LIMIT:
+			ok = v.get(m_memory_limit);
+			break;
+		case CBT_SWAP_LIMIT:
+			ok = v.get(m_swap_limit);
+			break;
+		case CBT_CPU_SHARES:
+			ok = v.get(m_cpu_shares);
+			break;
+		case CBT_CPU_QUOTA:
+			ok = v.get(m_cpu_quota);
+			break;
+		case CBT_CPU_PERIOD:
+			ok = v.get(m_cpu_period);
+			break;
+		case CBT_CPUSET_CPU_COUNT:
+			ok = v.get(m_cpuset_cpu_count);
+			break;
+		case CBT_MESOS_TASK_ID:
+			m_mesos_task_id = v.rest();
+			break;
+		case CBT_METADATA_DEADLINE:
+			ok = v.get(m_metadata_deadline);
+			break;
+		case CBT_HEALTH_PROBE:
+		{
+			container_health_probe probe;
+			uint8_t type = 0;
+			ok = v.get(type) && v.get_str(probe.m_health_probe_exe);
+			probe.m_probe_type = (container_health_probe::probe_type)type;
+			while(ok && !v.empty())
+			{
+				std::string arg;
+				ok = v.get_str(arg);
+				probe.m_health_probe_args.push_back(std::move(arg));
+			}
+			if(ok)
+			{
+				m_health_probes.push_back(std::move(probe));
+			}
+			break;
+		}
+		default:
+			// Written by a newer version, skip it
+			break;
+		}
+
+		if(!ok)
+		{
+			error = "invalid container info field " + std::to_string(tag);
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -204,6 +204,19 @@ public:
 	// Match a process against the set of health probes
 	container_health_probe::probe_type match_health_probe(sinsp_threadinfo *tinfo);
 
+	// Whether an environment variable is written in the container
+	// events. Only a limited set of mesos/marathon-related ones are.
+	static bool is_evt_env_var(const std::string& var);
+
+	// The compact binary encoding of the PPME_CONTAINER_BIN_E events.
+	// Every field is a tag, a 16 bit length and the value, so readers
+	// skip the tags they don't know, and BIN_VERSION only changes if an
+	// existing field changes meaning.
+	static const uint8_t BIN_VERSION;
+	void to_bin(std::string& buf) const;
+	// Returns false and sets error if buf is not a valid encoding
+	bool from_bin(const char* buf, uint32_t len, std::string& error);
+
 	std::string m_id;
 	sinsp_container_type m_type;
 	std::string m_name;
@@ -0,0 +1,260 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+#include "container_info.h"
+
+static sinsp_container_info make_container()
+{
+	sinsp_container_info info;
+
+	info.m_id = "3ad7b26ded6d";
+	info.m_type = CT_CRIO;
+	info.m_name = "k8s_nginx_nginx-7db9fccd9b-zxl9v_default";
+	info.m_image = "docker.io/library/nginx:1.17";
+	info.m_imageid = "f7bb5701a33c0e572ed06ca554edca1bee96cbbc1f76f3b01c985de7e19d0657";
+	info.m_imagerepo = "docker.io/library/nginx";
+	info.m_imagetag = "1.17";
+	info.m_imagedigest = "sha256:ad5552c786f128e389a0263104ae39f3d3c7895579d45ae716f528185b36bc6f";
+	info.m_container_ip = 0x0a000203;
+	info.m_privileged = true;
+	info.m_is_pod_sandbox = false;
+	info.m_mounts.emplace_back("/var/lib/kubelet/pods/1/volumes", "/var/run/secrets", "ro", false, "rprivate");
+	info.m_mounts.emplace_back("/etc/hosts", "/etc/hosts", "", true, "");
+
+	sinsp_container_info::container_port_mapping mapping;
+	mapping.m_host_ip = 0x7f000001;
+	mapping.m_host_port = 8080;
+	mapping.m_container_port = 80;
+	info.m_port_mappings.push_back(mapping);
+
+	info.m_labels["io.kubernetes.pod.name"] = "nginx-7db9fccd9b-zxl9v";
+	info.m_labels["io.kubernetes.pod.namespace"] = "default";
+	info.m_labels["empty"] = "";
+	info.m_env.push_back("MESOS_TASK_ID=nginx.1234");
+	info.m_env.push_back("PATH=/usr/bin");
+	info.m_mesos_task_id = "nginx.1234";
+	info.m_memory_limit = 512 * 1024 * 1024;
+	info.m_swap_limit = -1;
+	info.m_cpu_shares = 512;
+	info.m_cpu_quota = 50000;
+	info.m_cpu_period = 100000;
+	info.m_cpuset_cpu_count = 2;
+	info.m_metadata_deadline = 0xfffffffffffffff0ULL;
+	info.m_health_probes.emplace_back(sinsp_container_info::container_health_probe::PT_LIVENESS_PROBE,
+					  "/bin/sh",
+					  std::vector<std::string>{"-c", "curl -f localhost"});
+
+	return info;
+}
+
+TEST(container_info_bin, round_trip)
+{
+	sinsp_container_info info = make_container();
+	sinsp_container_info decoded;
+	std::string buf;
+	std::string error;
+
+	info.to_bin(buf);
+	ASSERT_TRUE(decoded.from_bin(buf.data(), (uint32_t)buf.size(), error)) << error;
+
+	EXPECT_EQ(info.m_id, decoded.m_id);
+	EXPECT_EQ(info.m_type, decoded.m_type);
+	EXPECT_EQ(info.m_name, decoded.m_name);
+	EXPECT_EQ(info.m_image, decoded.m_image);
+	EXPECT_EQ(info.m_imageid, decoded.m_imageid);
+	EXPECT_EQ(info.m_imagerepo, decoded.m_imagerepo);
+	EXPECT_EQ(info.m_imagetag, decoded.m_imagetag);
+	EXPECT_EQ(info.m_imagedigest, decoded.m_imagedigest);
+	EXPECT_EQ(info.m_container_ip, decoded.m_container_ip);
+	EXPECT_EQ(info.m_privileged, decoded.m_privileged);
+	EXPECT_EQ(info.m_is_pod_sandbox, decoded.m_is_pod_sandbox);
+
+	ASSERT_EQ(2u, decoded.m_mounts.size());
+	for(uint32_t j = 0; j < decoded.m_mounts.size(); j++)
+	{
+		EXPECT_EQ(info.m_mounts[j].to_string(), decoded.m_mounts[j].to_string());
+	}
+
+	ASSERT_EQ(1u, decoded.m_port_mappings.size());
+	EXPECT_EQ(0x7f000001u, decoded.m_port_mappings[0].m_host_ip);
+	EXPECT_EQ(8080, decoded.m_port_mappings[0].m_host_port);
+	EXPECT_EQ(80, decoded.m_port_mappings[0].m_container_port);
+
+	EXPECT_EQ(info.m_labels, decoded.m_labels);
+
+	// Like in the JSON events, only the mesos variables are kept
+	ASSERT_EQ(1u, decoded.m_env.size());
+	EXPECT_EQ("MESOS_TASK_ID=nginx.1234", decoded.m_env[0]);
+
+	EXPECT_EQ(info.m_mesos_task_id, decoded.m_mesos_task_id);
+	EXPECT_EQ(info.m_memory_limit, decoded.m_memory_limit);
+	EXPECT_EQ(info.m_swap_limit, decoded.m_swap_limit);
+	EXPECT_EQ(info.m_cpu_shares, decoded.m_cpu_shares);
+	EXPECT_EQ(info.m_cpu_quota, decoded.m_cpu_quota);
+	EXPECT_EQ(info.m_cpu_period, decoded.m_cpu_period);
+	EXPECT_EQ(info.m_cpuset_cpu_count, decoded.m_cpuset_cpu_count);
+	EXPECT_EQ(info.m_metadata_deadline, decoded.m_metadata_deadline);
+
+	ASSERT_EQ(1u, decoded.m_health_probes.size());
+	auto& probe = decoded.m_health_probes.front();
+	EXPECT_EQ(sinsp_container_info::container_health_probe::PT_LIVENESS_PROBE, probe.m_probe_type);
+	EXPECT_EQ("/bin/sh", probe.m_health_probe_exe);
+	EXPECT_EQ(info.m_health_probes.front().m_health_probe_args, probe.m_health_probe_args);
+
+	// Encoding again gives the same bytes
+	std::string buf2;
+	decoded.to_bin(buf2);
+	EXPECT_EQ(buf, buf2);
+}
+
+TEST(container_info_bin, defaults)
+{
+	sinsp_container_info info;
+	sinsp_container_info decoded;
+	std::string buf;
+	std::string error;
+
+	info.m_id = "abc";
+	info.m_type = CT_DOCKER;
+	info.to_bin(buf);
+	ASSERT_TRUE(decoded.from_bin(buf.data(), (uint32_t)buf.size(), error)) << error;
+
+	EXPECT_EQ("abc", decoded.m_id);
+	EXPECT_EQ("", decoded.m_name);
+	EXPECT_EQ(1024, decoded.m_cpu_shares);
+	EXPECT_EQ(100000, decoded.m_cpu_period);
+	EXPECT_TRUE(decoded.m_mounts.empty());
+	EXPECT_TRUE(decoded.m_labels.empty());
+}
+
+TEST(container_info_bin, unknown_fields)
+{
+	sinsp_container_info info = make_container();
+	sinsp_container_info decoded;
+	std::string buf;
+	std::string error;
+
+	//
+	// A newer writer adds a field, with a tag this version doesn't know
+	//
+	info.to_bin(buf);
+	buf.push_back((char)200);
+	buf.push_back(3);
+	buf.push_back(0);
+	buf.append("xyz");
+
+	ASSERT_TRUE(decoded.from_bin(buf.data(), (uint32_t)buf.size(), error)) << error;
+	EXPECT_EQ(info.m_id, decoded.m_id);
+	EXPECT_EQ(info.m_labels, decoded.m_labels);
+}
+
+TEST(container_info_bin, invalid)
+{
+	sinsp_container_info info = make_container();
+	std::string buf;
+	std::string error;
+
+	info.to_bin(buf);
+
+	EXPECT_FALSE(sinsp_container_info().from_bin(buf.data(), 0, error));
+
+	// A truncation at a field boundary is a valid encoding, the others
+	// must be rejected without reading past the end
+	for(uint32_t len = 1; len < buf.size(); len++)
+	{
+		sinsp_container_info decoded;
+		std::string truncated = buf.substr(0, len);
+
+		decoded.from_bin(truncated.data(), len, error);
+	}
+	EXPECT_FALSE(sinsp_container_info().from_bin(buf.data(), (uint32_t)buf.size() - 1, error));
+
+	buf[0] = sinsp_container_info::BIN_VERSION + 1;
+	EXPECT_FALSE(sinsp_container_info().from_bin(buf.data(), (uint32_t)buf.size(), error));
+	EXPECT_NE(std::string::npos, error.find("version"));
+}
+
+//
+// Decoding time of the binary encoding against parsing the JSON of the
+// same container. Run with --gtest_also_run_disabled_tests.
+//
+TEST(container_info_bin, DISABLED_benchmark)
+{
+	const uint32_t iterations = 100000;
+	sinsp_container_info info = make_container();
+	std::string buf;
+	std::string error;
+
+	info.to_bin(buf);
+
+	Json::Value obj;
+	Json::Value& container = obj["container"];
+	container["id"] = info.m_id;
+	container["type"] = info.m_type;
+	container["name"] = info.m_name;
+	container["image"] = info.m_image;
+	container["imageid"] = info.m_imageid;
+	container["imagerepo"] = info.m_imagerepo;
+	container["imagetag"] = info.m_imagetag;
+	container["imagedigest"] = info.m_imagedigest;
+	container["privileged"] = info.m_privileged;
+	container["ip"] = "10.0.2.3";
+	for(auto& mntinfo : info.m_mounts)
+	{
+		Json::Value mount;
+		mount["Source"] = mntinfo.m_source;
+		mount["Destination"] = mntinfo.m_dest;
+		mount["Mode"] = mntinfo.m_mode;
+		mount["RW"] = mntinfo.m_rdwr;
+		mount["Propagation"] = mntinfo.m_propagation;
+		container["Mounts"].append(mount);
+	}
+	for(auto& label : info.m_labels)
+	{
+		container["labels"][label.first] = label.second;
+	}
+	container["memory_limit"] = (Json::Value::Int64)info.m_memory_limit;
+	container["cpu_shares"] = (Json::Value::Int64)info.m_cpu_shares;
+	container["metadata_deadline"] = (Json::Value::UInt64)info.m_metadata_deadline;
+	std::string json = Json::FastWriter().write(obj);
+
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t j = 0; j < iterations; j++)
+	{
+		sinsp_container_info decoded;
+		decoded.from_bin(buf.data(), (uint32_t)buf.size(), error);
+	}
+	double bin_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for(uint32_t j = 0; j < iterations; j++)
+	{
+		Json::Value root;
+		Json::Reader().parse(json, root);
+	}
+	double json_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("binary: %5zu bytes, %8.0f decodes/s\n", buf.size(), iterations / bin_secs);
+	printf("json:   %5zu bytes, %8.0f parses/s (JSON parsing only)\n", json.size(), iterations / json_secs);
+}
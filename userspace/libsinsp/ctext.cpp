@@ -27,6 +27,16 @@ limitations under the License.
 
 using namespace std;
 
+#ifndef _GNU_SOURCE
+//
+// Make sure we have a declaration for memmem()
+//
+extern "C" {
+extern void *memmem(const void *haystack, size_t haystacklen,
+	const void *needle, size_t needlelen);
+}
+#endif
+
 #define CTEXT_UNDER_X		0x01
 #define CTEXT_OVER_X		0x02
 #define CTEXT_UNDER_Y		0x04
@@ -76,6 +86,7 @@ ctext::ctext(WINDOW *win, ctext_config *config)
 	this->m_attr_mask = 0;
 	this->m_last_search = 0;
 	this->m_event_counter = 0;
+	this->m_n_dropped_rows = 0;
 
 	this->m_max_y = 0;
 
@@ -121,6 +132,57 @@ int8_t ctext::set_query(ctext_search *p_search, string new_query)
 	this->get_offset(&p_search->pos);
 	this->get_offset(&p_search->_start_pos);
 
+	p_search->_query = new_query;
+	p_search->_last_match.y = -1;
+	p_search->_last_event = this->m_event_counter;
+	p_search->_match_count = 0;
+	p_search->_no_match = false;
+	p_search->_no_match_row = 0;
+
+	return 0;
+}
+
+int8_t ctext::refine_query(ctext_search *p_search, string new_query)
+{
+	string& old_query = p_search->_query;
+
+	if(old_query.empty() ||
+		new_query.size() < old_query.size() ||
+		new_query.compare(0, old_query.size(), old_query) != 0)
+	{
+		return this->set_query(p_search, new_query);
+	}
+
+	if(p_search->_no_match)
+	{
+		//
+		// The old query wasn't in the buffer, so the new one can only
+		// be in the rows that were added after the last scan.
+		//
+		p_search->_query = new_query;
+		return 0;
+	}
+
+	if(p_search->_last_match.y == -1)
+	{
+		return this->set_query(p_search, new_query);
+	}
+
+	//
+	// The rows between the start of the search and the current match
+	// didn't contain the old query, so they can't contain the new one:
+	// restart from the current match, which is checked again since the
+	// new query may still be there.
+	//
+	if(p_search->is_forward)
+	{
+		p_search->pos.x--;
+	}
+	else
+	{
+		p_search->pos.x++;
+	}
+
 	p_search->_query = new_query;
 	p_search->_last_match.y = -1;
 	p_search->_last_event = this->m_event_counter;
@@ -197,6 +259,26 @@ int8_t ctext::str_search(ctext_search *to_search)
 
 	this->m_last_search = to_search;
 
+	if(to_search->_no_match)
+	{
+		search_ret = this->str_search_new_rows(to_search);
+		if(search_ret == 0)
+		{
+			if(this->m_config.m_do_wrap)
+			{
+				this->direct_scroll(&to_search->pos);
+			}
+			else
+			{
+				this->direct_scroll(0, to_search->pos.y);
+			}
+
+			this->redraw();
+		}
+
+		return search_ret;
+	}
+
 	// This makes sure that we scroll to a new y row
 	// if multiple matches are on the same viewport row.
 	for(;;)
@@ -231,15 +313,141 @@ int8_t ctext::str_search(ctext_search *to_search)
 		// We can do a general scroll_to and redraw.
 		this->redraw();
 	}
+	else if(to_search->_last_match.y == -1)
+	{
+		//
+		// We went through the whole buffer without a match, remember
+		// it so that the next searches only look at the new rows.
+		// The last row is still being appended to, so it will be
+		// scanned again.
+		//
+		to_search->_no_match = true;
+		to_search->_no_match_row = this->m_n_dropped_rows + this->m_buffer.size() - 1;
+	}
 
 	return search_ret;
 }
 
+int8_t ctext::str_search_new_rows(ctext_search *to_search)
+{
+	int32_t size = (int32_t)this->m_buffer.size();
+	int32_t y = 0;
+	size_t found;
+	string query = to_search->_query;
+
+	if(to_search->is_case_insensitive)
+	{
+		transform(query.begin(), query.end(), query.begin(), ::tolower);
+	}
+
+	if(to_search->_no_match_row > this->m_n_dropped_rows)
+	{
+		y = (int32_t)(to_search->_no_match_row - this->m_n_dropped_rows);
+	}
+
+	for(; y < size; y++)
+	{
+		found = this->find_in_row(this->m_buffer[y].data, query, 0, to_search->is_case_insensitive);
+
+		if(found != string::npos)
+		{
+			to_search->pos.y = y;
+			to_search->pos.x = (int32_t)found;
+			to_search->_start_pos.y = y;
+			to_search->_start_pos.x = (int32_t)found;
+			to_search->_last_match.y = y;
+			to_search->_last_event = this->m_event_counter;
+			to_search->_match_count = 1;
+			to_search->_no_match = false;
+			return 0;
+		}
+	}
+
+	to_search->_no_match_row = this->m_n_dropped_rows + size - 1;
+	return -1;
+}
+
+const char* ctext::row_haystack(const string& row, bool is_case_insensitive)
+{
+	if(!is_case_insensitive)
+	{
+		return row.data();
+	}
+
+	//
+	// Lowercase into a buffer that is reused across rows, so that
+	// we don't allocate while scanning.
+	//
+	this->m_search_lowercase.resize(row.size());
+	for(size_t j = 0; j < row.size(); j++)
+	{
+		this->m_search_lowercase[j] = (char)::tolower((unsigned char)row[j]);
+	}
+
+	return this->m_search_lowercase.data();
+}
+
+size_t ctext::find_in_row(const string& row, const string& query, size_t start, bool is_case_insensitive)
+{
+	if(start > row.size() || query.size() > row.size() - start)
+	{
+		return string::npos;
+	}
+
+	const char* haystack = this->row_haystack(row, is_case_insensitive);
+	const char* res = (const char*)memmem(haystack + start, row.size() - start, query.data(), query.size());
+
+	if(res == NULL)
+	{
+		return string::npos;
+	}
+
+	return res - haystack;
+}
+
+size_t ctext::rfind_in_row(const string& row, const string& query, size_t end, bool is_case_insensitive)
+{
+	size_t last = string::npos;
+
+	if(query.size() > row.size())
+	{
+		return string::npos;
+	}
+
+	//
+	// Same semantics as string::rfind: the match has to start at or
+	// before end.
+	//
+	end = min(end, row.size() - query.size());
+
+	const char* haystack = this->row_haystack(row, is_case_insensitive);
+	const char* cur = haystack;
+	size_t len = end + query.size();
+
+	for(;;)
+	{
+		const char* res = (const char*)memmem(cur, len - (cur - haystack), query.data(), query.size());
+		if(res == NULL)
+		{
+			break;
+		}
+
+		last = res - haystack;
+		cur = res + 1;
+		if((size_t)(cur - haystack) + query.size() > len)
+		{
+			break;
+		}
+	}
+
+	return last;
+}
+
 int8_t ctext::str_search_single(ctext_search *to_search_in, ctext_search *new_pos_out, ctext_pos *limit)
 {
 	int32_t size = (int32_t)this->m_buffer.size();
 	size_t found;
-	string haystack;
+	const string* haystack;
 	ctext_search res, *out;
 
 	if(!to_search_in)
@@ -277,19 +485,23 @@ int8_t ctext::str_search_single(ctext_search *to_search_in, ctext_search *new_po
 
 	for(;;) 
 	{
-		haystack = this->m_buffer[out->pos.y].data;
-		if(to_search_in->is_case_insensitive)
-		{
-			transform(haystack.begin(), haystack.end(), haystack.begin(), ::tolower);
-		}
+		haystack = &this->m_buffer[out->pos.y].data;
 
 		if(out->is_forward)
 		{
-			found = haystack.find(query, (size_t)( (out->pos.x == -2) ? out->pos.x + 2 : out->pos.x + 1));
+			found = this->find_in_row(*haystack, query,
+				(size_t)( (out->pos.x == -2) ? out->pos.x + 2 : out->pos.x + 1),
+				to_search_in->is_case_insensitive);
+		}
+		else if(out->pos.x <= 0 && !haystack->empty())
+		{
+			found = string::npos;
 		}
 		else
 		{
-			found = haystack.rfind(query, (size_t)( (out->pos.x == (int32_t)haystack.size()) ? out->pos.x : out->pos.x - 1));
+			found = this->rfind_in_row(*haystack, query,
+				(size_t)( (out->pos.x == (int32_t)haystack->size()) ? out->pos.x : out->pos.x - 1),
+				to_search_in->is_case_insensitive);
 		}
 
 		if(found == string::npos) 
@@ -346,6 +558,7 @@ int32_t ctext::clear(int32_t row_count)
 	{
 		ret = this->m_buffer.size();
 		this->m_buffer.clear();
+		this->m_n_dropped_rows += ret;
 		this->add_row();
 	}
 	else if(this->m_buffer.size()) 
@@ -353,6 +566,7 @@ int32_t ctext::clear(int32_t row_count)
 		ret = this->m_buffer.size();
 		this->m_buffer.erase(this->m_buffer.begin(), this->m_buffer.begin() + row_count);
 		ret -= this->m_buffer.size();
+		this->m_n_dropped_rows += ret;
 	}
 
 	// We do the same logic when removing content
@@ -690,13 +904,25 @@ void ctext::get_win_size()
 	this->m_win_height = height;
 }
 
-int8_t ctext::rebuf()
+void ctext::trim_buffer()
 {
-	// Memory management is expensive, so we only do this occasionally
-	if(this->m_config.m_buffer_size != -1 && (int32_t)this->m_buffer.size() > (this->m_config.m_buffer_size * 11 / 10))
+	if(this->m_config.m_buffer_size == -1)
+	{
+		return;
+	}
+
+	// Dropping rows from the front of the deque is cheap, so we keep
+	// the buffer exactly at the configured size.
+	while((int32_t)this->m_buffer.size() > this->m_config.m_buffer_size && this->m_buffer.size() > 1)
 	{
-		this->m_buffer.erase(this->m_buffer.begin(), this->m_buffer.end() - this->m_config.m_buffer_size);
+		this->m_buffer.pop_front();
+		this->m_n_dropped_rows++;
 	}
+}
+
+int8_t ctext::rebuf()
+{
+	this->trim_buffer();
 	
 	this->m_max_y = this->m_buffer.size() - 1;
 	
@@ -767,7 +993,7 @@ ctext_row* ctext::add_row()
 	// last line..
 	if(!this->m_buffer.empty())
 	{
-		ctext_row p_row = this->m_buffer.back();
+		const ctext_row& p_row = this->m_buffer.back();
 
 		if(!p_row.format.empty()) 
 		{
@@ -781,6 +1007,12 @@ ctext_row* ctext::add_row()
 
 	this->m_buffer.push_back(row);
 
+	//
+	// Trim as we go, so that the memory stays bounded even
+	// when we are not drawing.
+	//
+	this->trim_buffer();
+
 	return &this->m_buffer.back();
 }
 
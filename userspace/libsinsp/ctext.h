@@ -22,6 +22,7 @@ limitations under the License.
 #include <iostream>
 #include <string>
 #include <vector>
+#include <deque>
 #include <curses.h>
 #include <stdint.h>
 
@@ -37,7 +38,9 @@ struct ctext_config_struct
 {
 	//
 	// This specifies how many lines are kept
-	// in the ring-buffer.	
+	// in the ring-buffer. When the buffer is full,
+	// the oldest lines are dropped as new ones come
+	// in, so this is what bounds the memory usage.
 	//
 	// A value of -1 means to keep it completely
 	// unregulated.
@@ -176,7 +179,16 @@ typedef struct ctext_search_struct
 	uint64_t _last_event;
 	int16_t _match_count;
 
-	// The string to match
+	// Set when a full scan didn't find the query.
+	// _no_match_row is the absolute number of the
+	// last row that was scanned: the rows before
+	// it can't match this query or any refinement
+	// of it.
+	bool _no_match;
+	uint64_t _no_match_row;
+
+	// The string to match. This needs to stay
+	// the last member (see search_copy).
 	string _query;
 
 } ctext_search;
@@ -187,7 +199,12 @@ typedef struct ctext_row_struct
 	vector<ctext_format> format;
 } ctext_row;
 
-typedef vector<ctext_row> ctext_buffer;
+//
+// The rows live in a deque, which is a chunked store: the ring-buffer
+// trimming pops rows from the front in constant time, and the rows don't move
+// when new ones are appended.
+//
+typedef deque<ctext_row> ctext_buffer;
 
 class ctext 
 {
@@ -435,6 +452,17 @@ class ctext
 		//
 		int8_t set_query(ctext_search *p_search, string new_query);
 
+		//
+		// Incremental version of set_query, for when the user keeps
+		// typing. If new_query extends the current query, the search
+		// continues from the current match (the new query can't match
+		// before it) and the rows already known not to match are not
+		// scanned again. Otherwise this is equivalent to set_query.
+		//
+		// Returns 0 on success
+		//
+		int8_t refine_query(ctext_search *p_search, string new_query);
+
 		//
 		// After you've initiated your search you can then go over
 		// the body of text by re-executing the str_search function.
@@ -474,6 +502,7 @@ class ctext
 
 		ctext_row* add_row();
 		void add_format_if_needed();
+		void trim_buffer();
 		int8_t rebuf();
 		void get_win_size();
 		
@@ -508,6 +537,20 @@ class ctext
 		//
 		int8_t str_search_single(ctext_search *to_search_in, ctext_search *new_pos_out = 0, ctext_pos *limit = 0);
 
+		//
+		// Scan the rows added since a search failed, see _no_match.
+		// Returns 0 if a match was found.
+		//
+		int8_t str_search_new_rows(ctext_search *to_search);
+
+		//
+		// string::find and string::rfind on a row, without copies.
+		// For case insensitive searches the query must be lowercase.
+		//
+		size_t find_in_row(const string& row, const string& query, size_t start, bool is_case_insensitive);
+		size_t rfind_in_row(const string& row, const string& query, size_t end, bool is_case_insensitive);
+		const char* row_haystack(const string& row, bool is_case_insensitive);
+
 		// Whether or not to draw when new text comes in or to skip the step.
 		bool m_do_draw;
 		WINDOW *m_win;
@@ -515,6 +558,13 @@ class ctext
 		ctext_buffer m_buffer;
 		ctext_search *m_last_search;
 
+		// Rows dropped from the front of the buffer so far. The absolute
+		// number of the row at index y is m_n_dropped_rows + y.
+		uint64_t m_n_dropped_rows;
+
+		// Lowercase copy of the row being searched
+		string m_search_lowercase;
+
 		// The start point of the buffer with
 		// respect to the current viewport
 		ctext_pos m_pos_start;
@@ -0,0 +1,168 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#ifndef _WIN32
+#include <gtest.h>
+#include <string>
+#include "ctext.h"
+
+//
+// A ctext without a window, holding at most CTEXT_TEST_ROWS rows. The
+// searches start past the beginning of the current row, hence the prompts
+// in front of the lines
+//
+#define CTEXT_TEST_ROWS 10
+
+class ctext_test : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		ctext_config config;
+
+		m_ctext = new ctext(NULL, NULL);
+		m_ctext->get_config(&config);
+		config.m_buffer_size = CTEXT_TEST_ROWS;
+		m_ctext->set_config(&config);
+	}
+
+	void TearDown()
+	{
+		delete m_ctext;
+	}
+
+	void print_lines(uint32_t first, uint32_t count)
+	{
+		for(uint32_t j = first; j < first + count; j++)
+		{
+			m_ctext->printf("> line %u\n", j);
+		}
+	}
+
+	int8_t search(ctext_search* s, const std::string& query, bool is_case_insensitive = false)
+	{
+		m_ctext->new_search(s, query, is_case_insensitive, true, false);
+		return m_ctext->str_search(s);
+	}
+
+	ctext* m_ctext;
+};
+
+//
+// The oldest rows are dropped once the buffer is full
+//
+TEST_F(ctext_test, bounded_rows)
+{
+	ctext_search s;
+	int32_t size;
+
+	print_lines(0, 25);
+
+	// line 16 to line 24, and the empty row being appended to
+	m_ctext->get_buf_size(&size);
+	EXPECT_EQ(CTEXT_TEST_ROWS - 1, size);
+
+	EXPECT_EQ(-1, search(&s, "line 15"));
+	ASSERT_EQ(0, search(&s, "line 16"));
+	EXPECT_EQ(0, s.pos.y);
+	ASSERT_EQ(0, search(&s, "line 24"));
+	EXPECT_EQ(8, s.pos.y);
+}
+
+TEST_F(ctext_test, case_insensitive)
+{
+	ctext_search s;
+
+	m_ctext->printf("some Text\n");
+	m_ctext->printf("more TEXT here\n");
+
+	ASSERT_EQ(0, search(&s, "text", true));
+	EXPECT_EQ(0, s.pos.y);
+	EXPECT_EQ(5, s.pos.x);
+
+	ASSERT_EQ(0, search(&s, "TEXT"));
+	EXPECT_EQ(1, s.pos.y);
+	EXPECT_EQ(5, s.pos.x);
+
+	EXPECT_EQ(-1, search(&s, "texts", true));
+}
+
+//
+// After a failed search only the new rows are looked at, also when the
+// old ones have been dropped in the meantime
+//
+TEST_F(ctext_test, no_match)
+{
+	ctext_search s;
+
+	print_lines(0, 5);
+	EXPECT_EQ(-1, search(&s, "needle", true));
+	EXPECT_TRUE(s._no_match);
+
+	print_lines(5, 3);
+	EXPECT_EQ(-1, m_ctext->str_search(&s));
+	EXPECT_TRUE(s._no_match);
+
+	print_lines(8, 20);
+	m_ctext->printf("a NEEDLE\n");
+	ASSERT_EQ(0, m_ctext->str_search(&s));
+	EXPECT_FALSE(s._no_match);
+	EXPECT_EQ(CTEXT_TEST_ROWS - 2, s.pos.y);
+	EXPECT_EQ(2, s.pos.x);
+
+	//
+	// The row being appended to when the search failed is looked at
+	// again
+	//
+	EXPECT_EQ(-1, search(&s, "haystack"));
+	m_ctext->printf("hay");
+	m_ctext->printf("stack\n");
+	ASSERT_EQ(0, m_ctext->str_search(&s));
+	EXPECT_EQ(CTEXT_TEST_ROWS - 2, s.pos.y);
+}
+
+TEST_F(ctext_test, refine_query)
+{
+	ctext_search s;
+
+	print_lines(0, 5);
+
+	// Longer query, from the current match
+	ASSERT_EQ(0, search(&s, "line"));
+	EXPECT_EQ(0, s.pos.y);
+	m_ctext->refine_query(&s, "line 3");
+	ASSERT_EQ(0, m_ctext->str_search(&s));
+	EXPECT_EQ(3, s.pos.y);
+
+	// A refinement of a query that wasn't found isn't either
+	EXPECT_EQ(-1, search(&s, "xyz"));
+	m_ctext->refine_query(&s, "xyzw");
+	EXPECT_TRUE(s._no_match);
+	EXPECT_EQ(-1, m_ctext->str_search(&s));
+	m_ctext->printf("xyzw\n");
+	ASSERT_EQ(0, m_ctext->str_search(&s));
+	EXPECT_EQ(5, s.pos.y);
+
+	// Anything else starts over
+	m_ctext->refine_query(&s, "line 1");
+	EXPECT_FALSE(s._no_match);
+	ASSERT_EQ(0, m_ctext->str_search(&s));
+	EXPECT_EQ(1, s.pos.y);
+}
+#endif // _WIN32
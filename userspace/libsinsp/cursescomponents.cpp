@@ -1377,9 +1377,21 @@ bool curses_textbox::on_search_key_pressed(string search_str)
 	}
 	else
 	{
-		m_ctext->new_search(m_searcher,
-			search_str,
-			true);
+		//
+		// While the user keeps typing, the query grows one character at
+		// a time: refine the current search instead of starting over,
+		// so that we don't rescan the whole buffer at every key.
+		//
+		if(m_has_searched || m_searcher->_no_match)
+		{
+			m_ctext->refine_query(m_searcher, search_str);
+		}
+		else
+		{
+			m_ctext->new_search(m_searcher,
+				search_str,
+				true);
+		}
 
 		if(m_ctext->str_search(m_searcher) != 0)
 		{
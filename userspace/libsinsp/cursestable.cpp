@@ -194,11 +194,63 @@ void curses_table::configure(sinsp_table* table,
 */
 		m_legend.push_back(ci);
 	}
+
+	//
+	// Cache the per column rendering attributes. render() can run on the UI
+	// thread while the capture thread is flushing the table, and the table
+	// switches its types and extractors during the flush.
+	//
+	m_col_alignments.clear();
+	m_col_time_avg.clear();
+
+	for(j = 0; j < m_legend.size(); j++)
+	{
+		uint32_t tindex = m_table->m_do_merging? j + 2 : j + 1;
+		sinsp_filter_check* extractor = m_table->m_extractors->at(j + 1);
+
+		m_col_alignments.push_back(get_field_alignment(m_table->m_types->at(tindex)));
+		m_col_time_avg.push_back(extractor->m_aggregation == A_TIME_AVG ||
+			extractor->m_merge_aggregation == A_TIME_AVG);
+	}
+}
+
+//
+// Look up rows in the data that is being rendered, which is not necessarily
+// the latest sample of the table
+//
+int32_t curses_table::get_row_from_key(sinsp_table_field* key)
+{
+	uint32_t j;
+
+	if(m_data == NULL)
+	{
+		return -1;
+	}
+
+	for(j = 0; j < m_data->size(); j++)
+	{
+		sinsp_table_field* rowkey = &(m_data->at(j).m_key);
+
+		if(rowkey->m_len == key->m_len)
+		{
+			if(memcmp(rowkey->m_val, key->m_val, key->m_len) == 0)
+			{
+				return j;
+			}
+		}
+	}
+
+	return -1;
 }
 
 void curses_table::update_rowkey(int32_t row)
 {
-	sinsp_table_field* rowkey = m_table->get_row_key(row);
+	sinsp_table_field* rowkey = NULL;
+
+	if(m_data != NULL && row >= 0 && row < (int32_t)m_data->size())
+	{
+		rowkey = &m_data->at(row).m_key;
+	}
 
 	if(rowkey != NULL)
 	{
@@ -217,7 +269,7 @@ void curses_table::update_data(vector<sinsp_sample_row>* data, bool force_select
 
 	if(m_selection_changed && (m_last_key.m_isvalid || m_drilled_up || force_selection_change))
 	{
-		int32_t selct = m_table->get_row_from_key(&m_last_key);
+		int32_t selct = get_row_from_key(&m_last_key);
 		if(selct == -1)
 		{
 			m_selct--;
@@ -421,10 +473,7 @@ void curses_table::render(bool data_changed)
 				coltext = coltext.substr(0, m_legend[j].m_size - 1);
 			}
 
-			uint32_t tindex = m_table->m_do_merging? j + 2 : j + 1;
-
-			curses_table::alignment al = get_field_alignment(m_table->m_types->at(tindex));
-			if(al == curses_table::ALIGN_RIGHT)
+			if(m_col_alignments[j] == curses_table::ALIGN_RIGHT)
 			{
 				coltext.insert(0, m_legend[j].m_size - coltext.size() - 1, ' ');
 			}
@@ -488,11 +537,9 @@ void curses_table::render(bool data_changed)
 
 			for(j = 0, k = 0; j < m_legend.size(); j++)
 			{
-				sinsp_filter_check* extractor = m_table->m_extractors->at(j + 1);
 				uint64_t td = 0;
 
-				if(extractor->m_aggregation == A_TIME_AVG || 
-					extractor->m_merge_aggregation == A_TIME_AVG)
+				if(m_col_time_avg[j])
 				{
 					td = m_parent->get_time_delta();
 				}
@@ -68,6 +68,7 @@ public:
 	
 private:
 	alignment get_field_alignment(ppm_param_type type);
+	int32_t get_row_from_key(sinsp_table_field* key);
 	void print_error(string wstr);
 	void print_wait();
 	void print_line_centered(string line, int32_t off = 0);
@@ -81,6 +82,8 @@ private:
 	uint32_t m_scrolloff_x;
 	uint32_t m_colsizes[PT_MAX];
 	vector<curses_table_column_info> m_legend;
+	vector<alignment> m_col_alignments;
+	vector<bool> m_col_time_avg;
 	vector<sinsp_sample_row>* m_data;
 	sinsp_filter_check_reference* m_converter;
 	vector<uint32_t> m_column_startx;
@@ -270,6 +270,8 @@ sinsp_cursesui::sinsp_cursesui(sinsp* inspector,
 	m_truncated_input = false;
 	m_view_depth = 0;
 	m_interactive = false;
+	m_threaded_capture = false;
+	m_sample_generation = 0;
 	m_json_first_row = json_first_row;
 	m_json_last_row = json_last_row;
 	m_sorting_col = sorting_col;
@@ -538,6 +540,13 @@ void sinsp_cursesui::start(bool is_drilldown, bool is_spy_switch)
 			m_viz = NULL;
 		}
 
+		//
+		// Samples of the previous view can't be rendered by the new one
+		//
+		m_rendered_sample.reset();
+		m_sample_handoff.clear();
+		m_sample_generation++;
+
 		if(m_spectro != NULL)
 		{
 			delete m_spectro;
@@ -1502,6 +1511,19 @@ void sinsp_cursesui::handle_end_of_sample(sinsp_evt* evt, int32_t next_res)
 #ifndef NOCURSESUI
 	if(m_output_type == sinsp_table::OT_CURSES)
 	{
+		//
+		// With the threaded capture, the tables are rendered by the UI thread
+		//
+		if(m_threaded_capture && m_viz)
+		{
+			if(sample != NULL)
+			{
+				m_sample_handoff.publish(make_shared<sinsp_table_sample>(sample, m_sample_generation));
+			}
+
+			return;
+		}
+
 		//
 		// If the help page has been shown, don't update the screen
 		//
@@ -3300,6 +3322,157 @@ bool sinsp_cursesui::is_spectro_paused(int input)
 
 	return m_spectro->m_scroll_paused;
 }
+
+//
+// Consume all the keys in the input queue.
+// Returns true if the caller should return immediatly after calling us.
+// In that case, res is filled with the result.
+//
+bool sinsp_cursesui::handle_keyboard_input(bool* res, uint32_t* ninputs)
+{
+	*ninputs = 0;
+
+	while(true)
+	{
+		int input = getch();
+		bool sppaused = is_spectro_paused(input);
+
+		if(input == -1)
+		{
+			//
+			// All events consumed
+			//
+			if(m_spectro)
+			{
+				if(sppaused)
+				{
+					usleep(100000);
+					continue;
+				}
+				else
+				{
+					break;
+				}
+			}
+			else
+			{
+				break;
+			}
+		}
+		else
+		{
+			(*ninputs)++;
+		}
+
+		//
+		// Handle the event
+		//
+		sysdig_table_action ta = handle_input(input);
+
+		if(execute_table_action(ta, 0, res) == true)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//
+// Point the table visualization to a copy of the latest sample of the table.
+// The input handlers (selection, sorting, drilldowns) work on the table
+// sample, so this must be done before handling the input, and with the
+// capture lock held.
+//
+void sinsp_cursesui::sync_viz_with_table()
+{
+	if(m_viz == NULL || m_datatable == NULL || m_datatable->m_sample_data == NULL)
+	{
+		return;
+	}
+
+	shared_ptr<sinsp_table_sample> sample = make_shared<sinsp_table_sample>(m_datatable->m_sample_data, m_sample_generation);
+
+	m_viz->update_data(&sample->m_rows);
+	m_rendered_sample = sample;
+
+	//
+	// Whatever is pending is not newer than this
+	//
+	m_sample_handoff.clear();
+}
+
+bool sinsp_cursesui::handle_input_threaded()
+{
+	bool res;
+	uint32_t ninputs;
+	int input = getch();
+
+	if(input == -1 && m_spectro == NULL)
+	{
+		return false;
+	}
+
+	if(input != -1)
+	{
+		ungetch(input);
+	}
+
+	sync_viz_with_table();
+
+	bool stop = handle_keyboard_input(&res, &ninputs);
+
+	//
+	// The input handlers can point the visualization to the table sample,
+	// which is recycled by the capture thread at the next flush, and can
+	// change it (e.g. sorting). Switch to a fresh copy and show it.
+	//
+	if(ninputs != 0 && m_viz != NULL && m_datatable != NULL && m_datatable->m_sample_data != NULL)
+	{
+		sync_viz_with_table();
+
+		if(m_viewinfo_page == NULL && m_mainhelp_page == NULL)
+		{
+			m_viz->render(true);
+			render();
+		}
+	}
+
+	return stop && res;
+}
+
+void sinsp_cursesui::render_published_sample()
+{
+	shared_ptr<sinsp_table_sample> sample = m_sample_handoff.take();
+
+	if(sample == NULL || sample->m_generation != m_sample_generation || m_viz == NULL)
+	{
+		return;
+	}
+
+	//
+	// If the help page has been shown, don't update the screen
+	//
+	if(m_viewinfo_page != NULL || m_mainhelp_page != NULL)
+	{
+		return;
+	}
+
+	if(!m_paused)
+	{
+		m_viz->update_data(&sample->m_rows);
+		m_rendered_sample = sample;
+
+		if(m_datatable->m_type == sinsp_table::TT_LIST && m_inspector->is_live())
+		{
+			m_viz->follow_end();
+		}
+
+		m_viz->render(true);
+	}
+
+	render();
+}
 #endif //  NOCURSESUI
 
 //
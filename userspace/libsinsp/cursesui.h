@@ -464,6 +464,26 @@ public:
 	void turn_search_on(search_caller_interface* ifc, string header_text);
 	uint64_t get_time_delta();
 	void run_action(sinsp_view_action_info* action);
+#ifndef NOCURSESUI
+	//
+	// Threaded capture, for live captures with the curses output. The capture
+	// thread calls process_event() with the capture lock held, and publishes a
+	// copy of the table sample at each refresh interval instead of rendering
+	// it. The UI thread calls handle_input_threaded() with the capture lock
+	// held and render_published_sample() without it.
+	//
+	void set_threaded_capture(bool threaded)
+	{
+		m_threaded_capture = threaded;
+	}
+	// Returns true if the application is supposed to exit
+	bool handle_input_threaded();
+	void render_published_sample();
+	sinsp_table_sample_handoff* get_sample_handoff()
+	{
+		return &m_sample_handoff;
+	}
+#endif
 	void spy_selection(string field, string val, sinsp_view_column_info* column_info, bool is_dig);
 	sysdig_table_action handle_input(int ch);
 	bool handle_stdin_input(bool* res);
@@ -490,7 +510,11 @@ public:
 		if(m_output_type != sinsp_table::OT_JSON)
 		{
 #ifndef NOCURSESUI
-			if((ts - m_last_input_check_ts > m_input_check_period_ns) || m_eof)
+			//
+			// With the threaded capture, the input is handled by the UI thread
+			//
+			if(!m_threaded_capture &&
+				((ts - m_last_input_check_ts > m_input_check_period_ns) || m_eof))
 			{
 				uint32_t ninputs = 0;
 				uint64_t evtnum = evt->get_num();
@@ -510,48 +534,10 @@ public:
 				//
 				// If we have more than one event in the queue, consume all of them
 				//
-				while(true)
+				bool res;
+				if(handle_keyboard_input(&res, &ninputs) == true)
 				{
-					int input = getch();
-					bool sppaused = is_spectro_paused(input);
-
-					if(input == -1)
-					{
-						//
-						// All events consumed
-						//
-						if(m_spectro)
-						{
-							if(sppaused)
-							{
-								usleep(100000);
-								continue;
-							}
-							else
-							{
-								break;
-							}
-						}
-						else
-						{
-							break;
-						}
-					}
-					else
-					{
-						ninputs++;
-					}
-
-					//
-					// Handle the event
-					//
-					sysdig_table_action ta = handle_input(input);
-
-					bool res;
-					if(execute_table_action(ta, 0, &res) == true)
-					{
-						return res;
-					}
+					return res;
 				}
 
 				if(ninputs == 0)
@@ -772,6 +758,8 @@ private:
 	void print_progress(double progress);
 	void show_selected_view_info();
 	bool is_spectro_paused(int input);
+	bool handle_keyboard_input(bool* res, uint32_t* ninputs);
+	void sync_viz_with_table();
 #endif
 
 	vector<sinsp_menuitem_info> m_menuitems;
@@ -810,6 +798,10 @@ private:
 	int32_t m_sorting_col;
 	json_spy_renderer* m_json_spy_renderer;
 	sinsp_evt::param_fmt m_json_spy_text_fmt;
+	bool m_threaded_capture;
+	sinsp_table_sample_handoff m_sample_handoff;
+	shared_ptr<sinsp_table_sample> m_rendered_sample;
+	uint64_t m_sample_generation;
 };
 
 #endif // CSYSDIG
@@ -29,6 +29,9 @@ sinsp_dumper::sinsp_dumper(sinsp* inspector)
 	m_target_memory_buffer = NULL;
 	m_target_memory_buffer_size = 0;
 	m_nevts = 0;
+	m_file_nevts = 0;
+	m_checkpoint_interval_ns = 0;
+	m_next_checkpoint_ts = 0;
 }
 
 sinsp_dumper::sinsp_dumper(sinsp* inspector, uint8_t* target_memory_buffer, uint64_t target_memory_buffer_size)
@@ -37,6 +40,10 @@ sinsp_dumper::sinsp_dumper(sinsp* inspector, uint8_t* target_memory_buffer, uint
 	m_dumper = NULL;
 	m_target_memory_buffer = target_memory_buffer;
 	m_target_memory_buffer_size = target_memory_buffer_size;
+	m_nevts = 0;
+	m_file_nevts = 0;
+	m_checkpoint_interval_ns = 0;
+	m_next_checkpoint_ts = 0;
 }
 
 sinsp_dumper::~sinsp_dumper()
@@ -54,6 +61,8 @@ void sinsp_dumper::open(const string& filename, bool compress, bool threads_from
 		throw sinsp_exception("can't start event dump, inspector not opened yet");
 	}
 
+	m_inspector->export_user_list();
+
 	if(m_target_memory_buffer)
 	{
 		m_dumper = scap_memory_dump_open(m_inspector->m_h, m_target_memory_buffer, m_target_memory_buffer_size);
@@ -80,9 +89,10 @@ void sinsp_dumper::open(const string& filename, bool compress, bool threads_from
 		m_inspector->m_thread_manager->dump_threads_to_file(m_dumper);
 	}
 
-	m_inspector->m_container_manager.dump_containers(m_dumper);
+	m_file_nevts = m_inspector->m_container_manager.dump_containers(m_dumper);
 
 	m_nevts = 0;
+	m_next_checkpoint_ts = 0;
 }
 
 void sinsp_dumper::fdopen(int fd, bool compress, bool threads_from_sinsp)
@@ -92,6 +102,8 @@ void sinsp_dumper::fdopen(int fd, bool compress, bool threads_from_sinsp)
 		throw sinsp_exception("can't start event dump, inspector not opened yet");
 	}
 
+	m_inspector->export_user_list();
+
 	if(compress)
 	{
 		m_dumper = scap_dump_open_fd(m_inspector->m_h, fd, SCAP_COMPRESSION_GZIP, threads_from_sinsp);
@@ -111,9 +123,10 @@ void sinsp_dumper::fdopen(int fd, bool compress, bool threads_from_sinsp)
 		m_inspector->m_thread_manager->dump_threads_to_file(m_dumper);
 	}
 
-	m_inspector->m_container_manager.dump_containers(m_dumper);
+	m_file_nevts = m_inspector->m_container_manager.dump_containers(m_dumper);
 
 	m_nevts = 0;
+	m_next_checkpoint_ts = 0;
 }
 
 void sinsp_dumper::close()
@@ -153,6 +166,22 @@ void sinsp_dumper::dump(sinsp_evt* evt)
 	}
 
 	m_nevts++;
+	m_file_nevts++;
+
+	if(m_checkpoint_interval_ns != 0)
+	{
+		uint64_t ts = evt->get_ts();
+
+		if(m_next_checkpoint_ts == 0)
+		{
+			m_next_checkpoint_ts = ts + m_checkpoint_interval_ns;
+		}
+		else if(ts >= m_next_checkpoint_ts)
+		{
+			m_inspector->write_checkpoint(m_dumper, ts, m_file_nevts);
+			m_next_checkpoint_ts = ts + m_checkpoint_interval_ns;
+		}
+	}
 }
 
 uint64_t sinsp_dumper::written_bytes()
@@ -118,6 +118,15 @@ public:
 	*/
 	void dump(sinsp_evt* evt);
 
+	/*!
+	  \brief Write a state checkpoint every interval_ns of event time, see
+	   sinsp::set_checkpoint_interval(). 0, the default, disables them.
+	*/
+	inline void set_checkpoint_interval(uint64_t interval_ns)
+	{
+		m_checkpoint_interval_ns = interval_ns;
+	}
+
 	inline uint8_t* get_memory_dump_cur_buf()
 	{
 		return scap_get_memorydumper_curpos(m_dumper);
@@ -134,6 +143,10 @@ private:
 	uint8_t* m_target_memory_buffer;
 	uint64_t m_target_memory_buffer_size;
 	uint64_t m_nevts;
+	// As a reader that skips the checkpoints counts them
+	uint64_t m_file_nevts;
+	uint64_t m_checkpoint_interval_ns;
+	uint64_t m_next_checkpoint_ts;
 };
 
 /*@}*/
@@ -30,6 +30,7 @@ limitations under the License.
 
 #include "sinsp.h"
 #include "sinsp_int.h"
+#include "buffer_encoders.h"
 
 #include "../libscap/scap.h"
 
@@ -58,6 +59,95 @@ extern sinsp_evttables g_infotables;
 	}                                                       \
 } while(0)
 
+///////////////////////////////////////////////////////////////////////////////
+// sinsp_evt_param_lookup implementation
+///////////////////////////////////////////////////////////////////////////////
+sinsp_evt_param_lookup::sinsp_evt_param_lookup():
+	m_event_info(NULL)
+{
+}
+
+bool sinsp_evt_param_lookup::try_build(const struct ppm_event_info* ei, uint32_t size, uint32_t seed, vector<int8_t>* slots)
+{
+	slots->assign(size, -1);
+
+	for(uint32_t j = 0; j < ei->nparams; j++)
+	{
+		uint32_t slot = hash(ei->params[j].name, seed) & (size - 1);
+		int8_t cur = (*slots)[slot];
+
+		if(cur == -1)
+		{
+			(*slots)[slot] = (int8_t)j;
+		}
+		else if(strcmp(ei->params[cur].name, ei->params[j].name) != 0)
+		{
+			// Real collision. Duplicate names just keep the first index.
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void sinsp_evt_param_lookup::init(const struct ppm_event_info* event_info)
+{
+	vector<int8_t> slots;
+
+	m_event_info = event_info;
+	m_types.resize(PPM_EVENT_MAX);
+	m_slots.clear();
+
+	for(uint32_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+	{
+		const struct ppm_event_info* ei = &event_info[etype];
+		type_table& t = m_types[etype];
+
+		t.m_offset = (uint32_t)m_slots.size();
+		t.m_seed = 0;
+		t.m_mask = 0;
+
+		if(ei->nparams == 0)
+		{
+			continue;
+		}
+
+		//
+		// Start with a load factor of at most 1/2, and grow the table
+		// if no seed gives a perfect hash
+		//
+		uint32_t size = 2;
+		while(size < 2 * ei->nparams)
+		{
+			size <<= 1;
+		}
+
+		while(true)
+		{
+			uint32_t seed;
+
+			for(seed = 0; seed < 256; seed++)
+			{
+				if(try_build(ei, size, seed, &slots))
+				{
+					break;
+				}
+			}
+
+			if(seed < 256)
+			{
+				t.m_seed = seed;
+				t.m_mask = size - 1;
+				break;
+			}
+
+			size <<= 1;
+		}
+
+		m_slots.insert(m_slots.end(), slots.begin(), slots.end());
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // sinsp_evt implementation
 ///////////////////////////////////////////////////////////////////////////////
@@ -203,236 +293,23 @@ const struct ppm_param_info* sinsp_evt::get_param_info(uint32_t id)
 
 uint32_t binary_buffer_to_hex_string(char *dst, char *src, uint32_t dstlen, uint32_t srclen, sinsp_evt::param_fmt fmt)
 {
-	uint32_t j;
-	uint32_t k;
-	uint32_t l = 0;
-	uint32_t num_chunks;
-	uint32_t row_len;
-	char row[128];
-	char *ptr;
-	bool truncated = false;
-
-	for(j = 0; j < srclen; j += 8 * sizeof(uint16_t))
-	{
-		k = 0;
-		k += sprintf(row + k, "\n\t0x%.4x:", j);
-
-		ptr = &src[j];
-		num_chunks = 0;
-		while(num_chunks < 8 && ptr < src + srclen)
-		{
-			uint16_t chunk = htons(*(uint16_t*)ptr);
-
-			if(ptr == src + srclen - 1)
-			{
-				k += sprintf(row + k, " %.2x", *(((uint8_t*)&chunk) + 1));
-			}
-			else
-			{
-				k += sprintf(row + k, " %.4x", chunk);
-			}
-
-			num_chunks++;
-			ptr += sizeof(uint16_t);
-		}
-
-		if((fmt & sinsp_evt::PF_HEXASCII) || (fmt & sinsp_evt::PF_JSONHEXASCII))
-		{
-			// Fill the row with spaces to align it to other rows
-			while(num_chunks < 8)
-			{
-				memset(row + k, ' ', 5);
-
-				k += 5;
-				num_chunks++;
-			}
-
-			row[k++] = ' ';
-			row[k++] = ' ';
-
-			for(ptr = &src[j];
-				ptr < src + j + 8 * sizeof(uint16_t) && ptr < src + srclen;
-				ptr++, k++)
-			{
-				if(isprint((int)(uint8_t)*ptr))
-				{
-					row[k] = *ptr;
-				}
-				else
-				{
-					row[k] = '.';
-				}
-			}
-		}
-		row[k] = 0;
-
-		row_len = (uint32_t)strlen(row);
-		if(l + row_len >= dstlen - 1)
-		{
-			truncated = true;
-			break;
-		}
-		strcpy(dst + l, row);
-		l += row_len;
-	}
-
-	dst[l++] = '\n';
-
-	if(truncated)
-	{
-		return dstlen;
-	}
-	else
-	{
-		return l;
-	}
+	return buffer_encoders::to_hex(dst, src, dstlen, srclen,
+		(fmt & sinsp_evt::PF_HEXASCII) || (fmt & sinsp_evt::PF_JSONHEXASCII));
 }
 
 uint32_t binary_buffer_to_asciionly_string(char *dst, char *src, uint32_t dstlen, uint32_t srclen, sinsp_evt::param_fmt fmt)
 {
-	uint32_t j;
-	uint32_t k = 0;
-
-	if(fmt != sinsp_evt::PF_EOLS_COMPACT)
-	{
-		dst[k++] = '\n';
-	}
-
-	for(j = 0; j < srclen; j++)
-	{
-		//
-		// Make sure there's enough space in the target buffer.
-		// Note that we reserve two bytes, because some characters are expanded
-		// when copied.
-		//
-		if(k >= dstlen - 1)
-		{
-			dst[k - 1] = 0;
-			return dstlen;
-		}
-
-		if(isprint((int)(uint8_t)src[j]))
-		{
-			// switch(src[j])
-			// {
-			// case '"':
-			// case '\\':
-			// 	dst[k++] = '\\';
-			// 	break;
-			// default:
-			// 	break;
-			// }
-
-			dst[k] = src[j];
-			k++;
-		}
-		else if(src[j] == '\r')
-		{
-			dst[k] = '\n';
-			k++;
-		}
-		else if(src[j] == '\n')
-		{
-			if(j > 0 && src[j - 1] != '\r')
-			{
-				dst[k] = src[j];
-				k++;
-			}
-		}
-
-	}
-
-	return k;
+	return buffer_encoders::to_asciionly(dst, src, dstlen, srclen, fmt != sinsp_evt::PF_EOLS_COMPACT);
 }
 
 uint32_t binary_buffer_to_string_dots(char *dst, char *src, uint32_t dstlen, uint32_t srclen, sinsp_evt::param_fmt fmt)
 {
-	uint32_t j;
-	uint32_t k = 0;
-
-	for(j = 0; j < srclen; j++)
-	{
-		//
-		// Make sure there's enough space in the target buffer.
-		// Note that we reserve two bytes, because some characters are expanded
-		// when copied.
-		//
-		if(k >= dstlen - 1)
-		{
-			dst[k - 1] = 0;
-			return dstlen;
-		}
-
-		if(isprint((int)(uint8_t)src[j]))
-		{
-			// switch(src[j])
-			// {
-			// case '"':
-			// case '\\':
-			// 	dst[k++] = '\\';
-			// 	break;
-			// default:
-			// 	break;
-			// }
-
-			dst[k] = src[j];
-		}
-		else
-		{
-			dst[k] = '.';
-		}
-
-		k++;
-	}
-
-	return k;
+	return buffer_encoders::to_dots(dst, src, dstlen, srclen);
 }
 
 uint32_t binary_buffer_to_base64_string(char *dst, char *src, uint32_t dstlen, uint32_t srclen, sinsp_evt::param_fmt fmt)
 {
-	//
-	// base64 encoder, malloc-free version of:
-	// http://stackoverflow.com/questions/342409/how-do-i-base64-encode-decode-in-c
-	//
-	static char encoding_table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-		'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-		'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-		'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
-		'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
-		'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
-		'w', 'x', 'y', 'z', '0', '1', '2', '3',
-		'4', '5', '6', '7', '8', '9', '+', '/'};
-	static uint32_t mod_table[] = {0, 2, 1};
-
-	uint32_t j,k, enc_dstlen;
-
-	enc_dstlen = 4 * ((srclen + 2) / 3);
-	//
-	// Make sure there's enough space in the target buffer.
-	//
-	if(enc_dstlen >= dstlen - 1)
-	{
-		return dstlen;
-	}
-
-	for (j = 0, k = 0; j < srclen;) {
-
-		uint32_t octet_a = j < srclen ? (unsigned char)src[j++] : 0;
-		uint32_t octet_b = j < srclen ? (unsigned char)src[j++] : 0;
-		uint32_t octet_c = j < srclen ? (unsigned char)src[j++] : 0;
-
-		uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
-
-		dst[k++] = encoding_table[(triple >> 3 * 6) & 0x3F];
-		dst[k++] = encoding_table[(triple >> 2 * 6) & 0x3F];
-		dst[k++] = encoding_table[(triple >> 1 * 6) & 0x3F];
-		dst[k++] = encoding_table[(triple >> 0 * 6) & 0x3F];
-	}
-
-	for (j = 0; j < mod_table[srclen % 3]; j++)
-		dst[enc_dstlen - 1 - j] = '=';
-
-	return enc_dstlen;
+	return buffer_encoders::to_base64(dst, src, dstlen, srclen);
 }
 
 uint32_t binary_buffer_to_json_string(char *dst, char *src, uint32_t dstlen, uint32_t srclen, sinsp_evt::param_fmt fmt)
@@ -1608,11 +1485,12 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, OUT const char** resolved_s
 		{
 			if (strncmp(payload, "<NA>", 4) != 0)
 			{
-				string cwd = tinfo->get_cwd();
+				const string& cwd = tinfo->get_cwd_ref();
 
-				if(payload_len + cwd.length() >= m_resolved_paramstr_storage.size())
+				// The '/' between the two may be missing from cwd
+				if(payload_len + cwd.length() + 1 >= m_resolved_paramstr_storage.size())
 				{
-					m_resolved_paramstr_storage.resize(payload_len + cwd.length() + 1, 0);
+					m_resolved_paramstr_storage.resize(payload_len + cwd.length() + 2, 0);
 				}
 
 				if(!sinsp_utils::concatenate_paths(&m_resolved_paramstr_storage[0],
@@ -2109,10 +1987,9 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, OUT const char** resolved_s
 			snprintf(&m_paramstr_storage[0],
 					 m_paramstr_storage.size(),
 					 "%d", val);
-			auto find_it = m_inspector->get_userlist()->find(val);
-			if (find_it != m_inspector->get_userlist()->end())
+			scap_userinfo* user_info = m_inspector->get_user(val);
+			if (user_info != NULL)
 			{
-				scap_userinfo* user_info = find_it->second;
 				strcpy_sanitized(&m_resolved_paramstr_storage[0], user_info->name,
 								(uint32_t)m_resolved_paramstr_storage.size());
 			}
@@ -2142,10 +2019,9 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, OUT const char** resolved_s
 			snprintf(&m_paramstr_storage[0],
 					 m_paramstr_storage.size(),
 					 "%d", val);
-			auto find_it = m_inspector->get_grouplist()->find(val);
-			if (find_it != m_inspector->get_grouplist()->end())
+			scap_groupinfo* group_info = m_inspector->get_group(val);
+			if (group_info != NULL)
 			{
-				scap_groupinfo* group_info = find_it->second;
 				strcpy_sanitized(&m_resolved_paramstr_storage[0], group_info->name,
 								(uint32_t)m_resolved_paramstr_storage.size());
 			}
@@ -2364,22 +2240,19 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, OUT const char** resolved_s
 
 string sinsp_evt::get_param_value_str(const string &name, bool resolved)
 {
-	for(uint32_t i = 0; i < get_num_params(); i++)
-	{
-		if(name == get_param_name(i))
-		{
-			return get_param_value_str(i, resolved);
-		}
-	}
-
-	return string("");
+	return get_param_value_str(name.c_str(), resolved);
 }
 
 string sinsp_evt::get_param_value_str(const char *name, bool resolved)
 {
-	// TODO fix this !!
-	string s_name = string(name);
-	return get_param_value_str(s_name, resolved);
+	int32_t id = get_param_idx(name);
+
+	if(id < 0)
+	{
+		return string("");
+	}
+
+	return get_param_value_str((uint32_t)id, resolved);
 }
 
 string sinsp_evt::get_param_value_str(uint32_t i, bool resolved)
@@ -2400,43 +2273,44 @@ string sinsp_evt::get_param_value_str(uint32_t i, bool resolved)
 
 const char* sinsp_evt::get_param_value_str(const char* name, OUT const char** resolved_str, param_fmt fmt)
 {
-	for(uint32_t i = 0; i < get_num_params(); i++)
+	int32_t id = get_param_idx(name);
+
+	if(id < 0)
 	{
-		if(strcmp(name, get_param_name(i)) == 0)
-		{
-			return get_param_as_str(i, resolved_str, fmt);
-		}
+		*resolved_str = NULL;
+		return NULL;
 	}
 
-	*resolved_str = NULL;
-	return NULL;
+	return get_param_as_str((uint32_t)id, resolved_str, fmt);
 }
 
 const sinsp_evt_param* sinsp_evt::get_param_value_raw(const char* name)
 {
-	//
-	// Make sure the params are actually loaded
-	//
-	if((m_flags & sinsp_evt::SINSP_EF_PARAMS_LOADED) == 0)
+	int32_t id = get_param_idx(name);
+
+	if(id < 0)
 	{
-		load_params();
-		m_flags |= (uint32_t)sinsp_evt::SINSP_EF_PARAMS_LOADED;
+		return NULL;
 	}
 
+	return &(m_params[id]);
+}
+
+int32_t sinsp_evt::get_param_idx(const char* name)
+{
+	int32_t id = g_infotables.m_param_lookup.find(get_type(), name);
+
 	//
-	// Locate the parameter given the name
+	// Events coming from old captures can have less parameters than the
+	// event table. get_num_params() also makes sure that the parameters are
+	// loaded.
 	//
-	uint32_t np = get_num_params();
-
-	for(uint32_t j = 0; j < np; j++)
+	if(id < 0 || id >= (int32_t)get_num_params())
 	{
-		if(strcmp(name, get_param_name(j)) == 0)
-		{
-			return &(m_params[j]);
-		}
+		return -1;
 	}
 
-	return NULL;
+	return id;
 }
 
 void sinsp_evt::get_category(OUT sinsp_evt::category* cat)
@@ -167,17 +167,120 @@ bool sinsp_evt_formatter::on_capture_end(OUT string* res)
 	return res->size() > 0;
 }
 
+sinsp_evt_formatter::type_plan* sinsp_evt_formatter::get_plan(uint16_t etype)
+{
+	if(etype >= PPM_EVENT_MAX)
+	{
+		return NULL;
+	}
+
+	if(m_plans.empty())
+	{
+		m_plans.resize(PPM_EVENT_MAX);
+	}
+
+	type_plan* plan = &m_plans[etype];
+
+	if(plan->m_built)
+	{
+		return plan;
+	}
+
+	plan->m_can_have_all_values = true;
+	plan->m_run_token.resize(m_tokens.size());
+
+	for(uint32_t j = 0; j < m_tokens.size(); j++)
+	{
+		bool is_rawstring = m_tokens[j].first.empty();
+		bool run_token = is_rawstring || m_tokens[j].second->can_have_value(etype);
+		string constant;
+
+		plan->m_run_token[j] = run_token;
+
+		if(is_rawstring)
+		{
+			constant = ((rawstring_check*)m_tokens[j].second)->m_text;
+		}
+		else if(!run_token)
+		{
+			if(m_require_all_values)
+			{
+				plan->m_can_have_all_values = false;
+			}
+
+			constant = "<NA>";
+			if(m_tokenlens[j] != 0)
+			{
+				constant.resize(m_tokenlens[j], ' ');
+			}
+		}
+		else
+		{
+			plan->m_steps.push_back(make_pair((int32_t)j, string()));
+			continue;
+		}
+
+		//
+		// Merge consecutive constant segments
+		//
+		if(!plan->m_steps.empty() && plan->m_steps.back().first == -1)
+		{
+			plan->m_steps.back().second += constant;
+		}
+		else
+		{
+			plan->m_steps.push_back(make_pair(-1, constant));
+		}
+	}
+
+	plan->m_built = true;
+	return plan;
+}
+
+void sinsp_evt_formatter::append_token(uint32_t j, const char* str, OUT string* res)
+{
+	uint32_t tks = m_tokenlens[j];
+
+	if(tks != 0)
+	{
+		//
+		// Truncate or pad to the token width, without a temporary
+		//
+		size_t len = strlen(str);
+
+		if(len >= tks)
+		{
+			res->append(str, tks);
+		}
+		else
+		{
+			res->append(str, len);
+			res->append(tks - len, ' ');
+		}
+	}
+	else
+	{
+		(*res) += str;
+	}
+}
+
 bool sinsp_evt_formatter::resolve_tokens(sinsp_evt *evt, map<string,string>& values)
 {
 	bool retval = true;
 	const filtercheck_field_info* fi;
 	uint32_t j = 0;
+	type_plan* plan = get_plan(evt->get_type());
 
 	ASSERT(m_tokenlens.size() == m_tokens.size());
 
 	for(j = 0; j < m_tokens.size(); j++)
 	{
-		char* str = m_tokens[j].second->tostring(evt);
+		char* str = NULL;
+
+		if(plan == NULL || plan->m_run_token[j])
+		{
+			str = m_tokens[j].second->tostring(evt);
+		}
 
 		if(str == NULL)
 		{
@@ -202,27 +305,32 @@ bool sinsp_evt_formatter::resolve_tokens(sinsp_evt *evt, map<string,string>& val
 	return retval;
 }
 
-
 bool sinsp_evt_formatter::tostring(sinsp_evt* evt, OUT string* res)
 {
 	bool retval = true;
 	const filtercheck_field_info* fi;
+	sinsp_evt::param_fmt fmt = m_inspector->get_buffer_format();
+	type_plan* plan = get_plan(evt->get_type());
 
 	uint32_t j = 0;
-	vector<sinsp_filter_check*>::iterator it;
 	res->clear();
 
 	ASSERT(m_tokenlens.size() == m_tokens.size());
 
-	for(j = 0; j < m_tokens.size(); j++)
+	if(fmt == sinsp_evt::PF_JSON
+	   || fmt == sinsp_evt::PF_JSONEOLS
+	   || fmt == sinsp_evt::PF_JSONHEX
+	   || fmt == sinsp_evt::PF_JSONHEXASCII
+	   || fmt == sinsp_evt::PF_JSONBASE64)
 	{
-		if(m_inspector->get_buffer_format() == sinsp_evt::PF_JSON
-		   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONEOLS
-		   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONHEX
-		   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONHEXASCII
-		   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONBASE64)
+		for(j = 0; j < m_tokens.size(); j++)
 		{
-			Json::Value json_value = m_tokens[j].second->tojson(evt);
+			Json::Value json_value;
+
+			if(plan == NULL || plan->m_run_token[j])
+			{
+				json_value = m_tokens[j].second->tojson(evt);
+			}
 
 			if(retval == false)
 			{
@@ -239,10 +347,19 @@ bool sinsp_evt_formatter::tostring(sinsp_evt* evt, OUT string* res)
 
 			if(fi)
 			{
-				m_root[m_tokens[j].first] = m_tokens[j].second->tojson(evt);
+				m_root[m_tokens[j].first] = json_value;
 			}
 		}
-		else
+
+		(*res) = m_writer.write(m_root);
+		(*res) = res->substr(0, res->size() - 1);
+
+		return retval;
+	}
+
+	if(plan == NULL)
+	{
+		for(j = 0; j < m_tokens.size(); j++)
 		{
 			char* str = m_tokens[j].second->tostring(evt);
 
@@ -264,29 +381,48 @@ bool sinsp_evt_formatter::tostring(sinsp_evt* evt, OUT string* res)
 				}
 			}
 
-			uint32_t tks = m_tokenlens[j];
+			append_token(j, str, res);
+		}
+
+		return retval;
+	}
+
+	//
+	// The checks that can produce a value for this event type still run
+	// when the result is already known to be discarded, because some of
+	// them keep state across events (e.g. evt.delta).
+	//
+	retval = plan->m_can_have_all_values;
+
+	for(const pair<int32_t, string>& step : plan->m_steps)
+	{
+		if(step.first == -1)
+		{
+			(*res) += step.second;
+			continue;
+		}
 
-			if(tks != 0)
+		char* str = m_tokens[step.first].second->tostring(evt);
+
+		if(retval == false)
+		{
+			continue;
+		}
+
+		if(str == NULL)
+		{
+			if(m_require_all_values)
 			{
-				string sstr(str);
-				sstr.resize(tks, ' ');
-				(*res) += sstr;
+				retval = false;
+				continue;
 			}
 			else
 			{
-				(*res) += str;
+				str = (char*)"<NA>";
 			}
 		}
-	}
 
-	if(m_inspector->get_buffer_format() == sinsp_evt::PF_JSON
-	   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONEOLS
-	   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONHEX
-	   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONHEXASCII
-	   || m_inspector->get_buffer_format() == sinsp_evt::PF_JSONBASE64)
-	{
-		(*res) = m_writer.write(m_root);
-		(*res) = res->substr(0, res->size() - 1);
+		append_token(step.first, str, res);
 	}
 
 	return retval;
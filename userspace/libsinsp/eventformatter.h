@@ -80,7 +80,30 @@ public:
 	bool on_capture_end(OUT string* res);
 
 private:
+	//
+	// How to render the events of a given type. The tokens whose check
+	// can't have a value for the type are resolved once, when the plan is
+	// built, together with the constant text around them: rendering the
+	// event only runs the checks that can produce something.
+	//
+	struct type_plan
+	{
+		bool m_built = false;
+
+		// false if a required token can never have a value
+		bool m_can_have_all_values;
+
+		// for every token, whether its check needs to run
+		vector<bool> m_run_token;
+
+		// for the text rendering: (token index, "") for the tokens to
+		// run, (-1, text) for the constant segments
+		vector<pair<int32_t, string>> m_steps;
+	};
+
 	void set_format(const string& fmt);
+	type_plan* get_plan(uint16_t etype);
+	void append_token(uint32_t j, const char* str, OUT string* res);
 
 	// vector of (full string of the token, filtercheck) pairs
 	// e.g. ("proc.aname[2], ptr to sinsp_filter_check_thread)
@@ -89,6 +112,7 @@ private:
 	sinsp* m_inspector;
 	bool m_require_all_values;
 	vector<sinsp_filter_check*> m_chks_to_free;
+	vector<type_plan> m_plans;
 
 	Json::Value m_root;
 	Json::FastWriter m_writer;
@@ -0,0 +1,75 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "filter.h"
+#include "filterchecks.h"
+
+extern sinsp_filter_check_list g_filterlist;
+
+static sinsp_filter_check* new_check(sinsp* inspector, const char* fldname)
+{
+	sinsp_filter_check* chk = g_filterlist.new_filter_check_from_fldname(fldname, inspector, false);
+
+	if(chk != NULL)
+	{
+		chk->parse_field_name(fldname, true, false);
+	}
+
+	return chk;
+}
+
+TEST(eventformatter, can_have_value)
+{
+	sinsp inspector;
+
+	sinsp_filter_check* fdname = new_check(&inspector, "fd.name");
+	sinsp_filter_check* argname = new_check(&inspector, "evt.arg.name");
+	sinsp_filter_check* rawres = new_check(&inspector, "evt.rawres");
+	sinsp_filter_check* procname = new_check(&inspector, "proc.name");
+
+	ASSERT_TRUE(fdname != NULL);
+	ASSERT_TRUE(argname != NULL);
+	ASSERT_TRUE(rawres != NULL);
+	ASSERT_TRUE(procname != NULL);
+
+	EXPECT_TRUE(fdname->can_have_value(PPME_SYSCALL_OPEN_X));
+	EXPECT_TRUE(fdname->can_have_value(PPME_SYSCALL_READ_E));
+	EXPECT_FALSE(fdname->can_have_value(PPME_PROCEXIT_1_E));
+	EXPECT_FALSE(fdname->can_have_value(PPME_SYSCALL_EXECVE_19_X));
+
+	EXPECT_TRUE(argname->can_have_value(PPME_SYSCALL_OPEN_X));
+	EXPECT_FALSE(argname->can_have_value(PPME_SYSCALL_READ_X));
+
+	EXPECT_TRUE(rawres->can_have_value(PPME_SYSCALL_READ_X));
+	EXPECT_TRUE(rawres->can_have_value(PPME_SYSCALL_OPEN_X));
+	EXPECT_FALSE(rawres->can_have_value(PPME_SYSCALL_READ_E));
+
+	for(uint16_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+	{
+		EXPECT_TRUE(procname->can_have_value(etype));
+	}
+
+	delete fdname;
+	delete argname;
+	delete rawres;
+	delete procname;
+}
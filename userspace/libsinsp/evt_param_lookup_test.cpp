@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <chrono>
+#include "sinsp.h"
+#include "sinsp_int.h"
+
+static int32_t linear_find(const ppm_event_info* ei, const char* name)
+{
+	for(uint32_t j = 0; j < ei->nparams; j++)
+	{
+		if(strcmp(name, ei->params[j].name) == 0)
+		{
+			return j;
+		}
+	}
+
+	return -1;
+}
+
+TEST(evt_param_lookup, matches_linear_search)
+{
+	const ppm_event_info* etable = scap_get_event_info_table();
+	sinsp_evt_param_lookup lookup;
+
+	lookup.init(etable);
+
+	for(uint16_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+	{
+		//
+		// Every parameter name of every event, as seen by any event type
+		//
+		for(uint16_t other = 0; other < PPM_EVENT_MAX; other++)
+		{
+			for(uint32_t j = 0; j < etable[other].nparams; j++)
+			{
+				const char* name = etable[other].params[j].name;
+				ASSERT_EQ(linear_find(&etable[etype], name), lookup.find(etype, name))
+					<< etable[etype].name << " " << name;
+			}
+		}
+
+		EXPECT_EQ(-1, lookup.find(etype, ""));
+		EXPECT_EQ(-1, lookup.find(etype, "not_a_param"));
+	}
+
+	EXPECT_EQ(-1, lookup.find(PPM_EVENT_MAX, "fd"));
+}
+
+TEST(evt_param_lookup, global_tables)
+{
+	sinsp_evttables* tables = &g_infotables;
+
+	EXPECT_EQ(0, tables->m_param_lookup.find(PPME_SYSCALL_OPEN_X, "fd"));
+	EXPECT_EQ(1, tables->m_param_lookup.find(PPME_SYSCALL_OPEN_X, "name"));
+	EXPECT_EQ(-1, tables->m_param_lookup.find(PPME_SYSCALL_OPEN_X, "dirfd"));
+	EXPECT_EQ(-1, tables->m_param_lookup.find(PPME_SYSCALL_OPENAT_X, "dirfd"));
+	EXPECT_EQ(1, tables->m_param_lookup.find(PPME_SYSCALL_OPENAT_2_X, "dirfd"));
+}
+
+//
+// Lookups done by an arg-heavy filter like
+// "evt.arg.fd=3 or evt.arg.name contains /etc or evt.arg.res<0 or evt.arg.size>0",
+// across all the event types. Run with --gtest_also_run_disabled_tests.
+//
+TEST(evt_param_lookup, DISABLED_benchmark)
+{
+	const ppm_event_info* etable = scap_get_event_info_table();
+	const char* names[] = {"fd", "name", "res", "size", "data", "tuple"};
+	const uint32_t nnames = sizeof(names) / sizeof(names[0]);
+	const uint32_t rounds = 20000;
+	sinsp_evt_param_lookup lookup;
+	int64_t sum_linear = 0;
+	int64_t sum_lookup = 0;
+
+	lookup.init(etable);
+
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t r = 0; r < rounds; r++)
+	{
+		for(uint16_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+		{
+			for(uint32_t j = 0; j < nnames; j++)
+			{
+				sum_linear += linear_find(&etable[etype], names[j]);
+			}
+		}
+	}
+	auto mid = std::chrono::steady_clock::now();
+	for(uint32_t r = 0; r < rounds; r++)
+	{
+		for(uint16_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+		{
+			for(uint32_t j = 0; j < nnames; j++)
+			{
+				sum_lookup += lookup.find(etype, names[j]);
+			}
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	EXPECT_EQ(sum_linear, sum_lookup);
+
+	uint64_t nlookups = (uint64_t)rounds * PPM_EVENT_MAX * nnames;
+	printf("linear search: %.2f ns/lookup\n",
+		std::chrono::duration<double, std::nano>(mid - start).count() / nlookups);
+	printf("hash lookup:   %.2f ns/lookup\n",
+		std::chrono::duration<double, std::nano>(end - mid).count() / nlookups);
+}
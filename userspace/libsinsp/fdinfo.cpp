@@ -50,7 +50,7 @@ template<> string* sinsp_fdinfo_t::tostring()
 	return &m_name;
 }
 
-template<> char sinsp_fdinfo_t::get_typechar()
+template<> char sinsp_fdinfo_t::get_typechar() const
 {
 	switch(m_type)
 	{
@@ -93,7 +93,7 @@ template<> char sinsp_fdinfo_t::get_typechar()
 	}
 }
 
-template<> char* sinsp_fdinfo_t::get_typestring()
+template<> char* sinsp_fdinfo_t::get_typestring() const
 {
 	switch(m_type)
 	{
@@ -129,7 +129,7 @@ template<> char* sinsp_fdinfo_t::get_typestring()
 	}
 }
 
-template<> string sinsp_fdinfo_t::tostring_clean()
+template<> string sinsp_fdinfo_t::tostring_clean() const
 {
 	string m_tstr = m_name;
 	sanitize_string(m_tstr);
@@ -185,7 +185,7 @@ wildass_guess:
 	return true;
 }
 
-template<> scap_l4_proto sinsp_fdinfo_t::get_l4proto()
+template<> scap_l4_proto sinsp_fdinfo_t::get_l4proto() const
 {
 	scap_fd_type evt_type = m_type;
 
@@ -302,11 +302,17 @@ template<> void sinsp_fdinfo_t::unregister_event_callback(sinsp_pd_callback_type
 sinsp_fdtable::sinsp_fdtable(sinsp* inspector)
 {
 	m_inspector = inspector;
+	m_mark_cloned = false;
 	reset_cache();
 }
 
 sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 {
+	if(m_shared_table)
+	{
+		unshare();
+	}
+
 	//
 	// Look for the FD in the table
 	//
@@ -379,6 +385,11 @@ sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 
 void sinsp_fdtable::erase(int64_t fd)
 {
+	if(m_shared_table)
+	{
+		unshare();
+	}
+
 	unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit = m_table.find(fd);
 
 	if(fd == m_last_accessed_fd)
@@ -411,11 +422,18 @@ void sinsp_fdtable::erase(int64_t fd)
 
 void sinsp_fdtable::clear()
 {
+	m_shared_table.reset();
+	m_mark_cloned = false;
 	m_table.clear();
 }
 
 size_t sinsp_fdtable::size()
 {
+	if(m_shared_table)
+	{
+		return m_shared_table->size();
+	}
+
 	return m_table.size();
 }
 
@@ -423,3 +441,68 @@ void sinsp_fdtable::reset_cache()
 {
 	m_last_accessed_fd = -1;
 }
+
+void sinsp_fdtable::clone_from(sinsp_fdtable* parent)
+{
+	//
+	// The parent stops using its table too, since its fds can't change
+	// anymore while they are shared. Moving them doesn't copy anything.
+	//
+	if(!parent->m_shared_table)
+	{
+		parent->m_shared_table = make_shared<unordered_map<int64_t, sinsp_fdinfo_t>>(std::move(parent->m_table));
+		parent->m_table.clear();
+	}
+
+	parent->reset_cache();
+
+	m_table.clear();
+	m_shared_table = parent->m_shared_table;
+	m_mark_cloned = true;
+	reset_cache();
+
+#ifdef GATHER_INTERNAL_STATS
+	m_inspector->m_stats.m_n_shared_fdtables++;
+#endif
+}
+
+void sinsp_fdtable::copy_fd(const sinsp_fdinfo_t& src, OUT sinsp_fdinfo_t* dst) const
+{
+	*dst = src;
+
+	if(m_mark_cloned)
+	{
+		dst->set_is_cloned();
+	}
+}
+
+void sinsp_fdtable::unshare()
+{
+	//
+	// The last table that was sharing the fds takes them over, the
+	// others copy them
+	//
+	if(m_shared_table.use_count() == 1)
+	{
+		m_table = std::move(*m_shared_table);
+	}
+	else
+	{
+		m_table = *m_shared_table;
+#ifdef GATHER_INTERNAL_STATS
+		m_inspector->m_stats.m_n_copied_fdtables++;
+#endif
+	}
+
+	m_shared_table.reset();
+
+	if(m_mark_cloned)
+	{
+		for(auto& it : m_table)
+		{
+			it.second.set_is_cloned();
+		}
+
+		m_mark_cloned = false;
+	}
+}
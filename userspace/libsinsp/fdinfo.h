@@ -19,6 +19,7 @@ limitations under the License.
 
 #pragma once
 #include "sinsp_pd_callback_type.h"
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -158,19 +159,19 @@ public:
 
 	  Refer to the CHAR_FD_* defines in this fdinfo.h.
 	*/
-	char get_typechar();
+	char get_typechar() const;
 
 	/*!
 	  \brief Return an ASCII string that identifies the FD type.
 
 	  Can be on of 'file', 'directory', ipv4', 'ipv6', 'unix', 'pipe', 'event', 'signalfd', 'eventpoll', 'inotify', 'signalfd'.
 	*/
-	char* get_typestring();
+	char* get_typestring() const;
 
 	/*!
 	  \brief Return the fd name, after removing unprintable or invalid characters from it.
 	*/
-	std::string tostring_clean();
+	std::string tostring_clean() const;
 
 	/*!
 	  \brief Returns true if this is a unix socket.
@@ -183,7 +184,7 @@ public:
 	/*!
 	  \brief Returns true if this is an IPv4 socket.
 	*/
-	bool is_ipv4_socket()
+	bool is_ipv4_socket() const
 	{
 		return m_type == SCAP_FD_IPV4_SOCK;
 	}
@@ -191,7 +192,7 @@ public:
 	/*!
 	  \brief Returns true if this is an IPv4 socket.
 	*/
-	bool is_ipv6_socket()
+	bool is_ipv6_socket() const
 	{
 		return m_type == SCAP_FD_IPV6_SOCK;
 	}
@@ -272,7 +273,7 @@ public:
 	/*!
 	  \brief If this is a socket, returns the IP protocol. Otherwise, return SCAP_FD_UNKNOWN.
 	*/
-	scap_l4_proto get_l4proto();
+	scap_l4_proto get_l4proto() const;
 
 	/*!
 	  \brief Used by protocol decoders to register callbacks related to this FD.
@@ -287,7 +288,7 @@ public:
 	/*!
 	  \brief Return true if this FD is a socket server
 	*/
-	inline bool is_role_server()
+	inline bool is_role_server() const
 	{
 		return (m_flags & FLAGS_ROLE_SERVER) == FLAGS_ROLE_SERVER;
 	}
@@ -295,7 +296,7 @@ public:
 	/*!
 	  \brief Return true if this FD is a socket client
 	*/
-	inline bool is_role_client()
+	inline bool is_role_client() const
 	{
 		return (m_flags & FLAGS_ROLE_CLIENT) == FLAGS_ROLE_CLIENT;
 	}
@@ -303,12 +304,12 @@ public:
 	/*!
 	  \brief Return true if this FD is neither a client nor a server
 	*/
-	inline bool is_role_none()
+	inline bool is_role_none() const
 	{
 		return (m_flags & (FLAGS_ROLE_CLIENT | FLAGS_ROLE_SERVER)) == 0;
 	}
 
-	inline bool is_socket_connected()
+	inline bool is_socket_connected() const
 	{
 		return (m_flags & FLAGS_SOCKET_CONNECTED) == FLAGS_SOCKET_CONNECTED;
 	}
@@ -323,7 +324,7 @@ public:
 		return (m_flags & FLAGS_CONNECTION_FAILED) == FLAGS_CONNECTION_FAILED;
 	}
 
-	inline bool is_cloned()
+	inline bool is_cloned() const
 	{
 		return (m_flags & FLAGS_IS_CLONED) == FLAGS_IS_CLONED;
 	}
@@ -528,6 +529,11 @@ public:
 		//
 		// Caching failed, do a real lookup
 		//
+		if(m_shared_table)
+		{
+			unshare();
+		}
+
 		fdit = m_table.find(fd);
 
 		if(fdit == m_table.end())
@@ -556,12 +562,85 @@ public:
 	size_t size();
 	void reset_cache();
 
+	//
+	// Make this table a copy of the one of the parent of a fork(), with all
+	// the fds marked as cloned. The two tables share the fds until one of
+	// them is accessed, so that a child that exits (or a parent that waits
+	// for it) without touching its fds never copies them.
+	//
+	void clone_from(sinsp_fdtable* parent);
+
+	//
+	// The fds, for the callers that need to go through all of them
+	//
+	inline std::unordered_map<int64_t, sinsp_fdinfo_t>& get_table()
+	{
+		if(m_shared_table)
+		{
+			unshare();
+		}
+
+		return m_table;
+	}
+
+	//
+	// The fds, for the callers that go through all of them without changing
+	// them. A table that is still shared with the other side of a fork() is
+	// not copied, so its fds are not marked as cloned yet: use copy_fd() to
+	// get one the way this table will see it.
+	//
+	inline const std::unordered_map<int64_t, sinsp_fdinfo_t>& peek_table() const
+	{
+		if(m_shared_table)
+		{
+			return *m_shared_table;
+		}
+
+		return m_table;
+	}
+
+	//
+	// Like find(), for the callers that only look at the fd: a table that is
+	// still shared with the other side of a fork() is not copied, and the
+	// cache is left alone
+	//
+	inline const sinsp_fdinfo_t* peek(int64_t fd) const
+	{
+		const std::unordered_map<int64_t, sinsp_fdinfo_t>& table = peek_table();
+		std::unordered_map<int64_t, sinsp_fdinfo_t>::const_iterator fdit = table.find(fd);
+
+		if(fdit == table.end())
+		{
+			return NULL;
+		}
+
+		return &(fdit->second);
+	}
+
+	inline bool is_shared() const
+	{
+		return m_shared_table != nullptr;
+	}
+
+	void copy_fd(const sinsp_fdinfo_t& src, OUT sinsp_fdinfo_t* dst) const;
+
 	sinsp* m_inspector;
-	std::unordered_map<int64_t, sinsp_fdinfo_t> m_table;
 
 	//
 	// Simple fd cache
 	//
 	int64_t m_last_accessed_fd;
 	sinsp_fdinfo_t *m_last_accessed_fdinfo;
+
+private:
+	void unshare();
+
+	std::unordered_map<int64_t, sinsp_fdinfo_t> m_table;
+
+	//
+	// The fds at the time of the fork(), while this table shares them with
+	// the other side of it. m_table is empty in the meantime.
+	//
+	std::shared_ptr<std::unordered_map<int64_t, sinsp_fdinfo_t>> m_shared_table;
+	bool m_mark_cloned;
 };
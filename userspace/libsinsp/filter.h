@@ -44,6 +44,7 @@ private:
 	sinsp* m_inspector;
 
 	friend class sinsp_evt_formatter;
+	friend class sinsp_header_prefilter;
 };
 
 
@@ -211,7 +211,7 @@ bool sinsp_filter_check_fd::extract_fdname_from_creator(sinsp_evt *evt, OUT uint
 			sinsp_evt_param *parinfo;
 			char *name;
 			uint32_t namelen;
-			string sdir;
+			sinsp_strview sdir;
 
 			if(etype == PPME_SYSCALL_OPENAT_X)
 			{
@@ -236,15 +236,9 @@ bool sinsp_filter_check_fd::extract_fdname_from_creator(sinsp_evt *evt, OUT uint
 
 			sinsp_parser::parse_openat_dir(evt, name, dirfd, &sdir);
 
-			char fullpath[SCAP_MAX_PATH_SIZE];
+			sinsp_strview fullpath = sinsp_parser::concatenate_evt_paths(evt, sdir, name, namelen);
 
-			sinsp_utils::concatenate_paths(fullpath, SCAP_MAX_PATH_SIZE,
-				sdir.c_str(),
-				(uint32_t)sdir.length(),
-				name,
-				namelen);
-
-			m_tstr = fullpath;
+			m_tstr.assign(fullpath.m_data, fullpath.m_len);
 			if(sanitize_strings)
 			{
 				sanitize_string(m_tstr);
@@ -1239,7 +1233,7 @@ uint8_t* sinsp_filter_check_fd::extract(sinsp_evt *evt, OUT uint32_t* len, bool
 		break;
 	case TYPE_UID:
 		{
-			if(evt->get_type() == PPME_CONTAINER_JSON_E)
+			if(evt->get_type() == PPME_CONTAINER_JSON_E || evt->get_type() == PPME_CONTAINER_BIN_E)
 			{
 				return NULL;
 			}
@@ -1754,6 +1748,19 @@ bool sinsp_filter_check_fd::extract_fd(sinsp_evt *evt)
 	return true;
 }
 
+bool sinsp_filter_check_fd::can_have_value(uint16_t etype)
+{
+	//
+	// Same condition as extract_fd()
+	//
+	if(etype >= PPM_EVENT_MAX)
+	{
+		return true;
+	}
+
+	return (g_infotables.m_event_info[etype].flags & (EF_CREATES_FD | EF_USES_FD | EF_DESTROYS_FD)) != 0;
+}
+
 bool sinsp_filter_check_fd::compare(sinsp_evt *evt)
 {
 	//
@@ -2125,7 +2132,7 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 
 			if(sinfo != NULL)
 			{
-				m_tstr = sinfo->get_comm();
+				m_tstr = sinfo->m_comm;
 				RETURN_EXTRACT_STRING(m_tstr);
 			}
 			else
@@ -2155,20 +2162,20 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 
 				// mt has been updated to the highest process that has the same session id.
 				// mt's comm is considered the session leader.
-				m_tstr = mt->get_comm();
+				m_tstr = mt->m_comm;
 				RETURN_EXTRACT_STRING(m_tstr);
 			}
 		}
 	case TYPE_TTY:
 		RETURN_EXTRACT_VAR(tinfo->m_tty);
 	case TYPE_NAME:
-		m_tstr = tinfo->get_comm();
+		m_tstr = tinfo->m_comm;
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_EXE:
-		m_tstr = tinfo->get_exe();
+		m_tstr = tinfo->m_exe;
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_EXEPATH:
-		m_tstr = tinfo->get_exepath();
+		m_tstr = tinfo->m_exepath;
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_ARGS:
 		{
@@ -2214,7 +2221,8 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 		}
 	case TYPE_EXELINE:
 		{
-			m_tstr = tinfo->get_exe() + " ";
+			m_tstr = tinfo->m_exe;
+			m_tstr += ' ';
 
 			uint32_t j;
 			uint32_t nargs = (uint32_t)tinfo->m_args.size();
@@ -2231,7 +2239,7 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 			RETURN_EXTRACT_STRING(m_tstr);
 		}
 	case TYPE_CWD:
-		m_tstr = tinfo->get_cwd();
+		m_tstr = tinfo->get_cwd_ref();
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_NTHREADS:
 		{
@@ -2312,7 +2320,7 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 
 			if(ptinfo != NULL)
 			{
-				m_tstr = ptinfo->get_comm();
+				m_tstr = ptinfo->m_comm;
 				RETURN_EXTRACT_STRING(m_tstr);
 			}
 			else
@@ -2396,7 +2404,7 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 				}
 			}
 
-			m_tstr = mt->get_comm();
+			m_tstr = mt->m_comm;
 			RETURN_EXTRACT_STRING(m_tstr);
 		}
 	case TYPE_LOGINSHELLID:
@@ -2641,7 +2649,8 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 			return extract_thread_cpu(evt, len, tinfo, false, true);
 		}
 	case TYPE_NAMETID:
-		m_tstr = tinfo->get_comm() + to_string(evt->get_tid());
+		m_tstr = tinfo->m_comm;
+		m_tstr += to_string(evt->get_tid());
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_IS_CONTAINER_HEALTHCHECK:
 		m_tbool = (tinfo->m_category == sinsp_threadinfo::CAT_HEALTHCHECK);
@@ -2942,6 +2951,12 @@ int32_t sinsp_filter_check_event::extract_arg(string fldname, string val, OUT co
 		parsed_len = (uint32_t)(fldname.size() + strlen(pi->name) + 1);
 		m_argid = -1;
 
+		m_argidx_by_type.resize(PPM_EVENT_MAX);
+		for(uint32_t j = 0; j < PPM_EVENT_MAX; j++)
+		{
+			m_argidx_by_type[j] = (int8_t)g_infotables.m_param_lookup.find((uint16_t)j, pi->name);
+		}
+
 		if(parinfo != NULL)
 		{
 			*parinfo = pi;
@@ -3087,6 +3102,15 @@ size_t sinsp_filter_check_event::parse_filter_value(const char* str, uint32_t le
 	else
 	{
 		parsed_len = sinsp_filter_check::parse_filter_value(str, len, storage, storage_len);
+
+		//
+		// validate_filter_value() isn't virtual, the base class doesn't
+		// get here to set the delta
+		//
+		if(m_field_id == TYPE_AROUND)
+		{
+			validate_filter_value(str, len);
+		}
 	}
 
 	return parsed_len;
@@ -3263,7 +3287,7 @@ uint8_t *sinsp_filter_check_event::extract_abspath(sinsp_evt *evt, OUT uint32_t
 	path = parinfo->m_val;
 	pathlen = parinfo->m_len;
 
-	string sdir;
+	sinsp_strview sdir;
 
 	bool is_absolute = (path[0] == '/');
 	if(is_absolute)
@@ -3273,11 +3297,12 @@ uint8_t *sinsp_filter_check_event::extract_abspath(sinsp_evt *evt, OUT uint32_t
 		// Some processes (e.g. irqbalance) actually do this: they pass an invalid fd and
 		// and absolute path, and openat succeeds.
 		//
-		sdir = ".";
+		sdir = sinsp_strview{".", 1};
 	}
 	else if(dirfd == PPM_AT_FDCWD)
 	{
-		sdir = evt->m_tinfo->get_cwd();
+		const string& cwd = evt->m_tinfo->get_cwd_ref();
+		sdir = sinsp_strview{cwd.c_str(), (uint32_t)cwd.length()};
 	}
 	else
 	{
@@ -3286,27 +3311,22 @@ uint8_t *sinsp_filter_check_event::extract_abspath(sinsp_evt *evt, OUT uint32_t
 		if(evt->m_fdinfo == NULL)
 		{
 			ASSERT(false);
-			sdir = "<UNKNOWN>/";
+			sdir = sinsp_strview{"<UNKNOWN>/", 10};
 		}
 		else
 		{
-			if(evt->m_fdinfo->m_name[evt->m_fdinfo->m_name.length()] == '/')
-			{
-				sdir = evt->m_fdinfo->m_name;
-			}
-			else
-			{
-				sdir = evt->m_fdinfo->m_name + '/';
-			}
+			const string& dirname = evt->m_fdinfo->m_name;
+			sdir = sinsp_strview{dirname.c_str(), (uint32_t)dirname.length()};
 		}
 	}
 
-	char fullname[SCAP_MAX_PATH_SIZE];
-	sinsp_utils::concatenate_paths(fullname, SCAP_MAX_PATH_SIZE, sdir.c_str(), (uint32_t)sdir.length(), path, pathlen);
-
-	m_strstorage = fullname;
+	//
+	// The path is in the event arena, which is valid as long as the event
+	//
+	sinsp_strview fullname = sinsp_parser::concatenate_evt_paths(evt, sdir, path, pathlen);
 
-	RETURN_EXTRACT_STRING(m_strstorage);
+	*len = fullname.m_len;
+	return (uint8_t*)fullname.m_data;
 }
 
 inline uint8_t* sinsp_filter_check_event::extract_buflen(sinsp_evt *evt, OUT uint32_t* len)
@@ -3367,6 +3387,46 @@ Json::Value sinsp_filter_check_event::extract_as_js(sinsp_evt *evt, OUT uint32_t
 	return Json::nullValue;
 }
 
+bool sinsp_filter_check_event::can_have_value(uint16_t etype)
+{
+	if(etype >= PPM_EVENT_MAX)
+	{
+		return true;
+	}
+
+	switch(m_field_id)
+	{
+	case TYPE_ARGRAW:
+	case TYPE_ARGSTR:
+		if(m_argid != -1)
+		{
+			return m_argid < (int32_t)g_infotables.m_event_info[etype].nparams;
+		}
+		else if(!m_argidx_by_type.empty())
+		{
+			return m_argidx_by_type[etype] >= 0;
+		}
+
+		return true;
+	case TYPE_RESRAW:
+	case TYPE_RESSTR:
+		{
+			sinsp_evt_param_lookup* lookup = &g_infotables.m_param_lookup;
+
+			if(lookup->find(etype, "res") >= 0)
+			{
+				return true;
+			}
+
+			return (g_infotables.m_event_info[etype].flags & EF_CREATES_FD) &&
+				PPME_IS_EXIT(etype) &&
+				lookup->find(etype, "fd") >= 0;
+		}
+	default:
+		return true;
+	}
+}
+
 uint8_t* sinsp_filter_check_event::extract_error_count(sinsp_evt *evt, OUT uint32_t* len)
 {
 	const sinsp_evt_param* pi = evt->get_param_value_raw("res");
@@ -3799,7 +3859,18 @@ uint8_t* sinsp_filter_check_event::extract(sinsp_evt *evt, OUT uint32_t* len, bo
 	case TYPE_CPU:
 		RETURN_EXTRACT_VAR(evt->m_cpuid);
 	case TYPE_ARGRAW:
-		return extract_argraw(evt, len, m_arginfo->name);
+		{
+			int32_t id = get_argidx(evt);
+
+			if(id < 0)
+			{
+				return NULL;
+			}
+
+			sinsp_evt_param* pi = evt->get_param(id);
+			*len = pi->m_len;
+			return (uint8_t*)pi->m_val;
+		}
 		break;
 	case TYPE_ARGSTR:
 		{
@@ -3819,7 +3890,14 @@ uint8_t* sinsp_filter_check_event::extract(sinsp_evt *evt, OUT uint32_t* len, bo
 			}
 			else
 			{
-				argstr = evt->get_param_value_str(m_argname.c_str(), &resolved_argstr, m_inspector->get_buffer_format());
+				int32_t id = get_argidx(evt);
+
+				if(id < 0)
+				{
+					return NULL;
+				}
+
+				argstr = evt->get_param_as_str(id, &resolved_argstr, m_inspector->get_buffer_format());
 			}
 
 			if(resolved_argstr != NULL && resolved_argstr[0] != 0)
@@ -3887,7 +3965,9 @@ uint8_t* sinsp_filter_check_event::extract(sinsp_evt *evt, OUT uint32_t* len, bo
 					m_strstorage += evt->get_param_name(j);
 					m_strstorage += '=';
 					m_strstorage += argstr;
-					m_strstorage += string("(") + resolved_argstr + ") ";
+					m_strstorage += '(';
+					m_strstorage += resolved_argstr;
+					m_strstorage += ") ";
 				}
 			}
 
@@ -4596,7 +4676,6 @@ uint8_t* sinsp_filter_check_user::extract(sinsp_evt *evt, OUT uint32_t* len, boo
 	{
 		ASSERT(m_inspector != NULL);
 		uinfo = m_inspector->get_user(tinfo->m_uid);
-		ASSERT(uinfo != NULL);
 		if(uinfo == NULL)
 		{
 			return NULL;
@@ -4669,28 +4748,18 @@ uint8_t* sinsp_filter_check_group::extract(sinsp_evt *evt, OUT uint32_t* len, bo
 		RETURN_EXTRACT_VAR(tinfo->m_gid);
 	case TYPE_NAME:
 		{
-			unordered_map<uint32_t, scap_groupinfo*>::iterator it;
-
 			ASSERT(m_inspector != NULL);
-			unordered_map<uint32_t, scap_groupinfo*>* grouplist =
-				(unordered_map<uint32_t, scap_groupinfo*>*)m_inspector->get_grouplist();
-			ASSERT(grouplist->size() != 0);
-
-			if(tinfo->m_gid == 0xffffffff)
-			{
-				return NULL;
-			}
 
-			it = grouplist->find(tinfo->m_gid);
-			if(it == grouplist->end())
+			//
+			// NULL also while the group is being looked up, see
+			// sinsp::set_async_user_lookups()
+			//
+			scap_groupinfo* ginfo = m_inspector->get_group(tinfo->m_gid);
+			if(ginfo == NULL)
 			{
-				ASSERT(false);
 				return NULL;
 			}
 
-			scap_groupinfo* ginfo = it->second;
-			ASSERT(ginfo != NULL);
-
 			RETURN_EXTRACT_CSTR(ginfo->name);
 		}
 	default:
@@ -135,6 +135,16 @@ public:
 	//
 	virtual Json::Value tojson(sinsp_evt* evt);
 
+	//
+	// Return false if the field can never have a value for events of the
+	// given type (e.g. fd.name for a procexit), so that the formatters can
+	// skip the extraction for them. The default is to assume that it can.
+	//
+	virtual bool can_have_value(uint16_t etype)
+	{
+		return true;
+	}
+
 	sinsp* m_inspector;
 	bool m_needs_state_tracking = false;
 	sinsp_field_aggregation m_aggregation;
@@ -174,6 +184,7 @@ private:
 	void set_inspector(sinsp* inspector);
 
 friend class sinsp_filter_check_list;
+friend class sinsp_header_prefilter;
 };
 
 //
@@ -273,6 +284,7 @@ public:
 	bool compare_port(sinsp_evt *evt);
 	bool compare_domain(sinsp_evt *evt);
 	bool compare(sinsp_evt *evt);
+	bool can_have_value(uint16_t etype);
 
 	sinsp_threadinfo* m_tinfo;
 	sinsp_fdinfo_t* m_fdinfo;
@@ -458,6 +470,7 @@ public:
 	uint8_t* extract(sinsp_evt *evt, OUT uint32_t* len, bool sanitize_strings = true);
 	Json::Value extract_as_js(sinsp_evt *evt, OUT uint32_t* len);
 	bool compare(sinsp_evt *evt);
+	bool can_have_value(uint16_t etype);
 
 	uint64_t m_u64val;
 	uint64_t m_tsdelta;
@@ -469,6 +482,13 @@ public:
 	uint32_t m_evtid1;
 	const ppm_param_info* m_arginfo;
 
+	//
+	// For evt.arg.NAME and evt.rawarg.NAME, the index of the NAME
+	// parameter in every event type (-1 if the event doesn't have it),
+	// resolved when the field is parsed.
+	//
+	vector<int8_t> m_argidx_by_type;
+
 	//
 	// Note: this copy of the field is used by some fields, like TYPE_ARGS and
 	// TYPE_RESARG, that need to do on the fly type customization
@@ -478,6 +498,27 @@ public:
 private:
 	int32_t extract_arg(string fldname, string val, OUT const struct ppm_param_info** parinfo);
 	int32_t extract_type(string fldname, string val, OUT const struct ppm_param_info** parinfo);
+	inline int32_t get_argidx(sinsp_evt *evt)
+	{
+		uint16_t etype = evt->get_type();
+
+		if(etype >= m_argidx_by_type.size())
+		{
+			return -1;
+		}
+
+		int32_t id = m_argidx_by_type[etype];
+
+		//
+		// Events from old captures can have less parameters
+		//
+		if(id >= (int32_t)evt->get_num_params())
+		{
+			return -1;
+		}
+
+		return id;
+	}
 	uint8_t* extract_error_count(sinsp_evt *evt, OUT uint32_t* len);
 	uint8_t *extract_abspath(sinsp_evt *evt, OUT uint32_t *len);
 	inline uint8_t* extract_buflen(sinsp_evt *evt, OUT uint32_t* len);
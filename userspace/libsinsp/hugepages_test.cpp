@@ -0,0 +1,316 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <set>
+#include <vector>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "../../driver/ppm_ringbuffer.h"
+
+static const scap_hugepages_mode g_modes[] = {SCAP_HUGEPAGES_NONE, SCAP_HUGEPAGES_TRANSPARENT, SCAP_HUGEPAGES_EXPLICIT};
+static const char* g_mode_names[] = {"none", "transparent", "explicit"};
+
+TEST(hugepages, alloc_buffer)
+{
+	const size_t sizes[] = {1, 65536, SCAP_HUGEPAGE_SIZE, SCAP_HUGEPAGE_SIZE + 1, 3 * SCAP_HUGEPAGE_SIZE};
+
+	for(scap_hugepages_mode mode : g_modes)
+	{
+		for(size_t size : sizes)
+		{
+			char* buf = (char*)scap_alloc_buffer(size, mode);
+			ASSERT_TRUE(buf != NULL) << g_mode_names[mode] << " " << size;
+
+			if(mode != SCAP_HUGEPAGES_NONE)
+			{
+				EXPECT_EQ(0u, (uintptr_t)buf % SCAP_HUGEPAGE_SIZE) << g_mode_names[mode] << " " << size;
+			}
+
+			memset(buf, 0xaa, size);
+			EXPECT_EQ((char)0xaa, buf[size - 1]);
+			scap_free_buffer(buf, size, mode);
+		}
+	}
+
+	scap_free_buffer(NULL, 10, SCAP_HUGEPAGES_TRANSPARENT);
+}
+
+static int64_t free_hugepages()
+{
+	int64_t res = -1;
+	FILE* f = fopen("/sys/kernel/mm/hugepages/hugepages-2048kB/free_hugepages", "r");
+
+	if(f != NULL)
+	{
+		if(fscanf(f, "%" PRId64, &res) != 1)
+		{
+			res = -1;
+		}
+
+		fclose(f);
+	}
+
+	return res;
+}
+
+//
+// The explicit hugepages come from the SCAP_HUGEPAGE_SIZE pool, whatever
+// the default size is. Needs a few pages reserved in that pool.
+//
+TEST(hugepages, explicit_pool)
+{
+	const size_t size = 2 * SCAP_HUGEPAGE_SIZE + 1;
+	int64_t nfree = free_hugepages();
+
+	if(nfree < 3)
+	{
+		printf("not enough free %d kB hugepages, skipping\n", SCAP_HUGEPAGE_SIZE / 1024);
+		return;
+	}
+
+	char* buf = (char*)scap_alloc_buffer(size, SCAP_HUGEPAGES_EXPLICIT);
+	ASSERT_TRUE(buf != NULL);
+	EXPECT_EQ(0u, (uintptr_t)buf % SCAP_HUGEPAGE_SIZE);
+	memset(buf, 0xaa, size);
+	EXPECT_EQ(nfree - 3, free_hugepages());
+
+	scap_free_buffer(buf, size, SCAP_HUGEPAGES_EXPLICIT);
+	EXPECT_EQ(nfree, free_hugepages());
+}
+
+TEST(hugepages, evt_buffer_pool)
+{
+	const uint32_t nbufs = 2 * SCAP_HUGEPAGE_SIZE / SP_EVT_BUF_SIZE + 10;
+	std::vector<uint8_t*> bufs;
+	std::set<uint8_t*> unique;
+
+	for(uint32_t j = 0; j < nbufs; j++)
+	{
+		uint8_t* ptr = sinsp_evt_buffer_pool::alloc(SCAP_HUGEPAGES_TRANSPARENT);
+		ASSERT_TRUE(ptr != NULL);
+		memset(ptr, j & 0xff, SP_EVT_BUF_SIZE);
+		bufs.push_back(ptr);
+		unique.insert(ptr);
+	}
+
+	// No overlapping buffers
+	EXPECT_EQ(nbufs, unique.size());
+	for(auto it = unique.begin(); std::next(it) != unique.end(); ++it)
+	{
+		EXPECT_LE(*it + SP_EVT_BUF_SIZE, *std::next(it));
+	}
+
+	for(uint8_t* ptr : bufs)
+	{
+		sinsp_evt_buffer_pool::release(ptr);
+	}
+
+	// The released buffers are handed out again
+	uint8_t* ptr = sinsp_evt_buffer_pool::alloc(SCAP_HUGEPAGES_TRANSPARENT);
+	EXPECT_TRUE(unique.find(ptr) != unique.end());
+	sinsp_evt_buffer_pool::release(ptr);
+
+	// Buffers that don't come from the pool are freed
+	sinsp_evt_buffer_pool::release((uint8_t*)malloc(SP_EVT_BUF_SIZE));
+}
+
+//
+// A synthetic live source: one RING_BUF_SIZE ring per CPU, filled with
+// events of random size whose timestamps are interleaved across the rings.
+//
+class synthetic_rings
+{
+public:
+	synthetic_rings(uint32_t ncpus, uint32_t nthreads, scap_hugepages_mode mode):
+		m_mode(mode)
+	{
+		uint64_t ts = 1;
+
+		for(uint32_t j = 0; j < ncpus; j++)
+		{
+			m_rings.push_back((char*)scap_alloc_buffer(RING_BUF_SIZE, mode));
+			m_lens.push_back(0);
+		}
+
+		srand(45);
+
+		while(true)
+		{
+			uint32_t cpu = rand() % ncpus;
+			uint32_t datalen = 8 + rand() % 200;
+			uint32_t len = sizeof(ppm_evt_hdr) + sizeof(uint16_t) + datalen;
+
+			if(m_lens[cpu] + len > RING_BUF_SIZE)
+			{
+				break;
+			}
+
+			char* p = m_rings[cpu] + m_lens[cpu];
+			ppm_evt_hdr* hdr = (ppm_evt_hdr*)p;
+			hdr->ts = ts++;
+			hdr->tid = rand() % nthreads;
+			hdr->len = len;
+			hdr->type = rand() % 2 ? PPME_SYSCALL_READ_E : PPME_SYSCALL_READ_X;
+			hdr->nparams = 1;
+			*(uint16_t*)(p + sizeof(ppm_evt_hdr)) = (uint16_t)datalen;
+			memset(p + sizeof(ppm_evt_hdr) + sizeof(uint16_t), (int)(ts & 0xff), datalen);
+
+			m_lens[cpu] += len;
+			m_total_bytes += len;
+			m_nevts++;
+		}
+	}
+
+	~synthetic_rings()
+	{
+		for(char* ring : m_rings)
+		{
+			scap_free_buffer(ring, RING_BUF_SIZE, m_mode);
+		}
+	}
+
+	std::vector<char*> m_rings;
+	std::vector<uint32_t> m_lens;
+	uint64_t m_total_bytes = 0;
+	uint64_t m_nevts = 0;
+	scap_hugepages_mode m_mode;
+};
+
+//
+// Consume the rings like scap_next() does, picking the oldest event across
+// the CPUs, and save the enter events in a per thread buffer like the
+// parser does with m_lastevent_data.
+//
+static uint64_t consume(synthetic_rings& src, std::vector<uint8_t*>& thread_bufs)
+{
+	uint32_t ncpus = (uint32_t)src.m_rings.size();
+	std::vector<uint32_t> pos(ncpus, 0);
+	uint64_t sum = 0;
+
+	while(true)
+	{
+		ppm_evt_hdr* next = NULL;
+		uint32_t next_cpu = 0;
+
+		for(uint32_t j = 0; j < ncpus; j++)
+		{
+			if(pos[j] < src.m_lens[j])
+			{
+				ppm_evt_hdr* hdr = (ppm_evt_hdr*)(src.m_rings[j] + pos[j]);
+				if(next == NULL || hdr->ts < next->ts)
+				{
+					next = hdr;
+					next_cpu = j;
+				}
+			}
+		}
+
+		if(next == NULL)
+		{
+			break;
+		}
+
+		pos[next_cpu] += next->len;
+
+		uint8_t* data = (uint8_t*)next + sizeof(ppm_evt_hdr) + sizeof(uint16_t);
+		sum += next->tid + data[0];
+
+		if(next->type == PPME_SYSCALL_READ_E)
+		{
+			memcpy(thread_bufs[next->tid], next, next->len);
+		}
+		else
+		{
+			sum += thread_bufs[next->tid][sizeof(ppm_evt_hdr)];
+		}
+	}
+
+	return sum;
+}
+
+//
+// Consumer throughput with and without hugepages. The number of rings
+// defaults to the number of CPUs and can be set with SYSDIG_BENCH_NCPUS.
+// Run with --gtest_also_run_disabled_tests.
+//
+TEST(hugepages, DISABLED_benchmark)
+{
+	const uint32_t nthreads = 20000;
+	const uint32_t rounds = 5;
+	uint32_t ncpus = sinsp::num_possible_cpus();
+	uint64_t ref_sum = 0;
+
+	if(getenv("SYSDIG_BENCH_NCPUS") != NULL)
+	{
+		ncpus = atoi(getenv("SYSDIG_BENCH_NCPUS"));
+	}
+
+	for(scap_hugepages_mode mode : g_modes)
+	{
+		synthetic_rings src(ncpus, nthreads, mode);
+		std::vector<uint8_t*> thread_bufs;
+
+		for(uint32_t j = 0; j < nthreads; j++)
+		{
+			uint8_t* ptr = NULL;
+			if(mode != SCAP_HUGEPAGES_NONE)
+			{
+				ptr = sinsp_evt_buffer_pool::alloc(mode);
+			}
+			if(ptr == NULL)
+			{
+				ptr = (uint8_t*)malloc(SP_EVT_BUF_SIZE);
+			}
+			memset(ptr, 0, SP_EVT_BUF_SIZE);
+			thread_bufs.push_back(ptr);
+		}
+
+		// Warm up
+		uint64_t sum = consume(src, thread_bufs);
+		if(mode == SCAP_HUGEPAGES_NONE)
+		{
+			ref_sum = sum;
+		}
+		EXPECT_EQ(ref_sum, sum);
+
+		auto start = std::chrono::steady_clock::now();
+		for(uint32_t j = 0; j < rounds; j++)
+		{
+			consume(src, thread_bufs);
+		}
+		auto end = std::chrono::steady_clock::now();
+		double secs = std::chrono::duration<double>(end - start).count();
+
+		printf("%-12s %u rings: %8.2f Mevt/s %8.1f MB/s\n",
+			g_mode_names[mode],
+			ncpus,
+			(double)(src.m_nevts * rounds) / secs / 1000000,
+			(double)(src.m_total_bytes * rounds) / secs / (1024 * 1024));
+
+		for(uint8_t* ptr : thread_bufs)
+		{
+			sinsp_evt_buffer_pool::release(ptr);
+		}
+	}
+}
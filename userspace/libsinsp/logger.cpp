@@ -26,6 +26,11 @@ limitations under the License.
 #include <time.h>
 #endif
 #include <stdarg.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace
 {
@@ -34,8 +39,47 @@ thread_local char s_tbuf[16384];
 
 const size_t ENCODE_LEN = sizeof(uint64_t);
 
+// "SEV_XXX 31-12 23:59:59.999999 "
+const size_t MAX_PREFIX_LEN = 64;
+
+//
+// How a message is stored in the async buffer: the header, then the
+// message with its prefix
+//
+struct async_record
+{
+	uint32_t m_len;
+	sinsp_logger::severity m_sev;
+};
+
 } // end namespace
 
+struct sinsp_logger::async_state
+{
+	std::mutex m_mutex;
+	// Wakes up the writer
+	std::condition_variable m_queued_cond;
+	// Wakes up flush()
+	std::condition_variable m_written_cond;
+	std::thread m_thread;
+	bool m_running = false;
+	bool m_stop = false;
+
+	//
+	// The callers append to the front buffer, while the writer drains the
+	// back one
+	//
+	std::vector<char> m_front;
+	std::vector<char> m_back;
+	size_t m_front_len = 0;
+
+	// Messages queued and written so far
+	uint64_t m_n_queued = 0;
+	uint64_t m_n_written = 0;
+	uint64_t m_n_drops = 0;
+	uint64_t m_n_drops_reported = 0;
+};
+
 const uint32_t sinsp_logger::OT_NONE       = 0;
 const uint32_t sinsp_logger::OT_STDOUT     = 1;
 const uint32_t sinsp_logger::OT_STDERR     = (OT_STDOUT   << 1);
@@ -44,15 +88,20 @@ const uint32_t sinsp_logger::OT_CALLBACK   = (OT_FILE     << 1);
 const uint32_t sinsp_logger::OT_NOTS       = (OT_CALLBACK << 1);
 const uint32_t sinsp_logger::OT_ENCODE_SEV = (OT_NOTS     << 1);
 
+const size_t sinsp_logger::DEFAULT_ASYNC_BUFSIZE = 1024 * 1024;
+
 sinsp_logger::sinsp_logger():
 	m_file(nullptr),
 	m_callback(nullptr),
 	m_flags(OT_NONE),
-	m_sev(SEV_INFO)
+	m_sev(SEV_INFO),
+	m_is_async(false)
 { }
 
 sinsp_logger::~sinsp_logger()
 {
+	disable_async();
+
 	if(m_file)
 	{
 		ASSERT(m_flags & sinsp_logger::OT_FILE);
@@ -137,13 +186,14 @@ sinsp_logger::severity sinsp_logger::get_severity() const
 	return m_sev;
 }
 
-void sinsp_logger::log(std::string msg, const severity sev)
+size_t sinsp_logger::build_prefix(char* buf, size_t bufsize, const severity sev) const
 {
-	sinsp_logger_callback cb = nullptr;
+	size_t len = 0;
 
-	if(sev > m_sev)
+	if(m_flags & sinsp_logger::OT_ENCODE_SEV)
 	{
-		return;
+		memcpy(buf, encode_severity(sev), ENCODE_LEN);
+		len += ENCODE_LEN;
 	}
 
 	if((m_flags & sinsp_logger::OT_NOTS) == 0)
@@ -152,13 +202,11 @@ void sinsp_logger::log(std::string msg, const severity sev)
 
 		if(gettimeofday(&ts, nullptr) == 0)
 		{
-			const std::string::size_type ts_length = sizeof("31-12 23:59:59.999999 ");
-			char ts_buf[ts_length];
 			struct tm time_info = {};
 
 			gmtime_r(&ts.tv_sec, &time_info);
-			snprintf(ts_buf,
-				 sizeof(ts_buf),
+			len += snprintf(buf + len,
+				 bufsize - len,
 				 "%.2d-%.2d %.2d:%.2d:%.2d.%.6d ",
 				 time_info.tm_mon + 1,
 				 time_info.tm_mday,
@@ -166,20 +214,36 @@ void sinsp_logger::log(std::string msg, const severity sev)
 				 time_info.tm_min,
 				 time_info.tm_sec,
 				 (int)ts.tv_usec);
-
-			ts_buf[sizeof(ts_buf) - 1] = '\0';
-			msg.insert(0, ts_buf);
 		}
 	}
 
-	if(m_flags & sinsp_logger::OT_ENCODE_SEV)
+	buf[len] = '\0';
+	return len;
+}
+
+void sinsp_logger::log(std::string msg, const severity sev)
+{
+	if(sev > m_sev)
+	{
+		return;
+	}
+
+	if(m_is_async && write_async(msg.c_str(), msg.size(), sev))
 	{
-		char sev_buf[ENCODE_LEN + 1];
-		strncpy(sev_buf, encode_severity(sev), sizeof(sev_buf));
-		sev_buf[sizeof(sev_buf) - 1] = 0;
-		msg.insert(0, sev_buf);
+		return;
 	}
 
+	char prefix[MAX_PREFIX_LEN];
+	size_t prefix_len = build_prefix(prefix, sizeof(prefix), sev);
+	msg.insert(0, prefix, prefix_len);
+
+	write_sync(std::move(msg), sev);
+}
+
+void sinsp_logger::write_sync(std::string&& msg, const severity sev)
+{
+	sinsp_logger_callback cb = nullptr;
+
 	if(is_callback())
 	{
 		cb = m_callback;
@@ -210,10 +274,25 @@ const char* sinsp_logger::format(const severity sev, const char* const fmt, ...)
 {
 	va_list ap;
 
+	if(sev > m_sev)
+	{
+		s_tbuf[0] = '\0';
+		return s_tbuf;
+	}
+
 	va_start(ap, fmt);
-	vsnprintf(s_tbuf, sizeof s_tbuf, fmt, ap);
+	int len = vsnprintf(s_tbuf, sizeof s_tbuf, fmt, ap);
 	va_end(ap);
 
+	//
+	// In async mode the message goes straight from the thread local
+	// buffer to the async one
+	//
+	if(len >= 0 && m_is_async && write_async(s_tbuf, std::min((size_t)len, sizeof(s_tbuf) - 1), sev))
+	{
+		return s_tbuf;
+	}
+
 	log(s_tbuf, sev);
 
 	return s_tbuf;
@@ -223,15 +302,251 @@ const char* sinsp_logger::format(const char* const fmt, ...)
 {
 	va_list ap;
 
+	if(SEV_INFO > m_sev)
+	{
+		s_tbuf[0] = '\0';
+		return s_tbuf;
+	}
+
 	va_start(ap, fmt);
-	vsnprintf(s_tbuf, sizeof s_tbuf, fmt, ap);
+	int len = vsnprintf(s_tbuf, sizeof s_tbuf, fmt, ap);
 	va_end(ap);
 
+	if(len >= 0 && m_is_async && write_async(s_tbuf, std::min((size_t)len, sizeof(s_tbuf) - 1), SEV_INFO))
+	{
+		return s_tbuf;
+	}
+
 	log(s_tbuf, SEV_INFO);
 
 	return s_tbuf;
 }
 
+void sinsp_logger::enable_async(const size_t bufsize)
+{
+	if(!m_async)
+	{
+		m_async.reset(new async_state());
+	}
+
+	std::lock_guard<std::mutex> lock(m_async->m_mutex);
+
+	if(m_async->m_running)
+	{
+		return;
+	}
+
+	m_async->m_front.resize(bufsize);
+	m_async->m_back.resize(bufsize);
+	m_async->m_front_len = 0;
+	m_async->m_stop = false;
+	m_async->m_running = true;
+	m_async->m_thread = std::thread(&sinsp_logger::async_writer, this);
+	m_is_async = true;
+}
+
+void sinsp_logger::disable_async()
+{
+	if(!m_async)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_async->m_mutex);
+
+		if(!m_async->m_running)
+		{
+			return;
+		}
+
+		m_is_async = false;
+		m_async->m_stop = true;
+		m_async->m_queued_cond.notify_one();
+	}
+
+	//
+	// The writer drains the buffer before exiting
+	//
+	m_async->m_thread.join();
+
+	std::lock_guard<std::mutex> lock(m_async->m_mutex);
+	m_async->m_running = false;
+	m_async->m_written_cond.notify_all();
+}
+
+void sinsp_logger::flush()
+{
+	if(!m_async)
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_async->m_mutex);
+	uint64_t seq = m_async->m_n_queued;
+
+	m_async->m_written_cond.wait(lock, [this, seq] {
+		return !m_async->m_running || m_async->m_n_written >= seq;
+	});
+}
+
+uint64_t sinsp_logger::get_n_async_drops() const
+{
+	if(!m_async)
+	{
+		return 0;
+	}
+
+	std::lock_guard<std::mutex> lock(m_async->m_mutex);
+	return m_async->m_n_drops;
+}
+
+bool sinsp_logger::write_async(const char* msg, size_t len, const severity sev)
+{
+	char prefix[MAX_PREFIX_LEN];
+	size_t prefix_len = build_prefix(prefix, sizeof(prefix), sev);
+	async_record rec;
+
+	rec.m_len = (uint32_t)(prefix_len + len);
+	rec.m_sev = sev;
+
+	std::unique_lock<std::mutex> lock(m_async->m_mutex);
+
+	if(!m_async->m_running || m_async->m_stop)
+	{
+		return false;
+	}
+
+	if(m_async->m_front_len + sizeof(rec) + rec.m_len > m_async->m_front.size())
+	{
+		m_async->m_n_drops++;
+		return true;
+	}
+
+	char* p = m_async->m_front.data() + m_async->m_front_len;
+	memcpy(p, &rec, sizeof(rec));
+	memcpy(p + sizeof(rec), prefix, prefix_len);
+	memcpy(p + sizeof(rec) + prefix_len, msg, len);
+
+	if(m_async->m_front_len == 0)
+	{
+		m_async->m_queued_cond.notify_one();
+	}
+
+	m_async->m_front_len += sizeof(rec) + rec.m_len;
+	uint64_t seq = ++m_async->m_n_queued;
+
+	//
+	// Don't lose the last words of a dying process
+	//
+	if(sev <= SEV_CRITICAL)
+	{
+		m_async->m_written_cond.wait(lock, [this, seq] {
+			return m_async->m_n_written >= seq;
+		});
+	}
+
+	return true;
+}
+
+void sinsp_logger::async_writer()
+{
+	std::unique_lock<std::mutex> lock(m_async->m_mutex);
+
+	while(true)
+	{
+		m_async->m_queued_cond.wait(lock, [this] {
+			return m_async->m_front_len != 0 || m_async->m_stop;
+		});
+
+		if(m_async->m_front_len == 0)
+		{
+			break;
+		}
+
+		std::swap(m_async->m_front, m_async->m_back);
+		size_t len = m_async->m_front_len;
+		uint64_t seq = m_async->m_n_queued;
+		uint64_t ndrops = m_async->m_n_drops - m_async->m_n_drops_reported;
+		m_async->m_front_len = 0;
+		m_async->m_n_drops_reported = m_async->m_n_drops;
+
+		lock.unlock();
+
+		//
+		// Write the batch, with a single flush at the end
+		//
+		sinsp_logger_callback cb = is_callback() ? m_callback.load() : nullptr;
+		FILE* out = nullptr;
+
+		if(cb == nullptr)
+		{
+			if((m_flags & sinsp_logger::OT_FILE) && m_file)
+			{
+				out = m_file;
+			}
+			else if(m_flags & sinsp_logger::OT_STDOUT)
+			{
+				out = stdout;
+			}
+			else if(m_flags & sinsp_logger::OT_STDERR)
+			{
+				out = stderr;
+			}
+		}
+
+		const char* p = m_async->m_back.data();
+		const char* end = p + len;
+
+		while(p < end)
+		{
+			async_record rec;
+			memcpy(&rec, p, sizeof(rec));
+			p += sizeof(rec);
+
+			if(cb != nullptr)
+			{
+				cb(std::string(p, rec.m_len), rec.m_sev);
+			}
+			else if(out != nullptr)
+			{
+				fwrite(p, 1, rec.m_len, out);
+				fputc('\n', out);
+			}
+
+			p += rec.m_len;
+		}
+
+		if(ndrops != 0)
+		{
+			char msg[128];
+			char prefix[MAX_PREFIX_LEN];
+			size_t prefix_len = build_prefix(prefix, sizeof(prefix), SEV_WARNING);
+
+			snprintf(msg, sizeof(msg), "%.*slogger: dropped %" PRIu64 " messages, the async log buffer is full",
+				(int)prefix_len, prefix, ndrops);
+
+			if(cb != nullptr)
+			{
+				cb(std::string(msg), SEV_WARNING);
+			}
+			else if(out != nullptr)
+			{
+				fprintf(out, "%s\n", msg);
+			}
+		}
+
+		if(out != nullptr)
+		{
+			fflush(out);
+		}
+
+		lock.lock();
+		m_async->m_n_written = seq;
+		m_async->m_written_cond.notify_all();
+	}
+}
+
 namespace {
 // All severity strings should be ENCODE_LEN chars long
 const char* SEV_LEVELS[] = {
@@ -22,6 +22,7 @@ limitations under the License.
 #include "sinsp_public.h"
 
 #include <atomic>
+#include <memory>
 #include <string>
 
 /**
@@ -59,6 +60,8 @@ public:
 	const static uint32_t OT_NOTS;
 	const static uint32_t OT_ENCODE_SEV;
 
+	const static size_t DEFAULT_ASYNC_BUFSIZE;
+
 	/**
 	 * Initialize this sinsp_logger with no output sinks enabled.
 	 */
@@ -102,6 +105,41 @@ public:
 	/** Deregister any registered logging callbacks.  */
 	void remove_callback_log();
 
+	/**
+	 * Write the logs from a background thread instead of the caller.
+	 * The formatted messages are copied into a preallocated buffer of
+	 * bufsize bytes and the thread writes them to the log sink in
+	 * batches, with one flush per batch. If the buffer is full, the
+	 * messages are dropped and counted (see get_n_async_drops()).
+	 * Messages of SEV_CRITICAL or more severe are written before the
+	 * logging call returns.
+	 *
+	 * Note: the callback sink, if any, is invoked from the background
+	 * thread.
+	 */
+	void enable_async(size_t bufsize = DEFAULT_ASYNC_BUFSIZE);
+
+	/**
+	 * Write the pending messages, stop the background thread and go
+	 * back to writing the logs from the caller.
+	 */
+	void disable_async();
+
+	/** Returns true if the async mode is enabled. */
+	bool is_async() const { return m_is_async; }
+
+	/**
+	 * Block until the messages logged so far have been written. Does
+	 * nothing if the async mode is not enabled.
+	 */
+	void flush();
+
+	/**
+	 * Returns the number of messages dropped because the async buffer was
+	 * full.
+	 */
+	uint64_t get_n_async_drops() const;
+
 	/**
 	 * Set the minimum severity of logs that this sinsp_logger will emit.
 	 */
@@ -129,10 +167,12 @@ public:
 
 	/**
 	 * Write the given printf-style log message of the given severity
-	 * with the given format to the configured log sink.
+	 * with the given format to the configured log sink. The message is
+	 * not formatted if sev is filtered out.
 	 *
 	 * @returns a pointer to static thread-local storage containing the
-	 *          formatted log message.
+	 *          formatted log message, or an empty string if sev is
+	 *          filtered out.
 	 */
 	const char* format(severity sev, const char* fmt, ...);
 
@@ -158,10 +198,33 @@ private:
 
 	/** Returns a string containing encoded severity, for OT_ENCODE_SEV. */
 	static const char* encode_severity(severity sev);
+
+	/**
+	 * Write the encoded severity and the timestamp, as configured, to buf.
+	 * Returns the length of the prefix.
+	 */
+	size_t build_prefix(char* buf, size_t bufsize, severity sev) const;
+
+	/** Write the given message, prefix included, to the log sink. */
+	void write_sync(std::string&& msg, severity sev);
+
+	/**
+	 * Queue the message for the background thread. Returns false if the
+	 * async mode has been disabled in the meantime.
+	 */
+	bool write_async(const char* msg, size_t len, severity sev);
+
+	/** The body of the background thread. */
+	void async_writer();
+
+	struct async_state;
+
 	std::atomic<FILE*> m_file;
 	std::atomic<callback_t> m_callback;
 	std::atomic<uint32_t> m_flags;
 	std::atomic<severity> m_sev;
+	std::atomic<bool> m_is_async;
+	std::unique_ptr<async_state> m_async;
 };
 
 using sinsp_logger_callback = sinsp_logger::callback_t;
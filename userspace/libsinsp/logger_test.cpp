@@ -0,0 +1,184 @@
+/*
+Copyright (C) 2013-2019 Sysdig, Inc.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger.h"
+
+namespace
+{
+
+std::mutex s_mutex;
+std::vector<std::pair<std::string, sinsp_logger::severity>> s_msgs;
+// The writer thread, or the thread that logged in sync mode
+std::thread::id s_writer_tid;
+// When set, the callback is slow so that the buffer fills up
+std::atomic<bool> s_slow(false);
+
+void log_cb(std::string&& str, const sinsp_logger::severity sev)
+{
+	if(s_slow)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_msgs.emplace_back(std::move(str), sev);
+	s_writer_tid = std::this_thread::get_id();
+}
+
+} // end namespace
+
+class logger_async : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		s_msgs.clear();
+		s_slow = false;
+		m_logger.add_callback_log(log_cb);
+		m_logger.disable_timestamps();
+		m_logger.set_severity(sinsp_logger::SEV_DEBUG);
+	}
+
+	sinsp_logger m_logger;
+};
+
+TEST_F(logger_async, order)
+{
+	m_logger.enable_async();
+	ASSERT_TRUE(m_logger.is_async());
+
+	for(uint32_t j = 0; j < 1000; j++)
+	{
+		if(j % 2)
+		{
+			m_logger.format(sinsp_logger::SEV_INFO, "msg %u", j);
+		}
+		else
+		{
+			m_logger.log("msg " + std::to_string(j), sinsp_logger::SEV_DEBUG);
+		}
+	}
+
+	m_logger.flush();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	ASSERT_EQ(1000u, s_msgs.size());
+	for(uint32_t j = 0; j < s_msgs.size(); j++)
+	{
+		EXPECT_EQ("msg " + std::to_string(j), s_msgs[j].first);
+		EXPECT_EQ(j % 2 ? sinsp_logger::SEV_INFO : sinsp_logger::SEV_DEBUG, s_msgs[j].second);
+	}
+
+	EXPECT_NE(std::this_thread::get_id(), s_writer_tid);
+	EXPECT_EQ(0u, m_logger.get_n_async_drops());
+}
+
+TEST_F(logger_async, filtered_before_formatting)
+{
+	m_logger.set_severity(sinsp_logger::SEV_WARNING);
+
+	// The filtered messages are not rendered at all
+	EXPECT_STREQ("", m_logger.format(sinsp_logger::SEV_DEBUG, "%s", "x"));
+	EXPECT_TRUE(s_msgs.empty());
+
+	m_logger.enable_async();
+	EXPECT_STREQ("", m_logger.format(sinsp_logger::SEV_INFO, "%s %s", "x", "y"));
+	EXPECT_STREQ("x", m_logger.format(sinsp_logger::SEV_ERROR, "%s", "x"));
+	m_logger.flush();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	ASSERT_EQ(1u, s_msgs.size());
+	EXPECT_EQ("x", s_msgs[0].first);
+}
+
+TEST_F(logger_async, drops)
+{
+	s_slow = true;
+	m_logger.add_encoded_severity();
+
+	// Room for a handful of messages only
+	m_logger.enable_async(256);
+
+	for(uint32_t j = 0; j < 200; j++)
+	{
+		m_logger.format(sinsp_logger::SEV_INFO, "a message that takes some room %u", j);
+	}
+
+	m_logger.disable_async();
+	EXPECT_FALSE(m_logger.is_async());
+
+	uint64_t ndrops = m_logger.get_n_async_drops();
+	EXPECT_GT(ndrops, 0u);
+
+	//
+	// Every message is either written or dropped, and the drops are
+	// reported with a warning
+	//
+	std::lock_guard<std::mutex> lock(s_mutex);
+	uint64_t nwritten = 0;
+	uint64_t nreported = 0;
+
+	for(auto& it : s_msgs)
+	{
+		if(it.second == sinsp_logger::SEV_WARNING)
+		{
+			size_t pos = it.first.find("dropped ");
+			ASSERT_NE(std::string::npos, pos);
+			nreported += std::stoull(it.first.substr(pos + sizeof("dropped ") - 1));
+		}
+		else
+		{
+			EXPECT_EQ(0u, it.first.find("SEV_INF a message"));
+			nwritten++;
+		}
+	}
+
+	EXPECT_EQ(200u, nwritten + ndrops);
+	EXPECT_EQ(ndrops, nreported);
+}
+
+TEST_F(logger_async, critical_written_before_returning)
+{
+	s_slow = true;
+	m_logger.enable_async();
+
+	m_logger.log("first", sinsp_logger::SEV_INFO);
+	m_logger.log("fatal", sinsp_logger::SEV_CRITICAL);
+
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		ASSERT_EQ(2u, s_msgs.size());
+		EXPECT_EQ("first", s_msgs[0].first);
+		EXPECT_EQ("fatal", s_msgs[1].first);
+	}
+
+	// Back to sync mode, on this thread
+	m_logger.disable_async();
+	m_logger.log("sync", sinsp_logger::SEV_INFO);
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	ASSERT_EQ(3u, s_msgs.size());
+	EXPECT_EQ(std::this_thread::get_id(), s_writer_tid);
+}
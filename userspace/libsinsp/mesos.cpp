@@ -332,6 +332,26 @@ void mesos::rebuild_marathon_state(bool full)
 		{
 			clear_marathon();
 
+			//
+			// All the requests run in parallel, then the responses are
+			// parsed in the usual order
+			//
+			for(auto& group_http : m_marathon_groups_http)
+			{
+				if(group_http.second)
+				{
+					group_http.second->request_all_data();
+				}
+			}
+
+			for(auto& app_http : m_marathon_apps_http)
+			{
+				if(app_http.second)
+				{
+					app_http.second->request_all_data();
+				}
+			}
+
 			for(auto& group_http : m_marathon_groups_http)
 			{
 				if(group_http.second)
@@ -54,28 +54,36 @@ string mesos_auth::get_token()
 	return m_token;
 }
 
-void mesos_auth::authenticate()
-{
 #ifdef HAS_CAPTURE
+sinsp_curl_multi::request mesos_auth::make_auth_request() const
+{
+	sinsp_curl_multi::request req(m_auth_uri);
+	Json::FastWriter json_writer;
+	Json::Value auth_obj;
+
+	auth_obj["uid"] = m_dcos_enterprise_credentials.first;
+	auth_obj["password"] = m_dcos_enterprise_credentials.second;
+	req.m_body = json_writer.write(auth_obj);
+	req.m_headers.push_back("Content-Type: application/json");
+	// No certificates and no peer verification
+	req.m_ssl = std::make_shared<sinsp_ssl>("", "");
+	return req;
+}
 
+void mesos_auth::handle_auth_response(const sinsp_curl_multi::response& response)
+{
 	try
 	{
-		sinsp_curl auth_request(m_auth_uri, "", "");
-		Json::FastWriter json_writer;
-		Json::Value auth_obj;
-		auth_obj["uid"] = m_dcos_enterprise_credentials.first;
-		auth_obj["password"] = m_dcos_enterprise_credentials.second;
-		auth_request.add_header("Content-Type: application/json");
-		auth_request.setopt(CURLOPT_POST, 1);
-		auth_request.set_body(json_writer.write(auth_obj));
-		//auth_request.enable_debug();
-		auto response = auth_request.get_data();
-
-		if(auth_request.get_response_code() == 200)
+		if(response.m_result != CURLE_OK)
+		{
+			throw sinsp_exception(curl_easy_strerror(response.m_result));
+		}
+
+		if(response.m_response_code == 200)
 		{
 			Json::Reader json_reader;
 			Json::Value response_obj;
-			auto parse_ok = json_reader.parse(response, response_obj, false);
+			auto parse_ok = json_reader.parse(response.m_data, response_obj, false);
 			if(parse_ok && response_obj.isMember("token"))
 			{
 				m_token = response_obj["token"].asString();
@@ -85,16 +93,16 @@ void mesos_auth::authenticate()
 			{
 				std::string errstr;
 				errstr = json_reader.getFormattedErrorMessages();
-				g_json_error_log.log(response, errstr, sinsp_utils::get_current_time_ns(), m_auth_uri.to_string());
+				g_json_error_log.log(response.m_data, errstr, sinsp_utils::get_current_time_ns(), m_auth_uri.to_string());
 				throw sinsp_exception(string("Cannot parse json (" + errstr + ")"));
 			}
 			else
 			{
-				throw sinsp_exception(string("Cannot authenticate on Mesos master, response=") + response);
+				throw sinsp_exception(string("Cannot authenticate on Mesos master, response=") + response.m_data);
 			}
 		} else
 		{
-			throw sinsp_exception(string("Cannot authenticate on Mesos master, response_code=") + to_string(auth_request.get_response_code()));
+			throw sinsp_exception(string("Cannot authenticate on Mesos master, response_code=") + to_string(response.m_response_code));
 		}
 		time(&m_last_token_refresh_s);
 	}
@@ -108,6 +116,24 @@ void mesos_auth::authenticate()
 
 		g_json_error_log.log("", errstr, sinsp_utils::get_current_time_ns(), m_auth_uri.to_string());
 	}
+}
+#endif // HAS_CAPTURE
+
+void mesos_auth::authenticate()
+{
+#ifdef HAS_CAPTURE
+	//
+	// The first token is needed right away, by the requests that follow
+	//
+	try
+	{
+		handle_auth_response(m_curl_multi.perform(make_auth_request()));
+	}
+	catch(std::exception& e)
+	{
+		g_logger.log("Could not fetch authentication token via " + m_auth_uri.to_string() + ": " + e.what(),
+			sinsp_logger::SEV_ERROR);
+	}
 #endif // HAS_CAPTURE
 }
 
@@ -116,12 +142,29 @@ void mesos_auth::refresh_token()
 #ifdef HAS_CAPTURE
 	if(!m_dcos_enterprise_credentials.first.empty())
 	{
+		if(m_token_request.valid())
+		{
+			if(m_token_request.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				handle_auth_response(m_token_request.get());
+			}
+			return;
+		}
+
 		time_t now; time(&now);
 
 		if(difftime(now, m_last_token_refresh_s) > m_token_refresh_interval)
 		{
 			g_logger.format(sinsp_logger::SEV_DEBUG, "Regenerating Mesos Auth token");
-			authenticate();
+			try
+			{
+				m_token_request = m_curl_multi.start(make_auth_request());
+			}
+			catch(std::exception& e)
+			{
+				g_logger.log("Could not request authentication token via " + m_auth_uri.to_string() + ": " + e.what(),
+					sinsp_logger::SEV_ERROR);
+			}
 		}
 	}
 #endif // HAS_CAPTURE
@@ -45,15 +45,35 @@ public:
 	// token if necessary.
 	std::string get_token();
 
+#ifdef HAS_CAPTURE
+	// Shared by the HTTP clients of the API servers
+	sinsp_curl_multi& get_curl_multi();
+#endif // HAS_CAPTURE
+
 protected:
 	std::string             m_token;
 
 private:
 	void authenticate();
 
+#ifdef HAS_CAPTURE
+	sinsp_curl_multi::request make_auth_request() const;
+	void handle_auth_response(const sinsp_curl_multi::response& response);
+
+	sinsp_curl_multi m_curl_multi;
+	// The token refresh, the old token is used until it's done
+	std::future<sinsp_curl_multi::response> m_token_request;
+#endif // HAS_CAPTURE
+
 	const uri::credentials_t m_dcos_enterprise_credentials;
 	uri m_auth_uri;
 	int m_token_refresh_interval;
 	time_t m_last_token_refresh_s;
 };
 
+#ifdef HAS_CAPTURE
+inline sinsp_curl_multi& mesos_auth::get_curl_multi()
+{
+	return m_curl_multi;
+}
+#endif // HAS_CAPTURE
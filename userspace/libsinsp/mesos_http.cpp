@@ -43,7 +43,6 @@ mesos_http::mesos_http(mesos& m, const uri& url,
 					bool discover_mesos_lead_master,
 					bool discover_marathon,
 					int timeout_ms, const string& token):
-	m_sync_curl(curl_easy_init()),
 	m_select_curl(curl_easy_init()),
 	m_mesos(m),
 	m_url(url),
@@ -55,9 +54,10 @@ mesos_http::mesos_http(mesos& m, const uri& url,
 	m_is_mesos_state(url.to_string().find(mesos::default_state_api) != std::string::npos),
 	m_discover_lead_master(discover_mesos_lead_master),
 	m_discover_marathon(discover_marathon),
+	m_response_code(-1),
 	m_token(token)
 {
-	if(!m_sync_curl || !m_select_curl)
+	if(!m_select_curl)
 	{
 		throw sinsp_exception("mesos_http: CURL initialization failed.");
 	}
@@ -65,21 +65,11 @@ mesos_http::mesos_http(mesos& m, const uri& url,
 	ASSERT(m_curl_version);
 
 	m_request = make_request(url, m_curl_version);
-	if(!m_token.empty())
-	{
-		m_sync_curl_headers.add(string("Authorization: token=") + m_token);
-		check_error(curl_easy_setopt(m_sync_curl, CURLOPT_HTTPHEADER, m_sync_curl_headers.ptr()));
-	}
 	if(m_url.is_secure())
 	{
-		check_error(curl_easy_setopt(m_sync_curl, CURLOPT_SSL_VERIFYPEER, 0));
-		check_error(curl_easy_setopt(m_sync_curl, CURLOPT_SSL_VERIFYHOST, 0));
 		check_error(curl_easy_setopt(m_select_curl, CURLOPT_SSL_VERIFYPEER, 0));
 		check_error(curl_easy_setopt(m_select_curl, CURLOPT_SSL_VERIFYHOST, 0));
 	}
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_FORBID_REUSE, 1L));
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_CONNECTTIMEOUT_MS, m_timeout_ms));
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_TIMEOUT_MS, m_timeout_ms));
 
 	check_error(curl_easy_setopt(m_select_curl, CURLOPT_CONNECTTIMEOUT_MS, m_timeout_ms));
 	discover_mesos_leader();
@@ -92,7 +82,6 @@ mesos_http::~mesos_http()
 
 void mesos_http::cleanup()
 {
-	cleanup(&m_sync_curl);
 	cleanup(&m_select_curl);
 }
 
@@ -155,9 +144,7 @@ void mesos_http::discover_mesos_leader()
 		CURLcode res = get_data(m_url.to_string(), os);
 		if(res == CURLE_OK)
 		{
-			long http_response_code = 0;
-			check_error(curl_easy_getinfo(m_sync_curl, CURLINFO_RESPONSE_CODE, &http_response_code));
-			if(sinsp_curl::is_redirect(http_response_code))
+			if(sinsp_curl::is_redirect(m_response_code))
 			{
 				uri newurl(m_redirect);
 				m_url.set_host(newurl.get_host());
@@ -416,27 +403,59 @@ std::string mesos_http::make_request(uri url, curl_version_info_data* curl_versi
 	return request.str();
 }
 
+sinsp_curl_multi::request mesos_http::make_curl_request(const std::string& url) const
+{
+	sinsp_curl_multi::request req(url, m_timeout_ms);
+
+	if(!m_token.empty())
+	{
+		req.m_headers.push_back(string("Authorization: token=") + m_token);
+	}
+	if(req.m_url.is_secure())
+	{
+		// No certificates and no peer verification
+		req.m_ssl = std::make_shared<sinsp_ssl>("", "");
+	}
+	return req;
+}
+
+CURLcode mesos_http::take_response(const sinsp_curl_multi::response& response, std::ostream& os)
+{
+	m_response_code = response.m_response_code;
+	m_redirect = response.m_redirect;
+	os << response.m_data;
+	return response.m_result;
+}
+
 CURLcode mesos_http::get_data(const std::string& url, std::ostream& os)
 {
 	g_logger.log(std::string("mesos_http: Retrieving data from ") + uri(url).to_string(false), sinsp_logger::SEV_DEBUG);
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_URL, url.c_str()));
-
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_HEADERDATA, m_redirect));
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_HEADERFUNCTION, sinsp_curl::header_callback));
 
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_NOSIGNAL, 1)); //Prevent "longjmp causes uninitialized stack frame" bug
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_ACCEPT_ENCODING, "deflate"));
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_TIMEOUT_MS, m_timeout_ms));
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_WRITEFUNCTION, sinsp_curl::write_data));
+	//
+	// The connections stay open in the mesos instance's pool, so the
+	// requests that follow to the same server skip the connect and the TLS
+	// handshake
+	//
+	return take_response(m_mesos.get_curl_multi().perform(make_curl_request(url)), os);
+}
 
-	check_error(curl_easy_setopt(m_sync_curl, CURLOPT_WRITEDATA, &os));
-	return curl_easy_perform(m_sync_curl);
+void mesos_http::request_all_data()
+{
+	//
+	// A response left by an interrupted rebuild is stale by now
+	//
+	g_logger.log(std::string("mesos_http: Retrieving data from ") + m_url.to_string(false), sinsp_logger::SEV_DEBUG);
+	m_pending_data = m_mesos.get_curl_multi().start(make_curl_request(m_url.to_string()));
 }
 
 bool mesos_http::get_all_data(callback_func_t parse)
 {
 	std::ostringstream os;
-	CURLcode res = get_data(m_url.to_string(), os);
+	if(!m_pending_data.valid())
+	{
+		request_all_data();
+	}
+	CURLcode res = take_response(m_pending_data.get(), os);
 	if(res != CURLE_OK)
 	{
 		std::string errstr = std::string("Could not fetch url:") + curl_easy_strerror(res);
@@ -448,16 +467,14 @@ bool mesos_http::get_all_data(callback_func_t parse)
 	{
 		// HTTP errors are not returned by curl API
 		// error will be in the response stream
-		long http_code = 0;
-		curl_easy_getinfo(m_sync_curl, CURLINFO_RESPONSE_CODE, &http_code);
-		if(http_code >= 400)
+		if(m_response_code >= 400)
 		{
 			m_connected = false;
 			return false;
 		}
-		else if(sinsp_curl::is_redirect(http_code))
+		else if(sinsp_curl::is_redirect(m_response_code))
 		{
-			g_logger.log("mesos_http: HTTP redirect (" + std::to_string(http_code) + ')', sinsp_logger::SEV_DEBUG);
+			g_logger.log("mesos_http: HTTP redirect (" + std::to_string(m_response_code) + ')', sinsp_logger::SEV_DEBUG);
 			if(sinsp_curl::handle_redirect(m_url, std::string(m_redirect), os))
 			{
 				os.str("");
@@ -31,6 +31,7 @@ limitations under the License.
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <future>
 #include "sinsp_curl.h"
 #include "json_error_log.h"
 
@@ -52,6 +53,12 @@ public:
 
 	virtual ~mesos_http();
 
+	//
+	// Starts fetching the data, so that the requests of several clients run
+	// in parallel; get_all_data() takes the response, or makes the request
+	// if none was started
+	//
+	void request_all_data();
 	bool get_all_data(callback_func_t);
 
 	virtual int get_socket(long timeout_ms = -1);
@@ -82,10 +89,12 @@ public:
 	void set_token(const string& token);
 
 protected:
-	CURL* get_sync_curl();
 	CURL* get_select_curl();
 	mesos& get_mesos();
 	CURLcode get_data(const std::string& url, std::ostream& os);
+	sinsp_curl_multi::request make_curl_request(const std::string& url) const;
+	// Keeps the response code and the redirect of the response
+	CURLcode take_response(const sinsp_curl_multi::response& response, std::ostream& os);
 	void check_error(CURLcode res);
 	void cleanup();
 	void cleanup(CURL**);
@@ -104,7 +113,6 @@ private:
 
 	void send_request();
 
-	CURL*                   m_sync_curl;
 	CURL*                   m_select_curl;
 	mesos&                  m_mesos;
 	std::string             m_protocol;
@@ -125,9 +133,10 @@ private:
 	bool                    m_discover_marathon;
 	//bool                    m_redirect = false;
 	std::string::size_type  m_content_length = std::string::npos;
-	char                    m_redirect[CURL_MAX_HTTP_HEADER] = {0};
+	std::string             m_redirect;
+	long                    m_response_code;
 	string                  m_token;
-	sinsp_curl_http_headers m_sync_curl_headers;
+	std::future<sinsp_curl_multi::response> m_pending_data;
 
 	friend class mesos;
 
@@ -147,11 +156,6 @@ inline const uri& mesos_http::get_url() const
 	return m_url;
 }
 
-inline CURL* mesos_http::get_sync_curl()
-{
-	return m_sync_curl;
-}
-
 inline CURL* mesos_http::get_select_curl()
 {
 	return m_select_curl;
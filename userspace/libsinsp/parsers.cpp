@@ -29,7 +29,10 @@ limitations under the License.
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <atomic>
 #include <limits>
+#include <mutex>
+#include <unordered_set>
 
 #include "container_engine/mesos.h"
 #include "sinsp.h"
@@ -97,7 +100,7 @@ sinsp_parser::~sinsp_parser()
 	while(!m_tmp_events_buffer.empty())
 	{
 		auto ptr = m_tmp_events_buffer.top();
-		free(ptr);
+		sinsp_evt_buffer_pool::release(ptr);
 		m_tmp_events_buffer.pop();
 	}
 	m_protodecoders.clear();
@@ -227,6 +230,17 @@ void sinsp_parser::process_event(sinsp_evt *evt)
 			}
 		}
 
+		//
+		// The first I/O on a socket tells that it's connected, see
+		// parse_rw_exit()
+		//
+		if(evt->m_fdinfo != NULL && (eflags & (EF_READS_FROM_FD | EF_WRITES_TO_FD)) &&
+			(evt->m_fdinfo->is_ipv4_socket() || evt->m_fdinfo->is_ipv6_socket()) &&
+			!evt->m_fdinfo->is_socket_connected())
+		{
+			eflags = (ppm_event_flags)(((uint64_t)eflags) | EF_MODIFIES_STATE);
+		}
+
 		if(eflags & EF_MODIFIES_STATE)
 		{
 			do_filter_later = true;
@@ -452,6 +466,15 @@ void sinsp_parser::process_event(sinsp_evt *evt)
 	case PPME_CONTAINER_JSON_E:
 		parse_container_json_evt(evt);
 		break;
+	case PPME_CONTAINER_BIN_E:
+		parse_container_bin_evt(evt);
+		break;
+	case PPME_USER_ADDED_E:
+		parse_user_added_evt(evt);
+		break;
+	case PPME_GROUP_ADDED_E:
+		parse_group_added_evt(evt);
+		break;
 	case PPME_CPU_HOTPLUG_E:
 		parse_cpu_hotplug_enter(evt);
 		break;
@@ -599,7 +622,7 @@ bool sinsp_parser::reset(sinsp_evt *evt)
 		query_os = true;
 	}
 
-	if(etype == PPME_CONTAINER_JSON_E)
+	if(etype == PPME_CONTAINER_JSON_E || etype == PPME_CONTAINER_BIN_E)
 	{
 		evt->m_tinfo = nullptr;
 		return true;
@@ -1146,20 +1169,15 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 	tinfo->m_tid = childtid;
 	tinfo->m_ptid = tid;
 
+	//
+	// The command name, the executable name and the arguments come from the
+	// event below, no need to copy the ones of the parent
+	//
 	if(valid_parent)
 	{
-		// Copy the command name from the parent
-		tinfo->m_comm = ptinfo->m_comm;
-
-		// Copy the full executable name from the parent
-		tinfo->m_exe = ptinfo->m_exe;
-
 		// Copy the full executable path from the parent
 		tinfo->m_exepath = ptinfo->m_exepath;
 
-		// Copy the command arguments from the parent
-		tinfo->m_args = ptinfo->m_args;
-
 		// Copy the root from the parent
 		tinfo->m_root = ptinfo->m_root;
 
@@ -1204,10 +1222,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 			//
 			// Parent found in proc, use its data
 			//
-			tinfo->m_comm = ptinfo->m_comm;
-			tinfo->m_exe = ptinfo->m_exe;
 			tinfo->m_exepath = ptinfo->m_exepath;
-			tinfo->m_args = ptinfo->m_args;
 			tinfo->m_root = ptinfo->m_root;
 			tinfo->m_sid = ptinfo->m_sid;
 			tinfo->m_vpgid = ptinfo->m_vpgid;
@@ -1288,21 +1303,10 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 		// The right thing to do is looking at PPM_CL_CLONE_FILES, but there are
 		// syscalls like open and pipe2 that can override PPM_CL_CLONE_FILES with the O_CLOEXEC flag
 		//
-		tinfo->m_fdtable = *(ptinfo->get_fd_table());
-
-		//
-		// Track down that those are cloned fds
+		// The copy is deferred until the parent or the child access their
+		// fds, the fds are marked as cloned in the child then.
 		//
-		for(auto fdit = tinfo->m_fdtable.m_table.begin(); fdit != tinfo->m_fdtable.m_table.end(); ++fdit)
-		{
-			fdit->second.set_is_cloned();
-		}
-
-		//
-		// It's important to reset the cache of the child thread, to prevent it from
-		// referring to an element in the parent's table.
-		//
-		tinfo->m_fdtable.reset_cache();
+		tinfo->m_fdtable.clone_from(ptinfo->get_fd_table());
 
 		//
 		// Not a thread, copy cwd
@@ -1470,7 +1474,8 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 	}
 
 	//
-	// Set cgroups and heuristically detect container id
+	// Set cgroups and heuristically detect container id. Most children stay
+	// in the cgroups, and so in the container, of their parent.
 	//
 	switch(etype)
 	{
@@ -1479,7 +1484,10 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 		case PPME_SYSCALL_CLONE_20_X:
 			parinfo = evt->get_param(14);
 			tinfo->set_cgroups(parinfo->m_val, parinfo->m_len);
-			m_inspector->m_container_manager.resolve_container(tinfo, m_inspector->is_live());
+			m_inspector->m_container_manager.resolve_container(tinfo,
+				ptinfo->m_cgroups,
+				ptinfo->m_container_id,
+				m_inspector->is_live());
 			break;
 	}
 
@@ -1686,6 +1694,10 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 		// 2. docker-runc changes cgroup hierarchy of it
 		// 3. vpid=1 execve to the real process the user wants to run inside the container
 		//
+		// This is a full resolve even when the cgroups didn't change: the
+		// engines that match on the environment (mesos) or on the root
+		// (rkt fly) may match the new program.
+		//
 		m_inspector->m_container_manager.resolve_container(evt->m_tinfo, m_inspector->is_live());
 		break;
 	default:
@@ -1726,7 +1738,6 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 		// Get exepath
 		if (retrieve_enter_event(enter_evt, evt))
 		{
-			char fullpath[SCAP_MAX_PATH_SIZE];
 			parinfo = enter_evt->get_param(0);
 			if (strncmp(parinfo->m_val, "<NA>", 4) == 0)
 			{
@@ -1734,10 +1745,11 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 			}
 			else
 			{
-				sinsp_utils::concatenate_paths(fullpath, SCAP_MAX_PATH_SIZE,
-											   evt->m_tinfo->m_cwd.c_str(), (uint32_t)evt->m_tinfo->m_cwd.size(),
-											   parinfo->m_val, (uint32_t)parinfo->m_len);
-				evt->m_tinfo->m_exepath = fullpath;
+				const string& cwd = evt->m_tinfo->get_cwd_ref();
+				sinsp_strview fullpath = concatenate_evt_paths(evt,
+					sinsp_strview{cwd.c_str(), (uint32_t)cwd.length()},
+					parinfo->m_val, (uint32_t)parinfo->m_len);
+				evt->m_tinfo->m_exepath.assign(fullpath.m_data, fullpath.m_len);
 			}
 		}
 		break;
@@ -1835,10 +1847,9 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 	return;
 }
 
-void sinsp_parser::parse_openat_dir(sinsp_evt *evt, char* name, int64_t dirfd, OUT string* sdir)
+void sinsp_parser::parse_openat_dir(sinsp_evt *evt, char* name, int64_t dirfd, OUT sinsp_strview* sdir)
 {
 	bool is_absolute = (name[0] == '/');
-	string tdirstr;
 
 	if(is_absolute)
 	{
@@ -1847,11 +1858,12 @@ void sinsp_parser::parse_openat_dir(sinsp_evt *evt, char* name, int64_t dirfd, O
 		// Some processes (e.g. irqbalance) actually do this: they pass an invalid fd and
 		// and absolute path, and openat succeeds.
 		//
-		*sdir = ".";
+		*sdir = sinsp_strview{".", 1};
 	}
 	else if(dirfd == PPM_AT_FDCWD)
 	{
-		*sdir = evt->m_tinfo->get_cwd();
+		const string& cwd = evt->m_tinfo->get_cwd_ref();
+		*sdir = sinsp_strview{cwd.c_str(), (uint32_t)cwd.length()};
 	}
 	else
 	{
@@ -1860,23 +1872,36 @@ void sinsp_parser::parse_openat_dir(sinsp_evt *evt, char* name, int64_t dirfd, O
 		if(evt->m_fdinfo == NULL)
 		{
 			ASSERT(false);
-			*sdir = "<UNKNOWN>";
+			*sdir = sinsp_strview{"<UNKNOWN>", 9};
 		}
 		else
 		{
-			if(evt->m_fdinfo->m_name[evt->m_fdinfo->m_name.length()] == '/')
-			{
-				*sdir = evt->m_fdinfo->m_name;
-			}
-			else
-			{
-				tdirstr = evt->m_fdinfo->m_name + '/';
-				*sdir = tdirstr;
-			}
+			// concatenate_paths() adds the '/'
+			const string& dirname = evt->m_fdinfo->m_name;
+			*sdir = sinsp_strview{dirname.c_str(), (uint32_t)dirname.length()};
 		}
 	}
 }
 
+sinsp_strview sinsp_parser::concatenate_evt_paths(sinsp_evt *evt, const sinsp_strview& dir, const char* name, uint32_t namelen)
+{
+	sinsp_strview res;
+
+	//
+	// The normalized path is never longer than the two paths and the '/'
+	// between them. The paths that don't fit SCAP_MAX_PATH_SIZE still
+	// become /PATH_TOO_LONG.
+	//
+	uint32_t size = min(dir.m_len + namelen + 2, (uint32_t)SCAP_MAX_PATH_SIZE);
+	char* path = (char*)evt->m_inspector->get_evt_arena()->alloc(size);
+
+	sinsp_utils::concatenate_paths(path, size, dir.m_data, dir.m_len, name, namelen);
+
+	res.m_data = path;
+	res.m_len = (uint32_t)strlen(path);
+	return res;
+}
+
 template <typename T>
 void schedule_more_evts(sinsp* inspector, void* data, T* client, ppm_event_type evt_type)
 {
@@ -2001,7 +2026,7 @@ void sinsp_parser::parse_open_openat_creat_exit(sinsp_evt *evt)
 	uint32_t flags;
 	sinsp_fdinfo_t fdi;
 	sinsp_evt *enter_evt = &m_tmp_evt;
-	string sdir;
+	sinsp_strview sdir;
 	uint16_t etype = evt->get_type();
 	uint32_t dev = 0;
 
@@ -2050,7 +2075,8 @@ void sinsp_parser::parse_open_openat_creat_exit(sinsp_evt *evt)
 			dev = *(uint32_t *)parinfo->m_val;
 		}
 
-		sdir = evt->m_tinfo->get_cwd();
+		const string& cwd = evt->m_tinfo->get_cwd_ref();
+		sdir = sinsp_strview{cwd.c_str(), (uint32_t)cwd.length()};
 	}
 	else if(etype == PPME_SYSCALL_CREAT_X)
 	{
@@ -2067,7 +2093,8 @@ void sinsp_parser::parse_open_openat_creat_exit(sinsp_evt *evt)
 			dev = *(uint32_t *)parinfo->m_val;
 		}
 
-		sdir = evt->m_tinfo->get_cwd();
+		const string& cwd = evt->m_tinfo->get_cwd_ref();
+		sdir = sinsp_strview{cwd.c_str(), (uint32_t)cwd.length()};
 	}
 	else if(etype == PPME_SYSCALL_OPENAT_X)
 	{
@@ -2119,8 +2146,7 @@ void sinsp_parser::parse_open_openat_creat_exit(sinsp_evt *evt)
 	//ASSERT(parinfo->m_len == sizeof(uint32_t));
 	//mode = *(uint32_t*)parinfo->m_val;
 
-	char fullpath[SCAP_MAX_PATH_SIZE];
-	sinsp_utils::concatenate_paths(fullpath, SCAP_MAX_PATH_SIZE, sdir.c_str(), (uint32_t)sdir.length(), name, namelen);
+	sinsp_strview fullpath = concatenate_evt_paths(evt, sdir, name, namelen);
 
 	if(fd >= 0)
 	{
@@ -2138,7 +2164,7 @@ void sinsp_parser::parse_open_openat_creat_exit(sinsp_evt *evt)
 
 		fdi.m_openflags = flags;
 		fdi.m_dev = dev;
-		fdi.add_filename(fullpath);
+		fdi.add_filename(fullpath.m_data);
 
 		//
 		// If this is a user event fd, mark it with the proper flag
@@ -2169,7 +2195,7 @@ void sinsp_parser::parse_open_openat_creat_exit(sinsp_evt *evt)
 
 	if(m_fd_listener && !(flags & PPM_O_DIRECTORY))
 	{
-		m_fd_listener->on_file_open(evt, fullpath, flags);
+		m_fd_listener->on_file_open(evt, fullpath.m_data, flags);
 	}
 }
 
@@ -4552,6 +4578,67 @@ namespace
 	}
 }
 
+//
+// Copies a string parameter in a fixed size field of the user and group
+// tables, truncating it if needed
+//
+static void copy_str_param(sinsp_evt *evt, uint32_t id, char* dst, size_t size)
+{
+	sinsp_evt_param *parinfo = evt->get_param(id);
+	size_t len = min((size_t)parinfo->m_len, size - 1);
+
+	memcpy(dst, parinfo->m_val, len);
+	dst[len] = 0;
+}
+
+//
+// The users and groups resolved by the async lookups after the trace file
+// was opened. Live, they are already in the tables.
+//
+void sinsp_parser::parse_user_added_evt(sinsp_evt *evt)
+{
+	scap_userinfo user;
+	sinsp_evt_param *parinfo;
+
+	if(!m_inspector->is_capture())
+	{
+		return;
+	}
+
+	parinfo = evt->get_param(0);
+	ASSERT(parinfo->m_len == sizeof(uint32_t));
+	user.uid = *(uint32_t *)parinfo->m_val;
+
+	parinfo = evt->get_param(1);
+	ASSERT(parinfo->m_len == sizeof(uint32_t));
+	user.gid = *(uint32_t *)parinfo->m_val;
+
+	copy_str_param(evt, 2, user.name, sizeof(user.name));
+	copy_str_param(evt, 3, user.homedir, sizeof(user.homedir));
+	copy_str_param(evt, 4, user.shell, sizeof(user.shell));
+
+	m_inspector->add_user(user);
+}
+
+void sinsp_parser::parse_group_added_evt(sinsp_evt *evt)
+{
+	scap_groupinfo group;
+	sinsp_evt_param *parinfo;
+
+	if(!m_inspector->is_capture())
+	{
+		return;
+	}
+
+	parinfo = evt->get_param(0);
+	ASSERT(parinfo->m_len == sizeof(uint32_t));
+	group.gid = *(uint32_t *)parinfo->m_val;
+
+	copy_str_param(evt, 1, group.name, sizeof(group.name));
+
+	m_inspector->add_group(group);
+}
+
 void sinsp_parser::parse_container_json_evt(sinsp_evt *evt)
 {
 	sinsp_evt_param *parinfo = evt->get_param(0);
@@ -4750,6 +4837,23 @@ void sinsp_parser::parse_container_json_evt(sinsp_evt *evt)
 	}
 }
 
+void sinsp_parser::parse_container_bin_evt(sinsp_evt *evt)
+{
+	sinsp_evt_param *parinfo = evt->get_param(0);
+	sinsp_container_info container_info;
+	std::string error;
+
+	ASSERT(parinfo);
+	if(!container_info.from_bin(parinfo->m_val, parinfo->m_len, error))
+	{
+		throw sinsp_exception("Invalid container info event: " + error);
+	}
+
+	evt->m_tinfo_ref = container_info.get_tinfo(m_inspector);
+	evt->m_tinfo = evt->m_tinfo_ref.get();
+	m_inspector->m_container_manager.add_container(container_info, evt->get_thread_info(true));
+}
+
 void sinsp_parser::parse_container_evt(sinsp_evt *evt)
 {
 	sinsp_evt_param *parinfo;
@@ -4780,10 +4884,82 @@ void sinsp_parser::parse_cpu_hotplug_enter(sinsp_evt *evt)
 	}
 }
 
+static std::mutex g_evt_buffer_pool_mutex;
+static std::unordered_set<uintptr_t> g_evt_buffer_pool_chunks;
+static vector<uint8_t*> g_evt_buffer_pool_free;
+// Set once the first chunk is mapped, the chunks are never unmapped
+static std::atomic<bool> g_evt_buffer_pool_mapped(false);
+
+uint8_t* sinsp_evt_buffer_pool::alloc(scap_hugepages_mode mode)
+{
+	std::lock_guard<std::mutex> lock(g_evt_buffer_pool_mutex);
+
+	if(g_evt_buffer_pool_free.empty())
+	{
+		uint8_t* chunk = (uint8_t*)scap_alloc_buffer(SCAP_HUGEPAGE_SIZE, mode);
+		if(chunk == NULL)
+		{
+			return NULL;
+		}
+
+		g_evt_buffer_pool_chunks.insert((uintptr_t)chunk);
+		g_evt_buffer_pool_mapped.store(true, std::memory_order_release);
+
+		//
+		// Hand out the buffers in address order
+		//
+		for(uint32_t j = SCAP_HUGEPAGE_SIZE / SP_EVT_BUF_SIZE; j > 0; j--)
+		{
+			g_evt_buffer_pool_free.push_back(chunk + (j - 1) * SP_EVT_BUF_SIZE);
+		}
+	}
+
+	uint8_t* ptr = g_evt_buffer_pool_free.back();
+	g_evt_buffer_pool_free.pop_back();
+	return ptr;
+}
+
+void sinsp_evt_buffer_pool::release(uint8_t* ptr)
+{
+	//
+	// Without hugepages nothing ever comes from the pool. A buffer that
+	// does was allocated after the flag was set.
+	//
+	if(!g_evt_buffer_pool_mapped.load(std::memory_order_acquire))
+	{
+		free(ptr);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_evt_buffer_pool_mutex);
+
+	//
+	// The chunks are hugepage aligned
+	//
+	uintptr_t chunk = (uintptr_t)ptr & ~((uintptr_t)SCAP_HUGEPAGE_SIZE - 1);
+	if(g_evt_buffer_pool_chunks.find(chunk) != g_evt_buffer_pool_chunks.end())
+	{
+		g_evt_buffer_pool_free.push_back(ptr);
+	}
+	else
+	{
+		free(ptr);
+	}
+}
+
 uint8_t* sinsp_parser::reserve_event_buffer()
 {
 	if(m_tmp_events_buffer.empty())
 	{
+		if(m_inspector->m_hugepages != SCAP_HUGEPAGES_NONE)
+		{
+			uint8_t* ptr = sinsp_evt_buffer_pool::alloc(m_inspector->m_hugepages);
+			if(ptr != NULL)
+			{
+				return ptr;
+			}
+		}
+
 		return (uint8_t*)malloc(sizeof(uint8_t)*SP_EVT_BUF_SIZE);
 	}
 	else
@@ -5002,6 +5178,6 @@ void sinsp_parser::free_event_buffer(uint8_t *ptr)
 	}
 	else
 	{
-		free(ptr);
+		sinsp_evt_buffer_pool::release(ptr);
 	}
 }
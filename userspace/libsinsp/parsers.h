@@ -35,6 +35,23 @@ public:
 	uint32_t m_scap_buf_size;
 };
 
+//
+// Process wide pool of SP_EVT_BUF_SIZE buffers, carved out of hugepage backed
+// chunks, used to store the enter events of the threads when the inspector
+// runs with hugepages. Keeping these buffers packed in a few hugepages
+// instead of spread across the heap saves TLB misses when switching between
+// threads. The chunks are never returned to the kernel, the buffers are
+// recycled instead.
+//
+class sinsp_evt_buffer_pool
+{
+public:
+	// Returns NULL if no hugepage backed memory could be allocated
+	static uint8_t* alloc(scap_hugepages_mode mode);
+	// Takes both buffers from the pool and malloc()ed ones
+	static void release(uint8_t* ptr);
+};
+
 class sinsp_parser
 {
 public:
@@ -57,7 +74,15 @@ public:
 	//
 	// Combine the openat arguments into a full file name
 	//
-	static void parse_openat_dir(sinsp_evt *evt, char* name, int64_t dirfd, OUT string* sdir);
+	// sdir points to the thread or fd tables, and may not end with a '/'
+	//
+	static void parse_openat_dir(sinsp_evt *evt, char* name, int64_t dirfd, OUT sinsp_strview* sdir);
+
+	//
+	// sinsp_utils::concatenate_paths() into the event arena, so that the
+	// path lives as long as the event without a SCAP_MAX_PATH_SIZE buffer
+	//
+	static sinsp_strview concatenate_evt_paths(sinsp_evt *evt, const sinsp_strview& dir, const char* name, uint32_t namelen);
 
 	//
 	// Protocol decoder infrastructure methods
@@ -134,6 +159,9 @@ private:
 	void parse_setgid_exit(sinsp_evt* evt);
 	void parse_container_evt(sinsp_evt* evt); // deprecated, only for backward-compatibility
 	void parse_container_json_evt(sinsp_evt *evt);
+	void parse_container_bin_evt(sinsp_evt *evt);
+	void parse_user_added_evt(sinsp_evt *evt);
+	void parse_group_added_evt(sinsp_evt *evt);
 	inline uint32_t parse_tracer(sinsp_evt *evt, int64_t retval);
 	void parse_cpu_hotplug_enter(sinsp_evt* evt);
 	int get_k8s_version(const std::string& json);
@@ -194,4 +222,5 @@ private:
 	friend class sinsp_protodecoder;
 	friend class sinsp_baseliner;
 	friend class sinsp_container_manager;
+	friend class sinsp_thread_manager;
 };
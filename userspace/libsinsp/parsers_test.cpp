@@ -0,0 +1,380 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+#define VISIBILITY_PRIVATE
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "../../driver/ppm_events_public.h"
+
+//
+// A trace file made of the processes of this machine, as found in /proc,
+// followed by synthetic events. Only the socket fds are there, since that's
+// all libscap looks for when it runs without the driver.
+//
+class synthetic_capture
+{
+public:
+	synthetic_capture()
+	{
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_open_args oargs = {};
+		oargs.mode = SCAP_MODE_NODRIVER;
+		oargs.import_users = true;
+
+		char path[] = "/tmp/sinsp_parsers_testXXXXXX";
+		int fd = mkstemp(path);
+		::close(fd);
+		m_filename = path;
+
+		m_h = scap_open(oargs, error, &rc);
+		if(m_h == NULL)
+		{
+			throw sinsp_exception(error);
+		}
+
+		m_dumper = scap_dump_open(m_h, m_filename.c_str(), SCAP_COMPRESSION_NONE, false);
+		if(m_dumper == NULL)
+		{
+			throw sinsp_exception(scap_getlasterr(m_h));
+		}
+
+		scap_threadinfo* pinfo = scap_proc_get(m_h, getpid(), false);
+		if(pinfo == NULL)
+		{
+			throw sinsp_exception(scap_getlasterr(m_h));
+		}
+		m_cgroups.assign(pinfo->cgroups, pinfo->cgroups_len);
+		scap_proc_free(m_h, pinfo);
+
+		m_ts = sinsp_utils::get_current_time_ns();
+	}
+
+	~synthetic_capture()
+	{
+		unlink(m_filename.c_str());
+	}
+
+	// The events written so far can be read from get_filename() after this
+	void close()
+	{
+		scap_dump_close(m_dumper);
+		scap_close(m_h);
+	}
+
+	const std::string& get_filename() const
+	{
+		return m_filename;
+	}
+
+	// The cgroups of this process, in the format of the clone() events
+	const std::string& get_cgroups() const
+	{
+		return m_cgroups;
+	}
+
+	//
+	// The two exit events of a fork() of ptid, in the parent and in the child
+	//
+	void fork(int64_t ptid, int64_t ctid, const std::string& cgroups)
+	{
+		clone_exit(ptid, ctid, ptid, cgroups);
+		clone_exit(ctid, 0, ptid, cgroups);
+	}
+
+	void procexit(int64_t tid)
+	{
+		int64_t status = 0;
+
+		begin(tid, PPME_PROCEXIT_1_E);
+		add(&status, sizeof(status));
+		end();
+	}
+
+	void close_fd(int64_t tid, int64_t fd)
+	{
+		int64_t res = 0;
+
+		begin(tid, PPME_SYSCALL_CLOSE_E);
+		add(&fd, sizeof(fd));
+		end();
+
+		begin(tid, PPME_SYSCALL_CLOSE_X);
+		add(&res, sizeof(res));
+		end();
+	}
+
+private:
+	void clone_exit(int64_t tid, int64_t res, int64_t ptid, const std::string& cgroups)
+	{
+		int64_t pid = tid;
+		int64_t fdlimit = 1024;
+		uint64_t zero64 = 0;
+		uint32_t zero32 = 0;
+		const char* comm = "forkbomb";
+
+		begin(tid, PPME_SYSCALL_CLONE_20_X);
+		add(&res, sizeof(res));
+		add(comm, strlen(comm) + 1);
+		add("", 1);
+		add(&tid, sizeof(tid));
+		add(&pid, sizeof(pid));
+		add(&ptid, sizeof(ptid));
+		add("/", 2);
+		add(&fdlimit, sizeof(fdlimit));
+		add(&zero64, sizeof(zero64));
+		add(&zero64, sizeof(zero64));
+		add(&zero32, sizeof(zero32));
+		add(&zero32, sizeof(zero32));
+		add(&zero32, sizeof(zero32));
+		add(comm, strlen(comm) + 1);
+		add(cgroups.c_str(), cgroups.length());
+		add(&zero32, sizeof(zero32));
+		add(&zero32, sizeof(zero32));
+		add(&zero32, sizeof(zero32));
+		add(&tid, sizeof(tid));
+		add(&pid, sizeof(pid));
+		end();
+	}
+
+	void begin(int64_t tid, uint16_t type)
+	{
+		m_hdr.ts = m_ts++;
+		m_hdr.tid = tid;
+		m_hdr.type = type;
+		m_lens.clear();
+		m_data.clear();
+	}
+
+	void add(const void* val, size_t len)
+	{
+		m_lens.push_back((uint16_t)len);
+		m_data.append((const char*)val, len);
+	}
+
+	void end()
+	{
+		std::string evt;
+
+		m_hdr.nparams = (uint32_t)m_lens.size();
+		m_hdr.len = (uint32_t)(sizeof(m_hdr) + m_lens.size() * sizeof(uint16_t) + m_data.length());
+
+		evt.append((const char*)&m_hdr, sizeof(m_hdr));
+		evt.append((const char*)m_lens.data(), m_lens.size() * sizeof(uint16_t));
+		evt.append(m_data);
+
+		if(scap_dump(m_h, m_dumper, (scap_evt*)evt.data(), 0, 0) != SCAP_SUCCESS)
+		{
+			throw sinsp_exception(scap_getlasterr(m_h));
+		}
+	}
+
+	scap_t* m_h;
+	scap_dumper_t* m_dumper;
+	std::string m_filename;
+	std::string m_cgroups;
+	uint64_t m_ts;
+	scap_evt m_hdr;
+	std::vector<uint16_t> m_lens;
+	std::string m_data;
+};
+
+static int open_server_socket()
+{
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0)
+	{
+		throw sinsp_exception("cannot create the server socket");
+	}
+
+	return fd;
+}
+
+static void read_capture(sinsp* inspector, const std::string& filename)
+{
+	sinsp_evt* evt;
+
+	inspector->open(filename);
+
+	while(inspector->next(&evt) != SCAP_EOF)
+	{
+	}
+}
+
+//
+// The child of a fork() gets the fds of its parent at the time of the
+// fork, whatever the parent does with its own ones after that
+//
+TEST(parsers, clone_copies_fds)
+{
+	int fd = open_server_socket();
+	int kept_fd = open_server_socket();
+
+	synthetic_capture capture;
+	int64_t pid = getpid();
+	int64_t child = pid + 1000000;
+
+	capture.fork(pid, child, capture.get_cgroups());
+	capture.close_fd(pid, fd);
+	// The closed fds are removed when the next event comes
+	capture.close_fd(pid, fd);
+	capture.close();
+	::close(fd);
+	::close(kept_fd);
+
+	sinsp inspector;
+	read_capture(&inspector, capture.get_filename());
+
+	sinsp_threadinfo* ptinfo = inspector.get_thread(pid);
+	sinsp_threadinfo* tinfo = inspector.get_thread(child);
+	ASSERT_TRUE(ptinfo != NULL);
+	ASSERT_TRUE(tinfo != NULL);
+
+	EXPECT_TRUE(ptinfo->get_fd(fd) == NULL);
+	ASSERT_TRUE(tinfo->get_fd(fd) != NULL);
+	EXPECT_EQ(SCAP_FD_IPV4_SERVSOCK, tinfo->get_fd(fd)->m_type);
+	EXPECT_TRUE(tinfo->get_fd(fd)->is_cloned());
+	ASSERT_TRUE(ptinfo->get_fd(kept_fd) != NULL);
+	ASSERT_TRUE(tinfo->get_fd(kept_fd) != NULL);
+	EXPECT_FALSE(ptinfo->get_fd(kept_fd)->is_cloned());
+	EXPECT_TRUE(tinfo->get_fd(kept_fd)->is_cloned());
+}
+
+//
+// Going through the fds without changing them doesn't take them apart from
+// the other side of the fork()
+//
+TEST(parsers, clone_reads_shared_fds)
+{
+	int fd = open_server_socket();
+	struct sockaddr_in addr = {};
+	socklen_t len = sizeof(addr);
+	ASSERT_EQ(0, getsockname(fd, (struct sockaddr*)&addr, &len));
+
+	synthetic_capture capture;
+	int64_t pid = getpid();
+	int64_t child = pid + 1000000;
+
+	capture.fork(pid, child, capture.get_cgroups());
+	capture.close();
+	::close(fd);
+
+	sinsp inspector;
+	read_capture(&inspector, capture.get_filename());
+
+	sinsp_threadinfo* ptinfo = inspector.get_thread(pid);
+	sinsp_threadinfo* tinfo = inspector.get_thread(child);
+	ASSERT_TRUE(ptinfo != NULL);
+	ASSERT_TRUE(tinfo != NULL);
+	sinsp_fdtable* fdtable = tinfo->get_fd_table();
+	ASSERT_TRUE(fdtable->is_shared());
+
+	EXPECT_TRUE(tinfo->is_bound_to_port(ntohs(addr.sin_port)));
+	std::unique_ptr<sinsp_state_snapshot> snapshot(sinsp_state_snapshots::build(&inspector, 0, 0));
+	ASSERT_TRUE(snapshot->get_fds(child) != NULL);
+	EXPECT_EQ(fdtable->size(), snapshot->get_fds(child)->size());
+	auto it = fdtable->peek_table().find(fd);
+	ASSERT_TRUE(it != fdtable->peek_table().end());
+	EXPECT_FALSE(it->second.is_cloned());
+	sinsp_fdinfo_t fdinfo;
+	fdtable->copy_fd(it->second, &fdinfo);
+	EXPECT_TRUE(fdinfo.is_cloned());
+	EXPECT_TRUE(fdtable->is_shared());
+	EXPECT_TRUE(ptinfo->get_fd_table()->is_shared());
+	EXPECT_EQ(&it->second, tinfo->peek_fd(fd));
+	EXPECT_TRUE(fdtable->is_shared());
+
+	ASSERT_TRUE(tinfo->get_fd(fd) != NULL);
+	EXPECT_TRUE(tinfo->get_fd(fd)->is_cloned());
+	EXPECT_FALSE(fdtable->is_shared());
+}
+
+TEST(parsers, clone_container)
+{
+	synthetic_capture capture;
+	int64_t pid = getpid();
+	std::string docker_id = "0123456789ab";
+	std::string docker_cgroups = "cpuset=/docker/" + docker_id + std::string(52, 'f');
+	docker_cgroups.push_back(0);
+
+	capture.fork(pid, pid + 1000000, capture.get_cgroups());
+	capture.fork(pid, pid + 1000001, docker_cgroups);
+	capture.close();
+
+	sinsp inspector;
+	read_capture(&inspector, capture.get_filename());
+
+	sinsp_threadinfo* ptinfo = inspector.get_thread(pid);
+	ASSERT_TRUE(ptinfo != NULL);
+	EXPECT_EQ(ptinfo->m_container_id, inspector.get_thread(pid + 1000000)->m_container_id);
+	EXPECT_EQ(docker_id, inspector.get_thread(pid + 1000001)->m_container_id);
+}
+
+//
+// A fork storm from a process with a few hundred fds, the children exit
+// right away. Prints the parsing time per fork.
+//
+TEST(parsers, DISABLED_benchmark)
+{
+	const uint32_t nforks = 200000;
+	const uint32_t nfds = 200;
+	std::vector<int> fds;
+
+	for(uint32_t j = 0; j < nfds; j++)
+	{
+		fds.push_back(open_server_socket());
+	}
+
+	synthetic_capture capture;
+	int64_t pid = getpid();
+
+	for(uint32_t j = 0; j < nforks; j++)
+	{
+		int64_t child = pid + 1000000 + j;
+		capture.fork(pid, child, capture.get_cgroups());
+		capture.procexit(child);
+	}
+	capture.close();
+
+	for(auto fd : fds)
+	{
+		::close(fd);
+	}
+
+	sinsp inspector;
+	uint64_t start = sinsp_utils::get_current_time_ns();
+	read_capture(&inspector, capture.get_filename());
+	uint64_t duration = sinsp_utils::get_current_time_ns() - start;
+
+	printf("%.0f ns per fork\n", (double)duration / nforks);
+}
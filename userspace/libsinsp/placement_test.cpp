@@ -0,0 +1,122 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "scap.h"
+#include "scap-int.h"
+
+class placement : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		m_handle = (scap_t*)calloc(1, sizeof(scap_t));
+		m_handle->m_mode = SCAP_MODE_LIVE;
+		m_handle->m_consumer_cpu = -1;
+		m_handle->m_consumer_node = -1;
+	}
+
+	void TearDown()
+	{
+		free(m_handle->m_devs);
+		free(m_handle->m_cpu_nodes);
+		free(m_handle);
+	}
+
+	scap_t* m_handle;
+};
+
+//
+// The nodes are read once, for all the CPUs
+//
+TEST_F(placement, cpu_nodes)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+
+	EXPECT_EQ(-1, scap_get_cpu_node(m_handle, -1));
+	int32_t node = scap_get_cpu_node(m_handle, 0);
+	ASSERT_NE(nullptr, m_handle->m_cpu_nodes);
+	EXPECT_EQ(ncpus, (long)m_handle->m_ncpu_nodes);
+	EXPECT_EQ(-1, scap_get_cpu_node(m_handle, (int32_t)ncpus));
+
+	int32_t* table = m_handle->m_cpu_nodes;
+	m_handle->m_cpu_nodes[0] = node + 1;
+	EXPECT_EQ(node + 1, scap_get_cpu_node(m_handle, 0));
+	EXPECT_EQ(table, m_handle->m_cpu_nodes);
+}
+
+//
+// The consumer CPU is sampled when the stats are taken, unless it's pinned
+//
+TEST_F(placement, stats)
+{
+	scap_stats stats;
+	cpu_set_t set;
+	int32_t cpu = -1;
+
+	scap_get_placement_stats(m_handle, &stats);
+	EXPECT_GE(stats.consumer_cpu, 0);
+	EXPECT_FALSE(stats.consumer_pinned);
+
+	ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set));
+	for(int32_t j = CPU_SETSIZE - 1; j >= 0 && cpu < 0; j--)
+	{
+		if(CPU_ISSET(j, &set))
+		{
+			cpu = j;
+		}
+	}
+
+	ASSERT_EQ(SCAP_SUCCESS, scap_set_consumer_placement(m_handle, cpu, false));
+	scap_get_placement_stats(m_handle, &stats);
+	EXPECT_EQ(cpu, stats.consumer_cpu);
+	EXPECT_EQ(scap_get_cpu_node(m_handle, cpu), stats.consumer_node);
+	EXPECT_TRUE(stats.consumer_pinned);
+	EXPECT_EQ(cpu, sched_getcpu());
+
+	ASSERT_EQ(0, sched_setaffinity(0, sizeof(set), &set));
+}
+
+TEST_F(placement, rings)
+{
+	scap_stats stats;
+	int32_t nodes[] = {0, 1, 0, -1, 1, 1};
+
+	m_handle->m_ndevs = sizeof(nodes) / sizeof(nodes[0]);
+	m_handle->m_devs = (scap_device*)calloc(m_handle->m_ndevs, sizeof(scap_device));
+	for(uint32_t j = 0; j < m_handle->m_ndevs; j++)
+	{
+		m_handle->m_devs[j].m_node = nodes[j];
+	}
+
+	m_handle->m_consumer_pinned = true;
+	m_handle->m_consumer_cpu = 0;
+	m_handle->m_consumer_node = 1;
+	scap_get_placement_stats(m_handle, &stats);
+	EXPECT_EQ(3u, stats.n_rings_local);
+	EXPECT_EQ(2u, stats.n_rings_remote);
+
+	m_handle->m_consumer_node = -1;
+	scap_get_placement_stats(m_handle, &stats);
+	EXPECT_EQ(0u, stats.n_rings_local);
+	EXPECT_EQ(0u, stats.n_rings_remote);
+}
@@ -0,0 +1,838 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+#include <algorithm>
+
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "filter.h"
+#include "filterchecks.h"
+#include "prefilter.h"
+
+//
+// The state safety of each event type, see sinsp_prefilter_safety. An event
+// type is PFS_PARSE if:
+//  - it has EF_MODIFIES_STATE, like clone, execve, open, close or connect
+//    (the filter never drops them before parsing either)
+//  - it has EF_SKIPPARSERESET, like the scheduler, drop and procinfo events
+//  - it's EC_INTERNAL, since the internal events mode shows them even when
+//    the filter rejects them
+//  - it's parsed regardless of the filter for other reasons: write (tracers
+//    are written to /dev/null), tracers, containers, k8s, mesos, cpu hotplug
+//    and notifications
+//  - it's the enter event of one of the above, whose exit event can need it
+// Every other enter event is PFS_SKIP_WITH_EXIT and every other exit event
+// is PFS_SKIP. The I/O that connects a socket is parsed anyway, see
+// connects_socket().
+//
+// Keep this in sync with the event table: prefilter_test checks the rules
+// above against it.
+//
+static const sinsp_prefilter_safety g_prefilter_safety_table[] =
+{
+	/* PPME_GENERIC_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_GENERIC_X */ PFS_SKIP,
+	/* PPME_SYSCALL_OPEN_E */ PFS_PARSE,
+	/* PPME_SYSCALL_OPEN_X */ PFS_PARSE,
+	/* PPME_SYSCALL_CLOSE_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CLOSE_X */ PFS_PARSE,
+	/* PPME_SYSCALL_READ_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_READ_X */ PFS_SKIP,
+	/* PPME_SYSCALL_WRITE_E */ PFS_PARSE,
+	/* PPME_SYSCALL_WRITE_X */ PFS_PARSE,
+	/* PPME_SYSCALL_BRK_1_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_BRK_1_X */ PFS_SKIP,
+	/* PPME_SYSCALL_EXECVE_8_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_8_X */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_11_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_11_X */ PFS_PARSE,
+	/* PPME_PROCEXIT_E */ PFS_PARSE,
+	/* PPME_PROCEXIT_X */ PFS_SKIP,
+	/* PPME_SOCKET_SOCKET_E */ PFS_PARSE,
+	/* PPME_SOCKET_SOCKET_X */ PFS_PARSE,
+	/* PPME_SOCKET_BIND_E */ PFS_PARSE,
+	/* PPME_SOCKET_BIND_X */ PFS_PARSE,
+	/* PPME_SOCKET_CONNECT_E */ PFS_PARSE,
+	/* PPME_SOCKET_CONNECT_X */ PFS_PARSE,
+	/* PPME_SOCKET_LISTEN_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_LISTEN_X */ PFS_SKIP,
+	/* PPME_SOCKET_ACCEPT_E */ PFS_PARSE,
+	/* PPME_SOCKET_ACCEPT_X */ PFS_PARSE,
+	/* PPME_SOCKET_SEND_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_SEND_X */ PFS_SKIP,
+	/* PPME_SOCKET_SENDTO_E */ PFS_PARSE,
+	/* PPME_SOCKET_SENDTO_X */ PFS_PARSE,
+	/* PPME_SOCKET_RECV_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_RECV_X */ PFS_SKIP,
+	/* PPME_SOCKET_RECVFROM_E */ PFS_PARSE,
+	/* PPME_SOCKET_RECVFROM_X */ PFS_PARSE,
+	/* PPME_SOCKET_SHUTDOWN_E */ PFS_PARSE,
+	/* PPME_SOCKET_SHUTDOWN_X */ PFS_PARSE,
+	/* PPME_SOCKET_GETSOCKNAME_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_GETSOCKNAME_X */ PFS_SKIP,
+	/* PPME_SOCKET_GETPEERNAME_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_GETPEERNAME_X */ PFS_SKIP,
+	/* PPME_SOCKET_SOCKETPAIR_E */ PFS_PARSE,
+	/* PPME_SOCKET_SOCKETPAIR_X */ PFS_PARSE,
+	/* PPME_SOCKET_SETSOCKOPT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_SETSOCKOPT_X */ PFS_SKIP,
+	/* PPME_SOCKET_GETSOCKOPT_E */ PFS_PARSE,
+	/* PPME_SOCKET_GETSOCKOPT_X */ PFS_PARSE,
+	/* PPME_SOCKET_SENDMSG_E */ PFS_PARSE,
+	/* PPME_SOCKET_SENDMSG_X */ PFS_PARSE,
+	/* PPME_SOCKET_SENDMMSG_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_SENDMMSG_X */ PFS_SKIP,
+	/* PPME_SOCKET_RECVMSG_E */ PFS_PARSE,
+	/* PPME_SOCKET_RECVMSG_X */ PFS_PARSE,
+	/* PPME_SOCKET_RECVMMSG_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SOCKET_RECVMMSG_X */ PFS_SKIP,
+	/* PPME_SOCKET_ACCEPT4_E */ PFS_PARSE,
+	/* PPME_SOCKET_ACCEPT4_X */ PFS_PARSE,
+	/* PPME_SYSCALL_CREAT_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CREAT_X */ PFS_PARSE,
+	/* PPME_SYSCALL_PIPE_E */ PFS_PARSE,
+	/* PPME_SYSCALL_PIPE_X */ PFS_PARSE,
+	/* PPME_SYSCALL_EVENTFD_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EVENTFD_X */ PFS_PARSE,
+	/* PPME_SYSCALL_FUTEX_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_FUTEX_X */ PFS_SKIP,
+	/* PPME_SYSCALL_STAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_STAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_LSTAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LSTAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_FSTAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_FSTAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_STAT64_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_STAT64_X */ PFS_SKIP,
+	/* PPME_SYSCALL_LSTAT64_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LSTAT64_X */ PFS_SKIP,
+	/* PPME_SYSCALL_FSTAT64_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_FSTAT64_X */ PFS_SKIP,
+	/* PPME_SYSCALL_EPOLLWAIT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_EPOLLWAIT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_POLL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_POLL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SELECT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SELECT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_NEWSELECT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_NEWSELECT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_LSEEK_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LSEEK_X */ PFS_SKIP,
+	/* PPME_SYSCALL_LLSEEK_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LLSEEK_X */ PFS_SKIP,
+	/* PPME_SYSCALL_IOCTL_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_IOCTL_2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETCWD_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETCWD_X */ PFS_SKIP,
+	/* PPME_SYSCALL_CHDIR_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CHDIR_X */ PFS_PARSE,
+	/* PPME_SYSCALL_FCHDIR_E */ PFS_PARSE,
+	/* PPME_SYSCALL_FCHDIR_X */ PFS_PARSE,
+	/* PPME_SYSCALL_MKDIR_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_MKDIR_X */ PFS_SKIP,
+	/* PPME_SYSCALL_RMDIR_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_RMDIR_X */ PFS_SKIP,
+	/* PPME_SYSCALL_OPENAT_E */ PFS_PARSE,
+	/* PPME_SYSCALL_OPENAT_X */ PFS_PARSE,
+	/* PPME_SYSCALL_LINK_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LINK_X */ PFS_SKIP,
+	/* PPME_SYSCALL_LINKAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LINKAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_UNLINK_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_UNLINK_X */ PFS_SKIP,
+	/* PPME_SYSCALL_UNLINKAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_UNLINKAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PREAD_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PREAD_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PWRITE_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PWRITE_X */ PFS_SKIP,
+	/* PPME_SYSCALL_READV_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_READV_X */ PFS_SKIP,
+	/* PPME_SYSCALL_WRITEV_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_WRITEV_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PREADV_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PREADV_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PWRITEV_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PWRITEV_X */ PFS_SKIP,
+	/* PPME_SYSCALL_DUP_E */ PFS_PARSE,
+	/* PPME_SYSCALL_DUP_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SIGNALFD_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SIGNALFD_X */ PFS_PARSE,
+	/* PPME_SYSCALL_KILL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_KILL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_TKILL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_TKILL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_TGKILL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_TGKILL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_NANOSLEEP_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_NANOSLEEP_X */ PFS_SKIP,
+	/* PPME_SYSCALL_TIMERFD_CREATE_E */ PFS_PARSE,
+	/* PPME_SYSCALL_TIMERFD_CREATE_X */ PFS_PARSE,
+	/* PPME_SYSCALL_INOTIFY_INIT_E */ PFS_PARSE,
+	/* PPME_SYSCALL_INOTIFY_INIT_X */ PFS_PARSE,
+	/* PPME_SYSCALL_GETRLIMIT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETRLIMIT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SETRLIMIT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SETRLIMIT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PRLIMIT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PRLIMIT_X */ PFS_SKIP,
+	/* PPME_SCHEDSWITCH_1_E */ PFS_PARSE,
+	/* PPME_SCHEDSWITCH_1_X */ PFS_PARSE,
+	/* PPME_DROP_E */ PFS_PARSE,
+	/* PPME_DROP_X */ PFS_PARSE,
+	/* PPME_SYSCALL_FCNTL_E */ PFS_PARSE,
+	/* PPME_SYSCALL_FCNTL_X */ PFS_PARSE,
+	/* PPME_SCHEDSWITCH_6_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SCHEDSWITCH_6_X */ PFS_SKIP,
+	/* PPME_SYSCALL_EXECVE_13_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_13_X */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_16_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_16_X */ PFS_PARSE,
+	/* PPME_SYSCALL_BRK_4_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_BRK_4_X */ PFS_SKIP,
+	/* PPME_SYSCALL_MMAP_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_MMAP_X */ PFS_SKIP,
+	/* PPME_SYSCALL_MMAP2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_MMAP2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_MUNMAP_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_MUNMAP_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SPLICE_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SPLICE_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PTRACE_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PTRACE_X */ PFS_SKIP,
+	/* PPME_SYSCALL_IOCTL_3_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_IOCTL_3_X */ PFS_SKIP,
+	/* PPME_SYSCALL_EXECVE_14_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_14_X */ PFS_PARSE,
+	/* PPME_SYSCALL_RENAME_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_RENAME_X */ PFS_SKIP,
+	/* PPME_SYSCALL_RENAMEAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_RENAMEAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SYMLINK_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SYMLINK_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SYMLINKAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SYMLINKAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_FORK_E */ PFS_PARSE,
+	/* PPME_SYSCALL_FORK_X */ PFS_PARSE,
+	/* PPME_SYSCALL_VFORK_E */ PFS_PARSE,
+	/* PPME_SYSCALL_VFORK_X */ PFS_PARSE,
+	/* PPME_PROCEXIT_1_E */ PFS_PARSE,
+	/* PPME_PROCEXIT_1_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SENDFILE_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SENDFILE_X */ PFS_SKIP,
+	/* PPME_SYSCALL_QUOTACTL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_QUOTACTL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SETRESUID_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SETRESUID_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SETRESGID_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SETRESGID_X */ PFS_PARSE,
+	/* PPME_SYSDIGEVENT_E */ PFS_PARSE,
+	/* PPME_SYSDIGEVENT_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SETUID_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SETUID_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SETGID_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SETGID_X */ PFS_PARSE,
+	/* PPME_SYSCALL_GETUID_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETUID_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETEUID_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETEUID_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETGID_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETGID_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETEGID_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETEGID_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETRESUID_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETRESUID_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETRESGID_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETRESGID_X */ PFS_SKIP,
+	/* PPME_SYSCALL_EXECVE_15_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_15_X */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_17_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_17_X */ PFS_PARSE,
+	/* PPME_SYSCALL_FORK_17_E */ PFS_PARSE,
+	/* PPME_SYSCALL_FORK_17_X */ PFS_PARSE,
+	/* PPME_SYSCALL_VFORK_17_E */ PFS_PARSE,
+	/* PPME_SYSCALL_VFORK_17_X */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_20_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CLONE_20_X */ PFS_PARSE,
+	/* PPME_SYSCALL_FORK_20_E */ PFS_PARSE,
+	/* PPME_SYSCALL_FORK_20_X */ PFS_PARSE,
+	/* PPME_SYSCALL_VFORK_20_E */ PFS_PARSE,
+	/* PPME_SYSCALL_VFORK_20_X */ PFS_PARSE,
+	/* PPME_CONTAINER_E */ PFS_PARSE,
+	/* PPME_CONTAINER_X */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_16_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_16_X */ PFS_PARSE,
+	/* PPME_SIGNALDELIVER_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SIGNALDELIVER_X */ PFS_SKIP,
+	/* PPME_PROCINFO_E */ PFS_PARSE,
+	/* PPME_PROCINFO_X */ PFS_PARSE,
+	/* PPME_SYSCALL_GETDENTS_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETDENTS_X */ PFS_SKIP,
+	/* PPME_SYSCALL_GETDENTS64_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_GETDENTS64_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SETNS_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SETNS_X */ PFS_SKIP,
+	/* PPME_SYSCALL_FLOCK_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_FLOCK_X */ PFS_SKIP,
+	/* PPME_CPU_HOTPLUG_E */ PFS_PARSE,
+	/* PPME_CPU_HOTPLUG_X */ PFS_PARSE,
+	/* PPME_SOCKET_ACCEPT_5_E */ PFS_PARSE,
+	/* PPME_SOCKET_ACCEPT_5_X */ PFS_PARSE,
+	/* PPME_SOCKET_ACCEPT4_5_E */ PFS_PARSE,
+	/* PPME_SOCKET_ACCEPT4_5_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SEMOP_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SEMOP_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SEMCTL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SEMCTL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_PPOLL_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_PPOLL_X */ PFS_SKIP,
+	/* PPME_SYSCALL_MOUNT_E */ PFS_PARSE,
+	/* PPME_SYSCALL_MOUNT_X */ PFS_PARSE,
+	/* PPME_SYSCALL_UMOUNT_E */ PFS_PARSE,
+	/* PPME_SYSCALL_UMOUNT_X */ PFS_PARSE,
+	/* PPME_K8S_E */ PFS_PARSE,
+	/* PPME_K8S_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SEMGET_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SEMGET_X */ PFS_SKIP,
+	/* PPME_SYSCALL_ACCESS_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_ACCESS_X */ PFS_SKIP,
+	/* PPME_SYSCALL_CHROOT_E */ PFS_PARSE,
+	/* PPME_SYSCALL_CHROOT_X */ PFS_PARSE,
+	/* PPME_TRACER_E */ PFS_PARSE,
+	/* PPME_TRACER_X */ PFS_PARSE,
+	/* PPME_MESOS_E */ PFS_PARSE,
+	/* PPME_MESOS_X */ PFS_PARSE,
+	/* PPME_CONTAINER_JSON_E */ PFS_PARSE,
+	/* PPME_CONTAINER_JSON_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SETSID_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SETSID_X */ PFS_PARSE,
+	/* PPME_SYSCALL_MKDIR_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_MKDIR_2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_RMDIR_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_RMDIR_2_X */ PFS_SKIP,
+	/* PPME_NOTIFICATION_E */ PFS_PARSE,
+	/* PPME_NOTIFICATION_X */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_17_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_17_X */ PFS_PARSE,
+	/* PPME_SYSCALL_UNSHARE_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_UNSHARE_X */ PFS_SKIP,
+	/* PPME_INFRASTRUCTURE_EVENT_E */ PFS_PARSE,
+	/* PPME_INFRASTRUCTURE_EVENT_X */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_18_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_18_X */ PFS_PARSE,
+	/* PPME_PAGE_FAULT_E */ PFS_PARSE,
+	/* PPME_PAGE_FAULT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_EXECVE_19_E */ PFS_PARSE,
+	/* PPME_SYSCALL_EXECVE_19_X */ PFS_PARSE,
+	/* PPME_SYSCALL_SETPGID_E */ PFS_PARSE,
+	/* PPME_SYSCALL_SETPGID_X */ PFS_PARSE,
+	/* PPME_SYSCALL_BPF_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_BPF_X */ PFS_SKIP,
+	/* PPME_SYSCALL_SECCOMP_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_SECCOMP_X */ PFS_SKIP,
+	/* PPME_SYSCALL_UNLINK_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_UNLINK_2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_UNLINKAT_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_UNLINKAT_2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_MKDIRAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_MKDIRAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_OPENAT_2_E */ PFS_PARSE,
+	/* PPME_SYSCALL_OPENAT_2_X */ PFS_PARSE,
+	/* PPME_SYSCALL_LINK_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LINK_2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_LINKAT_2_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_LINKAT_2_X */ PFS_SKIP,
+	/* PPME_SYSCALL_FCHMODAT_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_FCHMODAT_X */ PFS_SKIP,
+	/* PPME_SYSCALL_CHMOD_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_CHMOD_X */ PFS_SKIP,
+	/* PPME_SYSCALL_FCHMOD_E */ PFS_SKIP_WITH_EXIT,
+	/* PPME_SYSCALL_FCHMOD_X */ PFS_SKIP,
+	/* PPME_CONTAINER_BIN_E */ PFS_PARSE,
+	/* PPME_CONTAINER_BIN_X */ PFS_PARSE,
+	/* PPME_USER_ADDED_E */ PFS_PARSE,
+	/* PPME_USER_ADDED_X */ PFS_PARSE,
+	/* PPME_GROUP_ADDED_E */ PFS_PARSE,
+	/* PPME_GROUP_ADDED_X */ PFS_PARSE,
+};
+
+static_assert(sizeof(g_prefilter_safety_table) / sizeof(g_prefilter_safety_table[0]) == PPM_EVENT_MAX,
+	"g_prefilter_safety_table must have an entry for every event type");
+
+///////////////////////////////////////////////////////////////////////////////
+// sinsp_header_prefilter implementation
+///////////////////////////////////////////////////////////////////////////////
+sinsp_header_prefilter::sinsp_header_prefilter(sinsp* inspector, sinsp_filter* filter)
+{
+	m_inspector = inspector;
+	m_useful = false;
+	memset(&m_exit_hdr, 0, sizeof(m_exit_hdr));
+
+	compile(filter->m_filter, &m_root);
+	m_root.m_boolop = BO_NONE;
+
+	get_window(m_root, &m_window_start, &m_window_end);
+}
+
+bool sinsp_header_prefilter::get_time_window(OUT uint64_t* start, OUT uint64_t* end) const
+{
+	*start = m_window_start;
+	*end = m_window_end;
+
+	return m_window_start != 0 || m_window_end != UINT64_MAX;
+}
+
+sinsp_prefilter_safety sinsp_header_prefilter::get_safety(uint16_t etype)
+{
+	if(etype >= PPM_EVENT_MAX)
+	{
+		return PFS_PARSE;
+	}
+
+	return g_prefilter_safety_table[etype];
+}
+
+void sinsp_header_prefilter::compile(gen_event_filter_check* chk, node* n)
+{
+	n->m_boolop = chk->m_boolop;
+	n->m_check = NULL;
+
+	gen_event_filter_expression* expr = dynamic_cast<gen_event_filter_expression*>(chk);
+	if(expr != NULL)
+	{
+		n->m_type = NT_EXPRESSION;
+		n->m_children.resize(expr->m_checks.size());
+
+		for(uint32_t j = 0; j < expr->m_checks.size(); j++)
+		{
+			compile(expr->m_checks[j], &n->m_children[j]);
+		}
+
+		return;
+	}
+
+	n->m_type = NT_UNKNOWN;
+
+	sinsp_filter_check* schk = dynamic_cast<sinsp_filter_check*>(chk);
+	if(schk == NULL)
+	{
+		return;
+	}
+
+	n->m_check = schk;
+	const char* name = schk->get_field_info()->m_name;
+
+	if(strcmp(name, "evt.type") == 0 || strcmp(name, "evt.dir") == 0)
+	{
+		//
+		// Run the check on an event of every type. The type of the
+		// generic events is in their parameters.
+		//
+		bool is_type = (strcmp(name, "evt.type") == 0);
+		scap_evt hdr;
+		sinsp_evt probe(m_inspector);
+
+		memset(&hdr, 0, sizeof(hdr));
+		probe.m_pevt = &hdr;
+		n->m_type_results.resize(PPM_EVENT_MAX);
+
+		for(uint16_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+		{
+			if(is_type && (etype == PPME_GENERIC_E || etype == PPME_GENERIC_X))
+			{
+				n->m_type_results[etype] = R_UNKNOWN;
+				continue;
+			}
+
+			hdr.type = etype;
+			probe.init();
+			n->m_type_results[etype] = schk->compare(&probe)? R_TRUE : R_FALSE;
+		}
+
+		n->m_type = NT_TYPE;
+	}
+	else if(strcmp(name, "evt.cpu") == 0)
+	{
+		n->m_type = NT_CPU;
+	}
+	else if(strcmp(name, "thread.tid") == 0)
+	{
+		n->m_type = NT_TID;
+	}
+	else if(strcmp(name, "proc.pid") == 0)
+	{
+		n->m_type = NT_PID;
+	}
+	else if(strcmp(name, "evt.rawtime") == 0 || strcmp(name, "evt.around") == 0)
+	{
+		compile_time(schk, n);
+	}
+
+	if(n->m_type != NT_UNKNOWN)
+	{
+		m_useful = true;
+	}
+}
+
+//
+// The timestamps for which the check is true. The bounds are exact, with the
+// overflows of sinsp_filter_check_event::compare() for evt.around.
+//
+void sinsp_header_prefilter::compile_time(sinsp_filter_check* chk, node* n)
+{
+	sinsp_filter_check_event* echk = dynamic_cast<sinsp_filter_check_event*>(chk);
+
+	if(echk == NULL)
+	{
+		return;
+	}
+
+	if(echk->m_field_id == sinsp_filter_check_event::TYPE_AROUND)
+	{
+		uint64_t t = echk->m_u64val;
+		uint64_t delta = echk->m_tsdelta;
+
+		if(delta > t || t > UINT64_MAX - delta)
+		{
+			return;
+		}
+
+		n->m_tmin = std::max(t - delta, delta);
+		n->m_tmax = std::min(t + delta, UINT64_MAX - delta);
+	}
+	else
+	{
+		if(chk->m_val_storages.size() != 1)
+		{
+			return;
+		}
+
+		uint64_t v = *(uint64_t*)chk->filter_value_p();
+
+		switch(chk->m_cmpop)
+		{
+		case CO_EQ:
+			n->m_tmin = v;
+			n->m_tmax = v;
+			break;
+		case CO_LT:
+			n->m_tmin = (v == 0)? 1 : 0;
+			n->m_tmax = (v == 0)? 0 : v - 1;
+			break;
+		case CO_LE:
+			n->m_tmin = 0;
+			n->m_tmax = v;
+			break;
+		case CO_GT:
+			n->m_tmin = (v == UINT64_MAX)? UINT64_MAX : v + 1;
+			n->m_tmax = (v == UINT64_MAX)? 0 : UINT64_MAX;
+			break;
+		case CO_GE:
+			n->m_tmin = v;
+			n->m_tmax = UINT64_MAX;
+			break;
+		default:
+			return;
+		}
+	}
+
+	n->m_type = NT_TIME;
+}
+
+//
+// The smallest range that contains the timestamps of the events that can
+// match. Unlike run(), this doesn't look at the events: the first
+// short-circuit makes the expression true with the range of the checks
+// before it, otherwise the checks in and are intersected.
+//
+void sinsp_header_prefilter::get_window(const node& n, OUT uint64_t* start, OUT uint64_t* end)
+{
+	*start = 0;
+	*end = UINT64_MAX;
+
+	if(n.m_type == NT_TIME)
+	{
+		*start = n.m_tmin;
+		*end = n.m_tmax;
+		return;
+	}
+	else if(n.m_type != NT_EXPRESSION)
+	{
+		return;
+	}
+
+	// Empty range
+	uint64_t exit_start = UINT64_MAX;
+	uint64_t exit_end = 0;
+
+	for(uint32_t j = 0; j < n.m_children.size(); j++)
+	{
+		const node& child = n.m_children[j];
+		uint64_t cstart = 0;
+		uint64_t cend = UINT64_MAX;
+
+		if(!(child.m_boolop & BO_NOT))
+		{
+			get_window(child, &cstart, &cend);
+		}
+
+		if(j != 0 && (child.m_boolop & BO_AND))
+		{
+			*start = std::max(*start, cstart);
+			*end = std::min(*end, cend);
+			continue;
+		}
+
+		if(j != 0 && *start <= *end)
+		{
+			exit_start = std::min(exit_start, *start);
+			exit_end = std::max(exit_end, *end);
+		}
+
+		*start = cstart;
+		*end = cend;
+	}
+
+	if(exit_start <= exit_end)
+	{
+		if(*start <= *end)
+		{
+			*start = std::min(*start, exit_start);
+			*end = std::max(*end, exit_end);
+		}
+		else
+		{
+			*start = exit_start;
+			*end = exit_end;
+		}
+	}
+}
+
+//
+// Same as sinsp_filter_check::compare(), on the value extracted from the
+// header
+//
+sinsp_header_prefilter::result sinsp_header_prefilter::run_check(const node& n, scap_evt* pevt, uint16_t cpuid, bool exact)
+{
+	sinsp_filter_check* chk = n.m_check;
+	ppm_param_type ptype;
+	int64_t val;
+	bool res;
+
+	switch(n.m_type)
+	{
+	case NT_EXPRESSION:
+		return run(n, pevt, cpuid, exact);
+	case NT_TYPE:
+		return (result)n.m_type_results[pevt->type];
+	case NT_CPU:
+		if(!exact)
+		{
+			return R_UNKNOWN;
+		}
+
+		ptype = chk->m_info.m_fields[chk->m_field_id].m_type;
+		res = chk->flt_compare(chk->m_cmpop, ptype, &cpuid, sizeof(cpuid), chk->m_val_storage_len);
+		return res? R_TRUE : R_FALSE;
+	case NT_TID:
+	case NT_PID:
+		if(n.m_type == NT_TID)
+		{
+			val = pevt->tid;
+		}
+		else
+		{
+			//
+			// The parser looks for the threads that aren't in the
+			// table in /proc, we can't
+			//
+			sinsp_threadinfo* tinfo = m_inspector->get_thread(pevt->tid, false, true);
+			if(tinfo == NULL)
+			{
+				return R_UNKNOWN;
+			}
+
+			val = tinfo->m_pid;
+		}
+
+		ptype = chk->m_info.m_fields[chk->m_field_id].m_type;
+		res = chk->flt_compare(chk->m_cmpop, ptype, &val, sizeof(val), chk->m_val_storage_len);
+		return res? R_TRUE : R_FALSE;
+	case NT_TIME:
+		if(pevt->ts > n.m_tmax)
+		{
+			return R_FALSE;
+		}
+		else if(!exact)
+		{
+			return R_UNKNOWN;
+		}
+
+		return (pevt->ts >= n.m_tmin)? R_TRUE : R_FALSE;
+	default:
+		return R_UNKNOWN;
+	}
+}
+
+//
+// Same as gen_event_filter_expression::compare(), in three-valued logic.
+// The expression returns at the first short-circuit, so an unknown result
+// before an and/or means that the outcome may be the one of the
+// short-circuit, or the one of the rest of the expression.
+//
+sinsp_header_prefilter::result sinsp_header_prefilter::run(const node& n, scap_evt* pevt, uint16_t cpuid, bool exact)
+{
+	result res = R_TRUE;
+	bool may_exit_true = false;
+	bool may_exit_false = false;
+
+	for(uint32_t j = 0; j < n.m_children.size(); j++)
+	{
+		const node& child = n.m_children[j];
+
+		if(j != 0)
+		{
+			if(child.m_boolop & BO_OR)
+			{
+				if(res == R_TRUE)
+				{
+					break;
+				}
+				else if(res == R_UNKNOWN)
+				{
+					may_exit_true = true;
+				}
+			}
+			else if(child.m_boolop & BO_AND)
+			{
+				if(res == R_FALSE)
+				{
+					break;
+				}
+				else if(res == R_UNKNOWN)
+				{
+					may_exit_false = true;
+				}
+			}
+		}
+
+		res = run_check(child, pevt, cpuid, exact);
+
+		if((child.m_boolop & BO_NOT) && res != R_UNKNOWN)
+		{
+			res = (res == R_TRUE)? R_FALSE : R_TRUE;
+		}
+	}
+
+	if((res == R_TRUE && may_exit_false) || (res == R_FALSE && may_exit_true))
+	{
+		return R_UNKNOWN;
+	}
+
+	return res;
+}
+
+//
+// The first I/O on a socket tells that it's connected, the parser looks at
+// it whatever the filter says. The fd is in the enter event, and in the
+// thread for the exit event.
+//
+bool sinsp_header_prefilter::connects_socket(scap_evt* pevt)
+{
+	int64_t fd;
+
+	if(!(g_infotables.m_event_info[pevt->type].flags & (EF_READS_FROM_FD | EF_WRITES_TO_FD)))
+	{
+		return false;
+	}
+
+	sinsp_threadinfo* tinfo = m_inspector->get_thread(pevt->tid, false, true);
+	if(tinfo == NULL)
+	{
+		//
+		// The parser can find the thread, and its fds, in /proc. In a
+		// trace file it makes one without fds.
+		//
+		return m_inspector->is_live();
+	}
+
+	if(PPME_IS_ENTER(pevt->type))
+	{
+		uint16_t* lens = (uint16_t*)((char*)pevt + sizeof(scap_evt));
+
+		if(pevt->nparams == 0 || lens[0] != sizeof(int64_t))
+		{
+			return true;
+		}
+
+		memcpy(&fd, (char*)lens + pevt->nparams * sizeof(uint16_t), sizeof(fd));
+	}
+	else if(tinfo->m_lastevent_type + 1 == pevt->type)
+	{
+		fd = tinfo->m_lastevent_fd;
+	}
+	else
+	{
+		//
+		// The parser drops an exit event without its enter event
+		//
+		return false;
+	}
+
+	//
+	// Don't copy the fds of a fork() child for this
+	//
+	const sinsp_fdinfo_t* fdinfo = tinfo->peek_fd(fd);
+
+	return fdinfo != NULL && (fdinfo->is_ipv4_socket() || fdinfo->is_ipv6_socket()) &&
+		!fdinfo->is_socket_connected();
+}
+
+bool sinsp_header_prefilter::can_skip(scap_evt* pevt, uint16_t cpuid)
+{
+	sinsp_prefilter_safety safety = get_safety(pevt->type);
+
+	if(safety == PFS_PARSE)
+	{
+		return false;
+	}
+
+	if(run(m_root, pevt, cpuid, true) != R_FALSE)
+	{
+		return false;
+	}
+
+	if(safety == PFS_SKIP_WITH_EXIT)
+	{
+		//
+		// The exit event will come from the same thread, maybe on
+		// another cpu, and later
+		//
+		m_exit_hdr = *pevt;
+		m_exit_hdr.type = pevt->type + 1;
+
+		if(run(m_root, &m_exit_hdr, cpuid, false) != R_FALSE)
+		{
+			return false;
+		}
+	}
+
+	return !connects_socket(pevt);
+}
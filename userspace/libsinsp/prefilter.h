@@ -0,0 +1,132 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <scap.h>
+
+#include "gen_filter.h"
+
+class sinsp;
+class sinsp_filter;
+class sinsp_filter_check;
+
+//
+// What the inspector must do with an event that the filter rejects
+//
+enum sinsp_prefilter_safety
+{
+	// The parser must see the event anyway, it changes the state
+	PFS_PARSE = 0,
+	// The event can be dropped without parsing it
+	PFS_SKIP = 1,
+	// Enter event, can be dropped only if its exit event is rejected too,
+	// since the parser pairs the two
+	PFS_SKIP_WITH_EXIT = 2,
+};
+
+//
+// The part of a filter that can be evaluated on the scap_evt headers, before
+// sinsp parses the events: evt.type, evt.dir, evt.cpu, thread.tid,
+// proc.pid (the latter only for threads that are already in the table),
+// evt.rawtime and evt.around.
+// The other fields are unknown at that point, so the pre-filter only rejects
+// the events that the filter would reject whatever their value.
+//
+class sinsp_header_prefilter
+{
+public:
+	sinsp_header_prefilter(sinsp* inspector, sinsp_filter* filter);
+
+	//
+	// False if no part of the filter can be evaluated on the headers, in
+	// which case the pre-filter is useless
+	//
+	bool is_useful() const
+	{
+		return m_useful;
+	}
+
+	//
+	// True if the event can be dropped without parsing it: the filter
+	// rejects it, the table below says that it doesn't change the state
+	// and it's not the first I/O on a socket
+	//
+	bool can_skip(scap_evt* pevt, uint16_t cpuid);
+
+	//
+	// The time range out of which the filter rejects every event, if the
+	// filter has conditions on evt.rawtime or evt.around. Returns false if
+	// the range is unbounded.
+	//
+	bool get_time_window(OUT uint64_t* start, OUT uint64_t* end) const;
+
+	//
+	// The state safety of each event type
+	//
+	static sinsp_prefilter_safety get_safety(uint16_t etype);
+
+private:
+	enum result
+	{
+		R_FALSE = 0,
+		R_TRUE = 1,
+		R_UNKNOWN = 2,
+	};
+
+	enum node_type
+	{
+		NT_EXPRESSION,
+		// Depends on the event type only, m_type_results has the outcome
+		NT_TYPE,
+		NT_CPU,
+		NT_TID,
+		NT_PID,
+		// evt.rawtime or evt.around, true between m_tmin and m_tmax
+		NT_TIME,
+		NT_UNKNOWN,
+	};
+
+	struct node
+	{
+		node_type m_type;
+		boolop m_boolop;
+		sinsp_filter_check* m_check;
+		std::vector<uint8_t> m_type_results;
+		uint64_t m_tmin;
+		uint64_t m_tmax;
+		std::vector<node> m_children;
+	};
+
+	void compile(gen_event_filter_check* chk, node* n);
+	void compile_time(sinsp_filter_check* chk, node* n);
+	static void get_window(const node& n, OUT uint64_t* start, OUT uint64_t* end);
+	result run(const node& n, scap_evt* pevt, uint16_t cpuid, bool exact);
+	result run_check(const node& n, scap_evt* pevt, uint16_t cpuid, bool exact);
+	bool connects_socket(scap_evt* pevt);
+
+	sinsp* m_inspector;
+	node m_root;
+	bool m_useful;
+	scap_evt m_exit_hdr;
+	uint64_t m_window_start;
+	uint64_t m_window_end;
+};
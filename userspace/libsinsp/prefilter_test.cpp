@@ -0,0 +1,376 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+#define VISIBILITY_PRIVATE
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "filter.h"
+#include "prefilter.h"
+#include "../../driver/ppm_events_public.h"
+
+extern sinsp_evttables g_infotables;
+
+class prefilter_test : public testing::Test
+{
+protected:
+	void compile(const std::string& filter)
+	{
+		sinsp_filter_compiler compiler(&m_inspector, filter);
+		m_filter.reset(compiler.compile());
+		m_prefilter.reset(new sinsp_header_prefilter(&m_inspector, m_filter.get()));
+	}
+
+	bool can_skip(uint16_t type, int64_t tid = 1, uint16_t cpuid = 1, uint64_t ts = 1000)
+	{
+		scap_evt hdr;
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.ts = ts;
+		hdr.tid = tid;
+		hdr.len = sizeof(hdr);
+		hdr.type = type;
+		return m_prefilter->can_skip(&hdr, cpuid);
+	}
+
+	sinsp m_inspector;
+	std::unique_ptr<sinsp_filter> m_filter;
+	std::unique_ptr<sinsp_header_prefilter> m_prefilter;
+};
+
+//
+// The events that change the state are always parsed, and the enter events
+// are skipped only together with their exit events
+//
+TEST(prefilter, safety_table)
+{
+	for(uint16_t etype = 0; etype < PPM_EVENT_MAX; etype++)
+	{
+		const struct ppm_event_info* info = &g_infotables.m_event_info[etype];
+		sinsp_prefilter_safety safety = sinsp_header_prefilter::get_safety(etype);
+
+		if((info->flags & (EF_MODIFIES_STATE | EF_SKIPPARSERESET)) || (info->category & EC_INTERNAL))
+		{
+			EXPECT_EQ(PFS_PARSE, safety) << info->name << " " << etype;
+		}
+
+		if(PPME_IS_ENTER(etype))
+		{
+			EXPECT_NE(PFS_SKIP, safety) << info->name << " " << etype;
+
+			if(sinsp_header_prefilter::get_safety(etype + 1) == PFS_PARSE)
+			{
+				EXPECT_EQ(PFS_PARSE, safety) << info->name << " " << etype;
+			}
+		}
+		else
+		{
+			EXPECT_NE(PFS_SKIP_WITH_EXIT, safety) << info->name << " " << etype;
+		}
+	}
+
+	EXPECT_EQ(PFS_PARSE, sinsp_header_prefilter::get_safety(PPM_EVENT_MAX));
+	EXPECT_EQ(PFS_PARSE, sinsp_header_prefilter::get_safety(PPME_SYSCALL_WRITE_X));
+	EXPECT_EQ(PFS_PARSE, sinsp_header_prefilter::get_safety(PPME_TRACER_E));
+}
+
+TEST_F(prefilter_test, type)
+{
+	compile("evt.type=open and fd.name contains /etc");
+	EXPECT_TRUE(m_prefilter->is_useful());
+
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_E));
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_X));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_OPEN_E));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_OPEN_X));
+	// Parsed anyway
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_CLOSE_X));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_WRITE_X));
+	// The type of the generic events is in their parameters
+	EXPECT_FALSE(can_skip(PPME_GENERIC_E));
+	EXPECT_FALSE(can_skip(PPME_GENERIC_X));
+}
+
+TEST_F(prefilter_test, direction)
+{
+	compile("evt.type=read and evt.dir=<");
+
+	EXPECT_TRUE(can_skip(PPME_SOCKET_LISTEN_E));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_X));
+	// Rejected, but the exit event isn't
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E));
+}
+
+TEST_F(prefilter_test, cpu)
+{
+	compile("evt.cpu=0");
+
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_X, 1, 1));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_X, 1, 0));
+	// The exit event can come on any cpu
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E, 1, 1));
+}
+
+TEST_F(prefilter_test, tid_pid)
+{
+	compile("thread.tid=42");
+
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_E, 7));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E, 42));
+
+	// The thread isn't in the table
+	compile("proc.pid=42");
+	EXPECT_TRUE(m_prefilter->is_useful());
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E, 7));
+}
+
+TEST_F(prefilter_test, unknown_fields)
+{
+	compile("proc.name=cat");
+	EXPECT_FALSE(m_prefilter->is_useful());
+
+	compile("not evt.type=read and proc.name=cat");
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_E));
+	EXPECT_FALSE(can_skip(PPME_SOCKET_LISTEN_E));
+
+	compile("not evt.type=read or proc.name=cat");
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E));
+
+	//
+	// No precedence, and the evaluation stops at the first short-circuit:
+	// a cat process matches whatever follows
+	//
+	compile("proc.name=cat or evt.type=open and evt.type=close");
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E));
+
+	compile("(proc.name=cat or evt.type=open) and evt.type=close");
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_E));
+}
+
+TEST_F(prefilter_test, time)
+{
+	uint64_t start;
+	uint64_t end;
+
+	compile("evt.rawtime>=1000 and evt.rawtime<2000 and proc.name=cat");
+	ASSERT_TRUE(m_prefilter->get_time_window(&start, &end));
+	EXPECT_EQ(1000u, start);
+	EXPECT_EQ(1999u, end);
+
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_X, 1, 1, 999));
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_X, 1, 1, 1000));
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_X, 1, 1, 2000));
+	// The exit event may come in the window
+	EXPECT_FALSE(can_skip(PPME_SYSCALL_READ_E, 1, 1, 999));
+	EXPECT_TRUE(can_skip(PPME_SYSCALL_READ_E, 1, 1, 2000));
+
+	// evt.around is in ms
+	compile("evt.around[5000000000]=2 or evt.rawtime=7000000000 and proc.name=cat");
+	ASSERT_TRUE(m_prefilter->get_time_window(&start, &end));
+	EXPECT_EQ(4998000000u, start);
+	EXPECT_EQ(7000000000u, end);
+
+	compile("evt.rawtime>=1000 or proc.name=cat");
+	EXPECT_FALSE(m_prefilter->get_time_window(&start, &end));
+
+	compile("not evt.rawtime>=1000 and evt.type=read");
+	EXPECT_FALSE(m_prefilter->get_time_window(&start, &end));
+
+	// A cat process matches whatever follows
+	compile("proc.name=cat or evt.rawtime>=1000 and evt.rawtime<=2000");
+	EXPECT_FALSE(m_prefilter->get_time_window(&start, &end));
+
+	compile("evt.rawtime<=2000 or proc.name=cat and evt.rawtime>=3000");
+	EXPECT_FALSE(m_prefilter->get_time_window(&start, &end));
+
+	compile("(evt.rawtime<=2000 or evt.rawtime>=3000) and evt.rawtime<=5000");
+	ASSERT_TRUE(m_prefilter->get_time_window(&start, &end));
+	EXPECT_EQ(0u, start);
+	EXPECT_EQ(5000u, end);
+}
+
+//
+// An event of this process, at the given time
+//
+static void dump_evt(scap_t* h, scap_dumper_t* dumper, uint64_t ts, uint16_t type, const std::vector<std::string>& params)
+{
+	scap_evt hdr;
+	std::string evt;
+	std::string data;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.ts = ts;
+	hdr.tid = getpid();
+	hdr.type = type;
+	hdr.nparams = (uint32_t)params.size();
+	hdr.len = (uint32_t)(sizeof(hdr) + params.size() * sizeof(uint16_t));
+
+	evt.append((const char*)&hdr, sizeof(hdr));
+
+	for(const auto& param : params)
+	{
+		uint16_t len = (uint16_t)param.size();
+
+		evt.append((const char*)&len, sizeof(len));
+		data.append(param);
+		((scap_evt*)&evt[0])->len += len;
+	}
+
+	evt.append(data);
+
+	ASSERT_EQ(SCAP_SUCCESS, scap_dump(h, dumper, (scap_evt*)&evt[0], 0, 0));
+}
+
+template<typename T> static std::string param(T val)
+{
+	return std::string((const char*)&val, sizeof(val));
+}
+
+static scap_t* open_nodriver()
+{
+	char error[SCAP_LASTERR_SIZE];
+	int32_t rc;
+	scap_open_args oargs = {};
+
+	oargs.mode = SCAP_MODE_NODRIVER;
+	oargs.import_users = true;
+
+	scap_t* h = scap_open(oargs, error, &rc);
+	if(h == NULL)
+	{
+		throw sinsp_exception(error);
+	}
+
+	return h;
+}
+
+//
+// Only a live capture declares its events in order. The events of another
+// file, here out of order, are read past the end of the time window.
+//
+TEST(prefilter, unsorted_file)
+{
+	char path[] = "/tmp/sinsp_prefilter_testXXXXXX";
+	uint64_t ts = sinsp_utils::get_current_time_ns();
+	std::vector<uint64_t> read_ts;
+	sinsp_evt* evt;
+	int32_t rc;
+
+	::close(mkstemp(path));
+	scap_t* h = open_nodriver();
+	scap_dumper_t* dumper = scap_dump_open(h, path, SCAP_COMPRESSION_NONE, false);
+	ASSERT_NE(nullptr, dumper) << scap_getlasterr(h);
+
+	dump_evt(h, dumper, ts, PPME_SYSCALL_CLOSE_E, {param<int64_t>(0)});
+	dump_evt(h, dumper, ts + 10 * ONE_SECOND_IN_NS, PPME_SYSCALL_CLOSE_E, {param<int64_t>(0)});
+	dump_evt(h, dumper, ts + 1, PPME_SYSCALL_CLOSE_E, {param<int64_t>(0)});
+	scap_dump_close(dumper);
+	scap_close(h);
+
+	sinsp inspector;
+	inspector.open(path);
+	inspector.set_filter("evt.type=close and evt.rawtime<=" + std::to_string(ts + 5 * ONE_SECOND_IN_NS));
+
+	while((rc = inspector.next(&evt)) != SCAP_EOF)
+	{
+		if(rc == SCAP_SUCCESS)
+		{
+			read_ts.push_back(evt->get_ts());
+		}
+	}
+
+	inspector.close();
+	unlink(path);
+
+	EXPECT_EQ(std::vector<uint64_t>({ts, ts + 1}), read_ts);
+}
+
+//
+// The I/O on a socket changes its state even when the filter rejects it,
+// the I/O on a file is dropped before the parser sees it
+//
+TEST(prefilter, socket_io)
+{
+	char path[] = "/tmp/sinsp_prefilter_testXXXXXX";
+	uint64_t ts = sinsp_utils::get_current_time_ns();
+	int64_t sockfd = 1000;
+	int64_t filefd = 1001;
+	sinsp_evt* evt;
+
+	::close(mkstemp(path));
+	scap_t* h = open_nodriver();
+	scap_dumper_t* dumper = scap_dump_open(h, path, SCAP_COMPRESSION_NONE, false);
+	ASSERT_NE(nullptr, dumper) << scap_getlasterr(h);
+
+	dump_evt(h, dumper, ts++, PPME_SOCKET_SOCKET_E, {param<uint32_t>(PPM_AF_INET), param<uint32_t>(SOCK_STREAM), param<uint32_t>(0)});
+	dump_evt(h, dumper, ts++, PPME_SOCKET_SOCKET_X, {param(sockfd)});
+	dump_evt(h, dumper, ts++, PPME_SYSCALL_OPEN_E, {});
+	dump_evt(h, dumper, ts++, PPME_SYSCALL_OPEN_X, {param(filefd), std::string("/dev/null", 10), param<uint32_t>(0), param<uint32_t>(0), param<uint32_t>(0)});
+	dump_evt(h, dumper, ts++, PPME_SOCKET_RECV_E, {param(sockfd), param<uint32_t>(4)});
+	dump_evt(h, dumper, ts++, PPME_SOCKET_RECV_X, {param<int64_t>(4), "data"});
+	dump_evt(h, dumper, ts++, PPME_SYSCALL_READ_E, {param(filefd), param<uint32_t>(4)});
+	dump_evt(h, dumper, ts++, PPME_SYSCALL_READ_X, {param<int64_t>(4), "data"});
+	scap_dump_close(dumper);
+	scap_close(h);
+
+	for(bool prefilter : {false, true})
+	{
+		uint32_t nprefiltered = 0;
+		sinsp inspector;
+
+		inspector.set_header_prefilter(prefilter);
+		inspector.open(path);
+		inspector.set_filter("evt.type=close");
+
+		while(inspector.next(&evt) != SCAP_EOF)
+		{
+			if(evt == NULL)
+			{
+				continue;
+			}
+
+			// The pre-filter drops the events before they get their thread
+			if(evt->m_filtered_out && evt->m_tinfo == NULL)
+			{
+				nprefiltered++;
+			}
+			else if(evt->get_type() == PPME_SOCKET_SOCKET_X)
+			{
+				ASSERT_NE(nullptr, evt->get_fd_info());
+				EXPECT_FALSE(evt->get_fd_info()->is_socket_connected());
+			}
+		}
+
+		sinsp_fdinfo_t* fdinfo = inspector.get_thread(getpid())->get_fd(sockfd);
+		ASSERT_NE(nullptr, fdinfo);
+		EXPECT_TRUE(fdinfo->is_socket_connected()) << prefilter;
+		EXPECT_EQ(prefilter? 2u : 0u, nprefiltered);
+
+		inspector.close();
+	}
+
+	unlink(path);
+}
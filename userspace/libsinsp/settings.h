@@ -122,6 +122,12 @@ limitations under the License.
 //
 #define CLONE_STALE_TIME_NS 2000000000
 
+//
+// How far back in time an event of an ordered trace file can go, merging
+// the per-CPU buffers of the live capture that wrote it
+//
+#define ORDERED_CAPTURE_SLACK_NS 1000000000
+
 //
 // For internal use
 //
@@ -75,6 +75,10 @@ sinsp::sinsp() :
 	m_parser = NULL;
 	m_dumper = NULL;
 	m_is_dumping = false;
+	m_autodump_from_state = false;
+	m_checkpoint_interval_ns = 0;
+	m_next_checkpoint_ts = 0;
+	m_autodump_nevts = 0;
 	m_metaevt = NULL;
 	m_meinfo.m_piscapevt = NULL;
 	m_network_interfaces = NULL;
@@ -94,6 +98,9 @@ sinsp::sinsp() :
 #ifdef HAS_FILTERING
 	m_filter = NULL;
 	m_evttype_filter = NULL;
+	m_prefilter_enabled = true;
+	m_time_window_pending = false;
+	m_time_window_end = UINT64_MAX;
 #endif
 
 	m_fds_to_remove = new vector<int64_t>;
@@ -107,6 +114,13 @@ sinsp::sinsp() :
 	m_buffer_format = sinsp_evt::PF_NORMAL;
 	m_input_fd = 0;
 	m_bpf = false;
+	m_hugepages = SCAP_HUGEPAGES_NONE;
+	m_consumer_cpu = -1;
+	m_consumer_local_alloc = false;
+	m_consumer_placement_pending = false;
+	m_unordered_consumption = false;
+	m_async_proc_lookup_workers = 0;
+	m_async_user_lookups = false;
 	m_isdebug_enabled = false;
 	m_isfatfile_enabled = false;
 	m_isinternal_events_enabled = false;
@@ -121,6 +135,7 @@ sinsp::sinsp() :
 	m_get_procs_cpu_from_driver = false;
 	m_is_tracers_capture_enabled = false;
 	m_file_start_offset = 0;
+	m_stop_at_checkpoint = false;
 	m_flush_memory_dump = false;
 	m_next_stats_print_time_ns = 0;
 	m_large_envs_enabled = false;
@@ -264,6 +279,8 @@ void sinsp::enable_page_faults()
 
 void sinsp::init()
 {
+	m_consumer_placement_pending = (m_consumer_cpu >= 0 || m_consumer_local_alloc);
+
 	//
 	// Retrieve machine information
 	//
@@ -311,6 +328,14 @@ void sinsp::init()
 	m_fds_to_remove->clear();
 	m_n_proc_lookups = 0;
 	m_n_proc_lookups_duration_ns = 0;
+	m_proc_lookup_stats = sinsp_proc_lookup_stats();
+
+	if(m_async_proc_lookup_workers != 0 && !is_capture())
+	{
+		m_async_proc_lookup.reset(new sinsp_async_proc_lookup(m_h,
+			string(scap_get_host_root()) + "/proc",
+			m_async_proc_lookup_workers));
+	}
 
 	//
 	// Return the tracers to the pool and clear the tracers list
@@ -342,7 +367,7 @@ void sinsp::init()
 
 			if(res == SCAP_SUCCESS)
 			{
-				if((pevent->type != PPME_CONTAINER_E) && (pevent->type != PPME_CONTAINER_JSON_E))
+				if((pevent->type != PPME_CONTAINER_E) && (pevent->type != PPME_CONTAINER_JSON_E) && (pevent->type != PPME_CONTAINER_BIN_E))
 				{
 					break;
 				}
@@ -390,6 +415,21 @@ void sinsp::init()
 
 	import_user_list();
 
+	if(m_async_user_lookups && m_import_users && !is_capture())
+	{
+		m_async_user_lookup.reset(new sinsp_async_user_lookup(&m_userlist, &m_grouplist));
+
+		//
+		// Start with the users of the threads that are already running
+		//
+		m_thread_manager->m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
+			get_user(tinfo.m_uid);
+			get_user((uint32_t)tinfo.m_loginuid);
+			get_group(tinfo.m_gid);
+			return true;
+		});
+	}
+
 	//
 	// Scan the list to create the proper parent/child dependencies
 	//
@@ -477,7 +517,7 @@ void sinsp::open(uint32_t timeout_ms)
 		oargs.proc_callback = ::on_new_entry_from_proc;
 		oargs.proc_callback_context = this;
 	}
-	oargs.import_users = m_import_users;
+	oargs.import_users = m_import_users && !m_async_user_lookups;
 
 	add_suppressed_comms(oargs);
 
@@ -490,6 +530,8 @@ void sinsp::open(uint32_t timeout_ms)
 		oargs.bpf_probe = NULL;
 	}
 
+	oargs.hugepages = m_hugepages;
+
 	add_suppressed_comms(oargs);
 
 	int32_t scap_rc;
@@ -500,6 +542,11 @@ void sinsp::open(uint32_t timeout_ms)
 		throw sinsp_exception(error, scap_rc);
 	}
 
+	if(m_unordered_consumption && scap_set_unordered(m_h, true) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(scap_getlasterr(m_h));
+	}
+
 	scap_set_refresh_proc_table_when_saving(m_h, !m_filter_proc_table_when_saving);
 
 	init();
@@ -530,7 +577,8 @@ void sinsp::open_nodriver()
 		oargs.proc_callback = ::on_new_entry_from_proc;
 		oargs.proc_callback_context = this;
 	}
-	oargs.import_users = m_import_users;
+	oargs.import_users = m_import_users && !m_async_user_lookups;
+	oargs.hugepages = SCAP_HUGEPAGES_NONE;
 
 	int32_t scap_rc;
 	m_h = scap_open(oargs, error, &scap_rc);
@@ -668,6 +716,7 @@ void sinsp::open_int()
 	{
 		oargs.start_offset = 0;
 	}
+	oargs.hugepages = m_hugepages;
 
 	add_suppressed_comms(oargs);
 
@@ -679,6 +728,8 @@ void sinsp::open_int()
 		throw sinsp_exception(error, scap_rc);
 	}
 
+	scap_set_stop_at_checkpoint(m_h, m_stop_at_checkpoint);
+
 	if(m_input_fd != 0)
 	{
 		// We can't get a reliable filesize
@@ -706,12 +757,78 @@ void sinsp::open(const std::string &filename)
 	}
 
 	m_input_filename = filename;
+	m_file_start_offset = 0;
+	m_stop_at_checkpoint = false;
 
 	g_logger.log("starting offline capture");
 
 	open_int();
 }
 
+void sinsp::open_at_checkpoint(const std::string &filename, const scap_checkpoint_info& checkpoint, bool stop_at_next)
+{
+	m_input_filename = filename;
+	m_file_start_offset = checkpoint.offset;
+	m_stop_at_checkpoint = stop_at_next;
+
+	g_logger.format("starting offline capture at offset %" PRIu64, checkpoint.offset);
+
+	open_int();
+
+	//
+	// Number the events like a reader that started from the beginning. The
+	// state events of the checkpoint come first and bring the count back to
+	// checkpoint.nevts (the subtraction can wrap around, the additions
+	// undo it).
+	//
+	m_nevts = checkpoint.nevts - checkpoint.nstateevts;
+}
+
+void sinsp::get_checkpoints(const std::string &filename, OUT std::vector<scap_checkpoint_info>* checkpoints)
+{
+	char error[SCAP_LASTERR_SIZE];
+	scap_checkpoint_info* list;
+	uint32_t nlist;
+
+	if(scap_list_checkpoints(filename.c_str(), &list, &nlist, error) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(error);
+	}
+
+	checkpoints->assign(list, list + nlist);
+	free(list);
+}
+
+void sinsp::seek_to_checkpoint(uint64_t ts)
+{
+	if(!is_capture() || m_input_fd != 0)
+	{
+		throw sinsp_exception("seeking needs a trace file opened by name");
+	}
+
+	vector<scap_checkpoint_info> checkpoints;
+	scap_checkpoint_info start = {0, 0, 0, 0, false};
+
+	get_checkpoints(m_input_filename, &checkpoints);
+
+	//
+	// A checkpoint follows the events with its timestamp, and more may come
+	// after it, so only the ones strictly before ts will do
+	//
+	for(auto& it : checkpoints)
+	{
+		if(it.ts >= ts)
+		{
+			break;
+		}
+
+		start = it;
+	}
+
+	restart_capture_at_filepos(start.offset);
+	m_nevts = start.nevts - start.nstateevts;
+}
+
 void sinsp::fdopen(int fd)
 {
 	m_input_fd = fd;
@@ -723,6 +840,13 @@ void sinsp::fdopen(int fd)
 
 void sinsp::close()
 {
+	//
+	// The lookup workers use the handle
+	//
+	m_async_proc_lookup.reset();
+	m_proc_lookup_results.clear();
+	m_async_user_lookup.reset();
+
 	if(m_h)
 	{
 		scap_close(m_h);
@@ -744,6 +868,10 @@ void sinsp::close()
 	}
 
 #ifdef HAS_FILTERING
+	m_prefilter.reset();
+	m_time_window_pending = false;
+	m_time_window_end = UINT64_MAX;
+
 	if(m_filter != NULL)
 	{
 		delete m_filter;
@@ -765,13 +893,17 @@ void sinsp::autodump_start(const string& dump_filename, bool compress)
 		throw sinsp_exception("inspector not opened yet");
 	}
 
+	bool from_state = m_autodump_from_state && !m_filter_proc_table_when_saving;
+
+	export_user_list();
+
 	if(compress)
 	{
-		m_dumper = scap_dump_open(m_h, dump_filename.c_str(), SCAP_COMPRESSION_GZIP, false);
+		m_dumper = scap_dump_open(m_h, dump_filename.c_str(), SCAP_COMPRESSION_GZIP, from_state);
 	}
 	else
 	{
-		m_dumper = scap_dump_open(m_h, dump_filename.c_str(), SCAP_COMPRESSION_NONE, false);
+		m_dumper = scap_dump_open(m_h, dump_filename.c_str(), SCAP_COMPRESSION_NONE, from_state);
 	}
 
 	m_is_dumping = true;
@@ -781,7 +913,40 @@ void sinsp::autodump_start(const string& dump_filename, bool compress)
 		throw sinsp_exception(scap_getlasterr(m_h));
 	}
 
-	m_container_manager.dump_containers(m_dumper);
+	if(from_state)
+	{
+		m_thread_manager->dump_threads_to_file(m_dumper);
+	}
+
+	m_autodump_nevts = m_container_manager.dump_containers(m_dumper);
+	m_next_checkpoint_ts = 0;
+}
+
+//
+// The state includes the event that was just written, which is the last
+// one before the checkpoint, so the checkpoint gets its timestamp. Throws
+// if the container events don't match the count in the CP block.
+//
+void sinsp::write_checkpoint(scap_dumper_t* dumper, uint64_t ts, uint64_t nevts)
+{
+	//
+	// Every container goes out as one event
+	//
+	uint32_t ncontainers = (uint32_t)m_container_manager.get_containers()->size();
+
+	export_user_list();
+
+	if(scap_write_checkpoint(m_h, dumper, ts, nevts, ncontainers) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(scap_getlasterr(m_h));
+	}
+
+	m_thread_manager->dump_threads_to_file(dumper);
+
+	if(m_container_manager.dump_containers(dumper) != ncontainers)
+	{
+		throw sinsp_exception("checkpoint state events don't match the container count");
+	}
 }
 
 void sinsp::autodump_next_file()
@@ -1046,6 +1211,60 @@ int32_t sinsp::next(OUT sinsp_evt **puevt)
 	sinsp_evt* evt;
 	int32_t res;
 
+	//
+	// The temporaries of the previous event go away with it
+	//
+	m_evt_arena.reset();
+
+	if(m_consumer_placement_pending)
+	{
+		m_consumer_placement_pending = false;
+
+		if(scap_set_consumer_placement(m_h, m_consumer_cpu, m_consumer_local_alloc) != SCAP_SUCCESS)
+		{
+			throw sinsp_exception(scap_getlasterr(m_h));
+		}
+	}
+
+	//
+	// Nobody holds thread pointers between two events, so this is where
+	// the async /proc lookups can replace their placeholders
+	//
+	if(m_async_proc_lookup && m_async_proc_lookup->get_n_pending() != 0)
+	{
+		merge_async_proc_lookups();
+	}
+
+	if(m_async_user_lookup)
+	{
+		if(m_async_user_lookup->has_pending())
+		{
+			m_async_user_lookup->merge_results();
+		}
+
+		if(m_async_user_lookup->has_new_entries())
+		{
+			queue_user_evts();
+		}
+	}
+
+#ifdef HAS_FILTERING
+	if(m_time_window_pending)
+	{
+		m_time_window_pending = false;
+		apply_time_window();
+	}
+#endif
+
+	//
+	// Same for the state snapshots: the previous event has been fully
+	// parsed
+	//
+	if(m_state_snapshots && m_state_snapshots->is_due(m_lastevent_ts))
+	{
+		m_state_snapshots->publish(sinsp_state_snapshots::build(this, m_lastevent_ts, m_nevts));
+	}
+
 	//
 	// Check if there are fake cpu events to  events
 	//
@@ -1065,6 +1284,13 @@ int32_t sinsp::next(OUT sinsp_evt **puevt)
 		res = SCAP_SUCCESS;
 		evt = m_container_evt.get();
 	}
+	else if(!m_pending_user_evts.empty())
+	{
+		res = SCAP_SUCCESS;
+		m_user_evt = std::move(m_pending_user_evts.front());
+		m_pending_user_evts.pop_front();
+		evt = m_user_evt.get();
+	}
 	else
 	{
 		evt = &m_evt;
@@ -1128,7 +1354,23 @@ int32_t sinsp::next(OUT sinsp_evt **puevt)
 
 	uint64_t ts = evt->get_ts();
 
-	if(m_firstevent_ts == 0 && evt->m_pevt->type != PPME_CONTAINER_JSON_E)
+#ifdef HAS_FILTERING
+	if(ts > m_time_window_end && ts - m_time_window_end > ORDERED_CAPTURE_SLACK_NS && m_evttype_filter == NULL &&
+		evt->m_pevt->type != PPME_CONTAINER_JSON_E && evt->m_pevt->type != PPME_CONTAINER_BIN_E &&
+		scap_section_is_ordered(m_h))
+	{
+		//
+		// The events of this section of the file are sorted by time: the
+		// filter won't accept any other of them. A capture appended to the
+		// file can still have some.
+		//
+		scap_skip_section(m_h);
+		*puevt = NULL;
+		return SCAP_TIMEOUT;
+	}
+#endif
+
+	if(m_firstevent_ts == 0 && evt->m_pevt->type != PPME_CONTAINER_JSON_E && evt->m_pevt->type != PPME_CONTAINER_BIN_E)
 	{
 		m_firstevent_ts = ts;
 	}
@@ -1213,12 +1455,20 @@ int32_t sinsp::next(OUT sinsp_evt **puevt)
 					" n_drops:%" PRIu64
 					" n_drops_buffer:%" PRIu64
 					" n_drops_pf:%" PRIu64
-					" n_drops_bug:%" PRIu64,
+					" n_drops_bug:%" PRIu64
+					" consumer_cpu:%" PRId32
+					" consumer_node:%" PRId32
+					" n_rings_local:%" PRIu32
+					" n_rings_remote:%" PRIu32,
 					stats.n_evts,
 					stats.n_drops,
 					stats.n_drops_buffer,
 					stats.n_drops_pf,
-					stats.n_drops_bug);
+					stats.n_drops_bug,
+					stats.consumer_cpu,
+					stats.consumer_node,
+					stats.n_rings_local,
+					stats.n_rings_remote);
 			}
 
 			m_next_stats_print_time_ns = ts - (ts % ONE_SECOND_IN_NS) + ONE_SECOND_IN_NS;
@@ -1265,6 +1515,28 @@ int32_t sinsp::next(OUT sinsp_evt **puevt)
 		m_fds_to_remove->clear();
 	}
 
+#if defined(HAS_FILTERING) && defined(HAS_CAPTURE_FILTERING)
+	//
+	// Drop the events that the filter rejects based on their header only,
+	// if they don't change the state. The evttype filters and the analyzer
+	// want to see every event.
+	//
+	if(m_prefilter && m_evttype_filter == NULL &&
+#ifdef HAS_ANALYZER
+		m_analyzer == NULL &&
+#endif
+		m_prefilter->can_skip(evt->m_pevt, evt->m_cpuid))
+	{
+		evt->init();
+		evt->m_filtered_out = true;
+#ifdef GATHER_INTERNAL_STATS
+		m_stats.m_n_prefiltered_evts++;
+#endif
+		*puevt = evt;
+		return SCAP_TIMEOUT;
+	}
+#endif
+
 #ifdef SIMULATE_DROP_MODE
 	bool sd = false;
 	bool sw = false;
@@ -1340,6 +1612,21 @@ int32_t sinsp::next(OUT sinsp_evt **puevt)
 		{
 			throw sinsp_exception(scap_getlasterr(m_h));
 		}
+
+		m_autodump_nevts++;
+
+		if(m_checkpoint_interval_ns != 0)
+		{
+			if(m_next_checkpoint_ts == 0)
+			{
+				m_next_checkpoint_ts = ts + m_checkpoint_interval_ns;
+			}
+			else if(ts >= m_next_checkpoint_ts)
+			{
+				write_checkpoint(m_dumper, ts, m_autodump_nevts);
+				m_next_checkpoint_ts = ts + m_checkpoint_interval_ns;
+			}
+		}
 	}
 
 #if defined(HAS_FILTERING) && defined(HAS_CAPTURE_FILTERING)
@@ -1482,13 +1769,27 @@ threadinfo_map_t::ptr_t sinsp::get_thread_ref(int64_t tid, bool query_os_if_not_
 				}
 			}
 
+			if(m_async_proc_lookup)
+			{
+				//
+				// Go on with a placeholder, merge_async_proc_lookups()
+				// will fill it
+				//
+				if(m_async_proc_lookup->request(tid, scan_sockets))
+				{
+					m_proc_lookup_stats.m_n_requested++;
+				}
+			}
+			else
+			{
 #ifdef HAS_ANALYZER
-			uint64_t ts = sinsp_utils::get_current_time_ns();
+				uint64_t ts = sinsp_utils::get_current_time_ns();
 #endif
-			scap_proc = scap_proc_get(m_h, tid, scan_sockets);
+				scap_proc = scap_proc_get(m_h, tid, scan_sockets);
 #ifdef HAS_ANALYZER
-			m_n_proc_lookups_duration_ns += sinsp_utils::get_current_time_ns() - ts;
+				m_n_proc_lookups_duration_ns += sinsp_utils::get_current_time_ns() - ts;
 #endif
+			}
 		}
 
 		if(scap_proc)
@@ -1534,6 +1835,93 @@ threadinfo_map_t::ptr_t sinsp::get_thread_ref(int64_t tid, bool query_os_if_not_
 	return sinsp_proc;
 }
 
+void sinsp::merge_async_proc_lookups()
+{
+	m_proc_lookup_results.clear();
+	m_async_proc_lookup->get_complete_results(m_proc_lookup_results);
+
+	for(auto& it : m_proc_lookup_results)
+	{
+		int64_t tid = it.first;
+		sinsp_proc_lookup_result& res = it.second;
+
+		m_proc_lookup_stats.m_lookup_ns_total += res.m_lookup_ns;
+		m_proc_lookup_stats.m_lookup_ns_max = max(m_proc_lookup_stats.m_lookup_ns_max, res.m_lookup_ns);
+		m_proc_lookup_stats.m_wait_ns_total += res.m_wait_ns;
+		m_proc_lookup_stats.m_wait_ns_max = max(m_proc_lookup_stats.m_wait_ns_max, res.m_wait_ns);
+
+		if(!res.m_tinfo)
+		{
+			//
+			// Same as a failed synchronous lookup, the placeholder stays
+			//
+			g_logger.format(sinsp_logger::SEV_DEBUG, "async proc lookup failed: %s", res.m_error.c_str());
+			m_proc_lookup_stats.m_n_failed++;
+			continue;
+		}
+
+		//
+		// If the events already told us who this thread is (e.g. with an
+		// execve), or that it's gone, they're more recent than /proc
+		//
+		auto placeholder = find_thread(tid, true);
+		if(!placeholder || placeholder->m_comm != "<NA>")
+		{
+			m_proc_lookup_stats.m_n_discarded++;
+			continue;
+		}
+
+		sinsp_threadinfo* newti = new sinsp_threadinfo(this);
+		newti->init(res.m_tinfo.get());
+
+		scap_update_suppressed_tid(m_h, newti->m_comm.c_str(), tid);
+
+		//
+		// Keep what the events taught us in the meantime: the fds opened
+		// since the placeholder was created, the children and the state
+		// of the syscall in progress
+		//
+		for(auto& fdit : placeholder->m_fdtable.get_table())
+		{
+			if(newti->m_fdtable.find(fdit.first) == NULL)
+			{
+				newti->m_fdtable.add(fdit.first, &fdit.second);
+			}
+		}
+
+		newti->m_nchilds = placeholder->m_nchilds;
+		newti->m_lastevent_fd = placeholder->m_lastevent_fd;
+		newti->m_lastevent_ts = placeholder->m_lastevent_ts;
+		newti->m_prevevent_ts = placeholder->m_prevevent_ts;
+		newti->m_lastaccess_ts = placeholder->m_lastaccess_ts;
+		newti->m_lastevent_type = placeholder->m_lastevent_type;
+		newti->m_lastevent_cpuid = placeholder->m_lastevent_cpuid;
+		newti->m_lastevent_category = placeholder->m_lastevent_category;
+		std::swap(newti->m_lastevent_data, placeholder->m_lastevent_data);
+
+		if(m_thread_manager->add_thread(newti, false))
+		{
+			m_proc_lookup_stats.m_n_merged++;
+		}
+		else
+		{
+			std::swap(newti->m_lastevent_data, placeholder->m_lastevent_data);
+			delete newti;
+			m_proc_lookup_stats.m_n_discarded++;
+		}
+	}
+}
+
+void sinsp::get_proc_lookup_stats(OUT sinsp_proc_lookup_stats* stats)
+{
+	*stats = m_proc_lookup_stats;
+
+	if(m_async_proc_lookup)
+	{
+		stats->m_n_pending = m_async_proc_lookup->get_n_pending();
+	}
+}
+
 sinsp_threadinfo* sinsp::get_thread(int64_t tid)
 {
 	return get_thread(tid, false, true);
@@ -1609,6 +1997,11 @@ void sinsp::set_cri_timeout(int64_t timeout_ms)
 	m_container_manager.set_cri_timeout(timeout_ms);
 }
 
+void sinsp::set_binary_container_evts(bool enable)
+{
+	m_container_manager.set_binary_container_evts(enable);
+}
+
 void sinsp::set_snaplen(uint32_t snaplen)
 {
 	//
@@ -1725,6 +2118,7 @@ void sinsp::set_filter(sinsp_filter* filter)
 	}
 
 	m_filter = filter;
+	init_header_prefilter();
 }
 
 void sinsp::set_filter(const string& filter)
@@ -1738,6 +2132,7 @@ void sinsp::set_filter(const string& filter)
 	sinsp_filter_compiler compiler(this, filter);
 	m_filter = compiler.compile();
 	m_filterstring = filter;
+	init_header_prefilter();
 }
 
 const string sinsp::get_filter()
@@ -1745,6 +2140,97 @@ const string sinsp::get_filter()
 	return m_filterstring;
 }
 
+void sinsp::set_header_prefilter(bool enable)
+{
+	m_prefilter_enabled = enable;
+	init_header_prefilter();
+}
+
+void sinsp::init_header_prefilter()
+{
+	m_prefilter.reset();
+	m_time_window_end = UINT64_MAX;
+
+	if(m_prefilter_enabled && m_filter != NULL)
+	{
+		m_prefilter.reset(new sinsp_header_prefilter(this, m_filter));
+
+		if(!m_prefilter->is_useful())
+		{
+			m_prefilter.reset();
+		}
+	}
+
+	//
+	// The filter can come before or after the file is opened
+	//
+	m_time_window_pending = (m_prefilter != NULL);
+}
+
+//
+// The events out of the time window of the filter are rejected anyway, so
+// the trace file can be read from the last checkpoint before the window,
+// and up to the end of the window only. Unless something wants the
+// rejected events too.
+//
+void sinsp::apply_time_window()
+{
+	uint64_t start;
+	uint64_t end;
+
+	m_time_window_end = UINT64_MAX;
+
+	if(!m_prefilter || !is_capture() || m_isfatfile_enabled || m_isinternal_events_enabled ||
+#ifdef HAS_ANALYZER
+		m_analyzer != NULL ||
+#endif
+		!m_prefilter->get_time_window(&start, &end))
+	{
+		return;
+	}
+
+	m_time_window_end = end;
+
+	//
+	// Seeking reopens the file and compiles the filter string again, only
+	// do it once, on files read from their start
+	//
+	if(start == 0 || m_input_fd != 0 || m_file_start_offset != 0 || m_nevts != 0 || m_filterstring.empty())
+	{
+		return;
+	}
+
+	vector<scap_checkpoint_info> checkpoints;
+	scap_checkpoint_info checkpoint = {0, 0, 0, 0, false};
+
+	get_checkpoints(m_input_filename, &checkpoints);
+
+	//
+	// Only the events of an ordered file are all before the checkpoints
+	// that come after them
+	//
+	for(auto& it : checkpoints)
+	{
+		if(!it.ordered || it.ts + ORDERED_CAPTURE_SLACK_NS >= start)
+		{
+			break;
+		}
+
+		checkpoint = it;
+	}
+
+	if(checkpoint.offset != 0)
+	{
+		g_logger.format(sinsp_logger::SEV_DEBUG, "filter time window starts at %" PRIu64 ", skipping to offset %" PRIu64,
+			start, checkpoint.offset);
+
+		restart_capture_at_filepos(checkpoint.offset);
+		m_nevts = checkpoint.nevts - checkpoint.nstateevts;
+		m_time_window_pending = false;
+		m_time_window_end = end;
+	}
+}
+
 void sinsp::add_evttype_filter(string &name,
 			       set<uint32_t> &evttypes,
 			       set<uint32_t> &syscalls,
@@ -1802,6 +2288,11 @@ scap_userinfo* sinsp::get_user(uint32_t uid)
 	it = m_userlist.find(uid);
 	if(it == m_userlist.end())
 	{
+		if(m_async_user_lookup)
+		{
+			m_async_user_lookup->request_user(uid);
+		}
+
 		return NULL;
 	}
 
@@ -1813,6 +2304,167 @@ const unordered_map<uint32_t, scap_groupinfo*>* sinsp::get_grouplist()
 	return &m_grouplist;
 }
 
+scap_groupinfo* sinsp::get_group(uint32_t gid)
+{
+	unordered_map<uint32_t, scap_groupinfo*>::const_iterator it;
+	if(gid == 0xffffffff)
+	{
+		return NULL;
+	}
+
+	it = m_grouplist.find(gid);
+	if(it == m_grouplist.end())
+	{
+		if(m_async_user_lookup)
+		{
+			m_async_user_lookup->request_group(gid);
+		}
+
+		return NULL;
+	}
+
+	return it->second;
+}
+
+//
+// With the async user lookups scap doesn't know the users, give it the ones
+// the trace file needs: the ones of the threads that go in it, looked up
+// right away if needed, and the ones resolved so far
+//
+void sinsp::export_user_list()
+{
+	if(!m_async_user_lookup)
+	{
+		return;
+	}
+
+	vector<scap_userinfo> users;
+	vector<scap_groupinfo> groups;
+
+	m_thread_manager->m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
+		if(tinfo.m_uid != 0xffffffff)
+		{
+			m_async_user_lookup->get_user_now(tinfo.m_uid);
+		}
+		if(tinfo.m_loginuid >= 0)
+		{
+			m_async_user_lookup->get_user_now((uint32_t)tinfo.m_loginuid);
+		}
+		if(tinfo.m_gid != 0xffffffff)
+		{
+			m_async_user_lookup->get_group_now(tinfo.m_gid);
+		}
+		return true;
+	});
+
+	for(auto& it : m_userlist)
+	{
+		users.push_back(*it.second);
+	}
+
+	for(auto& it : m_grouplist)
+	{
+		groups.push_back(*it.second);
+	}
+
+	if(scap_set_user_list(m_h, users.data(), (uint32_t)users.size(), groups.data(), (uint32_t)groups.size()) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(scap_getlasterr(m_h));
+	}
+}
+
+//
+// Builds an internal event, without thread, with the given parameters
+//
+sinsp_evt* sinsp::new_internal_evt(uint16_t type, uint64_t ts, const vector<pair<const void*, uint16_t>>& params)
+{
+	size_t totlen = sizeof(scap_evt) + params.size() * sizeof(uint16_t);
+	sinsp_evt* evt = new sinsp_evt(this);
+
+	for(auto& it : params)
+	{
+		totlen += it.second;
+	}
+
+	evt->m_pevt_storage = new char[totlen];
+	evt->m_pevt = (scap_evt*)evt->m_pevt_storage;
+	evt->m_cpuid = 0;
+	evt->m_evtnum = 0;
+
+	scap_evt* scapevt = evt->m_pevt;
+	scapevt->ts = ts;
+	scapevt->tid = -1;
+	scapevt->len = (uint32_t)totlen;
+	scapevt->type = type;
+	scapevt->nparams = (uint32_t)params.size();
+
+	uint16_t* lens = (uint16_t*)((char*)scapevt + sizeof(struct ppm_evt_hdr));
+	char* valptr = (char*)(lens + params.size());
+
+	for(auto& it : params)
+	{
+		*lens++ = it.second;
+		memcpy(valptr, it.first, it.second);
+		valptr += it.second;
+	}
+
+	evt->init();
+	return evt;
+}
+
+//
+// The entries resolved after a trace file was opened aren't in its user
+// block: they go out as events, which the dumps write like the other ones
+// and the readers add to their tables
+//
+void sinsp::queue_user_evts()
+{
+	vector<scap_userinfo*> users;
+	vector<scap_groupinfo*> groups;
+	uint64_t ts = m_lastevent_ts? m_lastevent_ts : sinsp_utils::get_current_time_ns();
+
+	m_async_user_lookup->get_new_entries(users, groups);
+
+	for(auto user : users)
+	{
+		m_pending_user_evts.emplace_back(new_internal_evt(PPME_USER_ADDED_E, ts, {
+			{&user->uid, sizeof(uint32_t)},
+			{&user->gid, sizeof(uint32_t)},
+			{user->name, (uint16_t)(strlen(user->name) + 1)},
+			{user->homedir, (uint16_t)(strlen(user->homedir) + 1)},
+			{user->shell, (uint16_t)(strlen(user->shell) + 1)}}));
+	}
+
+	for(auto group : groups)
+	{
+		m_pending_user_evts.emplace_back(new_internal_evt(PPME_GROUP_ADDED_E, ts, {
+			{&group->gid, sizeof(uint32_t)},
+			{group->name, (uint16_t)(strlen(group->name) + 1)}}));
+	}
+}
+
+void sinsp::add_user(const scap_userinfo& user)
+{
+	auto res = m_userlist.emplace(user.uid, nullptr);
+
+	if(res.second)
+	{
+		m_evt_userlist.push_back(user);
+		res.first->second = &m_evt_userlist.back();
+	}
+}
+
+void sinsp::add_group(const scap_groupinfo& group)
+{
+	auto res = m_grouplist.emplace(group.gid, nullptr);
+
+	if(res.second)
+	{
+		m_evt_grouplist.push_back(group);
+		res.first->second = &m_evt_grouplist.back();
+	}
+}
+
 #ifdef HAS_FILTERING
 void sinsp::get_filtercheck_fields_info(OUT vector<const filter_check_info*>* list)
 {
@@ -1871,6 +2523,9 @@ sinsp_stats sinsp::get_stats()
 		m_stats.m_n_preemptions = 0;
 	}
 
+	m_stats.m_n_arena_allocs = m_evt_arena.get_n_allocs();
+	m_stats.m_n_arena_heap_allocs = m_evt_arena.get_n_heap_allocs();
+
 	//
 	// Count the number of threads and fds by scanning the tables,
 	// and update the thread-related stats.
@@ -1910,6 +2565,18 @@ void sinsp::set_log_stderr()
 	g_logger.add_stderr_log();
 }
 
+void sinsp::set_log_async(bool enable)
+{
+	if(enable)
+	{
+		g_logger.enable_async();
+	}
+	else
+	{
+		g_logger.disable_async();
+	}
+}
+
 void sinsp::set_min_log_severity(sinsp_logger::severity sev)
 {
 	g_logger.set_severity(sev);
@@ -2443,6 +3110,42 @@ void sinsp::set_bpf_probe(const string& bpf_probe)
 	m_bpf_probe = bpf_probe;
 }
 
+void sinsp::set_hugepages(scap_hugepages_mode mode)
+{
+	m_hugepages = mode;
+}
+
+void sinsp::set_consumer_placement(int32_t cpu, bool local_alloc)
+{
+	m_consumer_cpu = cpu;
+	m_consumer_local_alloc = local_alloc;
+}
+
+void sinsp::set_unordered_consumption(bool enable)
+{
+	m_unordered_consumption = enable;
+}
+
+void sinsp::set_async_proc_lookups(uint32_t nworkers)
+{
+	m_async_proc_lookup_workers = nworkers;
+}
+
+void sinsp::set_async_user_lookups(bool enable)
+{
+	m_async_user_lookups = enable;
+}
+
+void sinsp::enable_state_snapshots(uint64_t interval_ns)
+{
+	if(m_state_snapshots)
+	{
+		throw sinsp_exception("state snapshots already enabled");
+	}
+
+	m_state_snapshots.reset(new sinsp_state_snapshots(interval_ns));
+}
+
 bool sinsp::is_bpf_enabled()
 {
 	// At the inspector level, bpf can be explicitly enabled via
@@ -95,6 +95,11 @@ using namespace std;
 #include "ifinfo.h"
 #include "eventformatter.h"
 #include "sinsp_pd_callback_type.h"
+#include "async_proc_lookup.h"
+#include "async_user_lookup.h"
+#include "state_snapshot.h"
+#include "arena.h"
+#include "prefilter.h"
 
 class sinsp_partial_transaction;
 class sinsp_parser;
@@ -272,6 +277,37 @@ public:
 	*/
 	void fdopen(int fd);
 
+	/*!
+	  \brief Start reading a trace file from one of its state checkpoints,
+	   with the thread, fd and container tables stored in it.
+
+	  \param filename the trace file name.
+	  \param checkpoint one of the checkpoints returned by
+	   \ref get_checkpoints(). An offset of 0 is the beginning of the file.
+	  \param stop_at_next if true, \ref next() returns SCAP_EOF at the
+	   following checkpoint, so that the chunks of a file can be processed
+	   independently.
+
+	  @throws a sinsp_exception containing the error string is thrown in case
+	   of failure.
+	*/
+	void open_at_checkpoint(const std::string &filename, const scap_checkpoint_info& checkpoint, bool stop_at_next = false);
+
+	/*!
+	  \brief List the state checkpoints of a trace file, see
+	   \ref set_checkpoint_interval().
+	*/
+	static void get_checkpoints(const std::string &filename, OUT std::vector<scap_checkpoint_info>* checkpoints);
+
+	/*!
+	  \brief Restart reading the trace file from the last checkpoint before
+	   ts, or from the beginning of the file if there is none. A checkpoint
+	   comes after the events with its timestamp, so the events at ts are
+	   read too. The state is the one stored in the checkpoint, so the
+	   events before ts show the right process and fd information.
+	*/
+	void seek_to_checkpoint(uint64_t ts);
+
 	void open_nodriver();
 
 	/*!
@@ -384,6 +420,22 @@ public:
 	*/
 	const string get_filter();
 
+	/*!
+	  \brief Enable or disable the evaluation of the filter on the raw event
+	   headers, before parsing. When the filter has conditions on the event
+	   type, direction, cpu, thread id or process id, the events that can't
+	   match it and that don't change the inspector state are dropped
+	   without being parsed. Enabled by default.
+
+	  \note the dropped events don't update the last access time of their
+	   thread.
+	  \note when reading a trace file with a filter that has conditions on
+	   evt.rawtime or evt.around, this also makes the inspector start from
+	   the last state checkpoint before the time window of the filter, and
+	   return SCAP_EOF after the window.
+	*/
+	void set_header_prefilter(bool enable);
+
 	void add_evttype_filter(std::string &name,
 				std::set<uint32_t> &evttypes,
 				std::set<uint32_t> &syscalls,
@@ -411,6 +463,13 @@ public:
 	*/
 	void set_log_stderr();
 
+	/*!
+	  \brief Write the log messages from a background thread, so that
+	   logging doesn't block the event processing. Messages are dropped,
+	   and counted, if they are produced faster than they can be written.
+	*/
+	void set_log_async(bool enable);
+
 	/*!
 	  \brief Specify the minimum severity of the messages that go into the logs
 	   emitted by the library.
@@ -441,6 +500,36 @@ public:
 	*/
 	void autodump_next_file();
 
+	/*!
+	  \brief Write the thread and fd tables at the beginning of the files
+	   of \ref autodump_start() and \ref autodump_next_file() from the
+	   inspector state, instead of rescanning /proc.
+
+	  \note On hosts with many processes the rescan takes seconds, during
+	   which no event is read. The state is as accurate as the events that
+	   built it, so a process that was missed because of drops is missed
+	   in the file too. Ignored when the process table is filtered, see
+	   \ref filter_proc_table_when_saving().
+	*/
+	void set_autodump_from_state(bool enable)
+	{
+		m_autodump_from_state = enable;
+	}
+
+	/*!
+	  \brief Every interval_ns of event time, write a checkpoint with the
+	   thread, fd and container tables into the files of
+	   \ref autodump_start(). A reader can start from any checkpoint with
+	   the right state, see \ref open_at_checkpoint(), while one that
+	   reads the file from the beginning skips them. Readers that predate
+	   the checkpoints reload the state from them. 0, the default,
+	   disables the checkpoints.
+	*/
+	void set_checkpoint_interval(uint64_t interval_ns)
+	{
+		m_checkpoint_interval_ns = interval_ns;
+	}
+
 	/*!
 	  \brief Stops an event dump that was started with \ref autodump_start().
 
@@ -526,6 +615,8 @@ public:
  	  \note this call works with file captures as well, because the user
 	   table is stored in the trace files. In that case, the returned
 	   user list is the one of the machine where the capture happened.
+	   With set_async_user_lookups(), this starts the lookup of a user
+	   that is not in the table yet.
 	*/
 	scap_userinfo* get_user(uint32_t uid);
 
@@ -541,6 +632,17 @@ public:
 	*/
 	const unordered_map<uint32_t, scap_groupinfo*>* get_grouplist();
 
+	/*!
+	  \brief Lookup for group in the group table.
+
+	  \return the \ref scap_groupinfo object containing full group information,
+	   if group not found, returns NULL.
+
+	  \note with set_async_user_lookups(), this starts the lookup of a group
+	   that is not in the table yet.
+	*/
+	scap_groupinfo* get_group(uint32_t gid);
+
 	/*!
 	  \brief Fill the given structure with statistics about the currently
 	   open capture.
@@ -549,6 +651,12 @@ public:
 	*/
 	void get_capture_stats(scap_stats* stats) override;
 
+	/*!
+	  \brief Fill the given structure with the counters and the latencies of
+	   the async /proc lookups, see set_async_proc_lookups().
+	*/
+	void get_proc_lookup_stats(OUT sinsp_proc_lookup_stats* stats);
+
 	void set_max_thread_table_size(uint32_t value);
 
 #ifdef GATHER_INTERNAL_STATS
@@ -864,6 +972,91 @@ public:
 	std::vector<long> get_n_tracepoint_hit();
 	void set_bpf_probe(const std::string& bpf_probe);
 
+	/*!
+	  \brief Back the capture ring buffers, the file read buffer and the
+	   buffers that store the thread enter events with hugepages.
+	   Must be called before open().
+	*/
+	void set_hugepages(scap_hugepages_mode mode);
+
+	/*!
+	  \brief Pin the thread that reads the events (the one calling next())
+	   to the given CPU, and/or make it allocate its memory on the local
+	   NUMA node. The placement is applied by the first next() after open(),
+	   so it follows the consumer thread when it's not the one that opened
+	   the capture. The effective placement is reported by get_capture_stats().
+
+	  \param cpu The CPU to pin the consumer to, -1 to not pin it.
+	  \param local_alloc true to allocate the consumer memory on the NUMA node
+	   it runs on.
+	*/
+	void set_consumer_placement(int32_t cpu, bool local_alloc);
+
+	/*!
+	  \brief Read the events of a live capture one CPU at a time instead of
+	   in global timestamp order. This is faster, and fine for consumers
+	   that don't depend on the order of the events, like counters. The
+	   events that change the thread or fd state are still returned in
+	   order, see scap_set_unordered() for the exact guarantees.
+	   Must be called before open().
+	*/
+	void set_unordered_consumption(bool enable);
+
+	/*!
+	  \brief Look up the threads that show up without a clone or an execve
+	   (e.g. after drops) in /proc on nworkers background threads, instead
+	   of on the thread that processes the events. Until the lookup
+	   completes the thread has a placeholder entry with "<NA>" as comm,
+	   like the ones of the threads that are not in /proc anymore. The
+	   result is merged in the thread table between two events. 0, the
+	   default, reads /proc synchronously.
+	   Must be called before open().
+	*/
+	void set_async_proc_lookups(uint32_t nworkers);
+
+	/*!
+	  \brief Don't enumerate all the users and groups of the machine when a
+	   live capture is opened, which can take very long with LDAP or SSSD
+	   directories. Instead, get_user() and get_group() look up the ids that
+	   are not in the tables on a background thread and return NULL, which
+	   the fields and the event parameters show as "<NA>", until the result
+	   is merged between two events. The ids that don't exist are cached
+	   too. The trace files written in this mode start with the users and
+	   groups of the threads in the table and the ones resolved so far; the
+	   ones resolved later follow as useradded and groupadded internal
+	   events. Must be called before open().
+	*/
+	void set_async_user_lookups(bool enable);
+
+	/*!
+	  \brief Publish a copy of the thread, fd and container state every
+	   interval_ns nanoseconds of event time, and whenever
+	   sinsp_state_snapshots::request() is called. Other threads read the
+	   latest copy through a sinsp_state_snapshots::reader while the events
+	   are processed, without locking the event thread. 0 only publishes
+	   on request. The readers must be gone before the inspector is
+	   destroyed.
+	*/
+	void enable_state_snapshots(uint64_t interval_ns);
+
+	/*!
+	  \brief The publisher of the state snapshots, NULL unless
+	   \ref enable_state_snapshots() was called.
+	*/
+	sinsp_state_snapshots* get_state_snapshots()
+	{
+		return m_state_snapshots.get();
+	}
+
+	/*!
+	  \brief Memory for the temporaries of the current event, see
+	   sinsp_arena. It is reset by \ref next().
+	*/
+	sinsp_arena* get_evt_arena()
+	{
+		return &m_evt_arena;
+	}
+
 	bool is_bpf_enabled();
 
 	static unsigned num_possible_cpus();
@@ -905,6 +1098,11 @@ public:
 	void set_cri_socket_path(const std::string& path);
 	void set_cri_timeout(int64_t timeout_ms);
 
+	// Write the container events (live, and in the trace files) with
+	// the compact binary encoding instead of JSON. Older versions can't
+	// read trace files written this way.
+	void set_binary_container_evts(bool enable);
+
 VISIBILITY_PROTECTED
 	bool add_thread(const sinsp_threadinfo *ptinfo);
 	void set_mode(scap_mode_t value)
@@ -925,6 +1123,7 @@ private:
 
 	void open_int();
 	void init();
+	void write_checkpoint(scap_dumper_t* dumper, uint64_t ts, uint64_t nevts);
 	void import_thread_table();
 	void import_ifaddr_list();
 	void import_user_list();
@@ -1007,6 +1206,18 @@ private:
 
 	void add_suppressed_comms(scap_open_args &oargs);
 
+	void merge_async_proc_lookups();
+	void export_user_list();
+	sinsp_evt* new_internal_evt(uint16_t type, uint64_t ts, const vector<pair<const void*, uint16_t>>& params);
+	void queue_user_evts();
+	void add_user(const scap_userinfo& user);
+	void add_group(const scap_groupinfo& group);
+
+#ifdef HAS_FILTERING
+	void init_header_prefilter();
+	void apply_time_window();
+#endif
+
 	bool increased_snaplen_port_range_set() const
 	{
 		return m_increased_snaplen_port_range.range_start > 0 &&
@@ -1025,6 +1236,13 @@ private:
 	std::string m_input_filename;
 	bool m_bpf;
 	std::string m_bpf_probe;
+	scap_hugepages_mode m_hugepages;
+	int32_t m_consumer_cpu;
+	bool m_consumer_local_alloc;
+	bool m_consumer_placement_pending;
+	bool m_unordered_consumption;
+	uint32_t m_async_proc_lookup_workers;
+	bool m_async_user_lookups;
 	bool m_isdebug_enabled;
 	bool m_isfatfile_enabled;
 	bool m_isinternal_events_enabled;
@@ -1043,6 +1261,10 @@ private:
 	// the statistics analysis engine
 	scap_dumper_t* m_dumper;
 	bool m_is_dumping;
+	bool m_autodump_from_state;
+	uint64_t m_checkpoint_interval_ns;
+	uint64_t m_next_checkpoint_ts;
+	uint64_t m_autodump_nevts;
 	bool m_filter_proc_table_when_saving;
 	const scap_machine_info* m_machine_info;
 	uint32_t m_num_cpus;
@@ -1051,6 +1273,7 @@ private:
 	// This is used to support reading merged files, where the capture needs to
 	// restart in the middle of the file.
 	uint64_t m_file_start_offset;
+	bool m_stop_at_checkpoint;
 	bool m_flush_memory_dump;
 	bool m_large_envs_enabled;
 
@@ -1105,6 +1328,10 @@ public:
 	sinsp_filter* m_filter;
 	sinsp_evttype_filter *m_evttype_filter;
 	std::string m_filterstring;
+	bool m_prefilter_enabled;
+	unique_ptr<sinsp_header_prefilter> m_prefilter;
+	bool m_time_window_pending;
+	uint64_t m_time_window_end;
 
 #endif
 
@@ -1118,6 +1345,11 @@ public:
 	uint64_t m_n_proc_lookups_duration_ns;
 	int32_t m_max_n_proc_lookups = -1;
 	int32_t m_max_n_proc_socket_lookups = -1;
+	unique_ptr<sinsp_async_proc_lookup> m_async_proc_lookup;
+	std::vector<std::pair<int64_t, sinsp_proc_lookup_result>> m_proc_lookup_results;
+	sinsp_proc_lookup_stats m_proc_lookup_stats;
+	unique_ptr<sinsp_state_snapshots> m_state_snapshots;
+	sinsp_arena m_evt_arena;
 #ifdef HAS_ANALYZER
 	std::vector<uint64_t> m_tid_collisions;
 #endif
@@ -1162,6 +1394,10 @@ public:
 	bool m_import_users;
 	unordered_map<uint32_t, scap_userinfo*> m_userlist;
 	unordered_map<uint32_t, scap_groupinfo*> m_grouplist;
+	unique_ptr<sinsp_async_user_lookup> m_async_user_lookup;
+	// The entries that came from useradded/groupadded events
+	deque<scap_userinfo> m_evt_userlist;
+	deque<scap_groupinfo> m_evt_grouplist;
 
 	//
 	// The cycle-writer for files
@@ -1203,6 +1439,11 @@ public:
 	// Holds an event dequeued from the above queue
 	std::shared_ptr<sinsp_evt> m_container_evt;
 
+	// The useradded/groupadded events of the entries resolved since the
+	// last event, and the one being returned
+	std::deque<std::unique_ptr<sinsp_evt>> m_pending_user_evts;
+	std::unique_ptr<sinsp_evt> m_user_evt;
+
 	//
 	// End of second housekeeping
 	//
@@ -33,6 +33,7 @@ limitations under the License.
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
+#include <errno.h>
 
 sinsp_curl_http_headers::sinsp_curl_http_headers():
 	m_curl_header_list(NULL)
@@ -476,5 +477,334 @@ void sinsp_curl::set_body(const string& data)
 	add_header(string("Content-Length: ") + to_string(data.size()));
 }
 
+//
+// sinsp_curl_multi
+//
+
+// Upper bound of a wait, the worker is woken up by the new requests anyway
+#define CURL_MULTI_MAX_WAIT_MS 1000
+
+sinsp_curl_multi::request::request(const uri& url, long timeout_ms):
+	m_url(url),
+	m_timeout_ms(timeout_ms)
+{
+}
+
+sinsp_curl_multi::response::response():
+	m_result(CURLE_OK),
+	m_response_code(-1)
+{
+}
+
+sinsp_curl_multi::transfer::transfer(const request& req, callback_t callback):
+	m_request(req),
+	m_callback(callback),
+	m_curl(curl_easy_init())
+{
+	if(!m_curl)
+	{
+		throw sinsp_exception("Cannot initialize CURL.");
+	}
+
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_URL, m_request.m_url.to_string().c_str()));
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_NOSIGNAL, 1L));
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_ACCEPT_ENCODING, "deflate"));
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_CONNECTTIMEOUT_MS, m_request.m_timeout_ms));
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_TIMEOUT_MS, m_request.m_timeout_ms));
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_WRITEFUNCTION, &sinsp_curl_multi::write_data));
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_WRITEDATA, &m_response.m_data));
+#if LIBCURL_VERSION_MAJOR >= 7 && LIBCURL_VERSION_MINOR >= 25
+	sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_TCP_KEEPALIVE, 1L));
+#endif // LIBCURL_VERSION_MAJOR >= 7 && LIBCURL_VERSION_MINOR >= 25
+
+	if(!m_request.m_body.empty())
+	{
+		sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDSIZE, (long)m_request.m_body.size()));
+		sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDS, m_request.m_body.c_str()));
+	}
+
+	for(const auto& header : m_request.m_headers)
+	{
+		m_headers.add(header);
+	}
+
+	//
+	// A single header list can be set, so the token is added to ours
+	// instead of using the one of the token
+	//
+	if(m_request.m_bt && !m_request.m_bt->get_token().empty())
+	{
+		m_headers.add("Authorization: Bearer " + m_request.m_bt->get_token());
+	}
+
+	if(m_headers.ptr() != NULL)
+	{
+		sinsp_curl::check_error(curl_easy_setopt(m_curl.get(), CURLOPT_HTTPHEADER, m_headers.ptr()));
+	}
+
+	sinsp_curl::init_ssl(m_curl.get(), m_request.m_ssl);
+}
+
+sinsp_curl_multi::sinsp_curl_multi(long max_host_connections, long max_connections):
+	m_curlm(curl_multi_init()),
+	m_stop(false)
+{
+	if(!m_curlm)
+	{
+		throw sinsp_exception("Cannot initialize CURL multi handle.");
+	}
+
+	if(pipe2(m_wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0)
+	{
+		curl_multi_cleanup(m_curlm);
+		throw sinsp_exception(std::string("Cannot create CURL multi wake up pipe: ") + strerror(errno));
+	}
+
+	curl_multi_setopt(m_curlm, CURLMOPT_MAX_HOST_CONNECTIONS, max_host_connections);
+	curl_multi_setopt(m_curlm, CURLMOPT_MAXCONNECTS, max_connections);
+}
+
+sinsp_curl_multi::~sinsp_curl_multi()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	if(m_thread.joinable())
+	{
+		wake();
+		m_thread.join();
+	}
+
+	curl_multi_cleanup(m_curlm);
+	close(m_wake_pipe[0]);
+	close(m_wake_pipe[1]);
+}
+
+void sinsp_curl_multi::add_request(const request& req, callback_t callback)
+{
+	std::unique_ptr<transfer> t(new transfer(req, callback));
+
+	g_logger.log("CURL multi: requesting " + req.m_url.to_string(false), sinsp_logger::SEV_DEBUG);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if(m_stop)
+		{
+			throw sinsp_exception("CURL multi: request added while stopping");
+		}
+
+		m_queue.push_back(std::move(t));
+
+		//
+		// Started at the first request, most of these objects are never
+		// used
+		//
+		if(!m_thread.joinable())
+		{
+			m_thread = std::thread(&sinsp_curl_multi::run, this);
+		}
+	}
+
+	wake();
+}
+
+std::future<sinsp_curl_multi::response> sinsp_curl_multi::start(const request& req)
+{
+	std::shared_ptr<std::promise<response>> promise(new std::promise<response>());
+
+	add_request(req, [promise](const response& res)
+	{
+		promise->set_value(res);
+	});
+
+	return promise->get_future();
+}
+
+sinsp_curl_multi::response sinsp_curl_multi::perform(const request& req)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if(std::this_thread::get_id() == m_thread.get_id())
+		{
+			throw sinsp_exception("CURL multi: perform() called from a callback");
+		}
+	}
+
+	return start(req).get();
+}
+
+void sinsp_curl_multi::wake()
+{
+	char c = 0;
+
+	//
+	// If the pipe is full, the worker has a wake up pending already
+	//
+	if(write(m_wake_pipe[1], &c, 1) < 0 && errno != EAGAIN)
+	{
+		g_logger.format(sinsp_logger::SEV_ERROR, "CURL multi: cannot wake up the worker: %s", strerror(errno));
+	}
+}
+
+size_t sinsp_curl_multi::write_data(void* ptr, size_t size, size_t nmemb, void* cb)
+{
+	reinterpret_cast<std::string*>(cb)->append(reinterpret_cast<const char*>(ptr), size * nmemb);
+	return size * nmemb;
+}
+
+void sinsp_curl_multi::complete(transfer* t, CURLcode result)
+{
+	response& res = t->m_response;
+	char* redirect = NULL;
+
+	res.m_result = result;
+
+	if(result == CURLE_OK)
+	{
+		curl_easy_getinfo(t->m_curl.get(), CURLINFO_RESPONSE_CODE, &res.m_response_code);
+
+		if(curl_easy_getinfo(t->m_curl.get(), CURLINFO_REDIRECT_URL, &redirect) == CURLE_OK && redirect != NULL)
+		{
+			res.m_redirect = redirect;
+		}
+	}
+	else
+	{
+		g_logger.log("CURL multi: request to " + t->m_request.m_url.to_string(false) + " failed: " +
+			curl_easy_strerror(result), sinsp_logger::SEV_DEBUG);
+	}
+
+	try
+	{
+		t->m_callback(res);
+	}
+	catch(const std::exception& e)
+	{
+		g_logger.format(sinsp_logger::SEV_ERROR, "CURL multi: request callback error: %s", e.what());
+	}
+}
+
+void sinsp_curl_multi::run()
+{
+	std::vector<std::unique_ptr<transfer>> added;
+
+	while(true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if(m_stop)
+			{
+				break;
+			}
+
+			added.swap(m_queue);
+		}
+
+		for(auto& t : added)
+		{
+			CURLMcode mres = curl_multi_add_handle(m_curlm, t->m_curl.get());
+
+			if(mres != CURLM_OK)
+			{
+				g_logger.format(sinsp_logger::SEV_ERROR, "CURL multi: cannot add the request: %s",
+					curl_multi_strerror(mres));
+				complete(t.get(), CURLE_FAILED_INIT);
+				continue;
+			}
+
+			CURL* curl = t->m_curl.get();
+			m_running[curl] = std::move(t);
+		}
+		added.clear();
+
+		int still_running;
+		CURLMcode pres = curl_multi_perform(m_curlm, &still_running);
+
+		//
+		// Nothing would ever complete, the waiters get an error instead
+		//
+		if(pres != CURLM_OK && pres != CURLM_CALL_MULTI_PERFORM)
+		{
+			g_logger.format(sinsp_logger::SEV_ERROR, "CURL multi: cannot perform the requests: %s",
+				curl_multi_strerror(pres));
+
+			for(auto& it : m_running)
+			{
+				curl_multi_remove_handle(m_curlm, it.first);
+				complete(it.second.get(), CURLE_FAILED_INIT);
+			}
+			m_running.clear();
+		}
+
+		CURLMsg* msg;
+		int nmsgs;
+
+		while((msg = curl_multi_info_read(m_curlm, &nmsgs)) != NULL)
+		{
+			if(msg->msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+
+			auto it = m_running.find(msg->easy_handle);
+
+			if(it == m_running.end())
+			{
+				ASSERT(false);
+				continue;
+			}
+
+			//
+			// The message is gone once the handle is removed
+			//
+			CURLcode result = msg->data.result;
+			std::unique_ptr<transfer> t(std::move(it->second));
+
+			m_running.erase(it);
+			curl_multi_remove_handle(m_curlm, t->m_curl.get());
+			complete(t.get(), result);
+		}
+
+		struct curl_waitfd wake_fd;
+		int numfds;
+		char buf[64];
+
+		wake_fd.fd = m_wake_pipe[0];
+		wake_fd.events = CURL_WAIT_POLLIN;
+		wake_fd.revents = 0;
+
+		curl_multi_wait(m_curlm, &wake_fd, 1, CURL_MULTI_MAX_WAIT_MS, &numfds);
+
+		while(read(m_wake_pipe[0], buf, sizeof(buf)) > 0)
+		{
+		}
+	}
+
+	//
+	// The waiters must not be left hanging
+	//
+	for(auto& it : m_running)
+	{
+		curl_multi_remove_handle(m_curlm, it.first);
+		complete(it.second.get(), CURLE_ABORTED_BY_CALLBACK);
+	}
+	m_running.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		added.swap(m_queue);
+	}
+
+	for(auto& t : added)
+	{
+		complete(t.get(), CURLE_ABORTED_BY_CALLBACK);
+	}
+}
+
 #endif // __linux__
 
@@ -33,6 +33,12 @@ limitations under the License.
 #include "curl/curl.h"
 #include <string>
 #include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 class sinsp_curl_http_headers
 {
@@ -182,4 +188,95 @@ inline sinsp_curl::bearer_token::ptr_t sinsp_curl::get_bt()
 	return m_bt;
 }
 
+//
+// Runs the requests in parallel on a worker thread, on a curl multi handle.
+// The connections are kept open between the requests and reused for the
+// ones to the same endpoint, up to max_host_connections per host.
+//
+class sinsp_curl_multi
+{
+public:
+	static const long DEFAULT_MAX_HOST_CONNECTIONS = 4L;
+	static const long DEFAULT_MAX_CONNECTIONS = 32L;
+
+	struct request
+	{
+		request(const uri& url, long timeout_ms = sinsp_curl::DEFAULT_TIMEOUT_MS);
+
+		uri m_url;
+		// A POST if not empty
+		std::string m_body;
+		std::vector<std::string> m_headers;
+		long m_timeout_ms;
+		sinsp_ssl::ptr_t m_ssl;
+		sinsp_bearer_token::ptr_t m_bt;
+	};
+
+	struct response
+	{
+		response();
+
+		CURLcode m_result;
+		// HTTP errors are not curl errors, they are only in the code
+		long m_response_code;
+		std::string m_data;
+		// Absolute, if the response is a redirect
+		std::string m_redirect;
+	};
+
+	//
+	// Called on the worker thread, so it must not block, nor wait for
+	// another request
+	//
+	typedef std::function<void(const response&)> callback_t;
+
+	sinsp_curl_multi(long max_host_connections = DEFAULT_MAX_HOST_CONNECTIONS,
+		long max_connections = DEFAULT_MAX_CONNECTIONS);
+	~sinsp_curl_multi();
+
+	//
+	// Can be called from any thread. The requests still running when this
+	// object goes away complete with CURLE_ABORTED_BY_CALLBACK
+	//
+	void add_request(const request& req, callback_t callback);
+	std::future<response> start(const request& req);
+	response perform(const request& req);
+
+private:
+	struct curl_easy_deleter
+	{
+		void operator()(CURL* curl) const
+		{
+			curl_easy_cleanup(curl);
+		}
+	};
+
+	struct transfer
+	{
+		transfer(const request& req, callback_t callback);
+
+		request m_request;
+		callback_t m_callback;
+		sinsp_curl_http_headers m_headers;
+		response m_response;
+		// Last, so that it goes away before what it points to
+		std::unique_ptr<CURL, curl_easy_deleter> m_curl;
+	};
+
+	static size_t write_data(void* ptr, size_t size, size_t nmemb, void* cb);
+	static void complete(transfer* t, CURLcode result);
+
+	void run();
+	void wake();
+
+	CURLM* m_curlm;
+	int m_wake_pipe[2];
+	std::thread m_thread;
+	std::mutex m_mutex;
+	bool m_stop;
+	// Protected by m_mutex, moved to m_running by the worker
+	std::vector<std::unique_ptr<transfer>> m_queue;
+	std::unordered_map<CURL*, std::unique_ptr<transfer>> m_running;
+};
+
 #endif // __linux__
@@ -0,0 +1,294 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "sinsp_curl.h"
+
+#define SLOW_RESPONSE_MS 500
+
+//
+// A keep-alive HTTP server on the loopback. It answers with the method,
+// the path and the body of the request, after SLOW_RESPONSE_MS for
+// "/slow"; "/hang" never gets an answer and "/redirect" goes to "/a"
+//
+class http_stand_in
+{
+public:
+	http_stand_in():
+		m_connections(0),
+		m_stop(false)
+	{
+		struct sockaddr_in addr = {};
+		socklen_t len = sizeof(addr);
+
+		m_fd = socket(AF_INET, SOCK_STREAM, 0);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if(m_fd < 0 ||
+		   bind(m_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+		   listen(m_fd, 16) != 0 ||
+		   getsockname(m_fd, (struct sockaddr*)&addr, &len) != 0)
+		{
+			throw sinsp_exception("cannot start the HTTP stand-in");
+		}
+
+		m_url = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+		m_accept_thread = std::thread(&http_stand_in::accept_loop, this);
+	}
+
+	~http_stand_in()
+	{
+		m_stop = true;
+		m_accept_thread.join();
+
+		for(auto& t : m_threads)
+		{
+			t.join();
+		}
+
+		close(m_fd);
+	}
+
+	std::string url(const std::string& path) const
+	{
+		return m_url + path;
+	}
+
+	uint32_t get_connections() const
+	{
+		return m_connections;
+	}
+
+private:
+	bool wait_readable(int fd)
+	{
+		struct pollfd pfd = {fd, POLLIN, 0};
+
+		while(!m_stop)
+		{
+			if(poll(&pfd, 1, 50) > 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void accept_loop()
+	{
+		while(wait_readable(m_fd))
+		{
+			int fd = accept(m_fd, NULL, NULL);
+
+			if(fd >= 0)
+			{
+				m_connections++;
+				m_threads.emplace_back(&http_stand_in::serve, this, fd);
+			}
+		}
+	}
+
+	void serve(int fd)
+	{
+		std::string in;
+		char buf[4096];
+
+		while(wait_readable(fd))
+		{
+			ssize_t n = read(fd, buf, sizeof(buf));
+
+			if(n <= 0)
+			{
+				break;
+			}
+
+			in.append(buf, n);
+
+			std::string::size_type end = in.find("\r\n\r\n");
+
+			if(end == std::string::npos)
+			{
+				continue;
+			}
+
+			size_t body_len = 0;
+			std::string::size_type cl = in.find("Content-Length: ");
+
+			if(cl != std::string::npos && cl < end)
+			{
+				body_len = std::stoul(in.substr(cl + 16));
+			}
+
+			if(in.size() < end + 4 + body_len)
+			{
+				continue;
+			}
+
+			std::string method = in.substr(0, in.find(' '));
+			std::string path = in.substr(method.size() + 1, in.find(' ', method.size() + 1) - method.size() - 1);
+			std::string body = method + " " + path + in.substr(end + 4, body_len);
+			std::string status = "200 OK";
+			std::string headers;
+
+			in.erase(0, end + 4 + body_len);
+
+			if(path == "/hang")
+			{
+				continue;
+			}
+			else if(path == "/slow")
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(SLOW_RESPONSE_MS));
+			}
+			else if(path == "/redirect")
+			{
+				status = "302 Found";
+				headers = "Location: /a\r\n";
+			}
+
+			std::string out = "HTTP/1.1 " + status + "\r\n" + headers +
+				"Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+			if(write(fd, out.data(), out.size()) != (ssize_t)out.size())
+			{
+				break;
+			}
+		}
+
+		close(fd);
+	}
+
+	int m_fd;
+	std::string m_url;
+	std::atomic<uint32_t> m_connections;
+	std::atomic<bool> m_stop;
+	std::thread m_accept_thread;
+	// The connections, only the accept thread adds to it
+	std::vector<std::thread> m_threads;
+};
+
+static uint64_t elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(sinsp_curl_multi, reuse)
+{
+	http_stand_in server;
+	sinsp_curl_multi curl_multi;
+
+	for(uint32_t j = 0; j < 5; j++)
+	{
+		sinsp_curl_multi::response res = curl_multi.perform(sinsp_curl_multi::request(server.url("/a")));
+
+		EXPECT_EQ(CURLE_OK, res.m_result);
+		EXPECT_EQ(200, res.m_response_code);
+		EXPECT_EQ("GET /a", res.m_data);
+	}
+
+	sinsp_curl_multi::request req(server.url("/b"));
+	req.m_body = "{\"uid\":\"x\"}";
+	req.m_headers.push_back("Content-Type: application/json");
+	sinsp_curl_multi::response res = curl_multi.perform(req);
+	EXPECT_EQ("POST /b{\"uid\":\"x\"}", res.m_data);
+
+	res = curl_multi.perform(sinsp_curl_multi::request(server.url("/redirect")));
+	EXPECT_EQ(302, res.m_response_code);
+	EXPECT_EQ(server.url("/a"), res.m_redirect);
+
+	EXPECT_EQ(1u, server.get_connections());
+}
+
+TEST(sinsp_curl_multi, parallel)
+{
+	const uint32_t nrequests = 4;
+	http_stand_in server;
+	sinsp_curl_multi curl_multi(nrequests);
+	std::vector<std::future<sinsp_curl_multi::response>> responses;
+	auto start = std::chrono::steady_clock::now();
+
+	for(uint32_t j = 0; j < nrequests; j++)
+	{
+		responses.push_back(curl_multi.start(sinsp_curl_multi::request(server.url("/slow"))));
+	}
+
+	for(auto& f : responses)
+	{
+		EXPECT_EQ("GET /slow", f.get().m_data);
+	}
+
+	EXPECT_LT(elapsed_ms(start), 2 * SLOW_RESPONSE_MS);
+	EXPECT_EQ(nrequests, server.get_connections());
+}
+
+TEST(sinsp_curl_multi, timeout)
+{
+	http_stand_in server;
+	sinsp_curl_multi curl_multi;
+	std::atomic<bool> on_worker(false);
+	std::thread::id main_id = std::this_thread::get_id();
+	auto start = std::chrono::steady_clock::now();
+
+	std::future<sinsp_curl_multi::response> hung = curl_multi.start(sinsp_curl_multi::request(server.url("/hang"), 1000));
+
+	//
+	// The answered requests don't wait for the one that is not
+	//
+	std::promise<sinsp_curl_multi::response> done;
+	curl_multi.add_request(sinsp_curl_multi::request(server.url("/a")), [&](const sinsp_curl_multi::response& res)
+	{
+		on_worker = (std::this_thread::get_id() != main_id);
+		done.set_value(res);
+	});
+
+	EXPECT_EQ("GET /a", done.get_future().get().m_data);
+	EXPECT_LT(elapsed_ms(start), 500u);
+	EXPECT_TRUE(on_worker);
+
+	EXPECT_EQ(CURLE_OPERATION_TIMEDOUT, hung.get().m_result);
+	EXPECT_GE(elapsed_ms(start), 1000u);
+}
+
+TEST(sinsp_curl_multi, abort)
+{
+	http_stand_in server;
+	std::future<sinsp_curl_multi::response> hung;
+	auto start = std::chrono::steady_clock::now();
+
+	{
+		sinsp_curl_multi curl_multi;
+
+		hung = curl_multi.start(sinsp_curl_multi::request(server.url("/hang"), 10000));
+	}
+
+	EXPECT_EQ(CURLE_ABORTED_BY_CALLBACK, hung.get().m_result);
+	EXPECT_LT(elapsed_ms(start), 5000u);
+}
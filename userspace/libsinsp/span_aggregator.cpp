@@ -0,0 +1,279 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <algorithm>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "tracers.h"
+#include "span_aggregator.h"
+
+#define SPAN_AGGREGATOR_PRUNED_FRAME ";[pruned]"
+
+sinsp_span_aggregator::sinsp_span_aggregator(sinsp* inspector, uint32_t max_nodes):
+	m_root(NULL, NULL),
+	m_max_nodes(max_nodes),
+	m_num_nodes(0),
+	m_num_spans(0),
+	m_num_pruned_nodes(0)
+{
+	if(inspector != NULL)
+	{
+		//
+		// Without it the exit events are not matched to their enter events
+		// and there's no duration
+		//
+		inspector->request_tracer_state_tracking();
+	}
+}
+
+sinsp_span_aggregator::~sinsp_span_aggregator()
+{
+}
+
+void sinsp_span_aggregator::process_event(sinsp_evt* evt)
+{
+	if(evt->get_type() != PPME_TRACER_X)
+	{
+		return;
+	}
+
+	sinsp_threadinfo* tinfo = evt->get_thread_info();
+
+	if(tinfo == NULL || tinfo->m_tracer_parser == NULL)
+	{
+		return;
+	}
+
+	sinsp_tracerparser* eparser = tinfo->m_tracer_parser;
+	sinsp_partial_tracer* pae = eparser->m_enter_pae;
+
+	if(pae == NULL)
+	{
+		return;
+	}
+
+	int64_t duration = eparser->m_exit_pae.m_time - pae->m_time;
+
+	if(duration < 0)
+	{
+		ASSERT(false);
+		duration = 0;
+	}
+
+	add_span(eparser->m_tags, duration);
+}
+
+void sinsp_span_aggregator::add_span(const vector<char*>& tags, uint64_t duration_ns)
+{
+	span_node* node = &m_root;
+	size_t depth = MIN(tags.size(), (size_t)SPAN_AGGREGATOR_MAX_DEPTH);
+
+	if(depth == 0)
+	{
+		return;
+	}
+
+	for(size_t j = 0; j < depth; j++)
+	{
+		m_key.assign(tags[j]);
+
+		auto it = node->m_children.find(m_key);
+
+		if(it == node->m_children.end())
+		{
+			it = node->m_children.emplace(m_key, nullptr).first;
+			it->second.reset(new span_node(node, &it->first));
+			m_num_nodes++;
+		}
+
+		node = it->second.get();
+	}
+
+	//
+	// Only the span's own node gets the time, the parent spans have their
+	// own exit events
+	//
+	node->m_total_ns += duration_ns;
+	node->m_count++;
+	m_num_spans++;
+
+	if(m_num_nodes > m_max_nodes)
+	{
+		prune();
+	}
+}
+
+//
+// The time of a node without children, some of which can have been pruned
+//
+uint64_t sinsp_span_aggregator::get_leaf_ns(const span_node* leaf)
+{
+	return MAX(leaf->m_total_ns, leaf->m_pruned_ns);
+}
+
+void sinsp_span_aggregator::collect_leaves(span_node* node, vector<span_node*>* leaves)
+{
+	for(auto& it : node->m_children)
+	{
+		span_node* child = it.second.get();
+
+		if(child->m_children.empty())
+		{
+			leaves->push_back(child);
+		}
+		else
+		{
+			collect_leaves(child, leaves);
+		}
+	}
+}
+
+void sinsp_span_aggregator::prune()
+{
+	//
+	// Go well below the limit, so that the tree is not walked again at the
+	// next new path
+	//
+	uint32_t target = m_max_nodes - m_max_nodes / 4;
+	vector<span_node*> leaves;
+
+	while(m_num_nodes > target)
+	{
+		uint32_t nremove = m_num_nodes - target;
+
+		leaves.clear();
+		collect_leaves(&m_root, &leaves);
+
+		if(leaves.size() > nremove)
+		{
+			nth_element(leaves.begin(), leaves.begin() + nremove, leaves.end(),
+				[](const span_node* a, const span_node* b)
+				{
+					return get_leaf_ns(a) < get_leaf_ns(b);
+				});
+
+			leaves.resize(nremove);
+		}
+
+		//
+		// Removing a leaf can turn its parent into a leaf, which is
+		// considered at the next pass
+		//
+		for(span_node* leaf : leaves)
+		{
+			span_node* parent = leaf->m_parent;
+
+			parent->m_pruned_ns += get_leaf_ns(leaf);
+			parent->m_children.erase(parent->m_children.find(*leaf->m_name));
+			m_num_nodes--;
+			m_num_pruned_nodes++;
+		}
+	}
+}
+
+uint64_t sinsp_span_aggregator::dump_node(ostream& os, const span_node* node, string* path) const
+{
+	size_t pathlen = path->size();
+	uint64_t children_ns = 0;
+	vector<const span_node*> children;
+
+	if(node != &m_root)
+	{
+		if(pathlen != 0)
+		{
+			path->push_back(';');
+		}
+
+		//
+		// The frame separators and the line breaks can't appear in the
+		// frame names
+		//
+		for(const char* p = node->m_name->c_str(); *p != 0; p++)
+		{
+			path->push_back((*p == ';' || *p == '\n' || *p == '\r') ? '_' : *p);
+		}
+	}
+
+	//
+	// Sorted, so that the same capture always gives the same output
+	//
+	children.reserve(node->m_children.size());
+
+	for(auto& it : node->m_children)
+	{
+		children.push_back(it.second.get());
+	}
+
+	sort(children.begin(), children.end(),
+		[](const span_node* a, const span_node* b)
+		{
+			return *a->m_name < *b->m_name;
+		});
+
+	for(const span_node* child : children)
+	{
+		children_ns += dump_node(os, child, path);
+	}
+
+	//
+	// The children can take longer than the parent if they run in parallel
+	// or outlive it, and a path can have no span of its own, e.g. "a.b" when
+	// there are only "a.b.c" spans
+	//
+	uint64_t used_ns = children_ns + node->m_pruned_ns;
+	uint64_t self_ns = (node->m_total_ns > used_ns)? node->m_total_ns - used_ns : 0;
+
+	if(self_ns != 0)
+	{
+		os << *path << ' ' << self_ns << '\n';
+	}
+
+	if(node->m_pruned_ns != 0)
+	{
+		if(node == &m_root)
+		{
+			os << (SPAN_AGGREGATOR_PRUNED_FRAME + 1) << ' ' << node->m_pruned_ns << '\n';
+		}
+		else
+		{
+			os << *path << SPAN_AGGREGATOR_PRUNED_FRAME << ' ' << node->m_pruned_ns << '\n';
+		}
+	}
+
+	path->resize(pathlen);
+
+	return MAX(node->m_total_ns, used_ns);
+}
+
+void sinsp_span_aggregator::dump_collapsed(ostream& os) const
+{
+	string path;
+
+	dump_node(os, &m_root, &path);
+	os.flush();
+}
+
+void sinsp_span_aggregator::clear()
+{
+	m_root.m_children.clear();
+	m_root.m_pruned_ns = 0;
+	m_num_nodes = 0;
+	m_num_spans = 0;
+	m_num_pruned_nodes = 0;
+}
@@ -0,0 +1,120 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+class sinsp;
+class sinsp_evt;
+
+#define SPAN_AGGREGATOR_DEFAULT_MAX_NODES 65536
+#define SPAN_AGGREGATOR_MAX_DEPTH 256
+
+//
+// Folds the tracer spans into a tree keyed by their tag path, e.g. the span
+// "a.b.c" goes into the node a -> b -> c, which keeps the sum of the
+// durations and the number of the spans with that path. The span id is not
+// part of the key, so all the transactions of the same kind end up in the
+// same branch.
+//
+// The number of nodes is bounded: when it goes over the limit, the leaves
+// with the smallest total time are removed and their time is accounted to
+// a "[pruned]" child of their parent, so the totals stay right.
+//
+class sinsp_span_aggregator
+{
+public:
+	//
+	// inspector can be NULL if the spans are only fed with add_span()
+	//
+	sinsp_span_aggregator(sinsp* inspector, uint32_t max_nodes = SPAN_AGGREGATOR_DEFAULT_MAX_NODES);
+	~sinsp_span_aggregator();
+
+	//
+	// Adds the span closed by the event, if it's a tracer exit matched to
+	// its enter event
+	//
+	void process_event(sinsp_evt* evt);
+	void add_span(const std::vector<char*>& tags, uint64_t duration_ns);
+
+	//
+	// Writes one "tag;tag;tag self_time_ns" line per node, the collapsed
+	// stack format that flamegraph.pl and most flame graph viewers take
+	//
+	void dump_collapsed(std::ostream& os) const;
+
+	void clear();
+
+	inline uint32_t get_num_nodes() const
+	{
+		return m_num_nodes;
+	}
+
+	inline uint64_t get_num_spans() const
+	{
+		return m_num_spans;
+	}
+
+	inline uint64_t get_num_pruned_nodes() const
+	{
+		return m_num_pruned_nodes;
+	}
+
+private:
+	struct span_node
+	{
+		span_node(span_node* parent, const std::string* name):
+			m_parent(parent),
+			m_name(name),
+			m_total_ns(0),
+			m_pruned_ns(0),
+			m_count(0)
+		{
+		}
+
+		span_node* m_parent;
+		// Points to the key in the parent's children table
+		const std::string* m_name;
+		uint64_t m_total_ns;
+		// The time of the removed children
+		uint64_t m_pruned_ns;
+		uint64_t m_count;
+		std::unordered_map<std::string, std::unique_ptr<span_node>> m_children;
+	};
+
+	static uint64_t get_leaf_ns(const span_node* leaf);
+	void prune();
+	void collect_leaves(span_node* node, std::vector<span_node*>* leaves);
+	// Returns the time of the node, including the children's
+	uint64_t dump_node(std::ostream& os, const span_node* node, std::string* path) const;
+
+	span_node m_root;
+	uint32_t m_max_nodes;
+	uint32_t m_num_nodes;
+	uint64_t m_num_spans;
+	uint64_t m_num_pruned_nodes;
+	// Reused for the lookups, to avoid an allocation per tag
+	std::string m_key;
+};
@@ -0,0 +1,324 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "span_aggregator.h"
+#include "../../driver/ppm_events_public.h"
+
+// Not in the fd table, so the writes are taken as tracers by the dump flag
+#define TRACER_FD 1000000
+
+//
+// A trace file made of the processes of this machine followed by tracer
+// writes of this process, like the ones sysdig saves
+//
+class tracer_capture
+{
+public:
+	tracer_capture():
+		m_ts(1000000000)
+	{
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_open_args oargs = {};
+		oargs.mode = SCAP_MODE_NODRIVER;
+		oargs.import_users = true;
+
+		char path[] = "/tmp/sinsp_span_aggregator_testXXXXXX";
+		int fd = mkstemp(path);
+		::close(fd);
+		m_filename = path;
+
+		m_h = scap_open(oargs, error, &rc);
+		if(m_h == NULL)
+		{
+			throw sinsp_exception(error);
+		}
+
+		m_dumper = scap_dump_open(m_h, m_filename.c_str(), SCAP_COMPRESSION_NONE, false);
+		if(m_dumper == NULL)
+		{
+			throw sinsp_exception(scap_getlasterr(m_h));
+		}
+	}
+
+	~tracer_capture()
+	{
+		unlink(m_filename.c_str());
+	}
+
+	void close()
+	{
+		scap_dump_close(m_dumper);
+		scap_close(m_h);
+	}
+
+	const std::string& get_filename() const
+	{
+		return m_filename;
+	}
+
+	//
+	// Writes a tracer string, e.g. ">:1:a.b::", delta ns after the previous
+	// one
+	//
+	void tracer(const std::string& str, uint64_t delta)
+	{
+		int64_t fd = TRACER_FD;
+		uint32_t size = (uint32_t)str.length();
+		int64_t res = size;
+
+		m_ts += delta;
+
+		begin(PPME_SYSCALL_WRITE_E);
+		add(&fd, sizeof(fd));
+		add(&size, sizeof(size));
+		end();
+
+		begin(PPME_SYSCALL_WRITE_X);
+		add(&res, sizeof(res));
+		add(str.c_str(), str.length());
+		end();
+	}
+
+private:
+	void begin(uint16_t type)
+	{
+		m_hdr.ts = m_ts;
+		m_hdr.tid = getpid();
+		m_hdr.type = type;
+		m_lens.clear();
+		m_data.clear();
+	}
+
+	void add(const void* val, size_t len)
+	{
+		m_lens.push_back((uint16_t)len);
+		m_data.append((const char*)val, len);
+	}
+
+	void end()
+	{
+		std::string evt;
+
+		m_hdr.nparams = (uint32_t)m_lens.size();
+		m_hdr.len = (uint32_t)(sizeof(m_hdr) + m_lens.size() * sizeof(uint16_t) + m_data.length());
+
+		evt.append((const char*)&m_hdr, sizeof(m_hdr));
+		evt.append((const char*)m_lens.data(), m_lens.size() * sizeof(uint16_t));
+		evt.append(m_data);
+
+		if(scap_dump(m_h, m_dumper, (scap_evt*)evt.data(), 0, SCAP_DF_TRACER) != SCAP_SUCCESS)
+		{
+			throw sinsp_exception(scap_getlasterr(m_h));
+		}
+	}
+
+	scap_t* m_h;
+	scap_dumper_t* m_dumper;
+	std::string m_filename;
+	uint64_t m_ts;
+	scap_evt m_hdr;
+	std::vector<uint16_t> m_lens;
+	std::string m_data;
+};
+
+static void add_span(sinsp_span_aggregator* aggregator, std::string path, uint64_t duration)
+{
+	std::vector<char*> tags;
+
+	for(char* tag = strtok(&path[0], "."); tag != NULL; tag = strtok(NULL, "."))
+	{
+		tags.push_back(tag);
+	}
+
+	aggregator->add_span(tags, duration);
+}
+
+static std::string dump(const sinsp_span_aggregator& aggregator)
+{
+	std::ostringstream os;
+
+	aggregator.dump_collapsed(os);
+	return os.str();
+}
+
+static uint64_t read_capture(const std::string& filename, sinsp_span_aggregator* aggregator)
+{
+	sinsp inspector;
+	sinsp_evt* evt;
+	uint64_t nevts = 0;
+
+	if(aggregator != NULL)
+	{
+		inspector.request_tracer_state_tracking();
+	}
+
+	inspector.open(filename);
+
+	while(inspector.next(&evt) != SCAP_EOF)
+	{
+		if(aggregator != NULL)
+		{
+			aggregator->process_event(evt);
+		}
+
+		nevts++;
+	}
+
+	return nevts;
+}
+
+TEST(span_aggregator, fold)
+{
+	sinsp_span_aggregator aggregator(NULL);
+
+	add_span(&aggregator, "web.db", 30);
+	add_span(&aggregator, "web.db", 10);
+	add_span(&aggregator, "web.cache", 5);
+	// web.sql has no span of its own
+	add_span(&aggregator, "web.sql.query", 10);
+	add_span(&aggregator, "web", 100);
+	add_span(&aggregator, "a;b.c", 7);
+	// Longer than the parent, e.g. an asynchronous child
+	add_span(&aggregator, "batch.job", 50);
+	add_span(&aggregator, "batch", 20);
+
+	EXPECT_EQ(8u, aggregator.get_num_spans());
+	EXPECT_EQ(9u, aggregator.get_num_nodes());
+	EXPECT_EQ("a_b;c 7\n"
+		"batch;job 50\n"
+		"web;cache 5\n"
+		"web;db 40\n"
+		"web;sql;query 10\n"
+		"web 45\n",
+		dump(aggregator));
+
+	aggregator.clear();
+	EXPECT_EQ(0u, aggregator.get_num_nodes());
+	EXPECT_EQ("", dump(aggregator));
+}
+
+TEST(span_aggregator, prune)
+{
+	const uint32_t max_nodes = 64;
+	sinsp_span_aggregator aggregator(NULL, max_nodes);
+
+	add_span(&aggregator, "root", 1000000);
+
+	for(uint32_t j = 0; j < 1000; j++)
+	{
+		add_span(&aggregator, "root.leaf" + std::to_string(j), j);
+		EXPECT_LE(aggregator.get_num_nodes(), max_nodes);
+	}
+
+	// The heaviest leaves survive
+	std::string out = dump(aggregator);
+	EXPECT_NE(std::string::npos, out.find("root;leaf999 999\n"));
+	EXPECT_EQ(std::string::npos, out.find("root;leaf1 "));
+	EXPECT_NE(std::string::npos, out.find("root;[pruned] "));
+
+	// and the time is all there
+	uint64_t sum = 0;
+	std::istringstream is(out);
+	std::string line;
+
+	while(std::getline(is, line))
+	{
+		sum += std::stoull(line.substr(line.rfind(' ') + 1));
+	}
+
+	EXPECT_EQ(1000000u, sum);
+	EXPECT_GT(aggregator.get_num_pruned_nodes(), 0u);
+}
+
+TEST(span_aggregator, capture)
+{
+	tracer_capture capture;
+
+	capture.tracer(">:1:web::", 0);
+	capture.tracer(">:1:web.db::", 10);
+	capture.tracer("<:1:web.db::", 30);
+	capture.tracer(">:1:web.db::", 5);
+	capture.tracer("<:1:web.db::", 20);
+	capture.tracer("<:1:web::", 15);
+	// No enter event
+	capture.tracer("<:2:web.cache::", 100);
+	capture.close();
+
+	sinsp_span_aggregator aggregator(NULL);
+	read_capture(capture.get_filename(), &aggregator);
+
+	EXPECT_EQ(3u, aggregator.get_num_spans());
+	EXPECT_EQ("web;db 50\n"
+		"web 30\n",
+		dump(aggregator));
+}
+
+TEST(span_aggregator, DISABLED_benchmark)
+{
+	const uint32_t ntransactions = 200000;
+	const uint32_t nendpoints = 2000;
+	tracer_capture capture;
+
+	for(uint32_t j = 0; j < ntransactions; j++)
+	{
+		std::string id = std::to_string(j + 1);
+		std::string endpoint = "api.endpoint" + std::to_string(j % nendpoints);
+
+		capture.tracer(">:" + id + ":" + endpoint + "::", 1000);
+		capture.tracer(">:" + id + ":" + endpoint + ".auth::", 100);
+		capture.tracer("<:" + id + ":" + endpoint + ".auth::", 2000);
+		capture.tracer(">:" + id + ":" + endpoint + ".db.query::", 100);
+		capture.tracer("<:" + id + ":" + endpoint + ".db.query::", 5000 + j % 1000);
+		capture.tracer("<:" + id + ":" + endpoint + "::", 300);
+	}
+	capture.close();
+
+	uint64_t start = sinsp_utils::get_current_time_ns();
+	uint64_t nevts = read_capture(capture.get_filename(), NULL);
+	uint64_t base = sinsp_utils::get_current_time_ns() - start;
+
+	for(uint32_t max_nodes : {SPAN_AGGREGATOR_DEFAULT_MAX_NODES, 1024})
+	{
+		sinsp_span_aggregator aggregator(NULL, max_nodes);
+		std::ostringstream os;
+
+		start = sinsp_utils::get_current_time_ns();
+		read_capture(capture.get_filename(), &aggregator);
+		aggregator.dump_collapsed(os);
+		uint64_t duration = sinsp_utils::get_current_time_ns() - start;
+
+		printf("max %u nodes: %.0f ns per event (%.0f without aggregation), %u nodes, %lu pruned, %lu bytes of output\n",
+			max_nodes,
+			(double)duration / nevts,
+			(double)base / nevts,
+			aggregator.get_num_nodes(),
+			aggregator.get_num_pruned_nodes(),
+			os.str().length());
+	}
+}
@@ -0,0 +1,248 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "state_snapshot.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// sinsp_state_snapshot implementation
+///////////////////////////////////////////////////////////////////////////////
+const sinsp_thread_snapshot* sinsp_state_snapshot::get_thread(int64_t tid) const
+{
+	auto it = m_threads.find(tid);
+	if(it == m_threads.end())
+	{
+		return NULL;
+	}
+
+	return &it->second;
+}
+
+const std::vector<sinsp_fd_snapshot>* sinsp_state_snapshot::get_fds(int64_t tid) const
+{
+	const sinsp_thread_snapshot* tinfo = get_thread(tid);
+
+	if(tinfo != NULL && (tinfo->m_flags & PPM_CL_CLONE_FILES))
+	{
+		tinfo = get_thread(tinfo->m_pid);
+	}
+
+	if(tinfo == NULL)
+	{
+		return NULL;
+	}
+
+	return &tinfo->m_fds;
+}
+
+const sinsp_container_info* sinsp_state_snapshot::get_container(const std::string& id) const
+{
+	auto it = m_containers.find(id);
+	if(it == m_containers.end())
+	{
+		return NULL;
+	}
+
+	return &it->second;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sinsp_state_snapshots implementation
+///////////////////////////////////////////////////////////////////////////////
+sinsp_state_snapshots::sinsp_state_snapshots(uint64_t interval_ns):
+	m_interval_ns(interval_ns),
+	m_next_ts(0),
+	m_requested(false),
+	m_n_published(0),
+	m_epoch(1),
+	m_current(NULL)
+{
+	for(uint32_t j = 0; j < MAX_READERS; j++)
+	{
+		m_reader_epochs[j].store(0);
+	}
+}
+
+//
+// There can't be readers anymore at this point
+//
+sinsp_state_snapshots::~sinsp_state_snapshots()
+{
+	for(auto& it : m_retired)
+	{
+		delete it.m_snapshot;
+	}
+
+	delete m_current.load();
+}
+
+sinsp_state_snapshots::reader::reader(sinsp_state_snapshots* snapshots):
+	m_snapshots(snapshots),
+	m_slot(MAX_READERS),
+	m_snapshot(NULL)
+{
+	//
+	// Announce the epoch before loading the pointer: a snapshot swapped
+	// out after this point is retired with an epoch that is at least ours,
+	// so it stays around until we leave. All the operations are
+	// sequentially consistent, which is what makes the ordering hold
+	// against the scan in reclaim().
+	//
+	uint64_t epoch = m_snapshots->m_epoch.load();
+
+	for(uint32_t j = 0; j < MAX_READERS; j++)
+	{
+		uint64_t expected = 0;
+
+		if(m_snapshots->m_reader_epochs[j].compare_exchange_strong(expected, epoch))
+		{
+			m_slot = j;
+			break;
+		}
+	}
+
+	if(m_slot == MAX_READERS)
+	{
+		throw sinsp_exception("too many concurrent state snapshot readers (max " + std::to_string(MAX_READERS) + ")");
+	}
+
+	m_snapshot = m_snapshots->m_current.load();
+}
+
+sinsp_state_snapshots::reader::~reader()
+{
+	m_snapshots->m_reader_epochs[m_slot].store(0);
+}
+
+void sinsp_state_snapshots::publish(sinsp_state_snapshot* snapshot)
+{
+	sinsp_state_snapshot* old = m_current.exchange(snapshot);
+
+	if(old != NULL)
+	{
+		retired_snapshot r;
+		r.m_snapshot = old;
+		r.m_epoch = m_epoch.fetch_add(1);
+		m_retired.push_back(r);
+	}
+
+	m_requested.store(false, std::memory_order_relaxed);
+	m_next_ts = snapshot->m_ts + m_interval_ns;
+	m_n_published.fetch_add(1, std::memory_order_relaxed);
+
+	reclaim();
+}
+
+void sinsp_state_snapshots::reclaim()
+{
+	if(m_retired.empty())
+	{
+		return;
+	}
+
+	//
+	// The oldest epoch a reader is still in. Whatever was retired before
+	// it can't be seen by anybody.
+	//
+	uint64_t min_epoch = UINT64_MAX;
+
+	for(uint32_t j = 0; j < MAX_READERS; j++)
+	{
+		uint64_t epoch = m_reader_epochs[j].load();
+
+		if(epoch != 0 && epoch < min_epoch)
+		{
+			min_epoch = epoch;
+		}
+	}
+
+	uint32_t n_kept = 0;
+
+	for(uint32_t j = 0; j < m_retired.size(); j++)
+	{
+		if(m_retired[j].m_epoch < min_epoch)
+		{
+			delete m_retired[j].m_snapshot;
+		}
+		else
+		{
+			m_retired[n_kept++] = m_retired[j];
+		}
+	}
+
+	m_retired.resize(n_kept);
+}
+
+sinsp_state_snapshot* sinsp_state_snapshots::build(sinsp* inspector, uint64_t ts, uint64_t evtnum)
+{
+	std::unique_ptr<sinsp_state_snapshot> snapshot(new sinsp_state_snapshot());
+
+	snapshot->m_ts = ts;
+	snapshot->m_evtnum = evtnum;
+	snapshot->m_threads.reserve(inspector->m_thread_manager->get_thread_count());
+
+	inspector->m_thread_manager->get_threads()->loop([&](sinsp_threadinfo& tinfo) {
+		sinsp_thread_snapshot& tsnap = snapshot->m_threads[tinfo.m_tid];
+
+		tsnap.m_tid = tinfo.m_tid;
+		tsnap.m_pid = tinfo.m_pid;
+		tsnap.m_ptid = tinfo.m_ptid;
+		tsnap.m_sid = tinfo.m_sid;
+		tsnap.m_vtid = tinfo.m_vtid;
+		tsnap.m_vpid = tinfo.m_vpid;
+		tsnap.m_comm = tinfo.m_comm;
+		tsnap.m_exe = tinfo.m_exe;
+		tsnap.m_exepath = tinfo.m_exepath;
+		tsnap.m_args = tinfo.m_args;
+		tsnap.m_cwd = tinfo.get_cwd();
+		tsnap.m_container_id = tinfo.m_container_id;
+		tsnap.m_flags = tinfo.m_flags;
+		tsnap.m_uid = tinfo.m_uid;
+		tsnap.m_gid = tinfo.m_gid;
+		tsnap.m_clone_ts = tinfo.m_clone_ts;
+
+		//
+		// The threads that share the fd table of their process have an
+		// empty one of their own. Like in get_fd_table(), the main thread
+		// owns the table even when it was created with CLONE_FILES.
+		//
+		if(!(tinfo.m_flags & PPM_CL_CLONE_FILES) || tinfo.m_tid == tinfo.m_pid)
+		{
+			tsnap.m_fds.reserve(tinfo.m_fdtable.size());
+
+			for(auto& it : tinfo.m_fdtable.peek_table())
+			{
+				sinsp_fd_snapshot fd;
+				fd.m_fd = it.first;
+				fd.m_type = it.second.m_type;
+				fd.m_openflags = it.second.m_openflags;
+				fd.m_name = it.second.m_name;
+				tsnap.m_fds.push_back(std::move(fd));
+			}
+		}
+
+		return true;
+	});
+
+	const unordered_map<string, sinsp_container_info>* containers = inspector->m_container_manager.get_containers();
+	snapshot->m_containers.insert(containers->begin(), containers->end());
+
+	return snapshot.release();
+}
@@ -0,0 +1,197 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <scap.h>
+
+#include "container_info.h"
+
+class sinsp;
+
+//
+// The immutable copy of an fd, see sinsp_fdinfo
+//
+struct sinsp_fd_snapshot
+{
+	int64_t m_fd;
+	scap_fd_type m_type;
+	uint32_t m_openflags;
+	std::string m_name;
+};
+
+//
+// The immutable copy of a thread, see sinsp_threadinfo. As in the thread
+// table, the threads of a process created with CLONE_FILES have no fds:
+// they are in the entry of the main thread, see get_fds().
+//
+struct sinsp_thread_snapshot
+{
+	int64_t m_tid;
+	int64_t m_pid;
+	int64_t m_ptid;
+	int64_t m_sid;
+	int64_t m_vtid;
+	int64_t m_vpid;
+	std::string m_comm;
+	std::string m_exe;
+	std::string m_exepath;
+	std::vector<std::string> m_args;
+	std::string m_cwd;
+	std::string m_container_id;
+	uint32_t m_flags;
+	uint32_t m_uid;
+	uint32_t m_gid;
+	uint64_t m_clone_ts;
+	std::vector<sinsp_fd_snapshot> m_fds;
+};
+
+//
+// The thread, fd and container state right after event m_evtnum
+//
+class sinsp_state_snapshot
+{
+public:
+	sinsp_state_snapshot():
+		m_ts(0),
+		m_evtnum(0)
+	{
+	}
+
+	const sinsp_thread_snapshot* get_thread(int64_t tid) const;
+
+	// The fds of the thread, taking CLONE_FILES into account. NULL if the
+	// thread or its main thread are not in the snapshot.
+	const std::vector<sinsp_fd_snapshot>* get_fds(int64_t tid) const;
+
+	const sinsp_container_info* get_container(const std::string& id) const;
+
+	uint64_t m_ts;
+	uint64_t m_evtnum;
+	std::unordered_map<int64_t, sinsp_thread_snapshot> m_threads;
+	std::unordered_map<std::string, sinsp_container_info> m_containers;
+};
+
+//
+// Publishes the snapshots taken by the event thread to any number of
+// reader threads without locks.
+//
+// The event thread swaps the current snapshot pointer and retires the
+// old one with the current epoch. A reader announces the epoch it
+// started in before loading the pointer, and a retired snapshot is
+// deleted only once no reader announced an epoch up to the one it was
+// retired in. A reader that holds a snapshot for a long time only delays
+// the reclaiming, the event thread never waits.
+//
+class sinsp_state_snapshots
+{
+public:
+	const static uint32_t MAX_READERS = 64;
+
+	//
+	// interval_ns is the event time between two snapshots, 0 to only take
+	// them on request()
+	//
+	sinsp_state_snapshots(uint64_t interval_ns);
+	~sinsp_state_snapshots();
+
+	//
+	// The snapshot seen by a reader, valid for the lifetime of the object.
+	// Throws sinsp_exception if there are already MAX_READERS readers.
+	//
+	class reader
+	{
+	public:
+		reader(sinsp_state_snapshots* snapshots);
+		~reader();
+
+		reader(const reader&) = delete;
+		reader& operator=(const reader&) = delete;
+
+		// NULL if no snapshot was taken yet
+		const sinsp_state_snapshot* get() const
+		{
+			return m_snapshot;
+		}
+
+	private:
+		sinsp_state_snapshots* m_snapshots;
+		uint32_t m_slot;
+		const sinsp_state_snapshot* m_snapshot;
+	};
+
+	//
+	// Ask the event thread to take a snapshot after the current event.
+	// Callable from any thread.
+	//
+	void request()
+	{
+		m_requested.store(true, std::memory_order_relaxed);
+	}
+
+	uint64_t get_n_published() const
+	{
+		return m_n_published.load(std::memory_order_relaxed);
+	}
+
+	//
+	// Event thread side
+	//
+	inline bool is_due(uint64_t ts) const
+	{
+		return m_requested.load(std::memory_order_relaxed) ||
+			(m_interval_ns != 0 && ts >= m_next_ts);
+	}
+
+	// Takes ownership of snapshot
+	void publish(sinsp_state_snapshot* snapshot);
+
+	// Copy the inspector state after the event with number evtnum
+	static sinsp_state_snapshot* build(sinsp* inspector, uint64_t ts, uint64_t evtnum);
+
+	// Snapshots retired but not deleted yet
+	size_t get_n_retired() const
+	{
+		return m_retired.size();
+	}
+
+private:
+	void reclaim();
+
+	struct retired_snapshot
+	{
+		sinsp_state_snapshot* m_snapshot;
+		uint64_t m_epoch;
+	};
+
+	uint64_t m_interval_ns;
+	uint64_t m_next_ts;
+	std::atomic<bool> m_requested;
+	std::atomic<uint64_t> m_n_published;
+	std::atomic<uint64_t> m_epoch;
+	std::atomic<sinsp_state_snapshot*> m_current;
+	// The epoch each reader started in, 0 if the slot is free
+	std::atomic<uint64_t> m_reader_epochs[MAX_READERS];
+	std::vector<retired_snapshot> m_retired;
+};
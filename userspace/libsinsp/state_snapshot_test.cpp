@@ -0,0 +1,251 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#define VISIBILITY_PRIVATE
+#include "sinsp.h"
+#include "state_snapshot.h"
+
+//
+// A snapshot where every name carries the event number, so that a reader
+// can tell if it sees pieces of two different snapshots
+//
+static sinsp_state_snapshot* make_snapshot(uint64_t evtnum)
+{
+	sinsp_state_snapshot* snapshot = new sinsp_state_snapshot();
+	std::string tag = std::to_string(evtnum);
+
+	snapshot->m_ts = evtnum * 1000;
+	snapshot->m_evtnum = evtnum;
+
+	for(int64_t tid = 1; tid <= (int64_t)(evtnum % 32) + 1; tid++)
+	{
+		sinsp_thread_snapshot& tinfo = snapshot->m_threads[tid];
+		tinfo.m_tid = tid;
+		tinfo.m_pid = 1;
+		tinfo.m_flags = tid == 1 ? 0 : PPM_CL_CLONE_FILES;
+		tinfo.m_comm = "comm" + tag;
+		tinfo.m_container_id = tag;
+	}
+
+	for(int64_t fd = 0; fd < (int64_t)(evtnum % 16); fd++)
+	{
+		sinsp_fd_snapshot fdinfo;
+		fdinfo.m_fd = fd;
+		fdinfo.m_type = SCAP_FD_FILE_V2;
+		fdinfo.m_openflags = 0;
+		fdinfo.m_name = "/tmp/" + tag;
+		snapshot->m_threads[1].m_fds.push_back(fdinfo);
+	}
+
+	snapshot->m_containers[tag].m_id = tag;
+
+	return snapshot;
+}
+
+TEST(state_snapshots, publish)
+{
+	sinsp_state_snapshots snapshots(1000);
+
+	EXPECT_TRUE(snapshots.is_due(0));
+	{
+		sinsp_state_snapshots::reader reader(&snapshots);
+		EXPECT_TRUE(reader.get() == NULL);
+	}
+
+	snapshots.publish(make_snapshot(3));
+	EXPECT_FALSE(snapshots.is_due(3500));
+	EXPECT_TRUE(snapshots.is_due(4000));
+	snapshots.request();
+	EXPECT_TRUE(snapshots.is_due(3500));
+
+	{
+		sinsp_state_snapshots::reader reader(&snapshots);
+		const sinsp_state_snapshot* snapshot = reader.get();
+
+		ASSERT_TRUE(snapshot != NULL);
+		EXPECT_EQ(3u, snapshot->m_evtnum);
+		EXPECT_EQ(4u, snapshot->m_threads.size());
+		EXPECT_TRUE(snapshot->get_thread(5) == NULL);
+
+		// The threads share the fd table of their process
+		ASSERT_TRUE(snapshot->get_fds(3) != NULL);
+		EXPECT_EQ(3u, snapshot->get_fds(3)->size());
+		EXPECT_EQ(snapshot->get_fds(1), snapshot->get_fds(3));
+
+		ASSERT_TRUE(snapshot->get_container("3") != NULL);
+		EXPECT_TRUE(snapshot->get_container("4") == NULL);
+	}
+
+	snapshots.publish(make_snapshot(4));
+	EXPECT_FALSE(snapshots.is_due(3500));
+	EXPECT_EQ(2u, snapshots.get_n_published());
+}
+
+TEST(state_snapshots, reclaim)
+{
+	sinsp_state_snapshots snapshots(0);
+
+	snapshots.publish(make_snapshot(1));
+
+	std::unique_ptr<sinsp_state_snapshots::reader> reader(new sinsp_state_snapshots::reader(&snapshots));
+	ASSERT_EQ(1u, reader->get()->m_evtnum);
+
+	//
+	// The snapshot held by the reader, and the ones published after it, are
+	// kept until the reader goes away
+	//
+	for(uint64_t j = 2; j <= 10; j++)
+	{
+		snapshots.publish(make_snapshot(j));
+	}
+	EXPECT_EQ(9u, snapshots.get_n_retired());
+	EXPECT_EQ(1u, reader->get()->m_evtnum);
+	EXPECT_EQ("comm1", reader->get()->get_thread(1)->m_comm);
+
+	reader.reset();
+	snapshots.publish(make_snapshot(11));
+	EXPECT_EQ(0u, snapshots.get_n_retired());
+
+	// A new reader sees the latest one
+	sinsp_state_snapshots::reader reader2(&snapshots);
+	EXPECT_EQ(11u, reader2.get()->m_evtnum);
+}
+
+TEST(state_snapshots, too_many_readers)
+{
+	sinsp_state_snapshots snapshots(0);
+	std::vector<std::unique_ptr<sinsp_state_snapshots::reader>> readers;
+
+	for(uint32_t j = 0; j < sinsp_state_snapshots::MAX_READERS; j++)
+	{
+		readers.emplace_back(new sinsp_state_snapshots::reader(&snapshots));
+	}
+
+	EXPECT_THROW(sinsp_state_snapshots::reader reader(&snapshots), sinsp_exception);
+
+	// A slot frees up as soon as a reader leaves
+	readers.pop_back();
+	sinsp_state_snapshots::reader reader(&snapshots);
+}
+
+//
+// One thread publishes as fast as it can while the readers check that
+// every snapshot they get is whole, and never older than the previous one
+// they got. Run under ASAN or TSAN to catch the snapshots freed too early.
+//
+TEST(state_snapshots, concurrent_readers)
+{
+	const uint64_t npublish = 5000;
+	const uint32_t nreaders = 8;
+	sinsp_state_snapshots snapshots(0);
+	std::atomic<bool> done(false);
+	std::atomic<uint64_t> nreads(0);
+	std::vector<std::thread> readers;
+
+	snapshots.publish(make_snapshot(1));
+
+	for(uint32_t j = 0; j < nreaders; j++)
+	{
+		readers.emplace_back([&]() {
+			uint64_t last = 0;
+
+			while(!done)
+			{
+				sinsp_state_snapshots::reader reader(&snapshots);
+				const sinsp_state_snapshot* snapshot = reader.get();
+				std::string tag = std::to_string(snapshot->m_evtnum);
+
+				ASSERT_GE(snapshot->m_evtnum, last);
+				last = snapshot->m_evtnum;
+
+				ASSERT_EQ(snapshot->m_evtnum % 32 + 1, snapshot->m_threads.size());
+				for(auto& it : snapshot->m_threads)
+				{
+					ASSERT_EQ(it.first, it.second.m_tid);
+					ASSERT_EQ("comm" + tag, it.second.m_comm);
+					ASSERT_TRUE(snapshot->get_container(it.second.m_container_id) != NULL);
+				}
+
+				const std::vector<sinsp_fd_snapshot>* fds = snapshot->get_fds(snapshot->m_threads.size());
+				ASSERT_TRUE(fds != NULL);
+				ASSERT_EQ(snapshot->m_evtnum % 16, fds->size());
+				for(auto& fd : *fds)
+				{
+					ASSERT_EQ("/tmp/" + tag, fd.m_name);
+				}
+
+				nreads++;
+			}
+		});
+	}
+
+	for(uint64_t j = 2; j <= npublish; j++)
+	{
+		snapshots.publish(make_snapshot(j));
+	}
+	done = true;
+
+	for(auto& t : readers)
+	{
+		t.join();
+	}
+
+	EXPECT_GT(nreads.load(), 0u);
+	EXPECT_EQ(npublish, snapshots.get_n_published());
+
+	// Nobody holds a snapshot anymore
+	snapshots.publish(make_snapshot(npublish + 1));
+	EXPECT_EQ(0u, snapshots.get_n_retired());
+}
+
+//
+// A process created with CLONE_FILES still owns its fd table, only its
+// other threads use the one of the main thread
+//
+TEST(state_snapshots, build_clone_files)
+{
+	sinsp inspector;
+
+	for(int64_t tid : {100, 101})
+	{
+		sinsp_threadinfo* tinfo = new sinsp_threadinfo(&inspector);
+		tinfo->m_tid = tid;
+		tinfo->m_pid = 100;
+		tinfo->m_flags = PPM_CL_CLONE_FILES;
+		inspector.add_thread(tinfo);
+	}
+
+	sinsp_fdinfo_t fdinfo;
+	fdinfo.m_type = SCAP_FD_FILE_V2;
+	fdinfo.m_name = "/tmp/x";
+	inspector.get_thread(100)->add_fd(3, &fdinfo);
+
+	std::unique_ptr<sinsp_state_snapshot> snapshot(sinsp_state_snapshots::build(&inspector, 0, 0));
+
+	ASSERT_TRUE(snapshot->get_fds(100) != NULL);
+	ASSERT_EQ(1u, snapshot->get_fds(100)->size());
+	EXPECT_EQ("/tmp/x", snapshot->get_fds(100)->at(0).m_name);
+	EXPECT_EQ(snapshot->get_fds(100), snapshot->get_fds(101));
+}
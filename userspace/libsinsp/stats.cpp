@@ -41,6 +41,11 @@ void sinsp_stats::clear()
 	m_n_store_drops = 0;
 	m_n_retrieved_evts = 0;
 	m_n_retrieve_drops = 0;
+	m_n_arena_allocs = 0;
+	m_n_arena_heap_allocs = 0;
+	m_n_shared_fdtables = 0;
+	m_n_copied_fdtables = 0;
+	m_n_prefiltered_evts = 0;
 	m_metrics_registry.clear_all_metrics();
 }
 
@@ -64,6 +69,13 @@ void sinsp_stats::emit(FILE* f)
 	fprintf(f, "store drops: %" PRIu64 "\n", m_n_store_drops);
 	fprintf(f, "retrieved evts: %" PRIu64 "\n", m_n_retrieved_evts);
 	fprintf(f, "retrieve drops: %" PRIu64 "\n", m_n_retrieve_drops);
+	fprintf(f, "event arena allocs: %" PRIu64 "(%" PRIu64 " from the heap)\n",
+		m_n_arena_allocs,
+		m_n_arena_heap_allocs);
+	fprintf(f, "fd tables shared on fork: %" PRIu64 "(%" PRIu64 " copied later)\n",
+		m_n_shared_fdtables,
+		m_n_copied_fdtables);
+	fprintf(f, "evts dropped before parsing: %" PRIu64 "\n", m_n_prefiltered_evts);
 
 	for(internal_metrics::registry::metric_map_iterator_t it = m_metrics_registry.get_metrics().begin(); it != m_metrics_registry.get_metrics().end(); it++)
 	{
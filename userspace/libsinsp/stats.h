@@ -53,6 +53,11 @@ public:
 	uint64_t m_n_store_drops;
 	uint64_t m_n_retrieved_evts;
 	uint64_t m_n_retrieve_drops;
+	uint64_t m_n_arena_allocs;
+	uint64_t m_n_arena_heap_allocs;
+	uint64_t m_n_shared_fdtables;
+	uint64_t m_n_copied_fdtables;
+	uint64_t m_n_prefiltered_evts;
 
 private:
 	internal_metrics::registry m_metrics_registry;
@@ -1606,3 +1606,108 @@ void sinsp_table::clear()
 		ASSERT(false);
 	}
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// sinsp_table_sample implementation
+///////////////////////////////////////////////////////////////////////////////
+sinsp_table_sample::sinsp_table_sample(vector<sinsp_sample_row>* rows, uint64_t generation)
+{
+	uint64_t totsize = 0;
+
+	m_generation = generation;
+
+	if(rows == NULL)
+	{
+		return;
+	}
+
+	for(auto it = rows->begin(); it != rows->end(); ++it)
+	{
+		totsize += it->m_key.m_len;
+
+		for(auto vit = it->m_values.begin(); vit != it->m_values.end(); ++vit)
+		{
+			totsize += vit->m_len;
+		}
+	}
+
+	//
+	// One allocation for all the values, so the copy is cheap compared to the
+	// rendering
+	//
+	m_storage.resize(totsize + 1);
+	uint8_t* pos = &m_storage[0];
+
+	m_rows.resize(rows->size());
+
+	for(uint32_t j = 0; j < rows->size(); j++)
+	{
+		sinsp_sample_row* src = &rows->at(j);
+		sinsp_sample_row* dst = &m_rows[j];
+
+		dst->m_key = src->m_key;
+		if(src->m_key.m_val != NULL)
+		{
+			memcpy(pos, src->m_key.m_val, src->m_key.m_len);
+			dst->m_key.m_val = pos;
+			pos += src->m_key.m_len;
+		}
+
+		dst->m_values = src->m_values;
+		for(auto vit = dst->m_values.begin(); vit != dst->m_values.end(); ++vit)
+		{
+			if(vit->m_val != NULL)
+			{
+				memcpy(pos, vit->m_val, vit->m_len);
+				vit->m_val = pos;
+				pos += vit->m_len;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sinsp_table_sample_handoff implementation
+///////////////////////////////////////////////////////////////////////////////
+void sinsp_table_sample_handoff::publish(shared_ptr<sinsp_table_sample> sample)
+{
+	lock_guard<mutex> lock(m_mtx);
+
+	if(m_sample != NULL)
+	{
+		m_n_dropped++;
+	}
+
+	m_sample = sample;
+	m_n_published++;
+}
+
+shared_ptr<sinsp_table_sample> sinsp_table_sample_handoff::take()
+{
+	lock_guard<mutex> lock(m_mtx);
+	shared_ptr<sinsp_table_sample> res = m_sample;
+
+	m_sample.reset();
+	return res;
+}
+
+void sinsp_table_sample_handoff::clear()
+{
+	lock_guard<mutex> lock(m_mtx);
+
+	m_sample.reset();
+}
+
+uint64_t sinsp_table_sample_handoff::get_n_published()
+{
+	lock_guard<mutex> lock(m_mtx);
+
+	return m_n_published;
+}
+
+uint64_t sinsp_table_sample_handoff::get_n_dropped()
+{
+	lock_guard<mutex> lock(m_mtx);
+
+	return m_n_dropped;
+}
@@ -17,6 +17,8 @@ limitations under the License.
 
 */
 
+#include <mutex>
+
 #define SINSP_TABLE_DEFAULT_REFRESH_INTERVAL_NS 1000000000
 #define SINSP_TABLE_BUFFER_ENTRY_SIZE 16384
 
@@ -219,6 +221,57 @@ public:
 	vector<sinsp_table_field> m_values;
 };
 
+//
+// Immutable copy of a table sample. The field values of a sample point into
+// the table buffers, which are recycled at every flush, while the values of
+// this copy point into m_storage, so that it can be rendered by another
+// thread while the table keeps processing events.
+//
+class sinsp_table_sample
+{
+public:
+	sinsp_table_sample(vector<sinsp_sample_row>* rows, uint64_t generation);
+
+	vector<sinsp_sample_row> m_rows;
+	uint64_t m_generation;
+
+private:
+	sinsp_table_sample(const sinsp_table_sample&);
+	sinsp_table_sample& operator=(const sinsp_table_sample&);
+
+	vector<uint8_t> m_storage;
+};
+
+//
+// Single slot handoff of table samples between the capture thread and the
+// UI thread. Only the most recent sample is kept: a sample that is replaced
+// before the UI gets to it is counted as dropped.
+//
+class sinsp_table_sample_handoff
+{
+public:
+	sinsp_table_sample_handoff()
+	{
+		m_n_published = 0;
+		m_n_dropped = 0;
+	}
+
+	void publish(shared_ptr<sinsp_table_sample> sample);
+	//
+	// Returns NULL if nothing was published since the last call
+	//
+	shared_ptr<sinsp_table_sample> take();
+	void clear();
+	uint64_t get_n_published();
+	uint64_t get_n_dropped();
+
+private:
+	mutex m_mtx;
+	shared_ptr<sinsp_table_sample> m_sample;
+	uint64_t m_n_published;
+	uint64_t m_n_dropped;
+};
+
 class sinsp_table
 {
 public:	
@@ -0,0 +1,99 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "table.h"
+
+static sinsp_table_field make_field(sinsp_table_buffer* buf, uint64_t val)
+{
+	return sinsp_table_field(buf->copy((uint8_t*)&val, sizeof(val)), sizeof(val), 1);
+}
+
+static uint64_t field_val(const sinsp_table_field& fld)
+{
+	uint64_t res;
+	memcpy(&res, fld.m_val, sizeof(res));
+	return res;
+}
+
+TEST(table_sample, deep_copy)
+{
+	sinsp_table_buffer* buf = new sinsp_table_buffer();
+	vector<sinsp_sample_row> rows;
+
+	for(uint64_t j = 0; j < 100; j++)
+	{
+		sinsp_sample_row row;
+		row.m_key = make_field(buf, j);
+		row.m_values.push_back(make_field(buf, j * 10));
+		row.m_values.push_back(make_field(buf, j * 100));
+		rows.push_back(row);
+	}
+
+	sinsp_table_sample sample(&rows, 7);
+
+	//
+	// The table recycles its buffers at every flush
+	//
+	delete buf;
+	rows.clear();
+
+	EXPECT_EQ(7u, sample.m_generation);
+	ASSERT_EQ(100u, sample.m_rows.size());
+	for(uint64_t j = 0; j < 100; j++)
+	{
+		EXPECT_EQ(j, field_val(sample.m_rows[j].m_key));
+		ASSERT_EQ(2u, sample.m_rows[j].m_values.size());
+		EXPECT_EQ(j * 10, field_val(sample.m_rows[j].m_values[0]));
+		EXPECT_EQ(j * 100, field_val(sample.m_rows[j].m_values[1]));
+		EXPECT_EQ(1u, sample.m_rows[j].m_values[1].m_cnt);
+	}
+
+	sinsp_table_sample empty(NULL, 0);
+	EXPECT_EQ(0u, empty.m_rows.size());
+}
+
+TEST(table_sample, handoff_drops)
+{
+	sinsp_table_sample_handoff handoff;
+	vector<sinsp_sample_row> rows;
+
+	EXPECT_TRUE(handoff.take() == NULL);
+
+	handoff.publish(make_shared<sinsp_table_sample>(&rows, 1));
+	handoff.publish(make_shared<sinsp_table_sample>(&rows, 2));
+	handoff.publish(make_shared<sinsp_table_sample>(&rows, 3));
+
+	//
+	// Only the last sample is kept
+	//
+	shared_ptr<sinsp_table_sample> sample = handoff.take();
+	ASSERT_TRUE(sample != NULL);
+	EXPECT_EQ(3u, sample->m_generation);
+	EXPECT_TRUE(handoff.take() == NULL);
+
+	handoff.publish(make_shared<sinsp_table_sample>(&rows, 4));
+	handoff.clear();
+	EXPECT_TRUE(handoff.take() == NULL);
+
+	EXPECT_EQ(4u, handoff.get_n_published());
+	EXPECT_EQ(2u, handoff.get_n_dropped());
+}
@@ -29,7 +29,7 @@ limitations under the License.
 
 extern sinsp_evttables g_infotables;
 
-static void copy_ipv6_address(uint32_t* dest, uint32_t* src)
+static void copy_ipv6_address(uint32_t* dest, const uint32_t* src)
 {
 	dest[0] = src[0];
 	dest[1] = src[1];
@@ -114,7 +114,7 @@ sinsp_threadinfo::~sinsp_threadinfo()
 	m_private_state.clear();
 	if(m_lastevent_data)
 	{
-		free(m_lastevent_data);
+		sinsp_evt_buffer_pool::release(m_lastevent_data);
 	}
 
 	if(m_tracer_parser)
@@ -127,7 +127,7 @@ void sinsp_threadinfo::fix_sockets_coming_from_proc()
 {
 	unordered_map<int64_t, sinsp_fdinfo_t>::iterator it;
 
-	for(it = m_fdtable.m_table.begin(); it != m_fdtable.m_table.end(); it++)
+	for(it = m_fdtable.get_table().begin(); it != m_fdtable.get_table().end(); it++)
 	{
 		if(it->second.m_type == SCAP_FD_IPV4_SOCK)
 		{
@@ -697,11 +697,11 @@ void sinsp_threadinfo::remove_fd(int64_t fd)
 
 bool sinsp_threadinfo::is_bound_to_port(uint16_t number)
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator it;
+	unordered_map<int64_t, sinsp_fdinfo_t>::const_iterator it;
 
 	sinsp_fdtable* fdt = get_fd_table();
 
-	for(it = fdt->m_table.begin(); it != fdt->m_table.end(); ++it)
+	for(it = fdt->peek_table().begin(); it != fdt->peek_table().end(); ++it)
 	{
 		if(it->second.m_type == SCAP_FD_IPV4_SOCK)
 		{
@@ -724,12 +724,12 @@ bool sinsp_threadinfo::is_bound_to_port(uint16_t number)
 
 bool sinsp_threadinfo::uses_client_port(uint16_t number)
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator it;
+	unordered_map<int64_t, sinsp_fdinfo_t>::const_iterator it;
 
 	sinsp_fdtable* fdt = get_fd_table();
 
-	for(it = fdt->m_table.begin();
-		it != fdt->m_table.end(); ++it)
+	for(it = fdt->peek_table().begin();
+		it != fdt->peek_table().end(); ++it)
 	{
 		if(it->second.m_type == SCAP_FD_IPV4_SOCK)
 		{
@@ -762,6 +762,13 @@ sinsp_threadinfo* sinsp_threadinfo::get_cwd_root()
 
 string sinsp_threadinfo::get_cwd()
 {
+	return get_cwd_ref();
+}
+
+const string& sinsp_threadinfo::get_cwd_ref()
+{
+	static const string default_cwd = "./";
+
 	// Ideally we should use get_cwd_root()
 	// but scap does not read CLONE_FS from /proc
 	// Also glibc and muslc use always
@@ -776,7 +783,7 @@ string sinsp_threadinfo::get_cwd()
 	else
 	{
 		ASSERT(false);
-		return "./";
+		return default_cwd;
 	}
 }
 
@@ -1141,7 +1148,7 @@ void sinsp_threadinfo::strvec_to_iovec(const vector<string> &strs,
 }
 
 
-void sinsp_threadinfo::fd_to_scap(scap_fdinfo *dst, sinsp_fdinfo_t* src)
+void sinsp_threadinfo::fd_to_scap(scap_fdinfo *dst, const sinsp_fdinfo_t* src)
 {
 	dst->type = src->m_type;
 	dst->ino = src->m_ino;
@@ -1340,12 +1347,17 @@ void sinsp_thread_manager::remove_thread(int64_t tid, bool force)
 		}
 
 		//
-		// If this is the main thread of a process, erase all the FDs that the process owns
+		// If this is the main thread of a process, erase all the FDs that the process owns.
+		// This only notifies the listener, so a child that exits without
+		// touching the fds it shares with its parent doesn't copy them here.
+		// If they are still shared, the listener gets a copy of each fd
+		// instead, so that it can't change the ones of the other side.
 		//
-		if(tinfo->m_pid == tinfo->m_tid)
+		if(tinfo->m_pid == tinfo->m_tid && m_inspector->m_parser->m_fd_listener)
 		{
-			unordered_map<int64_t, sinsp_fdinfo_t>* fdtable = &(tinfo->get_fd_table()->m_table);
-			unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit;
+			sinsp_fdtable* fdtable = tinfo->get_fd_table();
+			bool shared = fdtable->is_shared();
+			sinsp_fdinfo_t fdcopy;
 
 			erase_fd_params eparams;
 			eparams.m_remove_from_table = false;
@@ -1353,16 +1365,25 @@ void sinsp_thread_manager::remove_thread(int64_t tid, bool force)
 			eparams.m_tinfo = tinfo;
 			eparams.m_ts = m_inspector->m_lastevent_ts;
 
-			for(fdit = fdtable->begin(); fdit != fdtable->end(); ++fdit)
+			for(auto& fdit : fdtable->peek_table())
 			{
-				eparams.m_fd = fdit->first;
+				eparams.m_fd = fdit.first;
 
 				//
 				// The canceled fd should always be deleted immediately, so if it appears
 				// here it means we have a problem.
 				//
 				ASSERT(eparams.m_fd != CANCELED_FD_NUMBER);
-				eparams.m_fdinfo = &(fdit->second);
+
+				if(shared)
+				{
+					fdtable->copy_fd(fdit.second, &fdcopy);
+					eparams.m_fdinfo = &fdcopy;
+				}
+				else
+				{
+					eparams.m_fdinfo = const_cast<sinsp_fdinfo_t*>(&fdit.second);
+				}
 
 				m_inspector->m_parser->erase_fd(&eparams);
 			}
@@ -1556,18 +1577,23 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 		throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
 	}
 
+	//
+	// scap_threadinfo is large, so the same one is used for all the
+	// threads: thread_to_scap() overwrites every field we write
+	//
+	scap_threadinfo *sctinfo;
+
+	if((sctinfo = scap_proc_alloc(m_inspector->m_h)) == NULL)
+	{
+		throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
+	}
+
 	uint32_t idx = 0;
 	m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
-		scap_threadinfo *sctinfo;
 		struct iovec *args_iov, *envs_iov, *cgroups_iov;
 		int argscnt, envscnt, cgroupscnt;
 		string argsrem, envsrem, cgroupsrem;
 
-		if((sctinfo = scap_proc_alloc(m_inspector->m_h)) == NULL)
-		{
-			throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
-		}
-
 		thread_to_scap(tinfo, sctinfo);
 		tinfo.args_to_iovec(&args_iov, &argscnt, argsrem);
 		tinfo.env_to_iovec(&envs_iov, &envscnt, envsrem);
@@ -1583,6 +1609,7 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 						  cgroups_iov, cgroupscnt,
 						  tinfo.m_root.c_str()) != SCAP_SUCCESS)
 		{
+			scap_proc_free(m_inspector->m_h, sctinfo);
 			throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
 		}
 
@@ -1590,12 +1617,12 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 		free(envs_iov);
 		free(cgroups_iov);
 
-		scap_proc_free(m_inspector->m_h, sctinfo);
 		return true;
 	});
 
 	if(scap_write_proclist_trailer(m_inspector->m_h, dumper, totlen) != SCAP_SUCCESS)
 	{
+		scap_proc_free(m_inspector->m_h, sctinfo);
 		throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
 	}
 
@@ -1604,13 +1631,6 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 	//
 
 	m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
-		scap_threadinfo *sctinfo;
-
-		if((sctinfo = scap_proc_alloc(m_inspector->m_h)) == NULL)
-		{
-			throw sinsp_exception(scap_getlasterr(m_inspector->m_h));
-		}
-
 		// Note: as scap_fd_add/scap_write_proc_fds do not use
 		// any of the array-based fields like comm, etc. a
 		// shallow copy is safe
@@ -1621,7 +1641,7 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 			//
 			// Add the FDs
 			//
-			unordered_map<int64_t, sinsp_fdinfo_t>& fdtable = tinfo.get_fd_table()->m_table;
+			const unordered_map<int64_t, sinsp_fdinfo_t>& fdtable = tinfo.get_fd_table()->peek_table();
 			for(auto it = fdtable.begin(); it != fdtable.end(); ++it)
 			{
 				//
@@ -1660,7 +1680,9 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 			throw sinsp_exception("error calling scap_proc_add in sinsp_thread_manager::to_scap (" + string(scap_getlasterr(m_inspector->m_h)) + ")");
 		}
 
-		scap_proc_free(m_inspector->m_h, sctinfo);
+		scap_fd_free_proc_fd_table(m_inspector->m_h, sctinfo);
 		return true;
 	});
+
+	scap_proc_free(m_inspector->m_h, sctinfo);
 }
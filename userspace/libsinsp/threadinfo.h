@@ -96,6 +96,12 @@ public:
 	*/
 	std::string get_cwd();
 
+	/*!
+	  \brief Like \ref get_cwd(), without the copy. Valid until the working
+	   directory changes.
+	*/
+	const std::string& get_cwd_ref();
+
 	/*!
 	  \brief Return the values of all environment variables for the process
 	  containing this thread.
@@ -198,6 +204,27 @@ public:
 		return NULL;
 	}
 
+	/*!
+	  \brief Like get_fd(), for the callers that only look at the fd: an fd
+	   table still shared with the other side of a fork() is not copied.
+	*/
+	inline const sinsp_fdinfo_t* peek_fd(int64_t fd)
+	{
+		if(fd < 0)
+		{
+			return NULL;
+		}
+
+		sinsp_fdtable* fdt = get_fd_table();
+
+		if(fdt)
+		{
+			return fdt->peek(fd);
+		}
+
+		return NULL;
+	}
+
 	/*!
 	  \brief Return true if this thread is bound to the given server port.
 	*/
@@ -408,7 +435,7 @@ VISIBILITY_PRIVATE
 			  uint32_t &alen,
 			  std::string &rem) const;
 
-	void fd_to_scap(scap_fdinfo *dst, sinsp_fdinfo_t* src);
+	void fd_to_scap(scap_fdinfo *dst, const sinsp_fdinfo_t* src);
 
 	//  void push_fdop(sinsp_fdop* op);
 	// the queue of recent fd operations
@@ -441,6 +468,8 @@ VISIBILITY_PRIVATE
 	friend class sinsp_tracerparser;
 	friend class lua_cbacks;
 	friend class sinsp_baseliner;
+	friend class sinsp_state_snapshots;
+	friend class sinsp_header_prefilter;
 };
 
 /*@}*/
@@ -0,0 +1,203 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "scap.h"
+#include "scap-int.h"
+
+//
+// A live handle whose rings already contain a batch of events, so that
+// scap_next() can be called until the batch is consumed without touching
+// the driver.
+//
+class unordered_consumption : public testing::Test
+{
+protected:
+	void SetUp()
+	{
+		m_handle = (scap_t*)calloc(1, sizeof(scap_t));
+		m_handle->m_mode = SCAP_MODE_LIVE;
+	}
+
+	void TearDown()
+	{
+		free(m_handle->m_devs);
+		free(m_handle);
+	}
+
+	//
+	// Spread nevts events with increasing timestamps over ndevs rings, a
+	// barrier_every-th of them being closes
+	//
+	void fill(uint32_t ndevs, uint32_t nevts, uint32_t barrier_every)
+	{
+		m_rings.assign(ndevs, std::vector<char>());
+		m_nevts = nevts;
+
+		for(uint32_t j = 0; j < nevts; j++)
+		{
+			scap_evt evt;
+			std::vector<char>& ring = m_rings[rand() % ndevs];
+
+			evt.ts = j;
+			evt.tid = j;
+			evt.len = sizeof(scap_evt);
+			evt.type = (barrier_every != 0 && rand() % barrier_every == 0)? PPME_SYSCALL_CLOSE_X : PPME_SYSCALL_READ_X;
+			evt.nparams = 0;
+
+			ring.insert(ring.end(), (char*)&evt, (char*)&evt + sizeof(evt));
+		}
+
+		m_handle->m_ndevs = ndevs;
+		m_handle->m_devs = (scap_device*)calloc(ndevs, sizeof(scap_device));
+
+		for(uint32_t j = 0; j < ndevs; j++)
+		{
+			m_handle->m_devs[j].m_sn_next_event = m_rings[j].empty()? NULL : &m_rings[j][0];
+			m_handle->m_devs[j].m_sn_len = (uint32_t)m_rings[j].size();
+		}
+	}
+
+	std::vector<scap_evt> consume()
+	{
+		std::vector<scap_evt> res;
+
+		while(res.size() < m_nevts)
+		{
+			scap_evt* pevt;
+			uint16_t cpuid;
+
+			EXPECT_EQ(SCAP_SUCCESS, scap_next(m_handle, &pevt, &cpuid));
+			res.push_back(*pevt);
+		}
+
+		return res;
+	}
+
+	scap_t* m_handle;
+	std::vector<std::vector<char>> m_rings;
+	uint32_t m_nevts;
+};
+
+TEST_F(unordered_consumption, ordered_by_default)
+{
+	srand(46);
+	fill(8, 5000, 0);
+
+	std::vector<scap_evt> evts = consume();
+	for(uint32_t j = 0; j < evts.size(); j++)
+	{
+		EXPECT_EQ(j, evts[j].ts);
+	}
+}
+
+TEST_F(unordered_consumption, only_live)
+{
+	m_handle->m_mode = SCAP_MODE_CAPTURE;
+	EXPECT_EQ(SCAP_FAILURE, scap_set_unordered(m_handle, true));
+}
+
+TEST_F(unordered_consumption, barriers)
+{
+	srand(47);
+
+	for(uint32_t barrier_every : {0, 1, 3, 50, 1000})
+	{
+		fill(8, 5000, barrier_every);
+		ASSERT_EQ(SCAP_SUCCESS, scap_set_unordered(m_handle, true));
+
+		std::vector<scap_evt> evts = consume();
+		std::vector<uint64_t> seen;
+		uint64_t max_ts = 0;
+		uint64_t n_out_of_order = 0;
+
+		for(uint32_t j = 0; j < evts.size(); j++)
+		{
+			seen.push_back(evts[j].ts);
+
+			if(evts[j].ts < max_ts)
+			{
+				n_out_of_order++;
+			}
+			else
+			{
+				max_ts = evts[j].ts;
+			}
+
+			//
+			// Everything older than a barrier comes before it, everything
+			// newer comes after it
+			//
+			if(evts[j].type == PPME_SYSCALL_CLOSE_X)
+			{
+				EXPECT_EQ(j, evts[j].ts) << "barrier_every " << barrier_every;
+			}
+		}
+
+		// Every event exactly once
+		std::sort(seen.begin(), seen.end());
+		for(uint32_t j = 0; j < seen.size(); j++)
+		{
+			ASSERT_EQ(j, seen[j]);
+		}
+
+		if(barrier_every == 0)
+		{
+			EXPECT_GT(n_out_of_order, 0u);
+		}
+		else if(barrier_every == 1)
+		{
+			EXPECT_EQ(0u, n_out_of_order);
+		}
+
+		free(m_handle->m_devs);
+		m_handle->m_devs = NULL;
+	}
+}
+
+TEST_F(unordered_consumption, per_cpu_order)
+{
+	srand(48);
+	fill(4, 5000, 20);
+	ASSERT_EQ(SCAP_SUCCESS, scap_set_unordered(m_handle, true));
+
+	std::vector<uint64_t> last_ts(4, 0);
+	std::vector<bool> started(4, false);
+
+	for(uint32_t j = 0; j < m_nevts; j++)
+	{
+		scap_evt* pevt;
+		uint16_t cpuid;
+
+		ASSERT_EQ(SCAP_SUCCESS, scap_next(m_handle, &pevt, &cpuid));
+		ASSERT_LT(cpuid, 4);
+
+		if(started[cpuid])
+		{
+			EXPECT_GT(pevt->ts, last_ts[cpuid]);
+		}
+
+		started[cpuid] = true;
+		last_ts[cpuid] = pevt->ts;
+	}
+}
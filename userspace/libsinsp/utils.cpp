@@ -126,6 +126,7 @@ sinsp_initializer::sinsp_initializer()
 	//
 	g_infotables.m_event_info = scap_get_event_info_table();
 	g_infotables.m_syscall_info_table = scap_get_syscall_info_table();
+	g_infotables.m_param_lookup.init(g_infotables.m_event_info);
 
 	//
 	// Init the logger
@@ -533,146 +534,87 @@ bool sinsp_utils::sockinfo_to_str(sinsp_sockinfo* sinfo, scap_fd_type stype, cha
 }
 
 //
-// Helper function to move a directory up in a path string
+// Append path to the normalized path that ends at target, one component at a
+// time: "." components and repeated '/' are dropped, ".." removes the last
+// component written, down to targetbase + 1 at most. Only the path is
+// scanned, the prefix is only looked at when rewinding over its last
+// components. Non printable characters are replaced with '.', as they
+// would break the output. Returns the end of the result.
 //
-void rewind_to_parent_path(char* targetbase, char** tc, const char** pc, uint32_t delta)
+static char* append_normalized_path(char* targetbase, char* target, const char* path)
 {
-	if(*tc <= targetbase + 1)
-	{
-		(*pc) += delta;
-		return;
-	}
-
-	(*tc)--;
+	char* tc = target;
+	const char* pc = path;
 
-	while(*((*tc) - 1) != '/' && (*tc) >= targetbase + 1)
+	if(*pc == '/' && tc == targetbase)
 	{
-		(*tc)--;
+		*tc++ = '/';
 	}
 
-	(*pc) += delta;
-}
-
-//
-// Args:
-//  - target: the string where we are supposed to start copying
-//  - targetbase: the base of the path, i.e. the furthest we can go back when
-//                following parent directories
-//  - path: the path to copy
-//
-void copy_and_sanitize_path(char* target, char* targetbase, const char* path)
-{
-	char* tc = target;
-	const char* pc = path;
-	g_invalidchar ic;
-
-	while(true)
+	while(*pc != 0)
 	{
-		if(*pc == 0)
+		if(*pc == '/')
 		{
-			*tc = 0;
-
-			//
-			// If the path ends with a '/', remove it, as the OS does.
-			//
-			if((tc > (targetbase + 1)) && (*(tc - 1) == '/'))
-			{
-				*(tc - 1) = 0;
-			}
+			pc++;
+			continue;
+		}
 
-			return;
+		//
+		// A component starts here, find where it ends
+		//
+		const char* end = pc;
+		while(*end != 0 && *end != '/')
+		{
+			end++;
 		}
 
-		if(ic(*pc))
+		if(end - pc == 1 && pc[0] == '.')
 		{
-			//
-			// Invalid char, substitute with a '.'
-			//
-			*tc = '.';
-			tc++;
-			pc++;
+			// Nothing to do
 		}
-		else
+		else if(end - pc == 2 && pc[0] == '.' && pc[1] == '.')
 		{
-			if(*pc == '.' && *(pc + 1) == '.' && *(pc + 2) == '/')
+			//
+			// Rewind to the parent. tc is right after a '/' here, or at
+			// targetbase.
+			//
+			if(tc > targetbase + 1)
 			{
-				//
-				// '../', rewind to the previous '/'
-				//
-				rewind_to_parent_path(targetbase, &tc, &pc, 3);
+				tc--;
 
-			}
-			else if(*pc == '.' && *(pc + 1) == '.')
-			{
-				//
-				// '..', with no '/'.
-				// This is valid if we are at the end of the string, and in that case we rewind.
-				// Otherwise it shouldn't happen and we leave the string intact
-				//
-				if(*(pc + 2) == 0)
+				while(tc > targetbase && *(tc - 1) != '/')
 				{
-					rewind_to_parent_path(targetbase, &tc, &pc, 2);
+					tc--;
 				}
-				else
-				{
-					*tc = '.';
-					*(tc + 1) = '.';
-					pc += 2;
-					tc += 2;
-				}
-			}
-			else if(*pc == '.' && *(pc + 1) == '/')
-			{
-				//
-				// './', just skip it
-				//
-				pc += 2;
 			}
-			else if(*pc == '.')
-			{
-				//
-				// '.', with no '/'.
-				// This is valid if we are at the end of the string, and in that case we rewind.
-				// Otherwise it shouldn't happen and we leave the string intact
-				//
-				if(*(pc + 1) == 0)
-				{
-					pc++;
-				}
-				else
-				{
-					*tc = *pc;
-					tc++;
-					pc++;
-				}
-			}
-			else if(*pc == '/')
+		}
+		else
+		{
+			for(; pc < end; pc++)
 			{
-				//
-				// '/', if the last char is already a '/', skip it
-				//
-				if(tc > targetbase && *(tc - 1) == '/')
-				{
-					pc++;
-				}
-				else
-				{
-					*tc = *pc;
-					tc++;
-					pc++;
-				}
+				// Printable ASCII, like isprint() in the C locale
+				*tc++ = ((unsigned char)(*pc - 0x20) < 0x5f) ? *pc : '.';
 			}
-			else
+
+			if(*end == '/')
 			{
-				//
-				// Normal char, copy it
-				//
-				*tc = *pc;
-				tc++;
-				pc++;
+				*tc++ = '/';
 			}
 		}
+
+		pc = end;
 	}
+
+	//
+	// If the path ends with a '/', remove it, as the OS does.
+	//
+	if((tc > (targetbase + 1)) && (*(tc - 1) == '/'))
+	{
+		tc--;
+	}
+
+	*tc = 0;
+	return tc;
 }
 
 //
@@ -685,7 +627,9 @@ bool sinsp_utils::concatenate_paths(char* target,
 									const char* path2,
 									uint32_t len2)
 {
-	if(targetlen < (len1 + len2 + 1))
+	bool add_slash = (len1 != 0 && path1[len1 - 1] != '/');
+
+	if(targetlen < (len1 + (add_slash ? 1 : 0) + len2 + 1))
 	{
 		strcpy(target, "/PATH_TOO_LONG");
 		return false;
@@ -694,13 +638,17 @@ bool sinsp_utils::concatenate_paths(char* target,
 	if(len2 != 0 && path2[0] != '/')
 	{
 		memcpy(target, path1, len1);
-		copy_and_sanitize_path(target + len1, target, path2);
+		if(add_slash)
+		{
+			target[len1++] = '/';
+		}
+
+		append_normalized_path(target, target + len1, path2);
 		return true;
 	}
 	else
 	{
-		target[0] = 0;
-		copy_and_sanitize_path(target, target, path2);
+		append_normalized_path(target, target, path2);
 		return false;
 	}
 }
@@ -81,7 +81,9 @@ public:
 	// Concatenate two paths and puts the result in "target".
 	// If path2 is relative, the concatenation happens and the result is true.
 	// If path2 is absolute, the concatenation does not happen, target contains path2 and the result is false.
-	// Assumes that path1 is well formed.
+	// Assumes that path1 is well formed, i.e. already normalized. The '/'
+	// between the two is added if path1 doesn't end with one. path2 is
+	// normalized like the kernel would, without following symlinks.
 	//
 	static bool concatenate_paths(char* target, uint32_t targetlen, const char* path1, uint32_t len1, const char* path2, uint32_t len2);
 
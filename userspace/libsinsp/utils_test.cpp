@@ -0,0 +1,200 @@
+/*
+Copyright (C) 2013-2018 Draios Inc dba Sysdig.
+
+This file is part of sysdig.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "sinsp.h"
+#include "utils.h"
+
+static std::string concatenate(const std::string& dir, const std::string& path)
+{
+	char target[SCAP_MAX_PATH_SIZE];
+
+	sinsp_utils::concatenate_paths(target, sizeof(target),
+		dir.c_str(), (uint32_t)dir.length(),
+		path.c_str(), (uint32_t)path.length() + 1);
+
+	return target;
+}
+
+//
+// What realpath() returns for an absolute path, without following symlinks
+//
+static std::string reference_resolve(const std::string& dir, const std::string& path)
+{
+	std::string full = (!path.empty() && path[0] == '/') ? path : dir + "/" + path;
+	std::vector<std::string> components;
+	size_t pos = 0;
+
+	while(pos <= full.length())
+	{
+		size_t end = full.find('/', pos);
+		if(end == std::string::npos)
+		{
+			end = full.length();
+		}
+
+		std::string component = full.substr(pos, end - pos);
+
+		if(component == "..")
+		{
+			if(!components.empty())
+			{
+				components.pop_back();
+			}
+		}
+		else if(!component.empty() && component != ".")
+		{
+			components.push_back(component);
+		}
+
+		pos = end + 1;
+	}
+
+	std::string res;
+	for(auto& it : components)
+	{
+		res += "/" + it;
+	}
+
+	return res.empty() ? "/" : res;
+}
+
+TEST(concatenate_paths, relative)
+{
+	EXPECT_EQ("/home/user/file", concatenate("/home/user/", "file"));
+	EXPECT_EQ("/home/user/file", concatenate("/home/user", "file"));
+	EXPECT_EQ("/home/file", concatenate("/home/user/", "../file"));
+	EXPECT_EQ("/home/user/file", concatenate("/home/user/", "./file"));
+	EXPECT_EQ("/home/user/a/b", concatenate("/home/user/", "a//b/"));
+	EXPECT_EQ("/", concatenate("/home/user/", "../../../.."));
+	EXPECT_EQ("/home", concatenate("/home/user/", ".."));
+	EXPECT_EQ("/home/user", concatenate("/home/user/", "."));
+	EXPECT_EQ("/file", concatenate("/", "file"));
+}
+
+TEST(concatenate_paths, absolute)
+{
+	char target[SCAP_MAX_PATH_SIZE];
+	const char* path = "/etc//./passwd";
+
+	EXPECT_FALSE(sinsp_utils::concatenate_paths(target, sizeof(target), "/home/", 6, path, (uint32_t)strlen(path) + 1));
+	EXPECT_STREQ("/etc/passwd", target);
+}
+
+//
+// The dots only have a meaning as whole components
+//
+TEST(concatenate_paths, dots_in_names)
+{
+	EXPECT_EQ("/tmp/a./b", concatenate("/tmp/", "a./b"));
+	EXPECT_EQ("/tmp/a../b", concatenate("/tmp/", "a../b"));
+	EXPECT_EQ("/tmp/.hidden", concatenate("/tmp/", ".hidden"));
+	EXPECT_EQ("/tmp/...", concatenate("/tmp/", "..."));
+	EXPECT_EQ("/tmp/..x/y", concatenate("/tmp/", "..x/y"));
+}
+
+TEST(concatenate_paths, invalid_chars)
+{
+	EXPECT_EQ("/tmp/a.b", concatenate("/tmp/", "a\nb"));
+}
+
+TEST(concatenate_paths, too_long)
+{
+	char target[16];
+	const char* path = "0123456789";
+
+	EXPECT_FALSE(sinsp_utils::concatenate_paths(target, sizeof(target), "/home/", 6, path, (uint32_t)strlen(path) + 1));
+	EXPECT_STREQ("/PATH_TOO_LONG", target);
+}
+
+TEST(concatenate_paths, random)
+{
+	const char* components[] = {"a", "bb", ".", "..", "...", "x.", "..y", ".z", ""};
+	const uint32_t ncomponents = sizeof(components) / sizeof(components[0]);
+
+	srand(42);
+
+	for(uint32_t j = 0; j < 100000; j++)
+	{
+		//
+		// The directory comes from the thread or fd tables, so it's always
+		// normalized
+		//
+		std::string dir = reference_resolve("/", std::string("/") + components[rand() % 3] + "/" + components[rand() % 3]);
+		std::string path = (rand() % 4 == 0) ? "/" : "";
+		uint32_t n = rand() % 6;
+
+		for(uint32_t k = 0; k < n; k++)
+		{
+			path += components[rand() % ncomponents];
+			path += (rand() % 3 == 0) ? "//" : "/";
+		}
+
+		if(rand() % 2 == 0)
+		{
+			path += components[rand() % ncomponents];
+		}
+
+		if(path.empty())
+		{
+			continue;
+		}
+
+		ASSERT_EQ(reference_resolve(dir, path), concatenate(dir, path)) << dir << " + " << path;
+	}
+}
+
+//
+// The paths of an open-heavy workload: mostly relative to the cwd, a few
+// climbing out of it
+//
+TEST(concatenate_paths, DISABLED_benchmark)
+{
+	const uint32_t n = 5000000;
+	std::string cwd = "/var/lib/docker/overlay2/0123456789abcdef0123456789abcdef/merged/usr/src/app/";
+	const char* paths[] = {
+		"node_modules/express/lib/router/index.js",
+		"./package.json",
+		"../lib/x86_64-linux-gnu/libc.so.6",
+		"src/../build/./out/main.o",
+	};
+	char target[SCAP_MAX_PATH_SIZE];
+	uint32_t lens[4];
+	uint64_t totlen = 0;
+
+	for(uint32_t j = 0; j < 4; j++)
+	{
+		lens[j] = (uint32_t)strlen(paths[j]) + 1;
+	}
+
+	uint64_t start = sinsp_utils::get_current_time_ns();
+
+	for(uint32_t j = 0; j < n; j++)
+	{
+		sinsp_utils::concatenate_paths(target, sizeof(target), cwd.c_str(), (uint32_t)cwd.length(), paths[j % 4], lens[j % 4]);
+		totlen += target[0];
+	}
+
+	uint64_t duration = sinsp_utils::get_current_time_ns() - start;
+
+	printf("%.1f ns per path (%" PRIu64 ")\n", (double)duration / n, totlen);
+}
@@ -26,6 +26,18 @@ category = "Performance";
 -- Chisel argument list
 args =
 {
+	{
+		name = "format",
+		description = "html (the default) for the flame UI page, or collapsed for one 'tag;tag;tag time_ns' line per span path, in the format taken by flamegraph.pl. The collapsed output is aggregated natively and uses bounded memory.",
+		argtype = "string",
+		optional = true
+	},
+	{
+		name = "max_nodes",
+		description = "With the collapsed format, the maximum number of span paths kept in memory. When there are more, the ones with the smallest time are merged into their parent. The default is 65536.",
+		argtype = "int",
+		optional = true
+	},
 }
 
 require "common"
@@ -33,6 +45,9 @@ json = require ("dkjson")
 
 local CAPTURE_LOGS = true
 
+local collapsed = false
+local max_nodes = 65536
+
 local spans = {}
 local fid
 local flatency
@@ -86,11 +101,28 @@ local PAGE_TRAILER = [[            };
 
 -- Argument notification callback
 function on_set_arg(name, val)
+	if name == "format" then
+		if val == "collapsed" then
+			collapsed = true
+		elseif val ~= "html" then
+			print("invalid format " .. val)
+			return false
+		end
+	elseif name == "max_nodes" then
+		max_nodes = parse_numeric_input(val, name)
+	end
+
 	return true
 end
 
 -- Initialization callback
 function on_init()
+	if collapsed then
+		chisel.set_span_aggregation(max_nodes)
+		chisel.set_filter("evt.type=tracer and evt.dir=<")
+		return true
+	end
+
 	-- Request the fields needed for this chisel
 	for j = 0, MAX_DEPTH do
 		local fname = "span.tag[" .. j .. "]"
@@ -261,6 +293,10 @@ end
 
 -- Event parsing callback
 function on_event()
+	if collapsed then
+		return true
+	end
+
 	local etype = evt.get_type()
 
 	if etype ~= "tracer" then
@@ -477,6 +513,11 @@ end
 
 -- Called by the engine at the end of the capture (Ctrl-C)
 function on_capture_end()
+	if collapsed then
+		chisel.print_span_aggregation()
+		return
+	end
+
 --print(st(full_tree))
 	-- Process the list and create the required transactions
 	collapse_tree()
@@ -89,15 +89,13 @@ function on_capture_end()
 		return
 	end
 
-	local ttable = sysdig.get_thread_table(filter)
-
 	print(extend_string("Proto", 6) ..
 		extend_string("Server Address", 25) ..
 		extend_string("Client Address", 25) ..
 		extend_string("State", 15) ..
 		"TID/PID/Program Name")
 
-	for tid, proc in pairs(ttable) do
+	for tid, proc in sysdig.iter_thread_table(filter) do
 		local fdtable = proc.fdtable
 		
 		for fd, fdinfo in pairs(fdtable) do
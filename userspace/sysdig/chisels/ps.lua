@@ -88,10 +88,9 @@ function on_capture_end(ts_s, ts_ns, delta)
 		return
 	end
 	
-	local ttable = sysdig.get_thread_table(filter)
+	-- The threads come sorted by tid, one at a time
+	local sorted_ttable = sysdig.iter_thread_table_nofds(filter)
 
-	local sorted_ttable = pairs_top_by_val(ttable, 0, function(t,a,b) return a < b end)
-	
 	print(extend_string("TID", 8) ..
 		extend_string("PID", 8) ..
 		extend_string("USER", 12) ..
@@ -196,6 +196,25 @@ function on_interval(ts_s, ts_ns, delta)
 	return true
 end
 
+-- Offline runs over multiple files with --parallel: every shard returns its
+-- partial table, which is summed into the table of the process that prints
+-- the result
+function get_mergeable_result()
+	return grtable
+end
+
+function on_merge(result)
+	for key, value in pairs(result) do
+		entryval = grtable[key]
+
+		if entryval == nil then
+			grtable[key] = value
+		else
+			grtable[key] = entryval + value
+		end
+	end
+end
+
 -- Called by the engine at the end of the capture (Ctrl-C)
 function on_capture_end(ts_s, ts_ns, delta)
 	if islive and vizinfo.output_format ~= "json" then
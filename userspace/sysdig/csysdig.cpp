@@ -27,6 +27,10 @@ limitations under the License.
 #include <sys/stat.h>
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <sinsp.h>
 #include "chisel.h"
@@ -73,6 +77,11 @@ static void usage()
 " -A, --print-ascii  When emitting JSON, only print the text portion of data buffers, and echo\n"
 "                    end-of-lines. This is useful to only display human-readable\n"
 "                    data.\n"
+" --async-user-lookups\n"
+"                    Don't read all the users and groups when the capture\n"
+"                    starts, look up the ones that show up on a background\n"
+"                    thread. Faster to start with LDAP or SSSD directories,\n"
+"                    but their name is <NA> until the lookup completes.\n"
 " -B<bpf_probe>, --bpf=<bpf_probe>\n"
 "                    Enable live capture using the specified BPF probe instead of the kernel module.\n"
 "                    The BPF probe can also be specified via the environment variable\n"
@@ -129,6 +138,10 @@ static void usage()
 "                    Print program logs into the given file.\n"
 " -n <num>, --numevents=<num>\n"
 "                    Stop capturing after <num> events\n"
+" --no-chisel-cache  Don't read or write the cache of the view descriptions\n"
+"                    (~/.cache/sysdig/chisel_catalog.json, see also the\n"
+"                    SYSDIG_CHISEL_CACHE environment variable), and load all\n"
+"                    the views at startup.\n"
 " --page-faults      Capture user/kernel major/minor page faults\n"
 " -pc, -pcontainer\n"
 "                    Instruct csysdig to use a container-friendly format in its\n"
@@ -196,6 +209,22 @@ static void add_chisel_dirs(sinsp* inspector)
 			inspector->add_chisel_dir(user_cdirs[j], true);
 		}
 	}
+
+	//
+	// Cache the chisel and view metadata across runs. SYSDIG_CHISEL_CACHE
+	// overrides the catalog location, and setting it to an empty string
+	// disables the cache.
+	//
+	char* s_cache_file = getenv("SYSDIG_CHISEL_CACHE");
+
+	if(s_cache_file != NULL)
+	{
+		sinsp_chisel::set_catalog_cache_file(s_cache_file, SYSDIG_VERSION);
+	}
+	else
+	{
+		sinsp_chisel::set_catalog_cache_file(sinsp_chisel::get_default_catalog_cache_file(), SYSDIG_VERSION);
+	}
 }
 
 static void print_views(sinsp_view_manager* view_manager)
@@ -295,6 +324,135 @@ captureinfo do_inspect(sinsp* inspector,
 	return retval;
 }
 
+#ifndef NOCURSESUI
+//
+// Number of events that the capture thread processes before giving the UI
+// thread a chance to grab the capture lock
+//
+#define CAPTURE_THREAD_BATCH_SIZE 1024
+#define UI_THREAD_POLL_PERIOD_US 20000
+
+//
+// Live capture with the curses UI: a capture thread consumes the events and
+// updates the tables, while this thread handles the keyboard and renders the
+// table samples that the capture thread hands off at every refresh interval.
+// This way, drawing the screen doesn't stall the capture and the input is
+// handled even when the capture thread is busy.
+//
+captureinfo do_inspect_threaded(sinsp* inspector,
+					   uint64_t cnt,
+					   sinsp_cursesui* ui)
+{
+	captureinfo retval;
+	mutex capture_mtx;
+	condition_variable capture_cv;
+	atomic<bool> ui_waiting(false);
+	atomic<bool> done(false);
+	exception_ptr error;
+
+	ui->set_threaded_capture(true);
+
+	thread capture_thread([&]()
+	{
+		try
+		{
+			while(!done)
+			{
+				unique_lock<mutex> lock(capture_mtx);
+
+				//
+				// Let the UI thread in if it's waiting for the lock
+				//
+				capture_cv.wait(lock, [&]() { return !ui_waiting; });
+
+				for(uint32_t j = 0; j < CAPTURE_THREAD_BATCH_SIZE; j++)
+				{
+					if(retval.m_nevts == cnt || g_terminate)
+					{
+						done = true;
+						break;
+					}
+
+					sinsp_evt* ev;
+					int32_t res = inspector->next(&ev);
+
+					if(res == SCAP_TIMEOUT)
+					{
+						break;
+					}
+					else if(res != SCAP_EOF && res != SCAP_SUCCESS)
+					{
+						throw sinsp_exception(inspector->getlasterr());
+					}
+
+					if(ui->process_event(ev, res) == true)
+					{
+						done = true;
+						break;
+					}
+
+					retval.m_nevts++;
+				}
+			}
+		}
+		catch(...)
+		{
+			lock_guard<mutex> lock(capture_mtx);
+			error = current_exception();
+			done = true;
+		}
+	});
+
+	while(!done)
+	{
+		try
+		{
+			ui_waiting = true;
+
+			{
+				lock_guard<mutex> lock(capture_mtx);
+				ui_waiting = false;
+
+				if(!done && ui->handle_input_threaded() == true)
+				{
+					done = true;
+				}
+			}
+
+			capture_cv.notify_all();
+
+			if(!done)
+			{
+				ui->render_published_sample();
+				usleep(UI_THREAD_POLL_PERIOD_US);
+			}
+		}
+		catch(...)
+		{
+			lock_guard<mutex> lock(capture_mtx);
+			if(!error)
+			{
+				error = current_exception();
+			}
+			ui_waiting = false;
+			done = true;
+		}
+	}
+
+	capture_cv.notify_all();
+	capture_thread.join();
+
+	ui->set_threaded_capture(false);
+
+	if(error)
+	{
+		rethrow_exception(error);
+	}
+
+	return retval;
+}
+#endif
+
 string g_version_string = SYSDIG_VERSION;
 
 sysdig_init_res csysdig_init(int argc, char **argv)
@@ -309,6 +467,7 @@ sysdig_init_res csysdig_init(int argc, char **argv)
 	int32_t n_filterargs = 0;
 	captureinfo cinfo;
 	string errorstr;
+	string dropped_samples_msg;
 	string display_view;
 	bool print_containers = false;
 	uint64_t refresh_interval_ns = 2000000000;
@@ -341,6 +500,7 @@ sysdig_init_res csysdig_init(int argc, char **argv)
 	static struct option long_options[] =
 	{
 		{"print-ascii", no_argument, 0, 'A' },
+		{"async-user-lookups", no_argument, 0, 0 },
 		{"bpf", optional_argument, 0, 'B' },
 #ifdef HAS_CAPTURE
 		{"cri", required_argument, 0, 0 },
@@ -358,6 +518,7 @@ sysdig_init_res csysdig_init(int argc, char **argv)
 		{"list", optional_argument, 0, 'l' },
 		{"list-views", no_argument, 0, 0},
 		{"mesos-api", required_argument, 0, 'm'},
+		{"no-chisel-cache", no_argument, 0, 0 },
 		{"numevents", required_argument, 0, 'n' },
 		{"page-faults", no_argument, 0, 0 },
 		{"print", required_argument, 0, 'p' },
@@ -524,6 +685,10 @@ sysdig_init_res csysdig_init(int argc, char **argv)
 						delete inspector;
 						return sysdig_init_res(EXIT_SUCCESS);
 					}
+					else if(optname == "async-user-lookups")
+					{
+						inspector->set_async_user_lookups(true);
+					}
 					else if(optname == "interactive")
 					{
 						is_interactive = true;
@@ -547,6 +712,10 @@ sysdig_init_res csysdig_init(int argc, char **argv)
 					{
 						inspector->set_log_file(optarg);
 					}
+					else if(optname == "no-chisel-cache")
+					{
+						sinsp_chisel::set_catalog_cache_file("");
+					}
 					else if(optname == "raw")
 					{
 						output_type = sinsp_table::OT_RAW;
@@ -967,9 +1136,28 @@ sysdig_init_res csysdig_init(int argc, char **argv)
 			//
 			// Start the capture loop
 			//
-			cinfo = do_inspect(inspector,
-				cnt,
-				&ui);
+#ifndef NOCURSESUI
+			if(output_type == sinsp_table::OT_CURSES && inspector->is_live())
+			{
+				cinfo = do_inspect_threaded(inspector,
+					cnt,
+					&ui);
+
+				sinsp_table_sample_handoff* handoff = ui.get_sample_handoff();
+				if(handoff->get_n_dropped() != 0)
+				{
+					dropped_samples_msg = to_string(handoff->get_n_dropped()) + " of " +
+						to_string(handoff->get_n_published()) +
+						" table samples were not displayed because the UI was busy";
+				}
+			}
+			else
+#endif
+			{
+				cinfo = do_inspect(inspector,
+					cnt,
+					&ui);
+			}
 
 			if(output_type == sinsp_table::OT_JSON)
 			{
@@ -1023,6 +1211,11 @@ exit:
 		cerr << errorstr << endl;
 	}
 
+	if(dropped_samples_msg != "")
+	{
+		cerr << dropped_samples_msg << endl;
+	}
+
 	return res;
 }
 
@@ -39,6 +39,8 @@ limitations under the License.
 #else
 #include <unistd.h>
 #include <getopt.h>
+#include <poll.h>
+#include <sys/wait.h>
 #endif
 
 static bool g_terminate = false;
@@ -46,6 +48,9 @@ static bool g_terminate = false;
 vector<sinsp_chisel*> g_chisels;
 #endif
 
+// True when the input files are split across processes (--parallel)
+static bool g_shards_enabled = false;
+
 static void usage();
 
 //
@@ -68,6 +73,21 @@ static void usage()
 " -A, --print-ascii  Only print the text portion of data buffers, and echo\n"
 "                    end-of-lines. This is useful to only display human-readable\n"
 "                    data.\n"
+" --async-log        Write the log messages (see -D) from a background thread\n"
+"                    instead of the thread that processes the events. If the\n"
+"                    messages come faster than they can be written, some are\n"
+"                    dropped and a warning with the count is logged.\n"
+" --async-proc-lookups=<num>\n"
+"                    Read /proc on <num> background threads when a process\n"
+"                    shows up without a clone or an execve, e.g. after drops.\n"
+"                    Its events are shown with <NA> as process name until the\n"
+"                    lookup completes, instead of stalling the capture. Use -v\n"
+"                    to see the lookup latencies at the end of the capture.\n"
+" --async-user-lookups\n"
+"                    Don't read all the users and groups when the capture\n"
+"                    starts, look up the ones that show up on a background\n"
+"                    thread. Faster to start with LDAP or SSSD directories,\n"
+"                    but their name is <NA> until the lookup completes.\n"
 " -b, --print-base64 Print data buffers in base64. This is useful for encoding\n"
 "                    binary data that needs to be used over media designed to\n"
 "                    handle textual data (i.e., terminal or json).\n"
@@ -76,6 +96,11 @@ static void usage()
 "                    The BPF probe can also be specified via the environment variable\n"
 "                    SYSDIG_BPF_PROBE. If <bpf_probe> is left empty, sysdig will\n"
 "                    try to load one from the sysdig-probe-loader script.\n"
+" --binary-container-events\n"
+"                    Write the container information in a compact binary format\n"
+"                    instead of JSON. It's faster to parse and smaller in the\n"
+"                    trace files, but the files can't be read by sysdig versions\n"
+"                    older than this one.\n"
 #ifdef HAS_CHISELS
 " -c <chiselname> <chiselargs>, --chisel <chiselname> <chiselargs>\n"
 "                    run the specified chisel. If the chisel require arguments,\n"
@@ -92,6 +117,11 @@ static void usage()
 "                    starting at 0 and continuing upward. The units of file_size\n"
 "                    are millions of bytes (10^6, not 2^20). Use the -W flag to\n"
 "                    determine how many files will be saved to disk.\n"
+" --checkpoint-interval=<sec>\n"
+"                    When writing trace files with -w, store the process, fd and\n"
+"                    container tables in the file every <sec> seconds of capture\n"
+"                    time. Reading can then start from any of these checkpoints\n"
+"                    with the right state, e.g. to split a file with --parallel.\n"
 #ifdef HAS_CAPTURE
 " --cri <path>       Path to CRI socket for container metadata\n"
 "                    Use the specified socket to fetch data from a CRI-compatible runtime\n"
@@ -99,6 +129,11 @@ static void usage()
 " --cri-timeout <timeout_ms>\n"
 "                    Wait at most <timeout_ms> milliseconds for response from CRI\n"
 #endif
+" --cpu-affinity=<cpu>\n"
+"                    Pin the thread that reads the events to the given CPU. On\n"
+"                    hosts with multiple NUMA nodes, pick a CPU on the node that\n"
+"                    runs most of the activity to capture. Use -v to see the\n"
+"                    effective placement at the end of the capture.\n"
 " -d, --displayflt   Make the given filter a display one\n"
 "                    Setting this option causes the events to be filtered\n"
 "                    after being parsed by the state system. Events are\n"
@@ -107,6 +142,10 @@ static void usage()
 " -D, --debug        Capture events about sysdig itself, display internal events\n"
 "                    in addition to system events, and print additional\n"
 "                    logging on standard error.\n"
+" --dump-from-state  When writing trace files with -w, write the process and fd\n"
+"                    tables at the beginning of each file from what sysdig knows\n"
+"                    instead of rescanning /proc. With -C, -G or -e, this makes\n"
+"                    starting a new file on a busy host much faster.\n"
 " -E, --exclude-users\n"
 "                    Don't create the user/group tables by querying the OS when\n"
 "                    sysdig starts. This also means that no user or group info\n"
@@ -145,6 +184,12 @@ static void usage()
 "                    If no data format is specified, this can be used with -W flag to\n"
 "                    create a ring buffer of events.\n"
 " -h, --help         Print this page\n"
+" --hugepages=transparent|explicit\n"
+"                    Back the capture ring buffers and the large event buffers\n"
+"                    with hugepages to reduce the TLB misses when reading events.\n"
+"                    'transparent' uses transparent hugepages, 'explicit' uses the\n"
+"                    hugepages reserved in /proc/sys/vm/nr_hugepages and falls\n"
+"                    back to transparent hugepages if there are none left.\n"
 #ifdef HAS_CHISELS
 " -i <chiselname>, --chisel-info <chiselname>\n"
 "                    Get a longer description and the arguments associated with\n"
@@ -189,7 +234,31 @@ static void usage()
 " -M <num_seconds>   Stop collecting after <num_seconds> reached.\n"
 " -n <num>, --numevents=<num>\n"
 "                    Stop capturing after <num> events\n"
+#ifdef HAS_CHISELS
+" --no-chisel-cache  Don't read or write the cache of the chisel descriptions\n"
+"                    (~/.cache/sysdig/chisel_catalog.json, see also the\n"
+"                    SYSDIG_CHISEL_CACHE environment variable), and load all\n"
+"                    the chisels to list them. Put it before -cl and -i.\n"
+#endif
+" --unordered        Read the events of a live capture one CPU at a time instead\n"
+"                    of in timestamp order, which is faster. Use this with\n"
+"                    chisels and filters that only count events or bytes: the\n"
+"                    events that change the process and fd state are still\n"
+"                    parsed in order, but the other ones can be out of order\n"
+"                    across CPUs, so time deltas and latencies are not reliable.\n"
+" --numa-local-alloc Allocate the memory of the thread that reads the events on\n"
+"                    the NUMA node it runs on (see --cpu-affinity).\n"
 " --page-faults      Capture user/kernel major/minor page faults\n"
+#ifdef HAS_CHISELS
+" --parallel=<num>   When reading multiple trace files with chisels, process\n"
+"                    them with <num> processes and merge the results. This\n"
+"                    only works with the chisels that can merge their results\n"
+"                    (e.g. the table chisels like topfiles_bytes); the others\n"
+"                    process the files sequentially. Every file is parsed\n"
+"                    with the state that it contains, like in a sequential run.\n"
+"                    With fewer files than processes, the files are also split\n"
+"                    at their checkpoints (see --checkpoint-interval).\n"
+#endif
 " -P, --progress     Print progress on stderr while processing trace files\n"
 " -p <output_format>, --print=<output_format>\n"
 "                    Specify the format to be used when printing the events.\n"
@@ -358,6 +427,22 @@ static void add_chisel_dirs(sinsp* inspector)
 			inspector->add_chisel_dir(user_cdirs[j], true);
 		}
 	}
+
+	//
+	// Cache the chisel and view metadata across runs. SYSDIG_CHISEL_CACHE
+	// overrides the catalog location, and setting it to an empty string
+	// disables the cache.
+	//
+	char* s_cache_file = getenv("SYSDIG_CHISEL_CACHE");
+
+	if(s_cache_file != NULL)
+	{
+		sinsp_chisel::set_catalog_cache_file(s_cache_file, SYSDIG_VERSION);
+	}
+	else
+	{
+		sinsp_chisel::set_catalog_cache_file(sinsp_chisel::get_default_catalog_cache_file(), SYSDIG_VERSION);
+	}
 }
 #endif
 
@@ -494,6 +579,364 @@ static void chisels_do_timeout(sinsp_evt* ev)
 #endif
 }
 
+static void chisels_on_shard_end()
+{
+#ifdef HAS_CHISELS
+	for(vector<sinsp_chisel*>::iterator it = g_chisels.begin();
+		it != g_chisels.end(); ++it)
+	{
+		(*it)->on_shard_end();
+	}
+#endif
+}
+
+#if defined(HAS_CHISELS) && !defined(_WIN32)
+//
+// --parallel runs an offline capture made of multiple files (e.g. the output
+// of -C/-G/-e) with several processes, each one with its own inspector and
+// chisel instances:
+//  - the workers are forked before opening anything, so they start from the
+//    same state as the parent
+//  - the unit of work is a file or, when there are fewer files than
+//    processes, the chunk of a file between two of its checkpoints. Every
+//    chunk starts from the state stored in its checkpoint and stops at the
+//    next one, so the only difference with a sequential run is the system
+//    calls whose enter event is in the previous chunk.
+//  - the shard indexes are in a pipe that all the processes read from, so a
+//    process picks a new shard as soon as it's done with the previous one.
+//    The parent always takes the first shard.
+//  - every process parses its files exactly like the sequential loop does,
+//    i.e. starting from the state (process and fd tables) stored in the file.
+//    As a consequence, the results are the same as a sequential run: state
+//    that is not in a file (like a system call whose enter event is in the
+//    previous file) is lost in both cases.
+//  - when they run out of files, the workers send the partial results of
+//    their chisels to the parent through another pipe and exit. The parent
+//    merges them into its own chisels, and then calls on_capture_end() once.
+//
+struct shard_info
+{
+	uint32_t m_fileidx;
+	// Where to start, and whether to stop at the next checkpoint
+	scap_checkpoint_info m_start;
+	bool m_chunk;
+};
+
+static vector<shard_info> g_shards;
+static bool g_is_shard_worker = false;
+static bool g_first_shard_taken = false;
+static int g_shard_jobs_fd = -1;
+static int g_shard_result_fd = -1;
+static vector<pair<pid_t, int>> g_shard_workers;
+
+static bool chisels_are_mergeable()
+{
+	for(uint32_t j = 0; j < g_chisels.size(); j++)
+	{
+		if(!g_chisels[j]->is_mergeable())
+		{
+			fprintf(stderr, "chisel %s can't merge its results, processing the files sequentially\n",
+				g_chisels[j]->get_name().c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void write_all(int fd, const char* buf, size_t len)
+{
+	while(len > 0)
+	{
+		ssize_t res = write(fd, buf, len);
+		if(res < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			throw sinsp_exception(string("error writing to pipe: ") + strerror(errno));
+		}
+
+		buf += res;
+		len -= res;
+	}
+}
+
+static void build_shards(const vector<string>& infiles, uint32_t nworkers)
+{
+	for(uint32_t j = 0; j < infiles.size(); j++)
+	{
+		vector<scap_checkpoint_info> checkpoints;
+		shard_info shard;
+
+		//
+		// Looking for the checkpoints means reading the whole file, so
+		// it's only worth it when the files alone can't keep all the
+		// processes busy
+		//
+		if(infiles.size() < nworkers)
+		{
+			sinsp::get_checkpoints(infiles[j], &checkpoints);
+		}
+
+		shard.m_fileidx = j;
+		shard.m_start.offset = 0;
+		shard.m_start.ts = 0;
+		shard.m_start.nevts = 0;
+		shard.m_start.nstateevts = 0;
+		shard.m_chunk = !checkpoints.empty();
+		g_shards.push_back(shard);
+
+		for(auto& it : checkpoints)
+		{
+			shard.m_start = it;
+			g_shards.push_back(shard);
+		}
+	}
+}
+
+static void start_shard_workers(uint32_t nworkers, uint32_t nshards)
+{
+	int jobs[2];
+
+	if(pipe(jobs) != 0)
+	{
+		throw sinsp_exception(string("can't create pipe: ") + strerror(errno));
+	}
+
+	//
+	// Anything buffered would be printed by every worker
+	//
+	cout << flush;
+	fflush(stdout);
+	fflush(stderr);
+
+	for(uint32_t j = 1; j < nworkers; j++)
+	{
+		int results[2];
+
+		if(pipe(results) != 0)
+		{
+			throw sinsp_exception(string("can't create pipe: ") + strerror(errno));
+		}
+
+		pid_t pid = fork();
+
+		if(pid < 0)
+		{
+			close(results[0]);
+			close(results[1]);
+			break;
+		}
+		else if(pid == 0)
+		{
+			close(jobs[1]);
+			close(results[0]);
+			for(uint32_t k = 0; k < g_shard_workers.size(); k++)
+			{
+				close(g_shard_workers[k].second);
+			}
+			g_shard_workers.clear();
+
+			g_is_shard_worker = true;
+			g_first_shard_taken = true;
+			g_shard_jobs_fd = jobs[0];
+			g_shard_result_fd = results[1];
+			g_shards_enabled = true;
+			return;
+		}
+
+		close(results[1]);
+		g_shard_workers.push_back(pair<pid_t, int>(pid, results[0]));
+	}
+
+	for(uint32_t j = 1; j < nshards; j++)
+	{
+		write_all(jobs[1], (const char*)&j, sizeof(j));
+	}
+
+	close(jobs[1]);
+
+	g_shard_jobs_fd = jobs[0];
+	g_shards_enabled = true;
+}
+
+static bool next_shard(OUT uint32_t* shardidx)
+{
+	if(!g_first_shard_taken)
+	{
+		g_first_shard_taken = true;
+		*shardidx = 0;
+		return true;
+	}
+
+	while(!g_terminate)
+	{
+		//
+		// Writes and reads of less than PIPE_BUF bytes are atomic, so
+		// the workers can't get a partial index
+		//
+		ssize_t res = read(g_shard_jobs_fd, shardidx, sizeof(*shardidx));
+
+		if(res == sizeof(*shardidx))
+		{
+			return true;
+		}
+		else if(res < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		break;
+	}
+
+	return false;
+}
+
+//
+// Worker side: send the partial results of the chisels to the parent
+//
+static void send_shard_results(int32_t res)
+{
+	Json::Value root;
+	Json::FastWriter writer;
+
+	root["res"] = res;
+	root["chisels"] = Json::Value(Json::arrayValue);
+
+	try
+	{
+		for(uint32_t j = 0; j < g_chisels.size(); j++)
+		{
+			Json::Value chres;
+			g_chisels[j]->get_mergeable_result(&chres);
+			root["chisels"].append(chres);
+		}
+	}
+	catch(sinsp_exception& e)
+	{
+		cerr << e.what() << endl;
+		root["res"] = EXIT_FAILURE;
+		root["chisels"] = Json::Value(Json::arrayValue);
+	}
+
+	string data = writer.write(root);
+
+	try
+	{
+		write_all(g_shard_result_fd, data.c_str(), data.size());
+	}
+	catch(sinsp_exception& e)
+	{
+		cerr << e.what() << endl;
+	}
+
+	close(g_shard_result_fd);
+}
+
+//
+// Parent side: wait for the workers and merge their results into our chisels.
+// Returns false if any of the workers failed.
+//
+static bool merge_shard_results()
+{
+	vector<string> data(g_shard_workers.size());
+	vector<bool> done(g_shard_workers.size(), false);
+	uint32_t ndone = 0;
+	bool success = true;
+	char buf[16384];
+
+	close(g_shard_jobs_fd);
+	g_shard_jobs_fd = -1;
+
+	//
+	// The results can be bigger than the pipe buffer, so read them as they
+	// come instead of waiting for the workers in order.
+	//
+	while(ndone < g_shard_workers.size())
+	{
+		vector<struct pollfd> fds;
+		vector<uint32_t> fd_workers;
+
+		for(uint32_t j = 0; j < g_shard_workers.size(); j++)
+		{
+			if(!done[j])
+			{
+				struct pollfd pfd;
+				pfd.fd = g_shard_workers[j].second;
+				pfd.events = POLLIN;
+				pfd.revents = 0;
+				fds.push_back(pfd);
+				fd_workers.push_back(j);
+			}
+		}
+
+		if(poll(&fds[0], fds.size(), -1) < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		for(uint32_t k = 0; k < fds.size(); k++)
+		{
+			if(fds[k].revents == 0)
+			{
+				continue;
+			}
+
+			ssize_t res = read(fds[k].fd, buf, sizeof(buf));
+			if(res > 0)
+			{
+				data[fd_workers[k]].append(buf, res);
+			}
+			else if(res == 0 || errno != EINTR)
+			{
+				done[fd_workers[k]] = true;
+				ndone++;
+			}
+		}
+	}
+
+	for(uint32_t j = 0; j < g_shard_workers.size(); j++)
+	{
+		int status;
+		Json::Value root;
+		Json::Reader reader;
+
+		close(g_shard_workers[j].second);
+		while(waitpid(g_shard_workers[j].first, &status, 0) < 0 && errno == EINTR);
+
+		if(!reader.parse(data[j], root, false) ||
+			!root.isObject() ||
+			root["chisels"].size() != g_chisels.size())
+		{
+			fprintf(stderr, "worker process %d failed\n", (int)g_shard_workers[j].first);
+			success = false;
+			continue;
+		}
+
+		if(root["res"].asInt() != EXIT_SUCCESS)
+		{
+			success = false;
+		}
+
+		for(uint32_t k = 0; k < g_chisels.size(); k++)
+		{
+			g_chisels[k]->merge_result(root["chisels"][k]);
+		}
+	}
+
+	g_shard_workers.clear();
+	return success;
+}
+#endif // defined(HAS_CHISELS) && !defined(_WIN32)
+
 void handle_end_of_file(bool print_progress, sinsp_evt_formatter* formatter = NULL)
 {
 	string line;
@@ -517,11 +960,20 @@ void handle_end_of_file(bool print_progress, sinsp_evt_formatter* formatter = NU
 	}
 
 	//
-	// Notify the chisels that we're exiting.
+	// Notify the chisels that we're exiting. With --parallel, the chisels
+	// are told about the end of the capture only once, after merging the
+	// results of all the files.
 	//
 	try
 	{
-		chisels_on_capture_end();
+		if(g_shards_enabled)
+		{
+			chisels_on_shard_end();
+		}
+		else
+		{
+			chisels_on_capture_end();
+		}
 	}
 	catch(...)
 	{
@@ -772,14 +1224,19 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 	bool unbuf_flag = false;
 	bool filter_proclist_flag = false;
 	string cname;
+	bool list_chisels_flag = false;
 	vector<summary_table_entry> summary_table;
 	string* k8s_api = 0;
 	string* k8s_api_cert = 0;
 	string* mesos_api = 0;
 	bool force_tracers_capture = false;
 	bool page_faults = false;
+	uint32_t nshards = 1;
 	bool bpf = false;
 	string bpf_probe;
+	scap_hugepages_mode hugepages = SCAP_HUGEPAGES_NONE;
+	int32_t consumer_cpu = -1;
+	bool numa_local_alloc = false;
 	std::set<std::string> suppress_comms;
 #ifdef HAS_CAPTURE
 	string cri_socket_path;
@@ -794,24 +1251,33 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 	static struct option long_options[] =
 	{
 		{"print-ascii", no_argument, 0, 'A' },
+		{"async-log", no_argument, 0, 0 },
+		{"async-proc-lookups", required_argument, 0, 0 },
+		{"async-user-lookups", no_argument, 0, 0 },
 		{"print-base64", no_argument, 0, 'b' },
 		{"bpf", optional_argument, 0, 'B' },
+		{"binary-container-events", no_argument, 0, 0 },
 #ifdef HAS_CHISELS
 		{"chisel", required_argument, 0, 'c' },
 		{"list-chisels", no_argument, 0, 0 },
+		{"no-chisel-cache", no_argument, 0, 0 },
 #endif
+		{"checkpoint-interval", required_argument, 0, 0 },
 #ifdef HAS_CAPTURE
 		{"cri", required_argument, 0, 0 },
 		{"cri-timeout", required_argument, 0, 0 },
 #endif
+		{"cpu-affinity", required_argument, 0, 0 },
 		{"displayflt", no_argument, 0, 'd' },
 		{"debug", no_argument, 0, 'D'},
+		{"dump-from-state", no_argument, 0, 0 },
 		{"exclude-users", no_argument, 0, 'E' },
 		{"event-limit", required_argument, 0, 'e'},
 		{"fatfile", no_argument, 0, 'F'},
 		{"filter-proclist", no_argument, 0, 0 },
 		{"seconds", required_argument, 0, 'G' },
 		{"help", no_argument, 0, 'h' },
+		{"hugepages", required_argument, 0, 0 },
 #ifdef HAS_CHISELS
 		{"chisel-info", required_argument, 0, 'i' },
 #endif
@@ -825,7 +1291,10 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 		{"list-markdown", no_argument, 0, 0 },
 		{"mesos-api", required_argument, 0, 'm'},
 		{"numevents", required_argument, 0, 'n' },
+		{"numa-local-alloc", no_argument, 0, 0 },
+		{"unordered", no_argument, 0, 0 },
 		{"page-faults", no_argument, 0, 0 },
+		{"parallel", required_argument, 0, 0 },
 		{"progress", required_argument, 0, 'P' },
 		{"print", required_argument, 0, 'p' },
 		{"quiet", no_argument, 0, 'q' },
@@ -907,16 +1376,14 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 					string chisel = optarg;
 					if(chisel == "l")
 					{
-						vector<chisel_desc> chlist;
-						sinsp_chisel::get_chisel_list(&chlist);
-						list_chisels(&chlist, true);
-						delete inspector;
-						return sysdig_init_res(EXIT_SUCCESS);
+						list_chisels_flag = true;
+					}
+					else
+					{
+						sinsp_chisel* ch = new sinsp_chisel(inspector, chisel);
+						parse_chisel_args(ch, inspector, optind, argc, argv, &n_filterargs);
+						g_chisels.push_back(ch);
 					}
-
-					sinsp_chisel* ch = new sinsp_chisel(inspector, chisel);
-					parse_chisel_args(ch, inspector, optind, argc, argv, &n_filterargs);
-					g_chisels.push_back(ch);
 				}
 #endif
 				break;
@@ -965,24 +1432,7 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 #ifdef HAS_CHISELS
 			// --chisel-info and -i
 			case 'i':
-				{
-					cname = optarg;
-					vector<chisel_desc> chlist;
-
-					sinsp_chisel::get_chisel_list(&chlist);
-
-					for(uint32_t j = 0; j < chlist.size(); j++)
-					{
-						if(chlist[j].m_name == cname)
-						{
-							print_chisel_info(&chlist[j]);
-							delete inspector;
-							return sysdig_init_res(EXIT_SUCCESS);
-						}
-					}
-
-					throw sinsp_exception("chisel " + cname + " not found - use -cl to list them.");
-				}
+				cname = optarg;
 				break;
 #endif
 
@@ -1191,11 +1641,10 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 						return sysdig_init_res(EXIT_SUCCESS);
 					}
 					else if (optname == "list-chisels") {
-						vector<chisel_desc> chlist;
-						sinsp_chisel::get_chisel_list(&chlist);
-						list_chisels(&chlist, true);
-						delete inspector;
-						return sysdig_init_res(EXIT_SUCCESS);
+						list_chisels_flag = true;
+					}
+					else if (optname == "no-chisel-cache") {
+						sinsp_chisel::set_catalog_cache_file("");
 					}
 #ifdef HAS_CAPTURE
 					else if (optname == "cri") {
@@ -1205,14 +1654,58 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 						inspector->set_cri_timeout(sinsp_numparser::parsed64(optarg));
 					}
 #endif
+					else if (optname == "cpu-affinity") {
+						consumer_cpu = sinsp_numparser::parsed32(optarg);
+					}
+					else if (optname == "numa-local-alloc") {
+						numa_local_alloc = true;
+					}
+					else if (optname == "unordered") {
+						inspector->set_unordered_consumption(true);
+					}
+					else if (optname == "binary-container-events") {
+						inspector->set_binary_container_evts(true);
+					}
+					else if (optname == "async-log") {
+						inspector->set_log_async(true);
+					}
+					else if (optname == "async-proc-lookups") {
+						inspector->set_async_proc_lookups(sinsp_numparser::parseu32(optarg));
+					}
+					else if (optname == "async-user-lookups") {
+						inspector->set_async_user_lookups(true);
+					}
 					else if (optname == "unbuffered") {
 						unbuf_flag = true;
 					}
 
+					else if (optname == "dump-from-state") {
+						inspector->set_autodump_from_state(true);
+					}
+
+					else if (optname == "checkpoint-interval") {
+						inspector->set_checkpoint_interval(sinsp_numparser::parseu64(optarg) * ONE_SECOND_IN_NS);
+					}
+
 					else if (optname == "filter-proclist") {
 						filter_proclist_flag = true;
 					}
 
+					else if (optname == "hugepages") {
+						if(string(optarg) == "transparent")
+						{
+							hugepages = SCAP_HUGEPAGES_TRANSPARENT;
+						}
+						else if(string(optarg) == "explicit")
+						{
+							hugepages = SCAP_HUGEPAGES_EXPLICIT;
+						}
+						else
+						{
+							throw sinsp_exception(string("invalid hugepages mode ") + optarg);
+						}
+					}
+
 					else if (optname == "large-environment") {
 						inspector->set_large_envs(true);
 					}
@@ -1225,6 +1718,10 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 					else if (optname == "page-faults") {
 						page_faults = true;
 					}
+
+					else if (optname == "parallel") {
+						nshards = sinsp_numparser::parseu32(optarg);
+					}
 				}
 				break;
             // getopt_long : '?' for an ambiguous match or an extraneous parameter
@@ -1237,6 +1734,40 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 			}
 		}
 
+#ifdef HAS_CHISELS
+		//
+		// The chisels are listed once all the options are parsed, so that
+		// --no-chisel-cache works wherever it is on the command line
+		//
+		if(list_chisels_flag)
+		{
+			vector<chisel_desc> chlist;
+			sinsp_chisel::get_chisel_list(&chlist);
+			list_chisels(&chlist, true);
+			delete inspector;
+			return sysdig_init_res(EXIT_SUCCESS);
+		}
+
+		if(!cname.empty())
+		{
+			vector<chisel_desc> chlist;
+
+			sinsp_chisel::get_chisel_list(&chlist);
+
+			for(uint32_t j = 0; j < chlist.size(); j++)
+			{
+				if(chlist[j].m_name == cname)
+				{
+					print_chisel_info(&chlist[j]);
+					delete inspector;
+					return sysdig_init_res(EXIT_SUCCESS);
+				}
+			}
+
+			throw sinsp_exception("chisel " + cname + " not found - use -cl to list them.");
+		}
+#endif
+
 #ifdef HAS_CAPTURE
 		if(!cri_socket_path.empty())
 		{
@@ -1259,6 +1790,9 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 			inspector->set_bpf_probe(bpf_probe);
 		}
 
+		inspector->set_hugepages(hugepages);
+		inspector->set_consumer_placement(consumer_cpu, numa_local_alloc);
+
 		//
 		// If -j was specified the event_buffer_format must be rewritten to account for it
 		//
@@ -1391,8 +1925,58 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 			}
 		}
 
-		for(uint32_t j = 0; j < infiles.size() || infiles.size() == 0; j++)
+#if defined(HAS_CHISELS) && !defined(_WIN32)
+		//
+		// Split the files across multiple processes if requested and
+		// possible. The chisels need to be initialized to know if they
+		// can merge their results, since they can replace themselves with
+		// another chisel (e.g. table_generator) in on_init().
+		//
+		if(nshards > 1 && !infiles.empty() && !g_chisels.empty())
 		{
+			if(outfile != "" || !summary_table.empty() || cnt != (uint64_t)-1 ||
+				duration_to_tot != 0 || print_progress)
+			{
+				fprintf(stderr, "--parallel can't be used with -w, -S, -n, -M or -P, processing the files sequentially\n");
+			}
+			else
+			{
+				initialize_chisels();
+
+				if(chisels_are_mergeable())
+				{
+					build_shards(infiles, nshards);
+
+					if(g_shards.size() > 1)
+					{
+						start_shard_workers(min(nshards, (uint32_t)g_shards.size()), g_shards.size());
+					}
+				}
+			}
+		}
+#endif
+
+		for(uint32_t j = 0; j < infiles.size() || infiles.size() == 0 || g_shards_enabled; j++)
+		{
+			uint32_t fileidx = j;
+
+#if defined(HAS_CHISELS) && !defined(_WIN32)
+			shard_info* shard = NULL;
+
+			if(g_shards_enabled)
+			{
+				uint32_t shardidx;
+
+				if(!next_shard(&shardidx))
+				{
+					break;
+				}
+
+				shard = &g_shards[shardidx];
+				fileidx = shard->m_fileidx;
+			}
+#endif
+
 #ifdef HAS_FILTERING
 			if(filter.size() && !is_filter_display)
 			{
@@ -1425,7 +2009,18 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 				//
 				// We have a file to open
 				//
-				inspector->open(infiles[j]);
+#if defined(HAS_CHISELS) && !defined(_WIN32)
+				if(shard != NULL && shard->m_chunk)
+				{
+					inspector->open_at_checkpoint(infiles[fileidx], shard->m_start, true);
+				}
+				else
+				{
+					inspector->open(infiles[fileidx]);
+				}
+#else
+				inspector->open(infiles[fileidx]);
+#endif
 			}
 			else
 			{
@@ -1614,6 +2209,37 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 					cstats.n_drops,
 					cstats.n_suppressed);
 
+				if(inspector->is_live())
+				{
+					fprintf(stderr, "Consumer CPU:%" PRId32 "%s, NUMA node:%" PRId32 "%s\nLocal Rings:%" PRIu32 ", Remote Rings:%" PRIu32 "\n",
+						cstats.consumer_cpu,
+						cstats.consumer_pinned ? " (pinned)" : "",
+						cstats.consumer_node,
+						cstats.consumer_local_alloc ? " (local alloc)" : "",
+						cstats.n_rings_local,
+						cstats.n_rings_remote);
+				}
+
+				sinsp_proc_lookup_stats lstats;
+				inspector->get_proc_lookup_stats(&lstats);
+
+				if(lstats.m_n_requested != 0)
+				{
+					uint64_t ncompleted = lstats.m_n_requested - lstats.m_n_pending;
+
+					fprintf(stderr, "Async Proc Lookups:%" PRIu64 " (merged:%" PRIu64 ", failed:%" PRIu64 ", discarded:%" PRIu64 ", pending:%" PRIu64 ")\n",
+						lstats.m_n_requested,
+						lstats.m_n_merged,
+						lstats.m_n_failed,
+						lstats.m_n_discarded,
+						lstats.m_n_pending);
+					fprintf(stderr, "Proc Lookup Time: avg %.3lfms, max %.3lfms, Wait: avg %.3lfms, max %.3lfms\n",
+						ncompleted ? (double)lstats.m_lookup_ns_total / ncompleted / 1000000 : 0,
+						(double)lstats.m_lookup_ns_max / 1000000,
+						ncompleted ? (double)lstats.m_wait_ns_total / ncompleted / 1000000 : 0,
+						(double)lstats.m_wait_ns_max / 1000000);
+				}
+
 				fprintf(stderr, "Elapsed time: %.3lf, Captured Events: %" PRIu64 ", %.2lf eps\n",
 					duration,
 					cinfo.m_nevts,
@@ -1643,6 +2269,39 @@ sysdig_init_res sysdig_init(int argc, char **argv)
 	}
 
 exit:
+#if defined(HAS_CHISELS) && !defined(_WIN32)
+	if(g_is_shard_worker)
+	{
+		//
+		// Workers are done once their results are sent. Skip the
+		// cleanup, in particular anything that could print.
+		//
+		send_shard_results(res.m_res);
+		cout << flush;
+		fflush(stdout);
+		_exit(res.m_res);
+	}
+	else if(g_shards_enabled)
+	{
+		try
+		{
+			if(!merge_shard_results() && res.m_res == EXIT_SUCCESS)
+			{
+				res.m_res = EXIT_FAILURE;
+			}
+
+			chisels_on_capture_end();
+		}
+		catch(sinsp_exception& e)
+		{
+			cerr << e.what() << endl;
+			res.m_res = EXIT_FAILURE;
+		}
+
+		g_shards_enabled = false;
+	}
+#endif
+
 	//
 	// If any of the chisels is requesting another run,
 	//